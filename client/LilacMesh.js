@@ -37,6 +37,26 @@
  * 
  * There is also an internal "_dirty" flag that stores whether the mesh
  * has changed.  See "isDirty()" for more information.
+ * 
+ * The triangles are also indexed so that edits do not need to examine
+ * every triangle.  "_edges" is an object that maps each ordered edge of
+ * every triangle to the triangle array that contains it, where the
+ * property name is the UID of the edge's first point, a colon, and the
+ * UID of its second point.  "_ptris" is an object that maps each point
+ * UID to an array of references to the triangle arrays that use the
+ * point.  Both must be updated whenever a triangle is added or dropped,
+ * which is handled by "_insertTri()" and "_removeTri()".
+ * 
+ * Finally, there is an internal spatial index of the points so that
+ * closestPoint() does not need to examine every point.  The normalized
+ * image area is divided into a uniform grid of "_gridDim" by "_gridDim"
+ * square cells.  "_grid" is an array with one element per cell in
+ * row-major order, where each element is either null or an array of
+ * references to the point objects located within that cell.  The grid
+ * must be updated whenever a point is added, moved, or dropped.  The
+ * grid starts out small and is rebuilt with a finer grid whenever the
+ * number of points grows too large for the current dimension, so that
+ * the expected number of points per cell stays bounded.
  */
 
 /*
@@ -55,6 +75,9 @@ function LilacMesh() {
   this._points = [];
   this._tris = [];
   this._dirty = false;
+  this._edges = {};
+  this._ptris = {};
+  this._gridBuild(LilacMesh._GRID_MIN_DIM);
 }
 
 /*
@@ -67,6 +90,25 @@ function LilacMesh() {
  */
 LilacMesh.MAX_POINT_ID = 1073741823;
 
+/*
+ * Private constants
+ * =================
+ */
+
+/*
+ * The initial and maximum number of cells along each axis of the
+ * spatial grid.  The maximum must be the initial dimension multiplied by
+ * a power of two.
+ */
+LilacMesh._GRID_MIN_DIM = 16;
+LilacMesh._GRID_MAX_DIM = 256;
+
+/*
+ * The grid is rebuilt at double the dimension when the average number
+ * of points per cell would exceed this value.
+ */
+LilacMesh._GRID_LOAD = 2;
+
 /*
  * Private static functions
  * ========================
@@ -390,6 +432,23 @@ LilacMesh._decodePair = function(str, isNorm) {
   return result;
 };
 
+/*
+ * Get the property name of an ordered edge in the edge index.
+ * 
+ * Parameters:
+ * 
+ *   a : number(int) - the UID of the first point of the edge
+ * 
+ *   b : number(int) - the UID of the second point of the edge
+ * 
+ * Return:
+ * 
+ *   the property name of the edge
+ */
+LilacMesh._edgeKey = function(a, b) {
+  return (String(a) + ":" + String(b));
+};
+
 /*
  * Given the unique ID number of a point, locate that point within a
  * point array.
@@ -795,13 +854,123 @@ LilacMesh._verify = function(m) {
  * ==========================
  */
 
+/*
+ * Find where a triangle belongs in the triangle list.
+ * 
+ * Triangles are sorted by their first vertex and then by their second
+ * vertex.  The return value is the index of the first triangle in the
+ * list that does not come before a triangle starting with the given two
+ * vertices, or the length of the list if there is no such triangle.
+ * Since ordered edges are unique, if a triangle with those first two
+ * vertices is present, it is at the returned index.
+ * 
+ * Parameters:
+ * 
+ *   a : number(int) - the UID of the first vertex
+ * 
+ *   b : number(int) - the UID of the second vertex
+ * 
+ * Return:
+ * 
+ *   the index within the triangle list
+ */
+LilacMesh.prototype._seekTri = function(a, b) {
+  
+  var lbound, ubound;
+  var mid, t;
+  
+  // Perform a binary search over the half-open range [lbound, ubound)
+  lbound = 0;
+  ubound = this._tris.length;
+  while (lbound < ubound) {
+    mid = lbound + Math.floor((ubound - lbound) / 2);
+    t = this._tris[mid];
+    
+    if ((t[0] < a) || ((t[0] === a) && (t[1] < b))) {
+      // Midpoint comes before the triangle, so search above it
+      lbound = mid + 1;
+    } else {
+      // Midpoint does not come before the triangle, so search up to and
+      // including it
+      ubound = mid;
+    }
+  }
+  
+  return lbound;
+};
+
+/*
+ * Add a triangle array to the edge and point indices, or remove it.
+ * 
+ * Parameters:
+ * 
+ *   t : Array - the triangle array in the triangle list
+ * 
+ *   add : boolean - true to add the triangle, false to remove it
+ */
+LilacMesh.prototype._indexTri = function(t, add) {
+  
+  var func_name = "_indexTri";
+  var i, k, a;
+  
+  for(i = 0; i < 3; i++) {
+    // Update the ordered edge starting at this vertex
+    k = LilacMesh._edgeKey(t[i], t[(i + 1) % 3]);
+    if (add) {
+      if (k in this._edges) {
+        LilacMesh._fault(func_name, 100);
+      }
+      this._edges[k] = t;
+    } else {
+      if (this._edges[k] !== t) {
+        LilacMesh._fault(func_name, 110);
+      }
+      delete this._edges[k];
+    }
+    
+    // Update the triangle list of this vertex
+    a = this._ptris[t[i]];
+    if (add) {
+      if (a === undefined) {
+        this._ptris[t[i]] = [t];
+      } else {
+        a.push(t);
+      }
+    } else {
+      if ((a === undefined) || (a.indexOf(t) < 0)) {
+        LilacMesh._fault(func_name, 120);
+      }
+      if (a.length <= 1) {
+        delete this._ptris[t[i]];
+      } else {
+        a.splice(a.indexOf(t), 1);
+      }
+    }
+  }
+};
+
+/*
+ * Rebuild the edge and point indices from the triangle list.
+ */
+LilacMesh.prototype._indexBuild = function() {
+  
+  var i;
+  
+  this._edges = {};
+  this._ptris = {};
+  for(i = 0; i < this._tris.length; i++) {
+    this._indexTri(this._tris[i], true);
+  }
+};
+
 /*
  * Insert a triangle vertex array into the triangle list in the
  * appropriate triangle order.
  * 
  * This does not verify that the triangle array is valid beyond checking
- * that it has three integers; it simply inserts in the proper place in
- * the array
+ * that it has three integers and that none of its ordered edges are
+ * already in use; it simply inserts in the proper place in the array
+ * and adds the triangle to the edge and point indices
  * 
  * Parameters:
  * 
@@ -811,7 +980,7 @@ LilacMesh._verify = function(m) {
 LilacMesh.prototype._insertTri = function(ta) {
   
   var func_name = "_insertTri";
-  var i, j, t;
+  var i, t;
   
   // Check parameter
   if ((typeof ta !== "object") || (!(ta instanceof Array))) {
@@ -830,53 +999,180 @@ LilacMesh.prototype._insertTri = function(ta) {
     }
   }
   
-  // If triangle array is empty, just insert as the first element and
-  // go no further
-  if (this._tris.length < 1) {
-    this._tris.push([ta[0], ta[1], ta[2]]);
+  // Make a copy of the triangle and index it, which also checks that
+  // its ordered edges are unique
+  t = [ta[0], ta[1], ta[2]];
+  this._indexTri(t, true);
+  
+  // Insert it into the triangle list at its sorted position
+  this._tris.splice(this._seekTri(t[0], t[1]), 0, t);
+};
+
+/*
+ * Remove a triangle from the triangle list and from the edge and point
+ * indices.
+ * 
+ * Parameters:
+ * 
+ *   t : Array - the triangle array in the triangle list
+ */
+LilacMesh.prototype._removeTri = function(t) {
+  
+  var func_name = "_removeTri";
+  var i;
+  
+  // Find the triangle in the list
+  i = this._seekTri(t[0], t[1]);
+  if ((i >= this._tris.length) || (this._tris[i] !== t)) {
+    LilacMesh._fault(func_name, 100);
+  }
+  
+  // Remove it from the list and the indices
+  this._tris.splice(i, 1);
+  this._indexTri(t, false);
+};
+
+/*
+ * Get the index of the spatial grid cell containing a given normalized
+ * location.
+ * 
+ * Coordinates of exactly 1.0 are placed in the last cell along that
+ * axis.
+ * 
+ * Parameters:
+ * 
+ *   nx : number - the normalized X coordinate in range [0.0, 1.0]
+ * 
+ *   ny : number - the normalized Y coordinate in range [0.0, 1.0]
+ * 
+ * Return:
+ * 
+ *   the index of the cell in the grid array
+ */
+LilacMesh.prototype._gridCell = function(nx, ny) {
+  
+  var gx, gy;
+  
+  gx = Math.min(Math.floor(nx * this._gridDim), this._gridDim - 1);
+  gy = Math.min(Math.floor(ny * this._gridDim), this._gridDim - 1);
+  
+  return (gy * this._gridDim) + gx;
+};
+
+/*
+ * Add a point object to the spatial grid at its current location.
+ * 
+ * If the number of points in the mesh has grown too large for the
+ * current grid dimension, the whole grid is rebuilt at a finer
+ * dimension instead.  The point object must already be in the points
+ * array.
+ * 
+ * Parameters:
+ * 
+ *   p : object - the point object to add
+ */
+LilacMesh.prototype._gridAdd = function(p) {
+  
+  var c;
+  
+  // Rebuild with a finer grid if there are now too many points, which
+  // also indexes the new point
+  if ((this._gridDim < LilacMesh._GRID_MAX_DIM) &&
+      (this._points.length >
+        LilacMesh._GRID_LOAD * this._gridDim * this._gridDim)) {
+    this._gridBuild(this._gridDim * 2);
     return;
   }
   
-  // Otherwise, find the index i of the first element in the triangle
-  // list that is greater than the new triangle in the sorting order, or
-  // set i to one beyond the last element if new triangle should come at
-  // the end of the list
-  for(i = 0; i < this._tris.length; i++) {
-    // Get current triangle
-    t = this._tris[i];
-    
-    // Check whether current element is greater, in which case break
-    // here
-    if (t[0] > ta[0]) {
-      break;
-    } else if (t[0] === ta[0]) {
-      if (t[1] > ta[1]) {
-        break;
-      }
-    }
+  // Add the point to its cell
+  c = this._gridCell(p.x, p.y);
+  if (this._grid[c] === null) {
+    this._grid[c] = [p];
+  } else {
+    this._grid[c].push(p);
   }
+};
+
+/*
+ * Remove a point object from the spatial grid.
+ * 
+ * The point must still have the coordinates it had when it was added to
+ * the grid, or a fault occurs.
+ * 
+ * Parameters:
+ * 
+ *   p : object - the point object to remove
+ */
+LilacMesh.prototype._gridRemove = function(p) {
   
-  // If new triangle should be added to end of list, add it there and
-  // proceed no further
-  if (i >= this._tris.length) {
-    this._tris.push([ta[0], ta[1], ta[2]]);
-    return;
+  var func_name = "_gridRemove";
+  var c, a, i;
+  
+  // Find the point within its cell
+  c = this._gridCell(p.x, p.y);
+  a = this._grid[c];
+  if (a === null) {
+    LilacMesh._fault(func_name, 100);
   }
   
-  // If we got here, i is the index of the element in the triangle
-  // array before which we should insert the new triangle, so begin by
-  // duplicating the last element at the end of the list
-  this._tris.push(this._tris[this._tris.length - 1]);
+  i = a.indexOf(p);
+  if (i < 0) {
+    LilacMesh._fault(func_name, 110);
+  }
   
-  // Starting at the second to last element and working back to and
-  // including i, shift all triangles in the list right by one
-  for(j = this._tris.length - 2; j >= i; j--) {
-    this._tris[j + 1] = this._tris[j];
+  // Remove it, releasing the cell array if it is now empty
+  if (a.length <= 1) {
+    this._grid[c] = null;
+  } else {
+    a.splice(i, 1);
+  }
+};
+
+/*
+ * Rebuild the spatial grid from the points array.
+ * 
+ * The requested dimension is increased if necessary so that the grid is
+ * not overloaded with the current number of points, up to the maximum
+ * dimension.
+ * 
+ * Parameters:
+ * 
+ *   dim : number(int) - the minimum number of cells along each axis
+ */
+LilacMesh.prototype._gridBuild = function(dim) {
+  
+  var func_name = "_gridBuild";
+  var i, c, p;
+  
+  // Check parameter
+  if ((typeof dim !== "number") || (!isFinite(dim)) ||
+      (Math.floor(dim) !== dim) || (dim < 1)) {
+    LilacMesh._fault(func_name, 100);
+  }
+  
+  // Choose the dimension
+  while ((dim < LilacMesh._GRID_MAX_DIM) &&
+          (this._points.length > LilacMesh._GRID_LOAD * dim * dim)) {
+    dim = dim * 2;
+  }
+  
+  // Blank the grid
+  this._gridDim = dim;
+  this._grid = [];
+  for(i = 0; i < dim * dim; i++) {
+    this._grid.push(null);
   }
   
-  // We can now insert the new element at index i, which is currently a
-  // duplicate of i + 1
-  this._tris[i] = [ta[0], ta[1], ta[2]];
+  // Add all the points
+  for(i = 0; i < this._points.length; i++) {
+    p = this._points[i];
+    c = this._gridCell(p.x, p.y);
+    if (this._grid[c] === null) {
+      this._grid[c] = [p];
+    } else {
+      this._grid[c].push(p);
+    }
+  }
 };
 
 /*
@@ -1049,6 +1345,10 @@ LilacMesh.prototype.fromJSON = function(str) {
     ]);
   }
   
+  // Index the new triangles and points
+  this._indexBuild();
+  this._gridBuild(LilacMesh._GRID_MIN_DIM);
+  
   // Clear the dirty flag
   this._dirty = false;
   
@@ -1543,7 +1843,7 @@ LilacMesh.prototype.setPoint = function(uid, nx, ny) {
   
   var func_name = "setPoint";
   var i, k;
-  var p, t;
+  var p, t, tl;
   var a, b, c;
   
   // Check parameters
@@ -1581,16 +1881,17 @@ LilacMesh.prototype.setPoint = function(uid, nx, ny) {
   // Get the point
   p = this._points[p];
   
-  // Go through all triangles to check orientation with new location
-  for(i = 0; i < this._tris.length; i++) {
+  // Get the triangles that use this point
+  tl = this._ptris[uid];
+  if (tl === undefined) {
+    tl = [];
+  }
+  
+  // Go through those triangles to check orientation with new location
+  for(i = 0; i < tl.length; i++) {
     
     // Get current triangle array
-    t = this._tris[i];
-    
-    // Ignore this triangle if current point not in it
-    if ((t[0] !== uid) && (t[1] !== uid) && (t[2] !== uid)) {
-      continue;
-    }
+    t = tl[i];
     
     // Get the index of the three vertices in the points array, except
     // set the point that matches the current point to true
@@ -1658,9 +1959,17 @@ LilacMesh.prototype.setPoint = function(uid, nx, ny) {
   }
   
   // If we got here, new position is fine, so update coordinates and
-  // return true and also set dirty flag
-  p.x = nx;
-  p.y = ny;
+  // return true and also set dirty flag; if the point changes cells,
+  // it must be moved in the spatial grid
+  if (this._gridCell(p.x, p.y) !== this._gridCell(nx, ny)) {
+    this._gridRemove(p);
+    p.x = nx;
+    p.y = ny;
+    this._gridAdd(p);
+  } else {
+    p.x = nx;
+    p.y = ny;
+  }
   this._dirty = true;
   return true;
 };
@@ -1759,7 +2068,9 @@ LilacMesh.prototype.closestPoint = function(nx, ny) {
   
   var func_name = "closestPoint";
   var nearest, nearest_len;
-  var i;
+  var i, k, r;
+  var gx, gy, x, y;
+  var a, p;
   var pl;
   var xd, yd;
   
@@ -1781,27 +2092,71 @@ LilacMesh.prototype.closestPoint = function(nx, ny) {
   nx = Math.max(nx, 0);
   ny = Math.max(ny, 0);
   
-  // Find the nearest point
+  // If there are no points, there is no nearest point
+  if (this._points.length < 1) {
+    return false;
+  }
+  
+  // Get the grid cell containing the location
+  gx = Math.min(Math.floor(nx * this._gridDim), this._gridDim - 1);
+  gy = Math.min(Math.floor(ny * this._gridDim), this._gridDim - 1);
+  
+  // Search square rings of cells at increasing distance around that
+  // cell; any point outside the first r rings is more than (r - 1) cell
+  // widths away from the location, so we can stop as soon as the
+  // nearest point found is closer than that
   nearest = false;
   nearest_len = false;
-  for(i = 0; i < this._points.length; i++) {
-    // Compute the square of the current point distance
-    xd = this._points[i].x - nx;
-    yd = this._points[i].y - ny;
-    pl = (xd * xd) + (yd * yd);
-    
-    // Update nearest if appropriate
-    if (nearest === false) {
-      // This is first point, so store in nearest
-      nearest = this._points[i].uid;
-      nearest_len = pl;
+  for(r = 0; r < this._gridDim; r++) {
+    // Stop if no unsearched point can be closer
+    if ((nearest !== false) && (r > 0)) {
+      pl = (r - 1) / this._gridDim;
+      if (nearest_len < pl * pl) {
+        break;
+      }
+    }
+    
+    // Search each cell on the ring that is within the grid; the top and
+    // bottom rows of the ring are searched in full, while the other
+    // rows only have a cell at each end
+    for(y = gy - r; y <= gy + r; y++) {
+      if ((y < 0) || (y >= this._gridDim)) {
+        continue;
+      }
       
-    } else {
-      // Not first point, so compare to current nearest distance
-      if (pl < nearest_len) {
-        // Closer, so store this point
-        nearest = this._points[i].uid;
-        nearest_len = pl;
+      if ((y === gy - r) || (y === gy + r)) {
+        k = 1;
+      } else {
+        k = 2 * r;
+      }
+      
+      for(x = gx - r; x <= gx + r; x += k) {
+        if ((x < 0) || (x >= this._gridDim)) {
+          continue;
+        }
+        
+        // Get the points in this cell, skipping empty cells
+        a = this._grid[(y * this._gridDim) + x];
+        if (a === null) {
+          continue;
+        }
+        
+        for(i = 0; i < a.length; i++) {
+          // Compute the square of the current point distance
+          p = a[i];
+          xd = p.x - nx;
+          yd = p.y - ny;
+          pl = (xd * xd) + (yd * yd);
+          
+          // Update nearest if this is the first point, or it is closer,
+          // or it is equally close with a lower UID, so that the result
+          // does not depend on the order of points within the grid
+          if ((nearest === false) || (pl < nearest_len) ||
+              ((pl === nearest_len) && (p.uid < nearest))) {
+            nearest = p.uid;
+            nearest_len = pl;
+          }
+        }
       }
     }
   }
@@ -1931,6 +2286,7 @@ LilacMesh.prototype.addIndependent = function(pa) {
   }
   
   // OK, we can define the points now, so add them to the points array
+  // and the spatial grid
   this._points.push({
     "uid": base_uid,
     "normd": 0,
@@ -1938,6 +2294,7 @@ LilacMesh.prototype.addIndependent = function(pa) {
     "x": pa[0][0],
     "y": pa[0][1]
   });
+  this._gridAdd(this._points[this._points.length - 1]);
   
   this._points.push({
     "uid": base_uid + 1,
@@ -1946,6 +2303,7 @@ LilacMesh.prototype.addIndependent = function(pa) {
     "x": pa[1][0],
     "y": pa[1][1]
   });
+  this._gridAdd(this._points[this._points.length - 1]);
   
   this._points.push({
     "uid": base_uid + 2,
@@ -1954,6 +2312,7 @@ LilacMesh.prototype.addIndependent = function(pa) {
     "x": pa[2][0],
     "y": pa[2][1]
   });
+  this._gridAdd(this._points[this._points.length - 1]);
   
   // Add a triangle, obeying the should_flip setting we determined
   if (should_flip) {
@@ -2117,6 +2476,7 @@ LilacMesh.prototype.addPivot = function(pivot, pn) {
   }
   
   // OK, we can define the points now, so add them to the points array
+  // and the spatial grid
   this._points.push({
     "uid": base_uid,
     "normd": 0,
@@ -2124,6 +2484,7 @@ LilacMesh.prototype.addPivot = function(pivot, pn) {
     "x": pn[0][0],
     "y": pn[0][1]
   });
+  this._gridAdd(this._points[this._points.length - 1]);
   
   this._points.push({
     "uid": base_uid + 1,
@@ -2132,6 +2493,7 @@ LilacMesh.prototype.addPivot = function(pivot, pn) {
     "x": pn[1][0],
     "y": pn[1][1]
   });
+  this._gridAdd(this._points[this._points.length - 1]);
   
   // Add a triangle, obeying the should_flip setting we determined
   if (should_flip) {
@@ -2206,7 +2568,7 @@ LilacMesh.prototype.addExtend = function(ep1, ep2, nx, ny) {
   
   var func_name = "addExtend";
   var p1, p2;
-  var i, k, t;
+  var k;
   var ip1, ip2;
   var should_flip;
   var result;
@@ -2291,14 +2653,8 @@ LilacMesh.prototype.addExtend = function(ep1, ep2, nx, ny) {
   
   // Verify that no existing triangle already has the ordered edge from
   // the two existing points
-  for(i = 0; i < this._tris.length; i++) {
-    t = this._tris[i];
-    
-    if (((ip1 === t[0]) && (ip2 === t[1])) ||
-        ((ip1 === t[1]) && (ip2 === t[2])) ||
-        ((ip1 === t[2]) && (ip2 === t[0]))) {
-      return false;
-    }
+  if (LilacMesh._edgeKey(ip1, ip2) in this._edges) {
+    return false;
   }
   
   // If points array currently empty, base UID is one; else, base UID is
@@ -2315,6 +2671,7 @@ LilacMesh.prototype.addExtend = function(ep1, ep2, nx, ny) {
   }
   
   // OK, we can define the new point now, so add it to the points array
+  // and the spatial grid
   this._points.push({
     "uid": base_uid,
     "normd": 0,
@@ -2322,6 +2679,7 @@ LilacMesh.prototype.addExtend = function(ep1, ep2, nx, ny) {
     "x": nx,
     "y": ny
   });
+  this._gridAdd(this._points[this._points.length - 1]);
   
   // Add a triangle, obeying the should_flip setting we determined
   if (should_flip) {
@@ -2355,10 +2713,11 @@ LilacMesh.prototype.addExtend = function(ep1, ep2, nx, ny) {
  * colinear, this function will fail, not add the triangle, and return
  * false.
  * 
- * This function will also check that the triangle is not already
- * present in the mesh, after the triangle has been correctly oriented.
- * If it is already present, this function will fail, not add the
- * duplicate triangle, and return false.
+ * This function will also check that none of the ordered edges of the
+ * triangle, after the triangle has been correctly oriented, are used in
+ * any existing triangle.  This includes the case where the triangle is
+ * already present in the mesh.  If any are used, this function will
+ * fail, not add the triangle, and return false.
  * 
  * Parameters:
  * 
@@ -2375,7 +2734,7 @@ LilacMesh.prototype.addExtend = function(ep1, ep2, nx, ny) {
 LilacMesh.prototype.addFill = function(v1, v2, v3) {
   
   var func_name = "addFill";
-  var x, k, t, i;
+  var x, k;
   var p1, p2, p3;
   
   // Check parameters
@@ -2454,15 +2813,12 @@ LilacMesh.prototype.addFill = function(v1, v2, v3) {
     return false;
   }
   
-  // Verify that triangle not already in mesh
-  for(i = 0; i < this._tris.length; i++) {
-    // Get current triangle
-    t = this._tris[i];
-    
-    // Fail if current triangle equal to new triangle
-    if ((v1 === t[0]) && (v2 === t[1]) && (v3 === t[2])) {
-      return false;
-    }
+  // Verify that no ordered edge of the triangle is already in the mesh,
+  // which also ensures the triangle is not already in the mesh
+  if ((LilacMesh._edgeKey(v1, v2) in this._edges) ||
+      (LilacMesh._edgeKey(v2, v3) in this._edges) ||
+      (LilacMesh._edgeKey(v3, v1) in this._edges)) {
+    return false;
   }
   
   // If we got here, add the new triangle and return true, and also set
@@ -2496,8 +2852,8 @@ LilacMesh.prototype.addFill = function(v1, v2, v3) {
 LilacMesh.prototype.dropTriangle = function(v1, v2, v3) {
   
   var func_name = "dropTriangle";
-  var pa, pb, pu;
-  var i, j, t, k;
+  var pa;
+  var j, t, k;
   
   // Check parameters
   if ((typeof v1 !== "number") ||
@@ -2526,62 +2882,26 @@ LilacMesh.prototype.dropTriangle = function(v1, v2, v3) {
   pa = [v1, v2, v3];
   pa.sort(LilacMesh._numericCmp);
   
-  // Initialize point-used array with false values
-  pu = [false, false, false];
-  
-  // Scan the triangle list
-  j = false;
-  for(i = 0; i < this._tris.length; i++) {
-    // Get current triangle
-    t = this._tris[i];
-    
-    // Put the current vertices in an array and sort by UID
-    pb = [t[0], t[1], t[2]];
-    pb.sort(LilacMesh._numericCmp);
-    
-    // Check whether current triangle is a match
-    if ((pb[0] === pa[0]) && (pb[1] === pa[1]) &&
-        (pb[2] === pa[2])) {
-      // Match, so set j to the index of this triangle
-      j = i;
-      
-    } else {
-      // Not a match, so see if any of our points are in use and update
-      // point-use list appropriately
-      for(k = 0; k < 3; k++) {
-        if ((pa[k] === pb[0]) ||
-            (pa[k] === pb[1]) ||
-            (pa[k] === pb[2])) {
-          pu[k] = true;
-        }
-      }
+  // The triangle always starts with the lowest UID, followed by either
+  // of the other two points depending on its orientation, so look up
+  // both possible ordered edges from the first point
+  t = this._edges[LilacMesh._edgeKey(pa[0], pa[1])];
+  if ((t === undefined) || (t[2] !== pa[2])) {
+    t = this._edges[LilacMesh._edgeKey(pa[0], pa[2])];
+    if ((t !== undefined) && (t[2] !== pa[1])) {
+      t = undefined;
     }
   }
   
   // Only proceed if we found the triangle to drop
-  if (j !== false) {
+  if (t !== undefined) {
     // Remove triangle from list
-    if (j >= this._tris.length - 1) {
-      // Triangle is last element in list, so just pop it from end of
-      // list
-      this._tris.pop();
-      
-    } else {
-      // Triangle is not last element in list, so starting at element
-      // and going up to and including second to last element, shift
-      // everything left
-      for(i = j; i < this._tris.length - 1; i++) {
-        this._tris[i] = this._tris[i + 1];
-      }
-      
-      // Pop the last element from the list, which is now a duplicate
-      this._tris.pop();
-    }
+    this._removeTri(t);
     
     // Drop any points that are no longer used from the point list
     for(k = 0; k < 3; k++) {
       // Skip current point if it is still used
-      if (pu[k]) {
+      if (pa[k] in this._ptris) {
         continue;
       }
       
@@ -2591,21 +2911,9 @@ LilacMesh.prototype.dropTriangle = function(v1, v2, v3) {
         LilacMesh._fault(func_name, 200);
       }
       
-      // Drop point from point list
-      if (j >= this._points.length - 1) {
-        // Point is last point in list, so pop
-        this._points.pop();
-      
-      } else {
-        // Point is not last point in list, so shift everything from
-        // index to second-to-last point left
-        for(i = j; i < this._points.length - 1; i++) {
-          this._points[i] = this._points[i + 1];
-        }
-        
-        // Pop the last point from the list, which is now a duplicate
-        this._points.pop();
-      }
+      // Drop point from spatial grid and point list
+      this._gridRemove(this._points[j]);
+      this._points.splice(j, 1);
     }
     
     // Set dirty flag
@@ -74,6 +74,15 @@
   var MIN_PORT_NUMBER = 1024;
   var MAX_PORT_NUMBER = 65535;
   
+  /*
+   * The delay in milliseconds between a change to the HTTP manifest
+   * file and reloading it.
+   * 
+   * Editors often save a file with several file system operations in a
+   * row, so the reload waits for them to settle.
+   */
+  var RELOAD_DELAY = 100;
+  
   /*
    * The HTML file that is served for "/shutdown"
    */
@@ -148,8 +157,21 @@
    *   "files" - JavaScript object interpreted as an associative array
    *   mapping case-sensitive file name strings (without the extension
    *   or a dot at the end, and containing only ASCII alphanumerics and
-   *   underscore) to Buffer objects containing the raw data to transmit
-   *   to the client
+   *   underscore) to file entry objects
+   * 
+   * File entry objects have four properties:
+   * 
+   *   "path" - the resolved path to the file on the local file system,
+   *   or false for files that the server generates in memory
+   * 
+   *   "data" - Buffer object containing the raw data to transmit to the
+   *   client, or false if the file has not been loaded yet
+   * 
+   *   "waiting" - array of callbacks waiting for the file while it is
+   *   being loaded, or false if it is not being loaded
+   * 
+   *   "gen" - integer that is incremented each time the file changes,
+   *   so that a load that started before the change is not kept
    * 
    * Additionally, there is a special entry in the top-level object for
    * the "extension" having special value "." (which would otherwise be
@@ -164,9 +186,12 @@
    * Any entry in m_vfs in the "json" category for file name "mesh" is
    * ignored.
    * 
-   * Most of this virtual file system is loaded by parsing the HTTP
-   * manifest file and loading all the referenced files into memory.
-   * The only exceptions are:
+   * Most of this virtual file system is defined by parsing the HTTP
+   * manifest file.  The referenced files are loaded into memory
+   * asynchronously the first time they are requested, and they are
+   * dropped from memory again when they change on disk, so the next
+   * request loads them again.  See readEntry() and watchFiles().  The
+   * only exceptions are:
    * 
    *   (1) The "/mesh.json" file, as described above
    * 
@@ -198,6 +223,41 @@
    */
   var m_vfs = false;
   
+  /*
+   * The path to the HTTP manifest file as a string.
+   * 
+   * This is set at the start of lilacme().  The manifest is loaded again
+   * when this file changes.
+   */
+  var m_manifest_path = false;
+  
+  /*
+   * The files that the server generates in memory.
+   * 
+   * This is set during lilacme() to an object with three properties:
+   * "trace_ext" is the extension of the tracing image, either "jpg" or
+   * "png"; "trace" is a Buffer holding the tracing image; and "config"
+   * is a Buffer holding the client configuration file.  These are added
+   * to the virtual file system again each time the manifest is reloaded.
+   */
+  var m_special = false;
+  
+  /*
+   * The file system watchers.
+   * 
+   * JavaScript object interpreted as an associative array mapping the
+   * resolved path of each watched directory to its fs.FSWatcher object.
+   * Directories are watched rather than files, because editors often
+   * save a file by replacing it, which would end a watch on the file.
+   */
+  var m_watchers = {};
+  
+  /*
+   * The timer for a pending reload of the HTTP manifest, or false if no
+   * reload is pending.
+   */
+  var m_reload_timer = false;
+  
   /*
    * The HTTP server instance.
    * 
@@ -668,7 +728,10 @@
    * for the "m_vfs" variable.
    * 
    * An exception is thrown and an error message printed if there is a
-   * problem parsing the JSON file or loading any of the files.
+   * problem parsing the JSON file.  The referenced files are not
+   * accessed.  Each path is resolved and replaced with a file entry that
+   * is not loaded yet; see checkFiles() for checking that the files
+   * exist.
    * 
    * The base_path parameter is the path to the directory that relative
    * file paths in the manifest are resolved against.  It should be the
@@ -871,35 +934,489 @@
     // We can now drop the original parsed representation
     root_p = null;
     
-    // Go through all files, resolve them against manifest path, check
-    // that they exist and are regular files, and replace their path
-    // strings with Buffer objects holding their contents
+    // Go through all files, resolve them against manifest path, and
+    // replace their path strings with file entries that are loaded on
+    // the first request
     for(p in root) {
       for(q in root[p].files) {
-        
-        // Resolve the path against the base path
         v = path.resolve(base_path, root[p].files[q]);
+        root[p].files[q] = fileEntry(v, false);
+      }
+    }
+    
+    // Return the decoded manifest
+    return root;
+  }
+  
+  /*
+   * Create a new file entry for the virtual file system.
+   * 
+   * See the documentation of the m_vfs variable for the format.  Files
+   * from the local file system are given by their path and start out
+   * unloaded.  Files that the server generates are given by their data,
+   * with a path of false.
+   * 
+   * Parameters:
+   * 
+   *   p : string | boolean - the resolved path to the file, or false
+   * 
+   *   d : Buffer | boolean - the data of a generated file, or false
+   * 
+   * Return:
+   * 
+   *   the new file entry
+   */
+  function fileEntry(p, d) {
+    
+    var func_name = "fileEntry";
+    
+    // Check parameters
+    if (((typeof p !== "string") && (p !== false)) ||
+        ((typeof d !== "object") && (d !== false))) {
+      fault(func_name, 100);
+    }
+    if ((d !== false) && (!(d instanceof Buffer))) {
+      fault(func_name, 110);
+    }
+    if ((p === false) === (d === false)) {
+      fault(func_name, 120);
+    }
+    
+    return {
+      "path": p,
+      "data": d,
+      "waiting": false,
+      "gen": 0
+    };
+  }
+  
+  /*
+   * Check that every file referenced from a virtual file system exists
+   * and is a regular file.
+   * 
+   * Parameters:
+   * 
+   *   vfs : object - the virtual file system to check
+   * 
+   * Return:
+   * 
+   *   the path of the first file that is missing, or false if all the
+   *   files are present
+   */
+  function checkFiles(vfs) {
+    
+    var func_name = "checkFiles";
+    var p, q, e;
+    
+    // Check parameter
+    if (typeof vfs !== "object") {
+      fault(func_name, 100);
+    }
+    
+    for(p in vfs) {
+      for(q in vfs[p].files) {
+        e = vfs[p].files[q];
+        if ((e.path !== false) && (!isRegularFile(e.path))) {
+          return e.path;
+        }
+      }
+    }
+    
+    return false;
+  }
+  
+  /*
+   * Asynchronously get the data of a file entry.
+   * 
+   * If the file is already in memory, the callback is invoked right
+   * away.  Otherwise, the file is read from the local file system, and
+   * every request that arrives while it is being read waits for the
+   * same read.  Reads of different files proceed in parallel.
+   * 
+   * The callback receives either a Buffer with the file data, or an
+   * integer HTTP error status code: 404 if the file no longer exists,
+   * or 500 for any other problem.
+   * 
+   * The data is only kept in memory if the file did not change while it
+   * was being read; otherwise, the next request reads it again.
+   * 
+   * Parameters:
+   * 
+   *   e : object - the file entry
+   * 
+   *   callback : function - the function to invoke with the result
+   */
+  function readEntry(e, callback) {
+    
+    var func_name = "readEntry";
+    var gen;
+    
+    // Check parameters
+    if ((typeof e !== "object") || (typeof callback !== "function")) {
+      fault(func_name, 100);
+    }
+    
+    // If the file is in memory, return it right away
+    if (e.data !== false) {
+      callback(e.data);
+      return;
+    }
+    
+    // If the file is already being read, wait for that read
+    if (e.waiting !== false) {
+      e.waiting.push(callback);
+      return;
+    }
+    
+    // Start reading the file
+    e.waiting = [callback];
+    gen = e.gen;
+    
+    fs.readFile(e.path, {"flag": "r"}, function(err, d) {
+      
+      var w, i, r;
+      
+      // Take the waiting callbacks
+      w = e.waiting;
+      e.waiting = false;
+      
+      // Get the result, keeping the data only if the file didn't
+      // change in the meantime
+      if (err) {
+        if (err.code === "ENOENT") {
+          r = 404;
+        } else {
+          r = 500;
+        }
+        console.log("Can't read file referenced from manifest!");
+        console.log("File path: " + e.path);
         
-        // Check that resolved path is to regular file
-        if (!isRegularFile(v)) {
-          console.log("Can't find file referenced from manifest!");
-          console.log("File path: " + v);
-          throw "find_manifest_element";
+      } else {
+        r = d;
+        if (e.gen === gen) {
+          e.data = d;
+        }
+      }
+      
+      // Deliver the result to everyone who was waiting
+      for(i = 0; i < w.length; i++) {
+        w[i](r);
+      }
+    });
+  }
+  
+  /*
+   * Drop every file entry for a given path from memory, so that the
+   * next request reads the file again.
+   * 
+   * Entries for other files are not affected.  If dir_only is true, the
+   * given path is a directory, and every entry for a file within that
+   * directory is dropped.  This is used when the file system does not
+   * report which file changed.
+   * 
+   * Parameters:
+   * 
+   *   p : string - the resolved path to the file or directory
+   * 
+   *   dir_only : boolean - true if p is a directory
+   */
+  function invalidatePath(p, dir_only) {
+    
+    var func_name = "invalidatePath";
+    var c, f, e;
+    
+    // Check state
+    if (typeof m_vfs !== "object") {
+      fault(func_name, 100);
+    }
+    
+    // Check parameters
+    if ((typeof p !== "string") || (typeof dir_only !== "boolean")) {
+      fault(func_name, 200);
+    }
+    
+    for(c in m_vfs) {
+      for(f in m_vfs[c].files) {
+        e = m_vfs[c].files[f];
+        if (e.path === false) {
+          continue;
         }
         
-        // Read the file and use it to replace the path
-        try {
-          root[p].files[q] = fs.readFileSync(v, {"flag": "r"});
-        } catch (ex) {
-          console.log("Can't read file referenced from manifest!");
-          console.log("File path: " + v);
-          throw "read_manifest_element";
+        if ((dir_only && (path.dirname(e.path) === p)) ||
+            ((!dir_only) && (e.path === p))) {
+          e.data = false;
+          e.gen++;
         }
       }
     }
+  }
+  
+  /*
+   * Add the files that the server generates to a virtual file system.
+   * 
+   * The m_special variable must be set.  See the documentation of the
+   * m_vfs variable for these files.
+   * 
+   * Parameters:
+   * 
+   *   vfs : object - the virtual file system
+   */
+  function addSpecialFiles(vfs) {
     
-    // Return the fully loaded manifest
-    return root;
+    var func_name = "addSpecialFiles";
+    var trxt;
+    
+    // Check state
+    if (typeof m_special !== "object") {
+      fault(func_name, 100);
+    }
+    
+    // Check parameter
+    if (typeof vfs !== "object") {
+      fault(func_name, 200);
+    }
+    
+    // Insert the tracing image into the virtual file system -- begin by
+    // establishing the image type category if not already established
+    trxt = m_special.trace_ext;
+    if (!(trxt in vfs)) {
+      // Establish new category for type
+      if (trxt === "jpg") {
+        vfs[trxt] = {
+          "mime_type": "image/jpeg",
+          "files": {}
+        };
+        
+      } else if (trxt === "png") {
+        vfs[trxt] = {
+          "mime_type": "image/png",
+          "files": {}
+        };
+        
+      } else {
+        // Shouldn't happen
+        fault(func_name, 300);
+      }
+    }
+    
+    // Now we can add an entry for the tracing file and store it there
+    // in the virtual file system
+    vfs[trxt].files["trace"] = fileEntry(false, m_special.trace);
+    
+    // Insert the client-side configuration file into the virtual file
+    // system -- begin by establishing the JSON category if not already
+    // established
+    if (!("json" in vfs)) {
+      vfs["json"] = {
+        "mime_type": "application/json",
+        "files": {}
+      };
+    }
+    
+    // Now we can add an entry for the client-side configuration file
+    // and store it there in the virtual file system
+    vfs["json"].files["config"] = fileEntry(false, m_special.config);
+  }
+  
+  /*
+   * Watch the directories of the HTTP manifest and of every file it
+   * references.
+   * 
+   * The m_vfs and m_manifest_path variables must be set.  Directories
+   * that are already watched are left alone, and watchers for
+   * directories that are no longer needed are closed, so this is called
+   * again after each reload of the manifest.
+   * 
+   * When a file changes, only the file entries for that file are
+   * dropped from memory.  When the manifest changes, it is reloaded
+   * with reloadManifest() after RELOAD_DELAY.  The watchers do not keep
+   * the process running after the server shuts down.
+   */
+  function watchFiles() {
+    
+    var func_name = "watchFiles";
+    var dirs, c, f, e, d;
+    
+    // Check state
+    if ((typeof m_vfs !== "object") ||
+        (typeof m_manifest_path !== "string")) {
+      fault(func_name, 100);
+    }
+    
+    // Get the set of directories to watch
+    dirs = {};
+    dirs[path.dirname(m_manifest_path)] = true;
+    for(c in m_vfs) {
+      for(f in m_vfs[c].files) {
+        e = m_vfs[c].files[f];
+        if (e.path !== false) {
+          dirs[path.dirname(e.path)] = true;
+        }
+      }
+    }
+    
+    // Close the watchers that are no longer needed
+    for(d in m_watchers) {
+      if (!(d in dirs)) {
+        m_watchers[d].close();
+        delete m_watchers[d];
+      }
+    }
+    
+    // Start watching the new directories
+    for(d in dirs) {
+      if (d in m_watchers) {
+        continue;
+      }
+      
+      try {
+        m_watchers[d] = fs.watch(d, {"persistent": false},
+                                  changeHandler(d));
+      } catch (ex) {
+        console.log("Can't watch directory for changes!");
+        console.log("Directory path: " + d);
+        console.log("Reason: " + ex);
+        continue;
+      }
+      
+      m_watchers[d].on("error", function(err) {
+        console.log("Error while watching for changes!");
+        console.log("Reason: " + err);
+      });
+    }
+  }
+  
+  /*
+   * Create the change event handler for a watched directory.
+   * 
+   * Parameters:
+   * 
+   *   d : string - the resolved path of the directory
+   * 
+   * Return:
+   * 
+   *   the event handler function for fs.watch()
+   */
+  function changeHandler(d) {
+    
+    var func_name = "changeHandler";
+    
+    // Check parameter
+    if (typeof d !== "string") {
+      fault(func_name, 100);
+    }
+    
+    return function(event_type, file_name) {
+      
+      var p;
+      
+      // If the changed file is not reported, assume that any file in
+      // the directory changed
+      if (typeof file_name !== "string") {
+        invalidatePath(d, true);
+        if (path.dirname(m_manifest_path) === d) {
+          scheduleReload();
+        }
+        return;
+      }
+      
+      // Drop the changed file, and reload the manifest if it changed
+      p = path.resolve(d, file_name);
+      invalidatePath(p, false);
+      if (p === m_manifest_path) {
+        scheduleReload();
+      }
+    };
+  }
+  
+  /*
+   * Reload the HTTP manifest after RELOAD_DELAY, unless a reload is
+   * already pending.
+   */
+  function scheduleReload() {
+    
+    if (m_reload_timer !== false) {
+      return;
+    }
+    
+    m_reload_timer = setTimeout(function() {
+      m_reload_timer = false;
+      reloadManifest();
+    }, RELOAD_DELAY);
+    m_reload_timer.unref();
+  }
+  
+  /*
+   * Asynchronously reload the HTTP manifest and replace the virtual file
+   * system with it.
+   * 
+   * The m_vfs, m_manifest_path, and m_special variables must be set.
+   * If the new manifest can't be read or is invalid, the problem is
+   * reported and the previous virtual file system is kept.  Files whose
+   * category, name, and path are unchanged keep their entries, so files
+   * already in memory are not read again.
+   */
+  function reloadManifest() {
+    
+    var func_name = "reloadManifest";
+    
+    // Check state
+    if ((typeof m_vfs !== "object") ||
+        (typeof m_manifest_path !== "string") ||
+        (typeof m_special !== "object")) {
+      fault(func_name, 100);
+    }
+    
+    fs.readFile(m_manifest_path, {
+      "encoding": "utf8",
+      "flag": "r"
+    }, function(err, str) {
+      
+      var vfs, c, f, e, p;
+      
+      // Read and decode the new manifest
+      if (err) {
+        console.log("Failed to reload HTTP manifest file!");
+        console.log("Reason: " + err);
+        return;
+      }
+      
+      try {
+        vfs = loadManifest(str, path.dirname(m_manifest_path));
+      } catch (ex) {
+        console.log("Keeping the previous HTTP manifest.");
+        return;
+      }
+      
+      p = checkFiles(vfs);
+      if (p !== false) {
+        console.log("Can't find file referenced from manifest!");
+        console.log("File path: " + p);
+      }
+      
+      // Keep the entries of unchanged files
+      for(c in vfs) {
+        if (!(c in m_vfs)) {
+          continue;
+        }
+        for(f in vfs[c].files) {
+          if (!(f in m_vfs[c].files)) {
+            continue;
+          }
+          e = m_vfs[c].files[f];
+          if (e.path === vfs[c].files[f].path) {
+            vfs[c].files[f] = e;
+          }
+        }
+      }
+      
+      // Add the generated files and switch over
+      addSpecialFiles(vfs);
+      m_vfs = vfs;
+      watchFiles();
+      
+      console.log("Reloaded HTTP manifest.");
+    });
   }
   
   /*
@@ -1083,8 +1600,10 @@
    * indicates the HTTP error status code that should be sent in
    * response.  If the array has two elements, the first element is a
    * string that has the value for the Content-Type header to respond
-   * with and the second element is a Buffer containing the data that
-   * should be sent back to the client.
+   * with and the second element is either a Buffer containing the data
+   * that should be sent back to the client, or a file entry from the
+   * virtual file system whose data should be sent back, which must be
+   * read with readEntry().
    * 
    * The m_mesh and m_vfs variables must be set before using this
    * function.
@@ -1097,7 +1616,7 @@
    * 
    *   an array of one element containing the error status code, or an
    *   array of two elements containing the content type as a string and
-   *   the data to transmit to the client as a Buffer
+   *   the data to transmit to the client as a Buffer or file entry
    */
   function readRequest(url) {
     
@@ -1214,6 +1733,61 @@
     return [404];
   }
   
+  /*
+   * Respond to a GET or HEAD request with the result of readRequest().
+   * 
+   * If the result is a file entry that is not in memory yet, the
+   * response is sent asynchronously once the file has been read.
+   * 
+   * Parameters:
+   * 
+   *   response : http.ServerResponse - the object used to respond to
+   *   the client's request
+   * 
+   *   retval : Array - the return value of readRequest()
+   * 
+   *   headRequest : boolean - true if client used a HEAD method, false
+   *   otherwise
+   */
+  function readRespond(response, retval, headRequest) {
+    
+    var func_name = "readRespond";
+    var ct;
+    
+    // Check parameters
+    if ((typeof retval !== "object") || (!(retval instanceof Array)) ||
+        (typeof headRequest !== "boolean")) {
+      fault(func_name, 100);
+    }
+    
+    // Handle the different responses
+    if (retval.length === 1) {
+      // HTTP error code was returned
+      httpError(retval[0], response, headRequest);
+      
+    } else if (retval.length === 2) {
+      // File was returned to transmit to client, either directly or as
+      // an entry of the virtual file system that may need reading
+      if (retval[1] instanceof Buffer) {
+        httpTransmit(response, retval[0], retval[1], headRequest);
+        
+      } else {
+        ct = retval[0];
+        readEntry(retval[1], function(d) {
+          if (d instanceof Buffer) {
+            httpTransmit(response, ct, d, headRequest);
+          } else {
+            httpError(d, response, headRequest);
+          }
+        });
+      }
+      
+    } else {
+      // Shouldn't happen
+      fault(func_name, 200);
+    }
+  }
+  
   /*
    * Function that handles POST requests.
    * 
@@ -1499,38 +2073,12 @@
     if (m === "GET") {
       // GET request, so we're doing a read request
       retval = readRequest(url);
-      
-      // Handle the different responses
-      if (retval.length === 1) {
-        // HTTP error code was returned
-        httpError(retval[0], response, false);
-        
-      } else if (retval.length === 2) {
-        // File was returned to transmit to client
-        httpTransmit(response, retval[0], retval[1], false);
-        
-      } else {
-        // Shouldn't happen
-        fault(func_name, 300);
-      }
+      readRespond(response, retval, false);
       
     } else if (m === "HEAD") {
       // HEAD request, so we're doing a read request
       retval = readRequest(url);
-      
-      // Handle the different responses
-      if (retval.length === 1) {
-        // HTTP error code was returned
-        httpError(retval[0], response, true);
-        
-      } else if (retval.length === 2) {
-        // File was returned to transmit to client
-        httpTransmit(response, retval[0], retval[1], true);
-        
-      } else {
-        // Shouldn't happen
-        fault(func_name, 400);
-      }
+      readRespond(response, retval, true);
       
     } else if (m === "POST") {
       // POST request
@@ -1628,6 +2176,18 @@
     });
     
     m_server.on("close", function() {
+      var d;
+      
+      // Stop watching for file changes
+      for(d in m_watchers) {
+        m_watchers[d].close();
+      }
+      m_watchers = {};
+      if (m_reload_timer !== false) {
+        clearTimeout(m_reload_timer);
+        m_reload_timer = false;
+      }
+      
       console.log("Server has shut down.");
     });
     
@@ -1692,10 +2252,12 @@
    * existing file, the converter will be used to convert the initial
    * Shastina to the initial JSON.
    * 
-   * All files specified by the manifest will be loaded into memory
-   * before the server begins.  Changes to the files after loading will
-   * be ignored, so the server must be restarted to refresh files in the
-   * HTTP manifest.
+   * The files specified by the manifest are only checked to exist before
+   * the server begins, so startup does not depend on their size.  Each
+   * is loaded into memory when it is first requested.  The manifest and
+   * the directories of its files are watched, so changed files are
+   * loaded again on their next request and a changed manifest is
+   * reloaded, without restarting the server.
    * 
    * Parameters:
    * 
@@ -1723,6 +2285,7 @@
     var func_name = "lilacme";
     var t, trxt, tfc;
     var ccfg;
+    var p;
     
     // Check parameters
     if ((typeof server_port !== "number") ||
@@ -1755,8 +2318,17 @@
       throw "read_manifest";
     }
     
-    // Process the manifest file to establish the virtual file system
-    m_vfs = loadManifest(t, path.dirname(manifest_path));
+    // Process the manifest file to establish the virtual file system,
+    // and check that all the files it references exist
+    m_manifest_path = path.resolve(manifest_path);
+    m_vfs = loadManifest(t, path.dirname(m_manifest_path));
+    
+    p = checkFiles(m_vfs);
+    if (p !== false) {
+      console.log("Can't find file referenced from manifest!");
+      console.log("File path: " + p);
+      throw "find_manifest_element";
+    }
     
     // Initialize the mesh file state
     if (new_mesh) {
@@ -1821,50 +2393,21 @@
             "}\n";
     ccfg = Buffer.from(ccfg, "utf8");
     
-    // Insert the tracing image into the virtual file system -- begin by
-    // establishing the image type category if not already established
-    if (!(trxt in m_vfs)) {
-      // Establish new category for type
-      if (trxt === "jpg") {
-        m_vfs[trxt] = {
-          "mime_type": "image/jpeg",
-          "files": {}
-        };
-        
-      } else if (trxt === "png") {
-        m_vfs[trxt] = {
-          "mime_type": "image/png",
-          "files": {}
-        };
-        
-      } else {
-        // Shouldn't happen
-        fault(func_name, 200);
-      }
-    }
-    
-    // Now we can add an entry for the tracing file and store it there
-    // in the virtual file system
-    m_vfs[trxt].files["trace"] = tfc;
-    
-    // Insert the client-side configuration file into the virtual file
-    // system -- begin by establishing the JSON category if not already
-    // established
-    if (!("json" in m_vfs)) {
-      m_vfs["json"] = {
-        "mime_type": "application/json",
-        "files": {}
-      };
-    }
-    
-    // Now we can add an entry for the client-side configuration file
-    // and store it there in the virtual file system
-    m_vfs["json"].files["config"] = ccfg;
+    // Insert the tracing image and the client-side configuration file
+    // into the virtual file system, keeping them to insert again
+    // whenever the manifest is reloaded
+    m_special = {
+      "trace_ext": trxt,
+      "trace": tfc,
+      "config": ccfg
+    };
+    addSpecialFiles(m_vfs);
     
     // We have successfully initialize m_mesh with the initial mesh
     // state and m_vfs with the server virtual file system, so we can
-    // now begin the server
+    // now begin the server and start watching for changes
     beginServer(server_port);
+    watchFiles();
   }
   
   /*
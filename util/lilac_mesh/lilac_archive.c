@@ -0,0 +1,1146 @@
+/*
+ * lilac_archive.c
+ * ===============
+ * 
+ * Implementation of lilac_archive.h
+ * 
+ * See the header for further information.
+ */
+
+#include "lilac_archive.h"
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+/*
+ * Constants
+ * ---------
+ */
+
+/*
+ * The length of the archive header and the archive trailer in bytes.
+ */
+#define HEADER_LEN (16)
+#define TRAILER_LEN (24)
+
+/*
+ * The length of each index record in bytes, not including the name.
+ */
+#define RECORD_LEN (17)
+
+/*
+ * The magic bytes at the start of the header and at the end of the
+ * trailer.
+ */
+#define HEADER_MAGIC "LILACMA1"
+#define HEADER_MAGIC_LEN (8)
+
+#define TRAILER_MAGIC "LMAX"
+#define TRAILER_MAGIC_LEN (4)
+
+/*
+ * Type declarations
+ * -----------------
+ */
+
+/*
+ * An entry in the index of an archive.
+ */
+typedef struct {
+  
+  /*
+   * The name of the mesh, which is a nul-terminated string.
+   */
+  char *pName;
+  
+  /*
+   * The offset and length in bytes of the mesh data in the archive.
+   */
+  uint64_t offset;
+  uint64_t length;
+  
+} ENTRY;
+
+/*
+ * LILAC_ARCHIVE structure.
+ */
+struct LILAC_ARCHIVE_TAG {
+  
+  /*
+   * The read-only memory mapping of the whole archive file, and its
+   * length in bytes.
+   */
+  const unsigned char *pMap;
+  size_t map_len;
+  
+  /*
+   * The length of the archive in bytes, which is shorter than the
+   * mapping if an interrupted append left unused bytes at the end of
+   * the file.
+   */
+  uint64_t length;
+  
+  /*
+   * The index entries, sorted by name.
+   */
+  ENTRY *pEntries;
+  int32_t count;
+  
+  /*
+   * The storage for all the names in the index, which the entries
+   * point into.
+   */
+  char *pNames;
+  
+  /*
+   * The offset of the index in the archive file, which is also the end
+   * of the mesh data.
+   */
+  uint64_t index_offset;
+  
+};
+
+/*
+ * LILAC_ARCHIVE_WRITER structure.
+ */
+struct LILAC_ARCHIVE_WRITER_TAG {
+  
+  /*
+   * The archive file.
+   */
+  FILE *pFile;
+  
+  /*
+   * The end of the data written so far, where the next mesh will be
+   * written.  When appending, this starts after the old trailer, so the
+   * old index stays valid until the new one is complete.
+   */
+  uint64_t data_end;
+  
+  /*
+   * The index entries in the order they were added, with each name
+   * separately allocated.  cap is the allocated capacity.
+   */
+  ENTRY *pEntries;
+  int32_t count;
+  int32_t cap;
+  
+  /*
+   * Hash table of entry indices for detecting duplicate names.
+   * 
+   * The table has hash_cap slots, which is a power of two and at least
+   * twice the entry capacity.  Unused slots are -1.
+   */
+  int32_t *pHash;
+  int32_t hash_cap;
+  
+  /*
+   * Non-zero if an error occurred that left the archive invalid.
+   */
+  int failed;
+  
+};
+
+/*
+ * Local functions
+ * ---------------
+ */
+
+/* Prototypes */
+static uint64_t get_u64(const unsigned char *p);
+static uint32_t get_u32(const unsigned char *p);
+static void put_u64(unsigned char *p, uint64_t v);
+static void put_u32(unsigned char *p, uint32_t v);
+
+static int valid_name(const char *pName, size_t len);
+static uint32_t hash_name(const char *pName);
+static int cmp_entry(const void *pA, const void *pB);
+
+static int writer_hash_find(LILAC_ARCHIVE_WRITER *pW, const char *pName);
+static void writer_hash_insert(LILAC_ARCHIVE_WRITER *pW, int32_t i);
+static void writer_grow(LILAC_ARCHIVE_WRITER *pW);
+static void writer_free(LILAC_ARCHIVE_WRITER *pW);
+static int writer_commit(LILAC_ARCHIVE_WRITER *pW, uint64_t length);
+
+/*
+ * Decode little-endian unsigned integers from bytes.
+ * 
+ * Parameters:
+ * 
+ *   p - pointer to the first byte
+ * 
+ * Return:
+ * 
+ *   the decoded integer
+ */
+static uint64_t get_u64(const unsigned char *p) {
+  
+  uint64_t v = 0;
+  int i = 0;
+  
+  for(i = 7; i >= 0; i--) {
+    v = (v << 8) | ((uint64_t) p[i]);
+  }
+  
+  return v;
+}
+
+static uint32_t get_u32(const unsigned char *p) {
+  return ((uint32_t) p[0]) |
+          (((uint32_t) p[1]) <<  8) |
+          (((uint32_t) p[2]) << 16) |
+          (((uint32_t) p[3]) << 24);
+}
+
+/*
+ * Encode little-endian unsigned integers into bytes.
+ * 
+ * Parameters:
+ * 
+ *   p - pointer to the first byte
+ * 
+ *   v - the integer to encode
+ */
+static void put_u64(unsigned char *p, uint64_t v) {
+  
+  int i = 0;
+  
+  for(i = 0; i < 8; i++) {
+    p[i] = (unsigned char) (v & 0xff);
+    v >>= 8;
+  }
+}
+
+static void put_u32(unsigned char *p, uint32_t v) {
+  
+  int i = 0;
+  
+  for(i = 0; i < 4; i++) {
+    p[i] = (unsigned char) (v & 0xff);
+    v >>= 8;
+  }
+}
+
+/*
+ * Check whether a mesh name is valid.
+ * 
+ * See LILAC_ARCHIVE_MAX_NAME in the header for the rules.
+ * 
+ * Parameters:
+ * 
+ *   pName - the name, which need not be nul-terminated
+ * 
+ *   len - the length of the name in bytes
+ * 
+ * Return:
+ * 
+ *   non-zero if valid, zero if not
+ */
+static int valid_name(const char *pName, size_t len) {
+  
+  size_t i = 0;
+  int c = 0;
+  
+  if ((len < 1) || (len > LILAC_ARCHIVE_MAX_NAME)) {
+    return 0;
+  }
+  
+  for(i = 0; i < len; i++) {
+    c = (int) ((unsigned char) pName[i]);
+    if ((c < 0x20) || (c > 0x7e) || (c == ':')) {
+      return 0;
+    }
+  }
+  
+  return 1;
+}
+
+/*
+ * Compute the FNV-1a hash of a nul-terminated name.
+ * 
+ * Parameters:
+ * 
+ *   pName - the name
+ * 
+ * Return:
+ * 
+ *   the hash
+ */
+static uint32_t hash_name(const char *pName) {
+  
+  uint32_t h = UINT32_C(2166136261);
+  
+  for( ; *pName != 0; pName++) {
+    h ^= (uint32_t) ((unsigned char) *pName);
+    h *= UINT32_C(16777619);
+  }
+  
+  return h;
+}
+
+/*
+ * Comparison function for sorting index entries by name with qsort().
+ */
+static int cmp_entry(const void *pA, const void *pB) {
+  return strcmp(
+          ((const ENTRY *) pA)->pName, ((const ENTRY *) pB)->pName);
+}
+
+/*
+ * Find a name in the hash table of an archive writer.
+ * 
+ * Parameters:
+ * 
+ *   pW - the archive writer
+ * 
+ *   pName - the name
+ * 
+ * Return:
+ * 
+ *   non-zero if the name is already in the archive, zero if not
+ */
+static int writer_hash_find(LILAC_ARCHIVE_WRITER *pW, const char *pName) {
+  
+  uint32_t h = 0;
+  int32_t i = 0;
+  
+  if (pW->hash_cap < 1) {
+    return 0;
+  }
+  
+  for(h = hash_name(pName) & ((uint32_t) (pW->hash_cap - 1));
+      ;
+      h = (h + 1) & ((uint32_t) (pW->hash_cap - 1))) {
+    i = (pW->pHash)[h];
+    if (i < 0) {
+      return 0;
+    }
+    if (strcmp((pW->pEntries)[i].pName, pName) == 0) {
+      return 1;
+    }
+  }
+}
+
+/*
+ * Insert an entry into the hash table of an archive writer.
+ * 
+ * The table must have room for the entry.
+ * 
+ * Parameters:
+ * 
+ *   pW - the archive writer
+ * 
+ *   i - the index of the entry
+ */
+static void writer_hash_insert(LILAC_ARCHIVE_WRITER *pW, int32_t i) {
+  
+  uint32_t h = 0;
+  
+  for(h = hash_name((pW->pEntries)[i].pName) &
+            ((uint32_t) (pW->hash_cap - 1));
+      (pW->pHash)[h] >= 0;
+      h = (h + 1) & ((uint32_t) (pW->hash_cap - 1)));
+  
+  (pW->pHash)[h] = i;
+}
+
+/*
+ * Double the entry capacity of an archive writer and rebuild its hash
+ * table.
+ * 
+ * Parameters:
+ * 
+ *   pW - the archive writer
+ */
+static void writer_grow(LILAC_ARCHIVE_WRITER *pW) {
+  
+  int32_t i = 0;
+  
+  if (pW->cap < 1) {
+    pW->cap = 256;
+  } else {
+    pW->cap *= 2;
+  }
+  
+  pW->pEntries = (ENTRY *) realloc(
+                    pW->pEntries, ((size_t) pW->cap) * sizeof(ENTRY));
+  if (pW->pEntries == NULL) {
+    abort();
+  }
+  
+  pW->hash_cap = pW->cap * 2;
+  free(pW->pHash);
+  pW->pHash = (int32_t *) malloc(
+                  ((size_t) pW->hash_cap) * sizeof(int32_t));
+  if (pW->pHash == NULL) {
+    abort();
+  }
+  
+  for(i = 0; i < pW->hash_cap; i++) {
+    (pW->pHash)[i] = -1;
+  }
+  for(i = 0; i < pW->count; i++) {
+    writer_hash_insert(pW, i);
+  }
+}
+
+/*
+ * Release an archive writer and all its memory, closing the file if it
+ * is still open.
+ * 
+ * Parameters:
+ * 
+ *   pW - the archive writer
+ */
+static void writer_free(LILAC_ARCHIVE_WRITER *pW) {
+  
+  int32_t i = 0;
+  
+  if (pW->pFile != NULL) {
+    fclose(pW->pFile);
+    pW->pFile = NULL;
+  }
+  
+  for(i = 0; i < pW->count; i++) {
+    free((pW->pEntries)[i].pName);
+  }
+  free(pW->pEntries);
+  free(pW->pHash);
+  free(pW);
+}
+
+/*
+ * Make an archive length take effect.
+ * 
+ * Everything written so far is flushed to the disk before the length is
+ * recorded in the header, and the header is then flushed as well.  The
+ * data beyond the old length is therefore complete before any reader can
+ * see it, and an append that is interrupted before this point leaves the
+ * old archive intact.
+ * 
+ * Parameters:
+ * 
+ *   pW - the archive writer
+ * 
+ *   length - the new length of the archive in bytes
+ * 
+ * Return:
+ * 
+ *   LILAC_ARCHIVE_ERR_OK if successful, or an error code
+ */
+static int writer_commit(LILAC_ARCHIVE_WRITER *pW, uint64_t length) {
+  
+  int err = LILAC_ARCHIVE_ERR_OK;
+  unsigned char buf[8];
+  
+  memset(buf, 0, sizeof(buf));
+  put_u64(buf, length);
+  
+  if (fflush(pW->pFile) || fsync(fileno(pW->pFile))) {
+    err = LILAC_ARCHIVE_ERR_IO;
+  }
+  
+  if (!err) {
+    if (fseeko(pW->pFile, (off_t) HEADER_MAGIC_LEN, SEEK_SET) ||
+        (fwrite(buf, 1, sizeof(buf), pW->pFile) != sizeof(buf))) {
+      err = LILAC_ARCHIVE_ERR_IO;
+    }
+  }
+  
+  if (!err) {
+    if (fflush(pW->pFile) || fsync(fileno(pW->pFile))) {
+      err = LILAC_ARCHIVE_ERR_IO;
+    }
+  }
+  
+  return err;
+}
+
+/*
+ * Public function implementations
+ * -------------------------------
+ * 
+ * See the header for specifications
+ */
+
+/*
+ * lilac_archive_open function.
+ */
+LILAC_ARCHIVE *lilac_archive_open(const char *pPath, int *pErrCode) {
+  
+  int status = 1;
+  int err = LILAC_ARCHIVE_ERR_OK;
+  int fd = -1;
+  int32_t i = 0;
+  size_t pos = 0;
+  size_t name_len = 0;
+  size_t names_size = 0;
+  uint64_t index_len = 0;
+  uint64_t count = 0;
+  void *pMap = NULL;
+  const unsigned char *pt = NULL;
+  const unsigned char *pr = NULL;
+  char *pn = NULL;
+  struct stat st;
+  LILAC_ARCHIVE *pA = NULL;
+  
+  memset(&st, 0, sizeof(struct stat));
+  
+  /* Check parameters */
+  if (pPath == NULL) {
+    abort();
+  }
+  
+  /* Allocate the archive structure */
+  pA = (LILAC_ARCHIVE *) calloc(1, sizeof(LILAC_ARCHIVE));
+  if (pA == NULL) {
+    abort();
+  }
+  
+  /* Open the file and get its size */
+  fd = open(pPath, O_RDONLY);
+  if (fd < 0) {
+    status = 0;
+    err = LILAC_ARCHIVE_ERR_OPEN;
+  }
+  
+  if (status) {
+    if (fstat(fd, &st)) {
+      status = 0;
+      err = LILAC_ARCHIVE_ERR_IO;
+    }
+  }
+  
+  if (status) {
+    if ((st.st_size < HEADER_LEN + TRAILER_LEN) ||
+        ((uint64_t) st.st_size > (uint64_t) SIZE_MAX)) {
+      status = 0;
+      err = LILAC_ARCHIVE_ERR_FORMAT;
+    }
+  }
+  
+  /* Map the whole file; the mapping stays valid after the file
+   * descriptor is closed */
+  if (status) {
+    pMap = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (pMap == MAP_FAILED) {
+      pMap = NULL;
+      status = 0;
+      err = LILAC_ARCHIVE_ERR_IO;
+    } else {
+      pA->pMap = (const unsigned char *) pMap;
+      pA->map_len = (size_t) st.st_size;
+    }
+  }
+  
+  if (fd >= 0) {
+    close(fd);
+    fd = -1;
+  }
+  
+  /* Check the header and get the archive length, which is the file
+   * length if the header does not record it */
+  if (status) {
+    if (memcmp(pA->pMap, HEADER_MAGIC, HEADER_MAGIC_LEN) != 0) {
+      status = 0;
+      err = LILAC_ARCHIVE_ERR_FORMAT;
+    }
+  }
+  
+  if (status) {
+    pA->length = get_u64(pA->pMap + HEADER_MAGIC_LEN);
+    if (pA->length == 0) {
+      pA->length = (uint64_t) pA->map_len;
+    }
+    if ((pA->length < HEADER_LEN + TRAILER_LEN) ||
+        (pA->length > (uint64_t) pA->map_len)) {
+      status = 0;
+      err = LILAC_ARCHIVE_ERR_FORMAT;
+    }
+  }
+  
+  /* Check the trailer at the end of the archive */
+  if (status) {
+    pt = pA->pMap + (size_t) (pA->length - TRAILER_LEN);
+    if (memcmp(pt + (TRAILER_LEN - TRAILER_MAGIC_LEN),
+                TRAILER_MAGIC, TRAILER_MAGIC_LEN) != 0) {
+      status = 0;
+      err = LILAC_ARCHIVE_ERR_FORMAT;
+    }
+  }
+  
+  if (status) {
+    pA->index_offset = get_u64(pt);
+    index_len = get_u64(pt + 8);
+    count = (uint64_t) get_u32(pt + 16);
+  
+    if ((pA->index_offset < HEADER_LEN) ||
+        (pA->index_offset > pA->length - TRAILER_LEN) ||
+        (index_len != (pA->length - TRAILER_LEN) - pA->index_offset) ||
+        (count > LILAC_ARCHIVE_MAX_COUNT) ||
+        (count * RECORD_LEN > index_len)) {
+      status = 0;
+      err = LILAC_ARCHIVE_ERR_FORMAT;
+    }
+  }
+  
+  /* Allocate the entries and the name storage, which needs at most the
+   * length of the index */
+  if (status) {
+    pA->count = (int32_t) count;
+    if (count > 0) {
+      pA->pEntries = (ENTRY *) calloc((size_t) count, sizeof(ENTRY));
+      names_size = (size_t) index_len;
+      pA->pNames = (char *) malloc(names_size);
+      if ((pA->pEntries == NULL) || (pA->pNames == NULL)) {
+        abort();
+      }
+    }
+  }
+  
+  /* Read each index record */
+  if (status) {
+    pr = pA->pMap + pA->index_offset;
+    pn = pA->pNames;
+    pos = 0;
+  
+    for(i = 0; i < pA->count; i++) {
+      if (pos + RECORD_LEN > (size_t) index_len) {
+        status = 0;
+        break;
+      }
+  
+      (pA->pEntries)[i].offset = get_u64(pr + pos);
+      (pA->pEntries)[i].length = get_u64(pr + pos + 8);
+      name_len = (size_t) pr[pos + 16];
+      pos += RECORD_LEN;
+  
+      if ((pos + name_len > (size_t) index_len) ||
+          (!valid_name((const char *) (pr + pos), name_len))) {
+        status = 0;
+        break;
+      }
+  
+      if (((pA->pEntries)[i].offset < HEADER_LEN) ||
+          ((pA->pEntries)[i].offset > pA->index_offset) ||
+          ((pA->pEntries)[i].length >
+              pA->index_offset - (pA->pEntries)[i].offset)) {
+        status = 0;
+        break;
+      }
+  
+      /* The name takes name_len bytes of the index and name_len + 1
+       * bytes of storage, but the record header is longer than one
+       * byte, so the storage never runs out */
+      memcpy(pn, pr + pos, name_len);
+      pn[name_len] = (char) 0;
+      (pA->pEntries)[i].pName = pn;
+      pn += name_len + 1;
+      pos += name_len;
+    }
+  
+    if ((!status) || (pos != (size_t) index_len)) {
+      status = 0;
+      err = LILAC_ARCHIVE_ERR_FORMAT;
+    }
+  }
+  
+  /* Sort the entries by name and check for duplicates */
+  if (status && (pA->count > 1)) {
+    qsort(pA->pEntries, (size_t) pA->count, sizeof(ENTRY), &cmp_entry);
+    for(i = 1; i < pA->count; i++) {
+      if (strcmp((pA->pEntries)[i - 1].pName,
+                  (pA->pEntries)[i].pName) == 0) {
+        status = 0;
+        err = LILAC_ARCHIVE_ERR_DUP;
+        break;
+      }
+    }
+  }
+  
+  /* Release the archive on failure */
+  if (!status) {
+    lilac_archive_close(pA);
+    pA = NULL;
+  }
+  
+  if (pErrCode != NULL) {
+    *pErrCode = err;
+  }
+  return pA;
+}
+
+/*
+ * lilac_archive_close function.
+ */
+void lilac_archive_close(LILAC_ARCHIVE *pA) {
+  
+  if (pA != NULL) {
+    if (pA->pMap != NULL) {
+      munmap((void *) pA->pMap, pA->map_len);
+      pA->pMap = NULL;
+    }
+    free(pA->pEntries);
+    free(pA->pNames);
+    free(pA);
+  }
+}
+
+/*
+ * lilac_archive_count function.
+ */
+int32_t lilac_archive_count(LILAC_ARCHIVE *pA) {
+  
+  if (pA == NULL) {
+    abort();
+  }
+  
+  return pA->count;
+}
+
+/*
+ * lilac_archive_find function.
+ */
+int32_t lilac_archive_find(LILAC_ARCHIVE *pA, const char *pName) {
+  
+  int32_t lo = 0;
+  int32_t hi = 0;
+  int32_t mid = 0;
+  int c = 0;
+  
+  if ((pA == NULL) || (pName == NULL)) {
+    abort();
+  }
+  
+  /* Binary search of the sorted entries */
+  lo = 0;
+  hi = pA->count - 1;
+  while (lo <= hi) {
+    mid = lo + ((hi - lo) / 2);
+    c = strcmp(pName, (pA->pEntries)[mid].pName);
+    if (c == 0) {
+      return mid;
+    } else if (c < 0) {
+      hi = mid - 1;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  
+  return -1;
+}
+
+/*
+ * lilac_archive_name function.
+ */
+const char *lilac_archive_name(LILAC_ARCHIVE *pA, int32_t i) {
+  
+  if (pA == NULL) {
+    abort();
+  }
+  if ((i < 0) || (i >= pA->count)) {
+    abort();
+  }
+  
+  return (pA->pEntries)[i].pName;
+}
+
+/*
+ * lilac_archive_data function.
+ */
+const unsigned char *lilac_archive_data(
+    LILAC_ARCHIVE * pA,
+    int32_t         i,
+    size_t        * pLen) {
+  
+  if ((pA == NULL) || (pLen == NULL)) {
+    abort();
+  }
+  if ((i < 0) || (i >= pA->count)) {
+    abort();
+  }
+  
+  *pLen = (size_t) (pA->pEntries)[i].length;
+  if (*pLen < 1) {
+    return NULL;
+  }
+  
+  return pA->pMap + (size_t) (pA->pEntries)[i].offset;
+}
+
+/*
+ * lilac_archive_ref function.
+ */
+int lilac_archive_ref(
+    const char  * pRef,
+    char       ** ppPath,
+    const char ** ppName) {
+  
+  const char *pc = NULL;
+  size_t len = 0;
+  
+  if ((pRef == NULL) || (ppPath == NULL) || (ppName == NULL)) {
+    abort();
+  }
+  
+  *ppPath = NULL;
+  *ppName = NULL;
+  
+  /* Find the last colon and check the extension before it */
+  pc = strrchr(pRef, ':');
+  if (pc == NULL) {
+    return 0;
+  }
+  
+  len = (size_t) (pc - pRef);
+  if (len < 5) {
+    return 0;
+  }
+  if ((pRef[len - 4] != '.') ||
+      (tolower((unsigned char) pRef[len - 3]) != 'l') ||
+      (tolower((unsigned char) pRef[len - 2]) != 'm') ||
+      (tolower((unsigned char) pRef[len - 1]) != 'a')) {
+    return 0;
+  }
+  
+  /* Copy the archive path */
+  *ppPath = (char *) malloc(len + 1);
+  if (*ppPath == NULL) {
+    abort();
+  }
+  memcpy(*ppPath, pRef, len);
+  (*ppPath)[len] = (char) 0;
+  
+  *ppName = pc + 1;
+  return 1;
+}
+
+/*
+ * lilac_archive_valid_name function.
+ */
+int lilac_archive_valid_name(const char *pName) {
+  
+  if (pName == NULL) {
+    abort();
+  }
+  
+  return valid_name(pName, strlen(pName));
+}
+
+/*
+ * lilac_archive_writer_open function.
+ */
+LILAC_ARCHIVE_WRITER *lilac_archive_writer_open(
+    const char * pPath,
+    int        * pErrCode) {
+  
+  int status = 1;
+  int err = LILAC_ARCHIVE_ERR_OK;
+  int32_t i = 0;
+  FILE *pf = NULL;
+  LILAC_ARCHIVE *pA = NULL;
+  LILAC_ARCHIVE_WRITER *pW = NULL;
+  unsigned char header[HEADER_LEN];
+  unsigned char trailer[TRAILER_LEN];
+  
+  memset(header, 0, sizeof(header));
+  memset(trailer, 0, sizeof(trailer));
+  
+  /* Check parameters */
+  if (pPath == NULL) {
+    abort();
+  }
+  
+  /* Allocate the writer */
+  pW = (LILAC_ARCHIVE_WRITER *) calloc(1, sizeof(LILAC_ARCHIVE_WRITER));
+  if (pW == NULL) {
+    abort();
+  }
+  
+  /* If the archive exists, load its index and continue writing after
+   * its trailer; otherwise, create a new, empty archive */
+  pf = fopen(pPath, "rb");
+  if (pf != NULL) {
+    fclose(pf);
+    pf = NULL;
+  
+    pA = lilac_archive_open(pPath, &err);
+    if (pA == NULL) {
+      status = 0;
+    }
+  
+    if (status) {
+      while (pW->cap < pA->count) {
+        writer_grow(pW);
+      }
+      for(i = 0; i < pA->count; i++) {
+        (pW->pEntries)[i].offset = (pA->pEntries)[i].offset;
+        (pW->pEntries)[i].length = (pA->pEntries)[i].length;
+        (pW->pEntries)[i].pName = (char *) malloc(
+                  strlen((pA->pEntries)[i].pName) + 1);
+        if ((pW->pEntries)[i].pName == NULL) {
+          abort();
+        }
+        strcpy((pW->pEntries)[i].pName, (pA->pEntries)[i].pName);
+        pW->count = i + 1;
+        writer_hash_insert(pW, i);
+      }
+      pW->data_end = pA->length;
+  
+      lilac_archive_close(pA);
+      pA = NULL;
+  
+      pW->pFile = fopen(pPath, "r+b");
+      if (pW->pFile == NULL) {
+        status = 0;
+        err = LILAC_ARCHIVE_ERR_OPEN;
+      }
+    }
+  
+    /* Record the current length in the header, in case the header does
+     * not have it yet, so that readers ignore the new data until the
+     * writer is closed */
+    if (status) {
+      err = writer_commit(pW, pW->data_end);
+      if (err) {
+        status = 0;
+      }
+    }
+  
+  } else {
+    pW->pFile = fopen(pPath, "w+b");
+    if (pW->pFile == NULL) {
+      status = 0;
+      err = LILAC_ARCHIVE_ERR_OPEN;
+    }
+  
+    /* Write an empty archive, so that the new archive is valid even if
+     * adding meshes to it is interrupted */
+    if (status) {
+      memcpy(header, HEADER_MAGIC, HEADER_MAGIC_LEN);
+      put_u64(trailer, HEADER_LEN);
+      memcpy(trailer + (TRAILER_LEN - TRAILER_MAGIC_LEN),
+              TRAILER_MAGIC, TRAILER_MAGIC_LEN);
+      if ((fwrite(header, 1, HEADER_LEN, pW->pFile) != HEADER_LEN) ||
+          (fwrite(trailer, 1, TRAILER_LEN, pW->pFile) != TRAILER_LEN)) {
+        status = 0;
+        err = LILAC_ARCHIVE_ERR_IO;
+      }
+      pW->data_end = HEADER_LEN + TRAILER_LEN;
+    }
+  
+    if (status) {
+      err = writer_commit(pW, pW->data_end);
+      if (err) {
+        status = 0;
+      }
+    }
+  }
+  
+  /* Release the writer on failure */
+  if (!status) {
+    writer_free(pW);
+    pW = NULL;
+  }
+  
+  if (pErrCode != NULL) {
+    *pErrCode = err;
+  }
+  return pW;
+}
+
+/*
+ * lilac_archive_writer_add function.
+ */
+int lilac_archive_writer_add(
+          LILAC_ARCHIVE_WRITER * pW,
+    const char                 * pName,
+    const unsigned char        * pData,
+          size_t                 len) {
+  
+  ENTRY *pe = NULL;
+  
+  /* Check parameters */
+  if ((pW == NULL) || (pName == NULL)) {
+    abort();
+  }
+  if ((pData == NULL) && (len > 0)) {
+    abort();
+  }
+  
+  /* Check the name */
+  if (!valid_name(pName, strlen(pName))) {
+    return LILAC_ARCHIVE_ERR_NAME;
+  }
+  if (writer_hash_find(pW, pName)) {
+    return LILAC_ARCHIVE_ERR_DUP;
+  }
+  if (pW->count >= LILAC_ARCHIVE_MAX_COUNT) {
+    return LILAC_ARCHIVE_ERR_FULL;
+  }
+  
+  /* Write the data at the end of the mesh data */
+  if (len > 0) {
+    if (fseeko(pW->pFile, (off_t) pW->data_end, SEEK_SET)) {
+      pW->failed = 1;
+      return LILAC_ARCHIVE_ERR_IO;
+    }
+    if (fwrite(pData, 1, len, pW->pFile) != len) {
+      pW->failed = 1;
+      return LILAC_ARCHIVE_ERR_IO;
+    }
+  }
+  
+  /* Add the entry */
+  if (pW->count >= pW->cap) {
+    writer_grow(pW);
+  }
+  
+  pe = &((pW->pEntries)[pW->count]);
+  pe->offset = pW->data_end;
+  pe->length = (uint64_t) len;
+  pe->pName = (char *) malloc(strlen(pName) + 1);
+  if (pe->pName == NULL) {
+    abort();
+  }
+  strcpy(pe->pName, pName);
+  
+  writer_hash_insert(pW, pW->count);
+  (pW->count)++;
+  pW->data_end += (uint64_t) len;
+  
+  return LILAC_ARCHIVE_ERR_OK;
+}
+
+/*
+ * lilac_archive_writer_close function.
+ */
+int lilac_archive_writer_close(LILAC_ARCHIVE_WRITER *pW) {
+  
+  int err = LILAC_ARCHIVE_ERR_OK;
+  int32_t i = 0;
+  size_t name_len = 0;
+  uint64_t index_len = 0;
+  unsigned char rec[RECORD_LEN];
+  unsigned char trailer[TRAILER_LEN];
+  
+  memset(rec, 0, sizeof(rec));
+  memset(trailer, 0, sizeof(trailer));
+  
+  if (pW == NULL) {
+    return LILAC_ARCHIVE_ERR_OK;
+  }
+  
+  if (pW->failed) {
+    err = LILAC_ARCHIVE_ERR_IO;
+  }
+  
+  /* Write the index after the mesh data */
+  if (!err) {
+    if (fseeko(pW->pFile, (off_t) pW->data_end, SEEK_SET)) {
+      err = LILAC_ARCHIVE_ERR_IO;
+    }
+  }
+  
+  for(i = 0; (!err) && (i < pW->count); i++) {
+    name_len = strlen((pW->pEntries)[i].pName);
+    put_u64(rec, (pW->pEntries)[i].offset);
+    put_u64(rec + 8, (pW->pEntries)[i].length);
+    rec[16] = (unsigned char) name_len;
+  
+    if ((fwrite(rec, 1, RECORD_LEN, pW->pFile) != RECORD_LEN) ||
+        (fwrite((pW->pEntries)[i].pName, 1, name_len, pW->pFile)
+            != name_len)) {
+      err = LILAC_ARCHIVE_ERR_IO;
+    }
+    index_len += (uint64_t) (RECORD_LEN + name_len);
+  }
+  
+  /* Write the trailer */
+  if (!err) {
+    put_u64(trailer, pW->data_end);
+    put_u64(trailer + 8, index_len);
+    put_u32(trailer + 16, (uint32_t) pW->count);
+    memcpy(trailer + (TRAILER_LEN - TRAILER_MAGIC_LEN),
+            TRAILER_MAGIC, TRAILER_MAGIC_LEN);
+    if (fwrite(trailer, 1, TRAILER_LEN, pW->pFile) != TRAILER_LEN) {
+      err = LILAC_ARCHIVE_ERR_IO;
+    }
+  }
+  
+  /* Make the new index take effect */
+  if (!err) {
+    err = writer_commit(pW, pW->data_end + index_len + TRAILER_LEN);
+  }
+  
+  /* Drop any bytes that an interrupted append left after the new
+   * trailer */
+  if (!err) {
+    if (ftruncate(fileno(pW->pFile),
+          (off_t) (pW->data_end + index_len + TRAILER_LEN))) {
+      /* Harmless, since readers ignore bytes after the archive */
+    }
+  }
+  
+  /* Close the file */
+  if (fclose(pW->pFile)) {
+    if (!err) {
+      err = LILAC_ARCHIVE_ERR_IO;
+    }
+  }
+  pW->pFile = NULL;
+  
+  writer_free(pW);
+  return err;
+}
+
+/*
+ * lilac_archive_errstr function.
+ */
+const char *lilac_archive_errstr(int code) {
+  
+  const char *pResult = NULL;
+  
+  switch (code) {
+  
+    case LILAC_ARCHIVE_ERR_OK:
+      pResult = "No error";
+      break;
+  
+    case LILAC_ARCHIVE_ERR_OPEN:
+      pResult = "Can't open archive file";
+      break;
+  
+    case LILAC_ARCHIVE_ERR_IO:
+      pResult = "I/O error on archive file";
+      break;
+  
+    case LILAC_ARCHIVE_ERR_FORMAT:
+      pResult = "Not a valid mesh archive";
+      break;
+  
+    case LILAC_ARCHIVE_ERR_NAME:
+      pResult = "Invalid mesh name for archive";
+      break;
+  
+    case LILAC_ARCHIVE_ERR_DUP:
+      pResult = "Duplicate mesh name in archive";
+      break;
+  
+    case LILAC_ARCHIVE_ERR_FULL:
+      pResult = "Too many meshes in archive";
+      break;
+  
+    default:
+      pResult = "Unknown error";
+  }
+  
+  return pResult;
+}
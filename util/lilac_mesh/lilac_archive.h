@@ -0,0 +1,347 @@
+#ifndef LILAC_ARCHIVE_H_INCLUDED
+#define LILAC_ARCHIVE_H_INCLUDED
+
+/*
+ * lilac_archive.h
+ * ===============
+ * 
+ * Lilac module for indexed archives of many mesh files.
+ * 
+ * A Lilac mesh archive packs many mesh files into a single file with an
+ * index of names and offsets, so that batch jobs do not have to open,
+ * stat, and read hundreds of thousands of small files.  The stored mesh
+ * files are copied byte for byte, so they may be in any format that the
+ * reader understands, including compressed files.  See MeshArchive.md
+ * in the documentation folder for the exact file format.
+ * 
+ * Archives are read through a read-only memory mapping of the whole
+ * file, so looking up a mesh by name is a binary search of the index and
+ * the mesh data is accessed in place without any copying.  Archives are
+ * written with a writer object, which creates a new archive or appends
+ * to an existing one and writes the updated index when closed.  An
+ * append does not touch the old index, so an append that fails leaves
+ * the old archive intact.
+ * 
+ * To address a mesh within an archive by a single path string, use the
+ * archive path, a colon, and the name of the mesh, such as
+ * "meshes.lma:face01".  lilac_archive_ref() splits such references.
+ * 
+ * This module requires POSIX for mmap().
+ */
+
+/*
+ * Imports
+ * -------
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Error codes
+ * -----------
+ * 
+ * Zero means no error, and is defined here as LILAC_ARCHIVE_ERR_OK.
+ * 
+ * Error codes can be converted into error message strings using
+ * lilac_archive_errstr().
+ */
+
+#define LILAC_ARCHIVE_ERR_OK     (0)   /* No error */
+#define LILAC_ARCHIVE_ERR_OPEN   (1)   /* Can't open archive file */
+#define LILAC_ARCHIVE_ERR_IO     (2)   /* I/O error */
+#define LILAC_ARCHIVE_ERR_FORMAT (3)   /* Not a valid archive */
+#define LILAC_ARCHIVE_ERR_NAME   (4)   /* Invalid mesh name */
+#define LILAC_ARCHIVE_ERR_DUP    (5)   /* Duplicate mesh name */
+#define LILAC_ARCHIVE_ERR_FULL   (6)   /* Too many meshes or too large */
+
+/*
+ * Constants
+ * ---------
+ */
+
+/*
+ * The maximum length in bytes of a mesh name within an archive.
+ * 
+ * Names must be at least one byte long.  Each byte must be a printable
+ * ASCII character in range 0x20 to 0x7e, except that the colon is not
+ * allowed, since it separates the archive path from the name in mesh
+ * references.
+ */
+#define LILAC_ARCHIVE_MAX_NAME (255)
+
+/*
+ * The maximum number of meshes in an archive.
+ */
+#define LILAC_ARCHIVE_MAX_COUNT (INT32_C(16777216))
+
+/*
+ * Type declarations
+ * -----------------
+ */
+
+/*
+ * Opaque structure for an archive opened for reading.
+ */
+struct LILAC_ARCHIVE_TAG;
+typedef struct LILAC_ARCHIVE_TAG LILAC_ARCHIVE;
+
+/*
+ * Opaque structure for an archive opened for writing.
+ */
+struct LILAC_ARCHIVE_WRITER_TAG;
+typedef struct LILAC_ARCHIVE_WRITER_TAG LILAC_ARCHIVE_WRITER;
+
+/*
+ * Public functions
+ * ----------------
+ */
+
+/*
+ * Open an existing archive for reading.
+ * 
+ * The whole archive file is mapped into memory read-only, and the index
+ * is validated and sorted by name.
+ * 
+ * pErrCode, if not NULL, receives LILAC_ARCHIVE_ERR_OK upon success or
+ * an error code upon failure.
+ * 
+ * Parameters:
+ * 
+ *   pPath - the path to the archive file
+ * 
+ *   pErrCode - pointer to variable to receive the error code, or NULL
+ * 
+ * Return:
+ * 
+ *   the opened archive, or NULL if failure
+ */
+LILAC_ARCHIVE *lilac_archive_open(const char *pPath, int *pErrCode);
+
+/*
+ * Close an archive opened for reading.
+ * 
+ * All data pointers returned from the archive become invalid.  If NULL
+ * is passed, the call is ignored.
+ * 
+ * Parameters:
+ * 
+ *   pA - the archive to close, or NULL
+ */
+void lilac_archive_close(LILAC_ARCHIVE *pA);
+
+/*
+ * Return the number of meshes in an archive.
+ * 
+ * Parameters:
+ * 
+ *   pA - the archive
+ * 
+ * Return:
+ * 
+ *   the number of meshes
+ */
+int32_t lilac_archive_count(LILAC_ARCHIVE *pA);
+
+/*
+ * Find a mesh by name within an archive.
+ * 
+ * Parameters:
+ * 
+ *   pA - the archive
+ * 
+ *   pName - the name of the mesh
+ * 
+ * Return:
+ * 
+ *   the index of the mesh, or -1 if there is no mesh with that name
+ */
+int32_t lilac_archive_find(LILAC_ARCHIVE *pA, const char *pName);
+
+/*
+ * Return the name of a mesh within an archive.
+ * 
+ * Meshes are indexed in ascending order of name, compared byte by byte.
+ * The returned string is owned by the archive and valid until the
+ * archive is closed.
+ * 
+ * Parameters:
+ * 
+ *   pA - the archive
+ * 
+ *   i - the index of the mesh
+ * 
+ * Return:
+ * 
+ *   the name of the mesh
+ */
+const char *lilac_archive_name(LILAC_ARCHIVE *pA, int32_t i);
+
+/*
+ * Return the data of a mesh within an archive.
+ * 
+ * The returned pointer is into the read-only memory mapping of the
+ * archive, and it is valid until the archive is closed.  It is not
+ * terminated in any way, so the length must be used.
+ * 
+ * Parameters:
+ * 
+ *   pA - the archive
+ * 
+ *   i - the index of the mesh
+ * 
+ *   pLen - receives the length of the data in bytes
+ * 
+ * Return:
+ * 
+ *   pointer to the data, or NULL if the length is zero
+ */
+const unsigned char *lilac_archive_data(
+    LILAC_ARCHIVE * pA,
+    int32_t         i,
+    size_t        * pLen);
+
+/*
+ * Split a mesh reference into an archive path and a mesh name.
+ * 
+ * A reference is an archive reference if it contains a colon and the
+ * part before the last colon ends in ".lma", compared case-insensitive.
+ * Any other reference is an ordinary file path.
+ * 
+ * For archive references, the archive path is copied into a newly
+ * allocated string, which the caller must eventually free(), and the
+ * name is a pointer into the reference just after the last colon.
+ * 
+ * Parameters:
+ * 
+ *   pRef - the mesh reference
+ * 
+ *   ppPath - receives the newly allocated archive path, or NULL if not
+ *   an archive reference
+ * 
+ *   ppName - receives the mesh name, or NULL if not an archive
+ *   reference
+ * 
+ * Return:
+ * 
+ *   non-zero if an archive reference, zero if an ordinary file path
+ */
+int lilac_archive_ref(
+    const char  * pRef,
+    char       ** ppPath,
+    const char ** ppName);
+
+/*
+ * Check whether a string is a valid mesh name for an archive.
+ * 
+ * See LILAC_ARCHIVE_MAX_NAME for the rules.  This lets callers check
+ * all names before they start writing to an archive.
+ * 
+ * Parameters:
+ * 
+ *   pName - the name
+ * 
+ * Return:
+ * 
+ *   non-zero if valid, zero if not
+ */
+int lilac_archive_valid_name(const char *pName);
+
+/*
+ * Open an archive for writing.
+ * 
+ * If the archive file does not exist, a new, empty archive is created.
+ * Otherwise, the existing archive is validated and new meshes will be
+ * appended to it.
+ * 
+ * New mesh data is written after the old trailer, and the new index
+ * only takes effect when lilac_archive_writer_close() succeeds.  Until
+ * then, and whenever writing fails or is interrupted, readers see the
+ * archive exactly as it was before it was opened for writing.
+ * 
+ * pErrCode, if not NULL, receives LILAC_ARCHIVE_ERR_OK upon success or
+ * an error code upon failure.
+ * 
+ * Parameters:
+ * 
+ *   pPath - the path to the archive file
+ * 
+ *   pErrCode - pointer to variable to receive the error code, or NULL
+ * 
+ * Return:
+ * 
+ *   the archive writer, or NULL if failure
+ */
+LILAC_ARCHIVE_WRITER *lilac_archive_writer_open(
+    const char * pPath,
+    int        * pErrCode);
+
+/*
+ * Append a mesh to an archive.
+ * 
+ * The name must be valid (see LILAC_ARCHIVE_MAX_NAME) and must not
+ * already be used within the archive.  The data is copied into the
+ * archive byte for byte.
+ * 
+ * Parameters:
+ * 
+ *   pW - the archive writer
+ * 
+ *   pName - the name of the mesh
+ * 
+ *   pData - the mesh data, which may be NULL only if len is zero
+ * 
+ *   len - the length of the mesh data in bytes
+ * 
+ * Return:
+ * 
+ *   LILAC_ARCHIVE_ERR_OK if successful, or an error code
+ */
+int lilac_archive_writer_add(
+          LILAC_ARCHIVE_WRITER * pW,
+    const char                 * pName,
+    const unsigned char        * pData,
+          size_t                 len);
+
+/*
+ * Write the index of an archive and close the writer.
+ * 
+ * The writer is released even if the index could not be written, in
+ * which case none of the meshes added by this writer are in the archive
+ * and the archive is otherwise unchanged.  If NULL is passed, the call
+ * is ignored and LILAC_ARCHIVE_ERR_OK is returned.
+ * 
+ * Parameters:
+ * 
+ *   pW - the archive writer, or NULL
+ * 
+ * Return:
+ * 
+ *   LILAC_ARCHIVE_ERR_OK if successful, or an error code
+ */
+int lilac_archive_writer_close(LILAC_ARCHIVE_WRITER *pW);
+
+/*
+ * Given an error code from this module, return an error message
+ * corresponding to that code.
+ * 
+ * The string has the first letter capitalized, but no punctuation or
+ * line break at the end.
+ * 
+ * If the given code is not recognized, "Unknown error" is returned.  If
+ * the given code is LILAC_ARCHIVE_ERR_OK (0), "No error" is returned.
+ * 
+ * The returned string is statically allocated.  The client should not
+ * attempt to free it.
+ * 
+ * Parameters:
+ * 
+ *   code - the error code
+ * 
+ * Return:
+ * 
+ *   an error message
+ */
+const char *lilac_archive_errstr(int code);
+
+#endif
@@ -0,0 +1,867 @@
+/*
+ * lilac_edit.c
+ * ============
+ * 
+ * Implementation of lilac_edit.h
+ * 
+ * See the header for further information.
+ */
+
+#include "lilac_edit.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Constants
+ * ---------
+ */
+
+/*
+ * The number of slots in the directed edge hash table.
+ * 
+ * This must be a power of two.  Each triangle has three directed edges,
+ * so the table is never more than 3/8 full.
+ */
+#define EDGE_HASH_BITS (13)
+#define EDGE_HASH_SIZE (1 << EDGE_HASH_BITS)
+
+/*
+ * Key value of an empty slot in the edge hash table.
+ */
+#define EDGE_EMPTY (UINT32_MAX)
+
+/*
+ * Type declarations
+ * -----------------
+ */
+
+/*
+ * LILAC_EDIT structure.
+ * 
+ * Triangles are stored in slots, each slot holding three vertex indices
+ * with the lowest index first.  Unused slots are kept on a stack.
+ * 
+ * Each vertex of a slot is a corner, numbered slot * 3 plus the vertex
+ * position.  The corners that use each point are kept in a doubly
+ * linked list starting at the point, so a point is an orphan exactly
+ * when its list is empty.
+ * 
+ * The edge hash table maps each directed edge, as the start vertex
+ * shifted left 16 bits plus the end vertex, to the slot of the triangle
+ * that has it.  It uses linear probing.
+ */
+struct LILAC_EDIT_TAG {
+  
+  int32_t point_count;
+  int32_t tri_count;
+  int32_t free_count;
+  
+  LILAC_MESH_POINT pts[LILAC_MESH_MAX_POINTS];
+  int16_t corner_head[LILAC_MESH_MAX_POINTS];
+  
+  uint16_t tris[LILAC_MESH_MAX_TRIS * 3];
+  int16_t corner_next[LILAC_MESH_MAX_TRIS * 3];
+  int16_t corner_prev[LILAC_MESH_MAX_TRIS * 3];
+  int16_t free_slots[LILAC_MESH_MAX_TRIS];
+  
+  uint32_t edge_key[EDGE_HASH_SIZE];
+  int16_t edge_slot[EDGE_HASH_SIZE];
+};
+
+/*
+ * Local functions
+ * ---------------
+ */
+
+/* Prototypes */
+static uint32_t edge_home(uint32_t key);
+static int32_t edge_find(const LILAC_EDIT *pE, int32_t a, int32_t b);
+static void edge_insert(LILAC_EDIT *pE, int32_t a, int32_t b, int32_t s);
+static void edge_remove(LILAC_EDIT *pE, int32_t a, int32_t b);
+
+static void link_tri(LILAC_EDIT *pE, int32_t s);
+static void unlink_tri(LILAC_EDIT *pE, int32_t s);
+static void canon_tri(uint16_t *pt);
+
+static int32_t orient(
+    const LILAC_MESH_POINT * pa,
+    const LILAC_MESH_POINT * pb,
+    const LILAC_MESH_POINT * pc);
+
+static int check_normal(int32_t normd, int32_t norma);
+static void release_point(LILAC_EDIT *pE, int32_t i);
+static int cmp_second(const void *pA, const void *pB);
+
+/*
+ * Get the home slot of a key in the edge hash table.
+ * 
+ * Parameters:
+ * 
+ *   key - the edge key
+ * 
+ * Return:
+ * 
+ *   the home slot
+ */
+static uint32_t edge_home(uint32_t key) {
+  return (uint32_t) ((key * UINT32_C(2654435761)) >> (32 - EDGE_HASH_BITS));
+}
+
+/*
+ * Find the triangle that has a directed edge.
+ * 
+ * Parameters:
+ * 
+ *   pE - the editing object
+ * 
+ *   a - the start vertex of the edge
+ * 
+ *   b - the end vertex of the edge
+ * 
+ * Return:
+ * 
+ *   the slot of the triangle, or -1 if there is none
+ */
+static int32_t edge_find(const LILAC_EDIT *pE, int32_t a, int32_t b) {
+  
+  uint32_t key = 0;
+  uint32_t h = 0;
+  
+  key = (((uint32_t) a) << 16) | ((uint32_t) b);
+  for(h = edge_home(key);
+      pE->edge_key[h] != EDGE_EMPTY;
+      h = (h + 1) & (EDGE_HASH_SIZE - 1)) {
+    if (pE->edge_key[h] == key) {
+      return pE->edge_slot[h];
+    }
+  }
+  
+  return -1;
+}
+
+/*
+ * Add a directed edge to the hash table.
+ * 
+ * The edge must not already be present.
+ * 
+ * Parameters:
+ * 
+ *   pE - the editing object
+ * 
+ *   a - the start vertex of the edge
+ * 
+ *   b - the end vertex of the edge
+ * 
+ *   s - the slot of the triangle that has the edge
+ */
+static void edge_insert(LILAC_EDIT *pE, int32_t a, int32_t b, int32_t s) {
+  
+  uint32_t key = 0;
+  uint32_t h = 0;
+  
+  key = (((uint32_t) a) << 16) | ((uint32_t) b);
+  for(h = edge_home(key);
+      pE->edge_key[h] != EDGE_EMPTY;
+      h = (h + 1) & (EDGE_HASH_SIZE - 1));
+  
+  pE->edge_key[h] = key;
+  pE->edge_slot[h] = (int16_t) s;
+}
+
+/*
+ * Remove a directed edge from the hash table.
+ * 
+ * The edge must be present.  Later entries of the same probe run are
+ * shifted back into the gap, so that lookups never need tombstones.
+ * 
+ * Parameters:
+ * 
+ *   pE - the editing object
+ * 
+ *   a - the start vertex of the edge
+ * 
+ *   b - the end vertex of the edge
+ */
+static void edge_remove(LILAC_EDIT *pE, int32_t a, int32_t b) {
+  
+  uint32_t key = 0;
+  uint32_t h = 0;
+  uint32_t j = 0;
+  uint32_t home = 0;
+  
+  key = (((uint32_t) a) << 16) | ((uint32_t) b);
+  for(h = edge_home(key);
+      pE->edge_key[h] != key;
+      h = (h + 1) & (EDGE_HASH_SIZE - 1)) {
+    if (pE->edge_key[h] == EDGE_EMPTY) {
+      abort();
+    }
+  }
+  
+  j = h;
+  for(j = (j + 1) & (EDGE_HASH_SIZE - 1);
+      pE->edge_key[j] != EDGE_EMPTY;
+      j = (j + 1) & (EDGE_HASH_SIZE - 1)) {
+  
+    /* An entry may fill the gap only if its home is not within the
+     * cyclic range after the gap up to the entry */
+    home = edge_home(pE->edge_key[j]);
+    if (((j - home) & (EDGE_HASH_SIZE - 1)) >=
+        ((j - h) & (EDGE_HASH_SIZE - 1))) {
+      pE->edge_key[h] = pE->edge_key[j];
+      pE->edge_slot[h] = pE->edge_slot[j];
+      h = j;
+    }
+  }
+  
+  pE->edge_key[h] = EDGE_EMPTY;
+}
+
+/*
+ * Add the corners and edges of a stored triangle to the indices.
+ * 
+ * Parameters:
+ * 
+ *   pE - the editing object
+ * 
+ *   s - the slot of the triangle
+ */
+static void link_tri(LILAC_EDIT *pE, int32_t s) {
+  
+  int32_t k = 0;
+  int32_t c = 0;
+  int32_t v = 0;
+  const uint16_t *pt = NULL;
+  
+  pt = &((pE->tris)[s * 3]);
+  for(k = 0; k < 3; k++) {
+    c = s * 3 + k;
+    v = pt[k];
+  
+    pE->corner_prev[c] = -1;
+    pE->corner_next[c] = pE->corner_head[v];
+    if (pE->corner_head[v] >= 0) {
+      pE->corner_prev[pE->corner_head[v]] = (int16_t) c;
+    }
+    pE->corner_head[v] = (int16_t) c;
+  
+    edge_insert(pE, v, pt[(k + 1) % 3], s);
+  }
+}
+
+/*
+ * Remove the corners and edges of a stored triangle from the indices.
+ * 
+ * Parameters:
+ * 
+ *   pE - the editing object
+ * 
+ *   s - the slot of the triangle
+ */
+static void unlink_tri(LILAC_EDIT *pE, int32_t s) {
+  
+  int32_t k = 0;
+  int32_t c = 0;
+  int32_t v = 0;
+  const uint16_t *pt = NULL;
+  
+  pt = &((pE->tris)[s * 3]);
+  for(k = 0; k < 3; k++) {
+    c = s * 3 + k;
+    v = pt[k];
+  
+    if (pE->corner_prev[c] >= 0) {
+      pE->corner_next[pE->corner_prev[c]] = pE->corner_next[c];
+    } else {
+      pE->corner_head[v] = pE->corner_next[c];
+    }
+    if (pE->corner_next[c] >= 0) {
+      pE->corner_prev[pE->corner_next[c]] = pE->corner_prev[c];
+    }
+  
+    edge_remove(pE, v, pt[(k + 1) % 3]);
+  }
+}
+
+/*
+ * Rotate a triangle so that its lowest vertex comes first.
+ * 
+ * Rotation keeps the winding of the triangle.
+ * 
+ * Parameters:
+ * 
+ *   pt - the three vertices of the triangle
+ */
+static void canon_tri(uint16_t *pt) {
+  
+  uint16_t v = 0;
+  
+  while ((pt[1] < pt[0]) || (pt[2] < pt[0])) {
+    v = pt[0];
+    pt[0] = pt[1];
+    pt[1] = pt[2];
+    pt[2] = v;
+  }
+}
+
+/*
+ * Compute the orientation of three points.
+ * 
+ * Coordinates are at most LILAC_MESH_MAX_C, so the cross product is
+ * computed exactly in 32-bit integers.
+ * 
+ * Parameters:
+ * 
+ *   pa - the first point
+ * 
+ *   pb - the second point
+ * 
+ *   pc - the third point
+ * 
+ * Return:
+ * 
+ *   greater than zero if counter-clockwise, less than zero if
+ *   clockwise, or zero if colinear
+ */
+static int32_t orient(
+    const LILAC_MESH_POINT * pa,
+    const LILAC_MESH_POINT * pb,
+    const LILAC_MESH_POINT * pc) {
+  
+  return (((int32_t) pb->x) - ((int32_t) pa->x)) *
+            (((int32_t) pc->y) - ((int32_t) pa->y)) -
+          (((int32_t) pb->y) - ((int32_t) pa->y)) *
+            (((int32_t) pc->x) - ((int32_t) pa->x));
+}
+
+/*
+ * Check the normal fields of a point.
+ * 
+ * Parameters:
+ * 
+ *   normd - the normal direction away from the viewer
+ * 
+ *   norma - the normal direction angle
+ * 
+ * Return:
+ * 
+ *   LILAC_MESH_ERR_OK or an error code
+ */
+static int check_normal(int32_t normd, int32_t norma) {
+  
+  if ((normd < 0) || (normd > LILAC_MESH_MAX_C) || (norma < 0)) {
+    return LILAC_MESH_ERR_NUMBER;
+  
+  } else if ((normd == 0) && (norma != 0)) {
+    return LILAC_MESH_ERR_NORMDA;
+  
+  } else if (norma >= LILAC_MESH_MAX_C) {
+    return LILAC_MESH_ERR_NORM2P;
+  }
+  
+  return LILAC_MESH_ERR_OK;
+}
+
+/*
+ * Release an orphaned point.
+ * 
+ * The last point is moved into the index of the released point, and
+ * the triangles that use it are renumbered.  Renumbering may change
+ * which vertex is lowest, so each of those triangles is taken out of
+ * the indices, rotated, and put back.
+ * 
+ * Parameters:
+ * 
+ *   pE - the editing object
+ * 
+ *   i - the index of the orphaned point
+ */
+static void release_point(LILAC_EDIT *pE, int32_t i) {
+  
+  int32_t last = 0;
+  int32_t c = 0;
+  int32_t s = 0;
+  int32_t n = 0;
+  int32_t k = 0;
+  int16_t moved[LILAC_MESH_MAX_TRIS];
+  uint16_t *pt = NULL;
+  
+  last = pE->point_count - 1;
+  if (i != last) {
+  
+    /* Gather the triangles of the last point before changing them */
+    for(c = pE->corner_head[last]; c >= 0; c = pE->corner_next[c]) {
+      moved[n] = (int16_t) (c / 3);
+      n++;
+    }
+  
+    for(k = 0; k < n; k++) {
+      s = moved[k];
+      unlink_tri(pE, s);
+  
+      pt = &((pE->tris)[s * 3]);
+      if (pt[0] == last) {
+        pt[0] = (uint16_t) i;
+      } else if (pt[1] == last) {
+        pt[1] = (uint16_t) i;
+      } else {
+        pt[2] = (uint16_t) i;
+      }
+      canon_tri(pt);
+  
+      link_tri(pE, s);
+    }
+  
+    pE->pts[i] = pE->pts[last];
+  }
+  
+  pE->corner_head[last] = -1;
+  (pE->point_count)--;
+}
+
+/*
+ * Comparison function for sorting triangles that share a first vertex
+ * by their second vertex.
+ * 
+ * Parameters:
+ * 
+ *   pA - the first triangle
+ * 
+ *   pB - the second triangle
+ * 
+ * Return:
+ * 
+ *   less than, equal to, or greater than zero
+ */
+static int cmp_second(const void *pA, const void *pB) {
+  
+  const uint16_t *pa = NULL;
+  const uint16_t *pb = NULL;
+  
+  pa = (const uint16_t *) pA;
+  pb = (const uint16_t *) pB;
+  
+  return ((int) pa[1]) - ((int) pb[1]);
+}
+
+/*
+ * Public function implementations
+ * -------------------------------
+ * 
+ * See the header for specifications
+ */
+
+/*
+ * lilac_edit_new function.
+ */
+LILAC_EDIT *lilac_edit_new(const LILAC_MESH *pMesh) {
+  
+  int32_t i = 0;
+  LILAC_EDIT *pE = NULL;
+  
+  /* Check parameter */
+  if (pMesh != NULL) {
+    if (lilac_mesh_check(pMesh, NULL) != LILAC_MESH_ERR_OK) {
+      abort();
+    }
+  }
+  
+  /* Allocate the object and clear the indices */
+  pE = (LILAC_EDIT *) calloc(1, sizeof(LILAC_EDIT));
+  if (pE == NULL) {
+    abort();
+  }
+  
+  for(i = 0; i < LILAC_MESH_MAX_POINTS; i++) {
+    pE->corner_head[i] = -1;
+  }
+  for(i = 0; i < EDGE_HASH_SIZE; i++) {
+    pE->edge_key[i] = EDGE_EMPTY;
+  }
+  
+  /* Stack the slots so that the lowest slot is used first */
+  for(i = 0; i < LILAC_MESH_MAX_TRIS; i++) {
+    pE->free_slots[i] = (int16_t) (LILAC_MESH_MAX_TRIS - 1 - i);
+  }
+  pE->free_count = LILAC_MESH_MAX_TRIS;
+  
+  /* Copy the mesh, if given */
+  if (pMesh != NULL) {
+    pE->point_count = pMesh->point_count;
+    if (pMesh->point_count > 0) {
+      memcpy(pE->pts, pMesh->pPoints,
+              ((size_t) pMesh->point_count) * sizeof(LILAC_MESH_POINT));
+    }
+  
+    for(i = 0; i < pMesh->tri_count; i++) {
+      memcpy(&((pE->tris)[i * 3]), &((pMesh->pTris)[i * 3]),
+              3 * sizeof(uint16_t));
+      link_tri(pE, i);
+    }
+    pE->tri_count = pMesh->tri_count;
+    pE->free_count = LILAC_MESH_MAX_TRIS - pMesh->tri_count;
+  }
+  
+  return pE;
+}
+
+/*
+ * lilac_edit_free function.
+ */
+void lilac_edit_free(LILAC_EDIT *pE) {
+  if (pE != NULL) {
+    free(pE);
+  }
+}
+
+/*
+ * lilac_edit_points function.
+ */
+int32_t lilac_edit_points(const LILAC_EDIT *pE) {
+  if (pE == NULL) {
+    abort();
+  }
+  return pE->point_count;
+}
+
+/*
+ * lilac_edit_tris function.
+ */
+int32_t lilac_edit_tris(const LILAC_EDIT *pE) {
+  if (pE == NULL) {
+    abort();
+  }
+  return pE->tri_count;
+}
+
+/*
+ * lilac_edit_point function.
+ */
+const LILAC_MESH_POINT *lilac_edit_point(const LILAC_EDIT *pE, int32_t i) {
+  if (pE == NULL) {
+    abort();
+  }
+  if ((i < 0) || (i >= pE->point_count)) {
+    abort();
+  }
+  return &((pE->pts)[i]);
+}
+
+/*
+ * lilac_edit_move function.
+ */
+int lilac_edit_move(LILAC_EDIT *pE, int32_t i, int32_t x, int32_t y) {
+  
+  int32_t c = 0;
+  const uint16_t *pt = NULL;
+  LILAC_MESH_POINT old;
+  
+  memset(&old, 0, sizeof(LILAC_MESH_POINT));
+  
+  /* Check parameters */
+  if (pE == NULL) {
+    abort();
+  }
+  if ((i < 0) || (i >= pE->point_count)) {
+    return LILAC_MESH_ERR_PTREF;
+  }
+  if ((x < 0) || (x > LILAC_MESH_MAX_C) ||
+      (y < 0) || (y > LILAC_MESH_MAX_C)) {
+    return LILAC_MESH_ERR_NUMBER;
+  }
+  
+  /* Move the point, then check every triangle around it */
+  old = pE->pts[i];
+  pE->pts[i].x = (uint16_t) x;
+  pE->pts[i].y = (uint16_t) y;
+  
+  for(c = pE->corner_head[i]; c >= 0; c = pE->corner_next[c]) {
+    pt = &((pE->tris)[(c / 3) * 3]);
+    if (orient(&((pE->pts)[pt[0]]),
+                &((pE->pts)[pt[1]]),
+                &((pE->pts)[pt[2]])) <= 0) {
+      pE->pts[i] = old;
+      return LILAC_MESH_ERR_ORIENT;
+    }
+  }
+  
+  return LILAC_MESH_ERR_OK;
+}
+
+/*
+ * lilac_edit_set_normal function.
+ */
+int lilac_edit_set_normal(
+    LILAC_EDIT * pE,
+    int32_t      i,
+    int32_t      normd,
+    int32_t      norma) {
+  
+  int err = 0;
+  
+  /* Check parameters */
+  if (pE == NULL) {
+    abort();
+  }
+  if ((i < 0) || (i >= pE->point_count)) {
+    return LILAC_MESH_ERR_PTREF;
+  }
+  
+  err = check_normal(normd, norma);
+  if (err == LILAC_MESH_ERR_OK) {
+    pE->pts[i].normd = (uint16_t) normd;
+    pE->pts[i].norma = (uint16_t) norma;
+  }
+  
+  return err;
+}
+
+/*
+ * lilac_edit_add_tri function.
+ */
+int lilac_edit_add_tri(
+          LILAC_EDIT       * pE,
+    const int32_t          * pv,
+    const LILAC_MESH_POINT * pNew,
+          int32_t          * pIndex) {
+  
+  int err = 0;
+  int32_t k = 0;
+  int32_t s = 0;
+  int32_t new_count = 0;
+  int32_t vi[3];
+  uint16_t pt[3];
+  LILAC_MESH_POINT p[3];
+  const LILAC_MESH_POINT *pp = NULL;
+  
+  memset(vi, 0, sizeof(vi));
+  memset(pt, 0, sizeof(pt));
+  memset(p, 0, sizeof(p));
+  
+  /* Check parameters */
+  if ((pE == NULL) || (pv == NULL)) {
+    abort();
+  }
+  
+  /* Resolve each vertex to an index and a point */
+  for(k = 0; k < 3; k++) {
+    if (pv[k] == LILAC_EDIT_NEW) {
+      if (pNew == NULL) {
+        abort();
+      }
+      pp = &(pNew[k]);
+      if ((pp->x > LILAC_MESH_MAX_C) || (pp->y > LILAC_MESH_MAX_C)) {
+        return LILAC_MESH_ERR_NUMBER;
+      }
+      err = check_normal(pp->normd, pp->norma);
+      if (err != LILAC_MESH_ERR_OK) {
+        return err;
+      }
+      vi[k] = pE->point_count + new_count;
+      new_count++;
+  
+    } else if ((pv[k] >= 0) && (pv[k] < pE->point_count)) {
+      pp = &((pE->pts)[pv[k]]);
+      vi[k] = pv[k];
+  
+    } else {
+      return LILAC_MESH_ERR_PTREF;
+    }
+    p[k] = *pp;
+  }
+  
+  /* Check the limits */
+  if (pE->point_count + new_count > LILAC_MESH_MAX_POINTS) {
+    return LILAC_MESH_ERR_PTOVER;
+  }
+  if (pE->tri_count >= LILAC_MESH_MAX_TRIS) {
+    return LILAC_MESH_ERR_TROVER;
+  }
+  
+  /* Check the triangle itself */
+  if ((vi[0] == vi[1]) || (vi[0] == vi[2]) || (vi[1] == vi[2])) {
+    return LILAC_MESH_ERR_VXDUP;
+  }
+  
+  s = orient(&(p[0]), &(p[1]), &(p[2]));
+  if (s == 0) {
+    return LILAC_MESH_ERR_ORIENT;
+  }
+  
+  pt[0] = (uint16_t) vi[0];
+  if (s > 0) {
+    pt[1] = (uint16_t) vi[1];
+    pt[2] = (uint16_t) vi[2];
+  } else {
+    pt[1] = (uint16_t) vi[2];
+    pt[2] = (uint16_t) vi[1];
+  }
+  canon_tri(pt);
+  
+  /* Edges to new points can't be present yet */
+  for(k = 0; k < 3; k++) {
+    if (edge_find(pE, pt[k], pt[(k + 1) % 3]) >= 0) {
+      return LILAC_MESH_ERR_DUPEDG;
+    }
+  }
+  
+  /* Add the new points and store the triangle */
+  for(k = 0; k < 3; k++) {
+    if (pv[k] == LILAC_EDIT_NEW) {
+      pE->pts[vi[k]] = p[k];
+    }
+  }
+  pE->point_count += new_count;
+  
+  (pE->free_count)--;
+  s = pE->free_slots[pE->free_count];
+  memcpy(&((pE->tris)[s * 3]), pt, sizeof(pt));
+  link_tri(pE, s);
+  (pE->tri_count)++;
+  
+  if (pIndex != NULL) {
+    memcpy(pIndex, vi, sizeof(vi));
+  }
+  
+  return LILAC_MESH_ERR_OK;
+}
+
+/*
+ * lilac_edit_drop_tri function.
+ */
+int lilac_edit_drop_tri(
+    LILAC_EDIT * pE,
+    int32_t      v1,
+    int32_t      v2,
+    int32_t      v3) {
+  
+  int32_t s = 0;
+  int32_t k = 0;
+  int32_t v = 0;
+  const uint16_t *pt = NULL;
+  int32_t vs[3];
+  
+  memset(vs, 0, sizeof(vs));
+  
+  /* Check parameters */
+  if (pE == NULL) {
+    abort();
+  }
+  if ((v1 < 0) || (v1 >= pE->point_count) ||
+      (v2 < 0) || (v2 >= pE->point_count) ||
+      (v3 < 0) || (v3 >= pE->point_count) ||
+      (v1 == v2) || (v1 == v3) || (v2 == v3)) {
+    return 0;
+  }
+  
+  /* The triangle has either the edge from v1 to v2 or the edge from v2
+   * to v1, and in either case its remaining vertex must be v3 */
+  s = edge_find(pE, v1, v2);
+  if (s >= 0) {
+    pt = &((pE->tris)[s * 3]);
+    if ((pt[0] != v3) && (pt[1] != v3) && (pt[2] != v3)) {
+      s = -1;
+    }
+  }
+  if (s < 0) {
+    s = edge_find(pE, v2, v1);
+    if (s >= 0) {
+      pt = &((pE->tris)[s * 3]);
+      if ((pt[0] != v3) && (pt[1] != v3) && (pt[2] != v3)) {
+        s = -1;
+      }
+    }
+  }
+  if (s < 0) {
+    return 0;
+  }
+  
+  /* Remove the triangle, remembering its vertices in descending order */
+  vs[0] = v1;
+  vs[1] = v2;
+  vs[2] = v3;
+  for(k = 0; k < 2; k++) {
+    if (vs[1] > vs[0]) {
+      v = vs[0];
+      vs[0] = vs[1];
+      vs[1] = v;
+    }
+    if (vs[2] > vs[1]) {
+      v = vs[1];
+      vs[1] = vs[2];
+      vs[2] = v;
+    }
+  }
+  
+  unlink_tri(pE, s);
+  pE->free_slots[pE->free_count] = (int16_t) s;
+  (pE->free_count)++;
+  (pE->tri_count)--;
+  
+  /* Release orphans from the highest index down, so that moving the
+   * last point never affects a point that is still to be released */
+  for(k = 0; k < 3; k++) {
+    if (pE->corner_head[vs[k]] < 0) {
+      release_point(pE, vs[k]);
+    }
+  }
+  
+  return 1;
+}
+
+/*
+ * lilac_edit_mesh function.
+ */
+LILAC_MESH *lilac_edit_mesh(const LILAC_EDIT *pE) {
+  
+  int err = 0;
+  int32_t i = 0;
+  int32_t c = 0;
+  int32_t n = 0;
+  int32_t start = 0;
+  uint16_t *pTris = NULL;
+  LILAC_MESH *pM = NULL;
+  
+  /* Check parameter */
+  if (pE == NULL) {
+    abort();
+  }
+  
+  /* Gather the triangles by first vertex, in ascending order of first
+   * vertex, and sort each group by second vertex */
+  if (pE->tri_count > 0) {
+    pTris = (uint16_t *) malloc(
+                ((size_t) pE->tri_count) * 3 * sizeof(uint16_t));
+    if (pTris == NULL) {
+      abort();
+    }
+  }
+  
+  for(i = 0; i < pE->point_count; i++) {
+    start = n;
+    for(c = pE->corner_head[i]; c >= 0; c = pE->corner_next[c]) {
+      if ((c % 3) == 0) {
+        memcpy(&(pTris[n * 3]), &((pE->tris)[c]), 3 * sizeof(uint16_t));
+        n++;
+      }
+    }
+    if (n - start > 1) {
+      qsort(&(pTris[start * 3]), (size_t) (n - start),
+              3 * sizeof(uint16_t), &cmp_second);
+    }
+  }
+  
+  /* The indices always keep the rules of the mesh format, so the check
+   * in lilac_mesh_from_arrays() can only fail on an internal error */
+  pM = lilac_mesh_from_arrays(
+          pE->pts, pE->point_count, pTris, n, 0, &err);
+  if (pM == NULL) {
+    abort();
+  }
+  
+  free(pTris);
+  pTris = NULL;
+  
+  return pM;
+}
@@ -0,0 +1,284 @@
+#ifndef LILAC_EDIT_H_INCLUDED
+#define LILAC_EDIT_H_INCLUDED
+
+/*
+ * lilac_edit.h
+ * ============
+ * 
+ * Lilac module for editing meshes in memory.
+ * 
+ * A LILAC_MESH is an immutable whole, because inserting or removing a
+ * single triangle would mean shifting the sorted triangle list and
+ * searching it for duplicated edges.  An editing object instead keeps
+ * the points and triangles in indexed structures:  a hash table of
+ * directed edges, and for each point a list of the triangle corners
+ * that use it.  Each edit then checks and maintains the rules of the
+ * mesh format in time proportional to the number of triangles around
+ * the points it touches, independent of the size of the mesh.
+ * 
+ * The editing operations are the same as in the LilacMesh client
+ * module:  moving a point, setting the normal of a point, adding a
+ * triangle, and dropping a triangle.  Points that are not used by any
+ * triangle after a drop are released automatically, so the editing
+ * object always satisfies every rule of the mesh format.  The sorted
+ * triangle order is only established when a mesh is exported with
+ * lilac_edit_mesh().
+ * 
+ * Edits that would break a rule fail without changing anything and
+ * return one of the LILAC_MESH_ERR error codes from lilac_mesh.h.
+ * 
+ * This module must be compiled together with lilac_mesh.c.
+ */
+
+/*
+ * Imports
+ * -------
+ */
+
+#include <stdint.h>
+#include "lilac_mesh.h"
+
+/*
+ * Constants
+ * ---------
+ */
+
+/*
+ * Vertex value for lilac_edit_add_tri() that requests a new point.
+ */
+#define LILAC_EDIT_NEW (-1)
+
+/*
+ * Type declarations
+ * -----------------
+ */
+
+/*
+ * Opaque structure for a mesh being edited.
+ */
+struct LILAC_EDIT_TAG;
+typedef struct LILAC_EDIT_TAG LILAC_EDIT;
+
+/*
+ * Public functions
+ * ----------------
+ */
+
+/*
+ * Create an editing object.
+ * 
+ * If pMesh is NULL, editing starts from an empty mesh.  Otherwise, the
+ * points and triangles of the mesh are copied, and the point indices
+ * are the same as in the mesh.  The mesh must satisfy all the rules of
+ * the mesh format, or a fault occurs.
+ * 
+ * The object holds space for the maximum number of points and
+ * triangles, so edits never allocate memory.  It should eventually be
+ * freed with lilac_edit_free().
+ * 
+ * Parameters:
+ * 
+ *   pMesh - the mesh to start from, or NULL
+ * 
+ * Return:
+ * 
+ *   a new editing object
+ */
+LILAC_EDIT *lilac_edit_new(const LILAC_MESH *pMesh);
+
+/*
+ * Free an editing object.
+ * 
+ * If NULL is passed, the call is ignored.
+ * 
+ * Parameters:
+ * 
+ *   pE - the editing object to free, or NULL
+ */
+void lilac_edit_free(LILAC_EDIT *pE);
+
+/*
+ * Return the current number of points.
+ * 
+ * Points are numbered from zero up to one less than this count.
+ * 
+ * Parameters:
+ * 
+ *   pE - the editing object
+ * 
+ * Return:
+ * 
+ *   the number of points
+ */
+int32_t lilac_edit_points(const LILAC_EDIT *pE);
+
+/*
+ * Return the current number of triangles.
+ * 
+ * Parameters:
+ * 
+ *   pE - the editing object
+ * 
+ * Return:
+ * 
+ *   the number of triangles
+ */
+int32_t lilac_edit_tris(const LILAC_EDIT *pE);
+
+/*
+ * Return a point.
+ * 
+ * The returned pointer is only valid until the next edit.  A fault
+ * occurs if the index is out of range.
+ * 
+ * Parameters:
+ * 
+ *   pE - the editing object
+ * 
+ *   i - the point index
+ * 
+ * Return:
+ * 
+ *   the point
+ */
+const LILAC_MESH_POINT *lilac_edit_point(const LILAC_EDIT *pE, int32_t i);
+
+/*
+ * Move a point.
+ * 
+ * The move fails with LILAC_MESH_ERR_ORIENT if any triangle that uses
+ * the point would become clockwise or degenerate.
+ * 
+ * Parameters:
+ * 
+ *   pE - the editing object
+ * 
+ *   i - the point index
+ * 
+ *   x - the new X coordinate
+ * 
+ *   y - the new Y coordinate
+ * 
+ * Return:
+ * 
+ *   LILAC_MESH_ERR_OK if successful, LILAC_MESH_ERR_PTREF if the index
+ *   is out of range, LILAC_MESH_ERR_NUMBER if a coordinate is out of
+ *   range, or LILAC_MESH_ERR_ORIENT
+ */
+int lilac_edit_move(LILAC_EDIT *pE, int32_t i, int32_t x, int32_t y);
+
+/*
+ * Set the normal of a point.
+ * 
+ * Parameters:
+ * 
+ *   pE - the editing object
+ * 
+ *   i - the point index
+ * 
+ *   normd - the new normal direction away from the viewer
+ * 
+ *   norma - the new normal direction angle
+ * 
+ * Return:
+ * 
+ *   LILAC_MESH_ERR_OK if successful, LILAC_MESH_ERR_PTREF if the index
+ *   is out of range, or the error code for an invalid normal
+ */
+int lilac_edit_set_normal(
+    LILAC_EDIT * pE,
+    int32_t      i,
+    int32_t      normd,
+    int32_t      norma);
+
+/*
+ * Add a triangle.
+ * 
+ * Each element of pv is either the index of an existing point or
+ * LILAC_EDIT_NEW.  For each LILAC_EDIT_NEW, the point at the same
+ * position in pNew is added as a new point.  New points are appended
+ * after the existing points, in the order they appear in pv.  pNew is
+ * only examined at positions with LILAC_EDIT_NEW, and it may be NULL
+ * if there are none.
+ * 
+ * The vertices may be given in any order and winding.  A clockwise
+ * triangle is flipped to counter-clockwise, and the triangle is stored
+ * starting at its lowest vertex.  The triangle is rejected if its
+ * points are colinear (LILAC_MESH_ERR_ORIENT) or if it shares a
+ * directed edge with another triangle after the flip
+ * (LILAC_MESH_ERR_DUPEDG), which includes adding the same triangle
+ * twice.
+ * 
+ * If pIndex is not NULL, it receives the point indices of the three
+ * vertices in the same order as pv, including the indices assigned to
+ * new points.
+ * 
+ * Parameters:
+ * 
+ *   pE - the editing object
+ * 
+ *   pv - the three vertices
+ * 
+ *   pNew - the new points, or NULL
+ * 
+ *   pIndex - array of three to receive the vertex indices, or NULL
+ * 
+ * Return:
+ * 
+ *   LILAC_MESH_ERR_OK if successful, or an error code
+ */
+int lilac_edit_add_tri(
+          LILAC_EDIT       * pE,
+    const int32_t          * pv,
+    const LILAC_MESH_POINT * pNew,
+          int32_t          * pIndex);
+
+/*
+ * Drop a triangle.
+ * 
+ * The triangle is identified by its three vertices in any order.  The
+ * call is ignored if there is no such triangle.
+ * 
+ * Any of the three points that is no longer used by a triangle is
+ * released.  A released point is replaced by the last point, which
+ * takes over its index, and released points are processed from the
+ * highest index to the lowest.  All other points keep their indices.
+ * 
+ * Parameters:
+ * 
+ *   pE - the editing object
+ * 
+ *   v1 - the first vertex
+ * 
+ *   v2 - the second vertex
+ * 
+ *   v3 - the third vertex
+ * 
+ * Return:
+ * 
+ *   non-zero if a triangle was dropped, zero if there was none
+ */
+int lilac_edit_drop_tri(
+    LILAC_EDIT * pE,
+    int32_t      v1,
+    int32_t      v2,
+    int32_t      v3);
+
+/*
+ * Export the edited mesh.
+ * 
+ * The triangles are put in the sorted order of the mesh format.  The
+ * return value is a new mesh object that should eventually be freed
+ * with lilac_mesh_free().  The editing object is not changed.
+ * 
+ * Parameters:
+ * 
+ *   pE - the editing object
+ * 
+ * Return:
+ * 
+ *   a new Lilac mesh object
+ */
+LILAC_MESH *lilac_edit_mesh(const LILAC_EDIT *pE);
+
+#endif
@@ -0,0 +1,406 @@
+/*
+ * lilac_mask.c
+ * ============
+ * 
+ * Implementation of lilac_mask.h
+ * 
+ * See the header for further information.
+ */
+
+#include "lilac_mask.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+/*
+ * Constants
+ * ---------
+ */
+
+/*
+ * The signature at the start of mask files.
+ */
+#define MASK_MAGIC "LILACMK1"
+#define MASK_MAGIC_LEN (8)
+
+/*
+ * The length of the header, which is the signature followed by the
+ * width and the height.  The header length is a multiple of eight, so
+ * every row is aligned to eight bytes within a page-aligned mapping.
+ */
+#define HEADER_LEN (16)
+
+/*
+ * Type declarations
+ * -----------------
+ */
+
+/*
+ * LILAC_MASK structure.
+ */
+struct LILAC_MASK_TAG {
+  
+  /*
+   * The read-only mapping of the whole mask file.
+   */
+  const unsigned char *pMap;
+  size_t map_len;
+  
+  /*
+   * The dimensions of the mask, and the length of each row in bytes.
+   */
+  int32_t w;
+  int32_t h;
+  size_t stride;
+};
+
+/*
+ * Local functions
+ * ---------------
+ */
+
+/* Prototypes */
+static uint32_t get_u32(const unsigned char *p);
+static void put_u32(unsigned char *p, uint32_t v);
+
+/*
+ * Decode a little-endian unsigned integer from bytes.
+ * 
+ * Parameters:
+ * 
+ *   p - pointer to the first byte
+ * 
+ * Return:
+ * 
+ *   the decoded integer
+ */
+static uint32_t get_u32(const unsigned char *p) {
+  return ((uint32_t) p[0]) |
+          (((uint32_t) p[1]) <<  8) |
+          (((uint32_t) p[2]) << 16) |
+          (((uint32_t) p[3]) << 24);
+}
+
+/*
+ * Encode a little-endian unsigned integer into bytes.
+ * 
+ * Parameters:
+ * 
+ *   p - pointer to the first byte
+ * 
+ *   v - the integer to encode
+ */
+static void put_u32(unsigned char *p, uint32_t v) {
+  p[0] = (unsigned char) (v & 0xff);
+  p[1] = (unsigned char) ((v >>  8) & 0xff);
+  p[2] = (unsigned char) ((v >> 16) & 0xff);
+  p[3] = (unsigned char) ((v >> 24) & 0xff);
+}
+
+/*
+ * Public function implementations
+ * -------------------------------
+ * 
+ * See the header for specifications
+ */
+
+/*
+ * lilac_mask_stride function.
+ */
+size_t lilac_mask_stride(int32_t w) {
+  
+  /* Check parameter */
+  if ((w < 1) || (w > LILAC_MASK_MAX_DIM)) {
+    abort();
+  }
+  
+  return ((((size_t) w) + 63) / 64) * 8;
+}
+
+/*
+ * lilac_mask_open function.
+ */
+LILAC_MASK *lilac_mask_open(const char *pPath, int *pErrCode) {
+  
+  int status = 1;
+  int err = LILAC_MASK_ERR_OK;
+  int fd = -1;
+  uint32_t w = 0;
+  uint32_t h = 0;
+  void *pMap = NULL;
+  struct stat st;
+  LILAC_MASK *pMask = NULL;
+  
+  memset(&st, 0, sizeof(struct stat));
+  
+  /* Check parameters */
+  if (pPath == NULL) {
+    abort();
+  }
+  
+  /* Allocate the mask structure */
+  pMask = (LILAC_MASK *) calloc(1, sizeof(LILAC_MASK));
+  if (pMask == NULL) {
+    abort();
+  }
+  
+  /* Open the file and get its size */
+  fd = open(pPath, O_RDONLY);
+  if (fd < 0) {
+    status = 0;
+    err = LILAC_MASK_ERR_OPEN;
+  }
+  
+  if (status) {
+    if (fstat(fd, &st)) {
+      status = 0;
+      err = LILAC_MASK_ERR_IO;
+    }
+  }
+  
+  /* Files too short for a header can't be mask files */
+  if (status) {
+    if (st.st_size < HEADER_LEN) {
+      status = 0;
+      err = LILAC_MASK_ERR_SIG;
+    } else if ((uint64_t) st.st_size > (uint64_t) SIZE_MAX) {
+      status = 0;
+      err = LILAC_MASK_ERR_FORMAT;
+    }
+  }
+  
+  /* Map the whole file; the mapping stays valid after the file
+   * descriptor is closed */
+  if (status) {
+    pMap = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (pMap == MAP_FAILED) {
+      pMap = NULL;
+      status = 0;
+      err = LILAC_MASK_ERR_IO;
+    } else {
+      pMask->pMap = (const unsigned char *) pMap;
+      pMask->map_len = (size_t) st.st_size;
+    }
+  }
+  
+  if (fd >= 0) {
+    close(fd);
+    fd = -1;
+  }
+  
+  /* Check the header */
+  if (status) {
+    if (memcmp(pMask->pMap, MASK_MAGIC, MASK_MAGIC_LEN) != 0) {
+      status = 0;
+      err = LILAC_MASK_ERR_SIG;
+    }
+  }
+  
+  if (status) {
+    w = get_u32(pMask->pMap + MASK_MAGIC_LEN);
+    h = get_u32(pMask->pMap + MASK_MAGIC_LEN + 4);
+    if ((w < 1) || (w > LILAC_MASK_MAX_DIM) ||
+        (h < 1) || (h > LILAC_MASK_MAX_DIM)) {
+      status = 0;
+      err = LILAC_MASK_ERR_FORMAT;
+    }
+  }
+  
+  /* The file must end exactly after the last row */
+  if (status) {
+    pMask->w = (int32_t) w;
+    pMask->h = (int32_t) h;
+    pMask->stride = lilac_mask_stride(pMask->w);
+    if (pMask->map_len != HEADER_LEN + pMask->stride * ((size_t) h)) {
+      status = 0;
+      err = LILAC_MASK_ERR_FORMAT;
+    }
+  }
+  
+  if (!status) {
+    lilac_mask_close(pMask);
+    pMask = NULL;
+  }
+  
+  if (pErrCode != NULL) {
+    *pErrCode = err;
+  }
+  return pMask;
+}
+
+/*
+ * lilac_mask_close function.
+ */
+void lilac_mask_close(LILAC_MASK *pMask) {
+  
+  if (pMask != NULL) {
+    if (pMask->pMap != NULL) {
+      munmap((void *) pMask->pMap, pMask->map_len);
+      pMask->pMap = NULL;
+    }
+    free(pMask);
+  }
+}
+
+/*
+ * lilac_mask_width function.
+ */
+int32_t lilac_mask_width(const LILAC_MASK *pMask) {
+  
+  if (pMask == NULL) {
+    abort();
+  }
+  return pMask->w;
+}
+
+/*
+ * lilac_mask_height function.
+ */
+int32_t lilac_mask_height(const LILAC_MASK *pMask) {
+  
+  if (pMask == NULL) {
+    abort();
+  }
+  return pMask->h;
+}
+
+/*
+ * lilac_mask_row function.
+ */
+const unsigned char *lilac_mask_row(const LILAC_MASK *pMask, int32_t y) {
+  
+  if (pMask == NULL) {
+    abort();
+  }
+  if ((y < 0) || (y >= pMask->h)) {
+    abort();
+  }
+  return pMask->pMap + HEADER_LEN + pMask->stride * ((size_t) y);
+}
+
+/*
+ * lilac_mask_write function.
+ */
+int lilac_mask_write(
+    const char          * pPath,
+          int32_t         w,
+          int32_t         h,
+    const unsigned char * pBits,
+          int           * pErrCode) {
+  
+  int status = 1;
+  int err = LILAC_MASK_ERR_OK;
+  int32_t y = 0;
+  size_t stride = 0;
+  size_t full = 0;
+  unsigned char *pRow = NULL;
+  unsigned char header[HEADER_LEN];
+  FILE *pOut = NULL;
+  
+  memset(header, 0, sizeof(header));
+  
+  /* Check parameters */
+  if ((pPath == NULL) || (pBits == NULL) ||
+      (h < 1) || (h > LILAC_MASK_MAX_DIM)) {
+    abort();
+  }
+  stride = lilac_mask_stride(w);
+  
+  /* Allocate a row buffer for clearing the padding bits */
+  pRow = (unsigned char *) malloc(stride);
+  if (pRow == NULL) {
+    abort();
+  }
+  full = ((size_t) w) / 8;
+  
+  /* Write the header and the rows */
+  pOut = fopen(pPath, "wb");
+  if (pOut == NULL) {
+    status = 0;
+    err = LILAC_MASK_ERR_OPEN;
+  }
+  
+  if (status) {
+    memcpy(header, MASK_MAGIC, MASK_MAGIC_LEN);
+    put_u32(header + MASK_MAGIC_LEN, (uint32_t) w);
+    put_u32(header + MASK_MAGIC_LEN + 4, (uint32_t) h);
+    if (fwrite(header, 1, HEADER_LEN, pOut) != HEADER_LEN) {
+      status = 0;
+      err = LILAC_MASK_ERR_IO;
+    }
+  }
+  
+  for(y = 0; status && (y < h); y++) {
+    memset(pRow, 0, stride);
+    memcpy(pRow, pBits + stride * ((size_t) y), full);
+    if ((w % 8) != 0) {
+      pRow[full] = (unsigned char) (pBits[stride * ((size_t) y) + full] &
+                      ((1 << (w % 8)) - 1));
+    }
+  
+    if (fwrite(pRow, 1, stride, pOut) != stride) {
+      status = 0;
+      err = LILAC_MASK_ERR_IO;
+    }
+  }
+  
+  if (pOut != NULL) {
+    if (fclose(pOut)) {
+      if (status) {
+        status = 0;
+        err = LILAC_MASK_ERR_IO;
+      }
+    }
+    pOut = NULL;
+  }
+  
+  free(pRow);
+  pRow = NULL;
+  
+  if (pErrCode != NULL) {
+    *pErrCode = err;
+  }
+  return status;
+}
+
+/*
+ * lilac_mask_errstr function.
+ */
+const char *lilac_mask_errstr(int code) {
+  
+  const char *pResult = NULL;
+  
+  switch (code) {
+  
+    case LILAC_MASK_ERR_OK:
+      pResult = "No error";
+      break;
+  
+    case LILAC_MASK_ERR_OPEN:
+      pResult = "Can't open mask file";
+      break;
+  
+    case LILAC_MASK_ERR_IO:
+      pResult = "I/O error on mask file";
+      break;
+  
+    case LILAC_MASK_ERR_SIG:
+      pResult = "Not a mask file";
+      break;
+  
+    case LILAC_MASK_ERR_FORMAT:
+      pResult = "Invalid mask file";
+      break;
+  
+    default:
+      pResult = "Unknown error";
+  }
+  
+  return pResult;
+}
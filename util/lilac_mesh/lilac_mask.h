@@ -0,0 +1,229 @@
+#ifndef LILAC_MASK_H_INCLUDED
+#define LILAC_MASK_H_INCLUDED
+
+/*
+ * lilac_mask.h
+ * ============
+ * 
+ * Lilac module for preprocessed 1-bit mask files.
+ * 
+ * A mask selects which pixels of a rendered image may be written.  Masks
+ * are drawn as PNG images, but decoding a PNG and converting every pixel
+ * to grayscale is expensive when the same mask is used for many renders.
+ * A mask file stores the thresholded mask as one bit per pixel, with
+ * every row aligned to eight bytes, so it can be used straight from a
+ * read-only memory mapping of the file.  See MaskFormat.md in the
+ * documentation folder for the exact file format.
+ * 
+ * In the bits of a mask file, one means that the pixel may be written
+ * (white in the PNG mask) and zero means that the pixel is masked out
+ * (black in the PNG mask).
+ * 
+ * This module requires POSIX for mmap().
+ */
+
+/*
+ * Imports
+ * -------
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Error codes
+ * -----------
+ * 
+ * Zero means no error, and is defined here as LILAC_MASK_ERR_OK.
+ * 
+ * Error codes can be converted into error message strings using
+ * lilac_mask_errstr().
+ */
+
+#define LILAC_MASK_ERR_OK     (0)   /* No error */
+#define LILAC_MASK_ERR_OPEN   (1)   /* Can't open mask file */
+#define LILAC_MASK_ERR_IO     (2)   /* I/O error */
+#define LILAC_MASK_ERR_SIG    (3)   /* Not a mask file */
+#define LILAC_MASK_ERR_FORMAT (4)   /* Invalid mask file */
+
+/*
+ * Constants
+ * ---------
+ */
+
+/*
+ * The maximum width and height of a mask.
+ */
+#define LILAC_MASK_MAX_DIM (16384)
+
+/*
+ * Type declarations
+ * -----------------
+ */
+
+/*
+ * Opaque structure for an open mask file.
+ */
+struct LILAC_MASK_TAG;
+typedef struct LILAC_MASK_TAG LILAC_MASK;
+
+/*
+ * Public functions
+ * ----------------
+ */
+
+/*
+ * Return the number of bytes in each row of a mask of a given width.
+ * 
+ * Rows hold one bit per pixel and are padded to a multiple of eight
+ * bytes.  The width must be in range 1 to LILAC_MASK_MAX_DIM.
+ * 
+ * Parameters:
+ * 
+ *   w - the width of the mask
+ * 
+ * Return:
+ * 
+ *   the number of bytes in each row
+ */
+size_t lilac_mask_stride(int32_t w);
+
+/*
+ * Open a mask file.
+ * 
+ * The whole file is mapped into memory read-only, and only the header
+ * and the file length are checked.  The rows are read in place through
+ * the mapping, so opening a mask costs almost nothing regardless of its
+ * size.
+ * 
+ * If the file exists but does not begin with the mask file signature,
+ * the error is LILAC_MASK_ERR_SIG, so that callers can fall back to
+ * another format such as PNG.
+ * 
+ * Parameters:
+ * 
+ *   pPath - the path to the mask file
+ * 
+ *   pErrCode - pointer to variable to receive the error code status of
+ *   the operation, or NULL
+ * 
+ * Return:
+ * 
+ *   the open mask, which should eventually be closed with
+ *   lilac_mask_close(), or NULL if failure
+ */
+LILAC_MASK *lilac_mask_open(const char *pPath, int *pErrCode);
+
+/*
+ * Close a mask file.
+ * 
+ * Row pointers obtained from the mask become invalid.  If NULL is
+ * passed, the call is ignored.
+ * 
+ * Parameters:
+ * 
+ *   pMask - the mask to close, or NULL
+ */
+void lilac_mask_close(LILAC_MASK *pMask);
+
+/*
+ * Return the width of a mask in pixels.
+ * 
+ * Parameters:
+ * 
+ *   pMask - the mask
+ * 
+ * Return:
+ * 
+ *   the width
+ */
+int32_t lilac_mask_width(const LILAC_MASK *pMask);
+
+/*
+ * Return the height of a mask in pixels.
+ * 
+ * Parameters:
+ * 
+ *   pMask - the mask
+ * 
+ * Return:
+ * 
+ *   the height
+ */
+int32_t lilac_mask_height(const LILAC_MASK *pMask);
+
+/*
+ * Return the bits of a row of a mask.
+ * 
+ * The bit for pixel x is bit (x % 8) of byte (x / 8), where bit zero is
+ * the least significant bit.  The row is lilac_mask_stride() bytes
+ * long and is aligned to eight bytes.  A fault occurs if the row is out
+ * of range.
+ * 
+ * Parameters:
+ * 
+ *   pMask - the mask
+ * 
+ *   y - the row, where zero is the top row
+ * 
+ * Return:
+ * 
+ *   the bits of the row
+ */
+const unsigned char *lilac_mask_row(const LILAC_MASK *pMask, int32_t y);
+
+/*
+ * Write a mask file.
+ * 
+ * pBits holds h rows of lilac_mask_stride(w) bytes each, in the same
+ * layout as returned by lilac_mask_row().  Padding bits after the last
+ * pixel of each row are written as zero whatever their value in pBits.
+ * 
+ * Parameters:
+ * 
+ *   pPath - the path to the mask file to create or overwrite
+ * 
+ *   w - the width, in range 1 to LILAC_MASK_MAX_DIM
+ * 
+ *   h - the height, in range 1 to LILAC_MASK_MAX_DIM
+ * 
+ *   pBits - the rows of bits
+ * 
+ *   pErrCode - pointer to variable to receive the error code status of
+ *   the operation, or NULL
+ * 
+ * Return:
+ * 
+ *   non-zero if successful, zero if failure
+ */
+int lilac_mask_write(
+    const char          * pPath,
+          int32_t         w,
+          int32_t         h,
+    const unsigned char * pBits,
+          int           * pErrCode);
+
+/*
+ * Given an error code from this module, return an error message
+ * corresponding to that code.
+ * 
+ * The string has the first letter capitalized, but no punctuation or
+ * line break at the end.
+ * 
+ * If the given code is not recognized, "Unknown error" is returned.  If
+ * the given code is LILAC_MASK_ERR_OK (0), "No error" is returned.
+ * 
+ * The returned string is statically allocated.  The client should not
+ * attempt to free it.
+ * 
+ * Parameters:
+ * 
+ *   code - the error code
+ * 
+ * Return:
+ * 
+ *   an error message
+ */
+const char *lilac_mask_errstr(int code);
+
+#endif
@@ -10,6 +10,8 @@
 #include "lilac_mesh.h"
 
 #include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -23,63 +25,57 @@
  */
 #define MAX_SN_STACK (16)
 
+/*
+ * The number of triangles checked together in each block of the bulk
+ * triangle validation.
+ */
+#define CHECK_BLOCK (64)
+
 /*
  * Type declarations
  * -----------------
  */
 
 /*
- * Structure storing usage bitmaps.
+ * The header stored in front of every block of counted memory.
  * 
- * Initialize with usage_map_init().  Reset with usage_map_reset()
- * before the structure goes out of scope to avoid a memory leak.
+ * The union pads the header so that the memory following it is aligned
+ * for any type.
+ */
+typedef union {
+  struct {
+    size_t size;
+    int sys;
+  } h;
+  long double align_ld;
+  void *align_p;
+  int64_t align_i;
+} MEM_HEADER;
+
+/*
+ * Local data
+ * ----------
+ */
+
+/*
+ * The installed allocator, or NULL functions for malloc() and free().
+ */
+static LILAC_MESH_ALLOC_FN m_fAlloc = NULL;
+static LILAC_MESH_FREE_FN m_fFree = NULL;
+static void *m_pMemCustom = NULL;
+
+/*
+ * The memory counters, protected by m_mem_lock.
  * 
- * Access the structure through the usage_map_ functions.
+ * m_mem_blocks is the number of live blocks, which must be zero when a
+ * new allocator is installed.
  */
-typedef struct {
-  
-  /*
-   * Pointer to a bitmap that keeps track of which points have been
-   * used within triangles.
-   * 
-   * The most significant bit of the first unsigned 32-bit integer
-   * represents point zero.  Bits that are zero mean the corresponding
-   * point has not been referenced from any triangle yet, while bits
-   * that are one mean the corresponding point has been referenced from
-   * at least one triangle.
-   * 
-   * The size **IN BITS** of this array is the number of points, rounded
-   * up to the nearest 32-bit boundary.  This array is dynamically
-   * allocated.  The pointer is NULL only if the point count is zero.
-   */
-  uint32_t *pPointUse;
-  
-  /*
-   * Pointer to a 2D bitmap that keeps track of which directed edges
-   * have been used within triangles.
-   * 
-   * The total length **IN BITS** of this bitmap is the total number of
-   * points squared, rounded up to the nearest 32-bit boundary.  The
-   * most significant bit of the first unsigned 32-bit integer is the
-   * first bit in the 2D bitmap.
-   * 
-   * A directed edge of a triangle going from a point with index i1 to
-   * a point with index i2 corresponds to a bit in this bitmap having
-   * the zero-based offset ((i1 * point_count) + i2).  Bits that are
-   * zero mean the corresponding directed edge has not yet been used in
-   * a triangle, while bits that are one mean the corresponding directed
-   * edge has been used in a triangle already.
-   *  
-   * This pointer is only NULL if the point count is zero.
-   */
-  uint32_t *pEdgeUse;
-  
-  /*
-   * The total number of points tracked by this usage map.
-   */
-  int32_t point_count;
-  
-} USAGE_MAP;
+static pthread_mutex_t m_mem_lock = PTHREAD_MUTEX_INITIALIZER;
+static size_t m_mem_cur[LILAC_MESH_MEM_COUNT];
+static size_t m_mem_peak[LILAC_MESH_MEM_COUNT];
+static size_t m_mem_total = 0;
+static size_t m_mem_total_peak = 0;
+static long m_mem_blocks = 0;
 
 /*
  * Local functions
@@ -87,12 +83,22 @@ typedef struct {
  */
 
 /* Prototypes */
-static void usage_map_init(USAGE_MAP *pM);
-static void usage_map_reset(USAGE_MAP *pM);
-static void usage_map_dim(USAGE_MAP *pM, int32_t point_count);
-static void usage_map_point(USAGE_MAP *pM, int32_t i);
-static int usage_map_edge(USAGE_MAP *pM, int32_t i1, int32_t i2);
-static int usage_map_orphan(USAGE_MAP *pM);
+static int tri_error(
+    const LILAC_MESH * pM,
+    const uint16_t   * pt,
+    const uint16_t   * pPrev);
+static int32_t scan_local(const LILAC_MESH *pM, int32_t count);
+static int32_t scan_edges(
+    const LILAC_MESH * pM,
+          int32_t      count,
+          int        * pOrphan);
+static int check_tris(
+    const LILAC_MESH * pM,
+          int32_t      count,
+          int          orphans,
+          int32_t    * pWhere);
+
+static int cmp_tri(const void *pA, const void *pB);
 
 static int32_t parseNumber(const char *pstr);
 
@@ -112,7 +118,6 @@ static int op_t(
     LILAC_MESH * pM,
     int32_t      ptsWritten,
     int32_t    * pTriWritten,
-    USAGE_MAP  * pUm,
     int        * pErrCode);
 
 static int readHeader(
@@ -124,306 +129,461 @@ static int readHeader(
     long     * pLine);
 
 /*
- * Initialize a usage map structure.
+ * Determine which rule a single triangle breaks, in the order that the
+ * rules are enforced while parsing.
+ * 
+ * This covers all the rules that depend only on the triangle itself
+ * and the triangle before it, which is everything except the rule
+ * against duplicate directed edges.  The orientation test of the
+ * original parser used normalized floating-point coordinates, but all
+ * coordinates are integers scaled by a power of two, so the same test
+ * is done exactly in integers.  The largest magnitude of the cross
+ * product is 2^29, so 32-bit integers are sufficient.
  * 
- * This clears the structure to zero, and then writes a point count of
- * zero with NULL pointers to the bitmap arrays.
+ * Parameters:
  * 
- * Only use this on uninitialized usage map structures.  Using this
- * function on a usage map that is already initialized may cause a
- * memory leak.
+ *   pM - the mesh containing the points
  * 
- * Before the usage map structure is released, call usage_map_reset() to
- * avoid memory leaks.
+ *   pt - the three vertex indices of the triangle
  * 
- * Parameters:
+ *   pPrev - the three vertex indices of the previous triangle, or NULL
+ *   if this is the first triangle
+ * 
+ * Return:
  * 
- *   pM - the uninitialized usage map structure
+ *   LILAC_MESH_ERR_OK or the error code of the first rule broken
  */
-static void usage_map_init(USAGE_MAP *pM) {
+static int tri_error(
+    const LILAC_MESH * pM,
+    const uint16_t   * pt,
+    const uint16_t   * pPrev) {
   
-  /* Check parameter */
-  if (pM == NULL) {
+  int32_t point_count = 0;
+  int32_t v1 = 0;
+  int32_t v2 = 0;
+  int32_t v3 = 0;
+  int32_t k = 0;
+  
+  const LILAC_MESH_POINT *pA = NULL;
+  const LILAC_MESH_POINT *pB = NULL;
+  const LILAC_MESH_POINT *pC = NULL;
+  
+  /* Check parameters */
+  if ((pM == NULL) || (pt == NULL)) {
     abort();
   }
   
-  /* Zero out structure */
-  memset(pM, 0, sizeof(USAGE_MAP));
+  point_count = pM->point_count;
+  v1 = pt[0];
+  v2 = pt[1];
+  v3 = pt[2];
   
-  /* Initialize */
-  pM->pPointUse = NULL;
-  pM->pEdgeUse = NULL;
-  pM->point_count = 0;
-}
-
-/*
- * Reset a usage map structure to its initial state.
- * 
- * The given usage map structure must already have been initialized with
- * usage_map_init().  This function will free the arrays if allocated
- * and change the point count in the structure to zero.
- * 
- * You must call this function on initialized usage maps before they are
- * released to avoid memory leaks.
- * 
- * Parameters:
- * 
- *   pM - the initialized usage map structure to reset
- */
-static void usage_map_reset(USAGE_MAP *pM) {
+  if ((v1 >= point_count) || (v2 >= point_count) ||
+      (v3 >= point_count)) {
+    return LILAC_MESH_ERR_PTREF;
+  }
   
-  /* Check parameter */
-  if (pM == NULL) {
-    abort();
+  if ((v1 == v2) || (v2 == v3) || (v1 == v3)) {
+    return LILAC_MESH_ERR_VXDUP;
   }
   
-  /* Free arrays if allocated */
-  if (pM->pPointUse != NULL) {
-    free(pM->pPointUse);
-    pM->pPointUse = NULL;
+  if ((v2 < v1) || (v3 < v1)) {
+    return LILAC_MESH_ERR_VXORD;
   }
   
-  if (pM->pEdgeUse != NULL) {
-    free(pM->pEdgeUse);
-    pM->pEdgeUse = NULL;
+  pA = &((pM->pPoints)[v1]);
+  pB = &((pM->pPoints)[v2]);
+  pC = &((pM->pPoints)[v3]);
+  
+  k = ((((int32_t) pB->x) - ((int32_t) pA->x)) *
+        (((int32_t) pC->y) - ((int32_t) pA->y))) -
+      ((((int32_t) pB->y) - ((int32_t) pA->y)) *
+        (((int32_t) pC->x) - ((int32_t) pA->x)));
+  if (!(k > 0)) {
+    return LILAC_MESH_ERR_ORIENT;
   }
   
-  /* Reset point count to zero */
-  pM->point_count = 0;
+  if (pPrev != NULL) {
+    if ((pPrev[0] > v1) || ((pPrev[0] == v1) && (pPrev[1] >= v2))) {
+      return LILAC_MESH_ERR_TRSORT;
+    }
+  }
+  
+  return LILAC_MESH_ERR_OK;
 }
 
 /*
- * Prepare a usage map structure for use with a given number of points.
+ * Find the first triangle that breaks any of the rules checked by
+ * tri_error().
+ * 
+ * The triangles are checked in blocks of CHECK_BLOCK.  The vertex
+ * coordinates of each block are first gathered into separate arrays,
+ * and then the orientation test runs over the whole block in a loop
+ * without any branches, which compilers turn into SIMD instructions.
+ * The rules about vertex indices and the sort order against the
+ * previous triangle are combined into the same flags without
+ * branching.  Only the first flagged triangle is then examined with
+ * tri_error() to determine which rule it breaks.
  * 
- * The given usage map structure must already have been initialized with
- * usage_map_init().  This function will automatically call the function
- * usage_map_reset() before updating the structure.
+ * Parameters:
  * 
- * point_count must be in range [0, LILAC_MESH_MAX_POINTS].  All bits in
- * the bitmaps are initialized to clear.
+ *   pM - the mesh
  * 
- * Parameters:
+ *   count - the number of triangles to check at the start of the list
  * 
- *   pM - the initialized usage map structure to dimension
+ * Return:
  * 
- *   point_count - the number of points to track
+ *   the index of the first triangle that breaks a rule, or count if
+ *   all the triangles are valid
  */
-static void usage_map_dim(USAGE_MAP *pM, int32_t point_count) {
+static int32_t scan_local(const LILAC_MESH *pM, int32_t count) {
+  
+  int32_t point_count = 0;
+  int32_t base = 0;
+  int32_t j = 0;
+  int32_t n = 0;
+  int32_t v1 = 0;
+  int32_t v2 = 0;
+  int32_t v3 = 0;
+  int32_t p1 = -1;
+  int32_t p2 = -1;
+  int32_t k = 0;
+  int32_t flag = 0;
+  
+  const uint16_t *pt = NULL;
+  const LILAC_MESH_POINT *pp = NULL;
+  
+  int32_t ax[CHECK_BLOCK];
+  int32_t ay[CHECK_BLOCK];
+  int32_t bx[CHECK_BLOCK];
+  int32_t by[CHECK_BLOCK];
+  int32_t cx[CHECK_BLOCK];
+  int32_t cy[CHECK_BLOCK];
+  int32_t bad[CHECK_BLOCK];
   
-  int32_t count = 0;
-  int32_t mcount = 0;
-
   /* Check parameters */
-  if ((pM == NULL) ||
-        (point_count < 0) || (point_count > LILAC_MESH_MAX_POINTS)) {
+  if ((pM == NULL) || (count < 0) || (count > pM->tri_count)) {
     abort();
   }
   
-  /* Begin by resetting structure */
-  usage_map_reset(pM);
+  point_count = pM->point_count;
+  pp = pM->pPoints;
   
-  /* Only proceed if at least one point requested */
-  if (point_count > 0) {
+  /* Without any points, the first triangle already refers to a point
+   * that does not exist */
+  if (point_count < 1) {
+    return 0;
+  }
   
-    /* Compute number of 32-bit blocks needed for point usage bitmap */
-    count = point_count / 32;
-    if (point_count % 32) {
-      count++;
+  for(base = 0; base < count; base += CHECK_BLOCK) {
+    n = count - base;
+    if (n > CHECK_BLOCK) {
+      n = CHECK_BLOCK;
     }
-  
-    /* Allocate and zero out point-use bitmap */
-    pM->pPointUse = (uint32_t *) calloc(count, sizeof(uint32_t));
-    if (pM->pPointUse == NULL) {
-      abort();
+    pt = &((pM->pTris)[base * 3]);
+    
+    /* Flag the index rules and the sort order against the previous
+     * triangle, which starts out as -1 so the first triangle always
+     * passes, and gather the coordinates, replacing indices that are
+     * out of range with zero so the gather stays within the point
+     * array */
+    for(j = 0; j < n; j++) {
+      v1 = pt[0];
+      v2 = pt[1];
+      v3 = pt[2];
+      pt += 3;
+      
+      flag = (v1 >= point_count) | (v2 >= point_count) |
+              (v3 >= point_count) |
+              (v1 == v2) | (v2 == v3) | (v1 == v3) |
+              (v2 < v1) | (v3 < v1) |
+              (p1 > v1) | ((p1 == v1) & (p2 >= v2));
+      bad[j] = flag;
+      
+      p1 = v1;
+      p2 = v2;
+      
+      v1 = (v1 < point_count) ? v1 : 0;
+      v2 = (v2 < point_count) ? v2 : 0;
+      v3 = (v3 < point_count) ? v3 : 0;
+      
+      ax[j] = pp[v1].x;
+      ay[j] = pp[v1].y;
+      bx[j] = pp[v2].x;
+      by[j] = pp[v2].y;
+      cx[j] = pp[v3].x;
+      cy[j] = pp[v3].y;
     }
     
-    /* Compute number of 32-bit blocks needed for edge usage bitmap */
-    mcount = point_count * point_count;
-    count = mcount / 32;
-    if (mcount % 32) {
-      count++;
+    /* Pad a partial block so that the orientation test always runs
+     * over a full block */
+    for( ; j < CHECK_BLOCK; j++) {
+      bad[j] = 0;
+      ax[j] = 0;
+      ay[j] = 0;
+      bx[j] = 0;
+      by[j] = 0;
+      cx[j] = 0;
+      cy[j] = 0;
     }
     
-    /* Allocate and zero out edge-use bitmap */
-    pM->pEdgeUse = (uint32_t *) calloc(count, sizeof(uint32_t));
-    if (pM->pEdgeUse == NULL) {
-      abort();
+    /* Orientation test over the whole block */
+    for(j = 0; j < CHECK_BLOCK; j++) {
+      k = ((bx[j] - ax[j]) * (cy[j] - ay[j])) -
+          ((by[j] - ay[j]) * (cx[j] - ax[j]));
+      bad[j] |= (k <= 0);
     }
     
-    /* Write the point count */
-    pM->point_count = point_count;
+    /* Stop at the first flagged triangle */
+    for(j = 0; j < n; j++) {
+      if (bad[j]) {
+        return base + j;
+      }
+    }
   }
+  
+  return count;
 }
 
 /*
- * Report in the usage map that a specific point index has been
- * referenced from a triangle.
+ * Find the first triangle that repeats a directed edge of an earlier
+ * triangle, and optionally check for orphan points.
+ * 
+ * Each triangle has the directed edges v1 to v2, v2 to v3, and v3 to
+ * v1, so each of its vertices is the start of exactly one of its edges.
+ * The edges are sorted into buckets by starting point with a counting
+ * sort, which keeps the edges within each bucket in triangle order.
+ * Each bucket is then checked for duplicate end points independently,
+ * using a stamp array that does not need clearing between buckets.
+ * The first duplicate within a bucket is the earliest triangle that
+ * repeats an edge from that bucket, and the earliest of those across
+ * all buckets is the result.
+ * 
+ * Since every vertex of every triangle starts an edge, a point is an
+ * orphan exactly when its bucket is empty.  The orphan check is only
+ * meaningful when all triangles are counted and valid.
+ * 
+ * All counted triangles must have vertex indices less than the point
+ * count of the mesh.
  * 
- * If the corresponding bit for the point is already set, this function
- * has no further effect.
+ * Parameters:
  * 
- * The given index must be in range [0, point_count) with the
- * point_count value established by a call to usage_map_dim().
+ *   pM - the mesh
  * 
- * Parameters:
+ *   count - the number of triangles to check at the start of the list
  * 
- *   pM - the initialized usage map structure
+ *   pOrphan - if not NULL, receives non-zero if any point does not
+ *   start an edge, zero otherwise
  * 
- *   i - the point index
+ * Return:
+ * 
+ *   the index of the first triangle that repeats a directed edge, or -1
+ *   if there is none
  */
-static void usage_map_point(USAGE_MAP *pM, int32_t i) {
+static int32_t scan_edges(
+    const LILAC_MESH * pM,
+          int32_t      count,
+          int        * pOrphan) {
+  
+  int32_t result = -1;
+  int32_t pc = 0;
+  int32_t i = 0;
+  int32_t j = 0;
+  int32_t a = 0;
+  int32_t b = 0;
   
-  int32_t offs = 0;
-  int shift = 0;
-  uint32_t mask = 0;
+  const uint16_t *pt = NULL;
+  int32_t *pStart = NULL;
+  int32_t *pFill = NULL;
+  int32_t *pStamp = NULL;
+  uint32_t *pEdge = NULL;
   
   /* Check parameters */
-  if ((pM == NULL) || (i < 0) || (i >= pM->point_count)) {
+  if ((pM == NULL) || (count < 0) || (count > LILAC_MESH_MAX_TRIS)) {
+    abort();
+  }
+  
+  pc = pM->point_count;
+  
+  /* Allocate the bucket starts, fill positions, and stamps in one
+   * array, and the sorted edges */
+  pStart = (int32_t *) lilac_mesh_mem_alloc(
+                        LILAC_MESH_MEM_WORK,
+                        (size_t) (pc * 3 + 1), sizeof(int32_t));
+  pEdge = (uint32_t *) lilac_mesh_mem_alloc(
+                        LILAC_MESH_MEM_WORK,
+                        (size_t) (count * 3 + 1), sizeof(uint32_t));
+  if ((pStart == NULL) || (pEdge == NULL)) {
     abort();
   }
+  pFill = pStart + (pc + 1);
+  pStamp = pFill + pc;
   
-  /* Compute offset and shift of the corresponding bit */
-  offs = i / 32;
-  shift = (int) (31 - (i % 32));
+  /* Count the edges in each bucket */
+  memset(pStart, 0, ((size_t) (pc + 1)) * sizeof(int32_t));
+  for(i = 0; i < count * 3; i++) {
+    pStart[(pM->pTris)[i] + 1]++;
+  }
+  
+  /* Convert the counts to bucket starting positions */
+  for(a = 0; a < pc; a++) {
+    pStart[a + 1] += pStart[a];
+    pFill[a] = pStart[a];
+    pStamp[a] = -1;
+  }
   
-  /* Compute mask */
-  mask = (uint32_t) (UINT32_C(1) << shift);
+  /* Sort the edges into buckets, each edge recording its end point in
+   * the low 16 bits and its triangle index in the high bits */
+  for(i = 0; i < count; i++) {
+    pt = &((pM->pTris)[i * 3]);
+    pEdge[pFill[pt[0]]++] = (((uint32_t) i) << 16) | pt[1];
+    pEdge[pFill[pt[1]]++] = (((uint32_t) i) << 16) | pt[2];
+    pEdge[pFill[pt[2]]++] = (((uint32_t) i) << 16) | pt[0];
+  }
+  
+  /* Find the first duplicate in each bucket */
+  for(a = 0; a < pc; a++) {
+    for(j = pStart[a]; j < pStart[a + 1]; j++) {
+      b = (int32_t) (pEdge[j] & 0xffff);
+      if (pStamp[b] == a) {
+        i = (int32_t) (pEdge[j] >> 16);
+        if ((result < 0) || (i < result)) {
+          result = i;
+        }
+        break;
+      }
+      pStamp[b] = a;
+    }
+  }
   
-  /* Set the appropriate bit */
-  (pM->pPointUse)[offs] |= mask;
+  /* Check for empty buckets */
+  if (pOrphan != NULL) {
+    *pOrphan = 0;
+    for(a = 0; a < pc; a++) {
+      if (pStart[a + 1] == pStart[a]) {
+        *pOrphan = 1;
+        break;
+      }
+    }
+  }
+  
+  lilac_mesh_mem_free(pStart);
+  lilac_mesh_mem_free(pEdge);
+  
+  return result;
 }
 
 /*
- * Report in the usage map that a specific directed edge has been used
- * in a triangle and check that it hasn't been used before.
- * 
- * i1 and i2 must both be in range [0, point_count) with the point_count
- * value established by a call to usage_map_dim().  The order of i1 and
- * i2 is significant because the edges are directed.  A fault occurs if
- * i1 and i2 are equal.
- * 
- * If the directed edge has not been marked for use yet, it is marked
- * for use and a non-zero value is returned.  If the directed edge has
- * already been marked for use, a zero value is returned.
+ * Check the triangle rules over the start of the triangle list in
+ * bulk.
+ * 
+ * The result is the same as checking each triangle in order with all
+ * the rules of the triangle operation, as the parser originally did.
+ * The triangle-local rules are checked first over all triangles with
+ * scan_local(), and then duplicate edges are checked with scan_edges()
+ * over the valid triangles before the first failure.  A triangle that
+ * repeats an edge must come earlier than that failure, so it is
+ * reported first.
+ * 
+ * If orphans is non-zero and all the triangles are valid, points not
+ * referenced by any counted triangle are reported as
+ * LILAC_MESH_ERR_ORPHAN.  This is only meaningful when count is the
+ * full triangle count.
  * 
  * Parameters:
  * 
- *   pM - the initialized usage map structure
+ *   pM - the mesh
+ * 
+ *   count - the number of triangles to check at the start of the list
  * 
- *   i1 - the first "from" point index of the edge
+ *   orphans - non-zero to also check for orphan points
  * 
- *   i2 - the second "to" point index of the edge
+ *   pWhere - receives the index of the failing triangle, or -1
  * 
  * Return:
  * 
- *   non-zero if successful, zero if directed edge has already been used
+ *   LILAC_MESH_ERR_OK or the error code of the first failure
  */
-static int usage_map_edge(USAGE_MAP *pM, int32_t i1, int32_t i2) {
+static int check_tris(
+    const LILAC_MESH * pM,
+          int32_t      count,
+          int          orphans,
+          int32_t    * pWhere) {
   
-  int status = 1;
+  int err = LILAC_MESH_ERR_OK;
+  int orphan = 0;
+  int32_t first = 0;
+  int32_t dup = 0;
   
-  int32_t ix = 0;
-  int32_t offs = 0;
-  int shift = 0;
-  uint32_t mask = 0;
-
   /* Check parameters */
-  if ((pM == NULL) ||
-      (i1 < 0) || (i1 >= pM->point_count) ||
-      (i2 < 0) || (i2 >= pM->point_count)) {
+  if ((pM == NULL) || (pWhere == NULL) ||
+      (count < 0) || (count > pM->tri_count)) {
     abort();
   }
-
-  /* Compute the 1D index of the bit */
-  ix = (i1 * pM->point_count) + i2;
   
-  /* Compute offset and shift of the corresponding bit */
-  offs = ix / 32;
-  shift = (int) (31 - (ix % 32));
+  *pWhere = -1;
   
-  /* Compute mask */
-  mask = (uint32_t) (UINT32_C(1) << shift);
+  first = scan_local(pM, count);
+  dup = scan_edges(pM, first, ((orphans && (first >= count)) ?
+                                  &orphan : NULL));
   
-  /* Check whether bit is set or not */
-  if ((pM->pEdgeUse)[offs] & mask) {
-    /* Already set, so fail */
-    status = 0;
-    
-  } else {
-    /* Not already set, so set it */
-    (pM->pEdgeUse)[offs] |= mask;
+  if (dup >= 0) {
+    err = LILAC_MESH_ERR_DUPEDG;
+    *pWhere = dup;
+  
+  } else if (first < count) {
+    err = tri_error(pM, &((pM->pTris)[first * 3]),
+            ((first > 0) ? &((pM->pTris)[(first - 1) * 3]) : NULL));
+    *pWhere = first;
+  
+  } else if (orphan) {
+    err = LILAC_MESH_ERR_ORPHAN;
   }
   
-  /* Return status */
-  return status;
+  return err;
 }
 
 /*
- * Check for orphaned points in the usage map.
+ * Comparison function for sorting triangles into the canonical order
+ * with qsort().
  * 
- * Orphaned points are point index values in range [0, point_count) that
- * have not been marked by a call to usage_map_point() yet.  The
- * point_count value is established by a call to usage_map_dim().
- * 
- * If there are no orphan points, zero is returned.  Otherwise, the
- * return is non-zero.
+ * Each element is three vertex indices.  Triangles are ordered by their
+ * first vertex, then their second, then their third.
  * 
  * Parameters:
  * 
- *   pM - the initialized usage map structure
+ *   pA - the first triangle
+ * 
+ *   pB - the second triangle
  * 
  * Return:
  * 
- *   non-zero if orphan points remain, zero if no orphan points  
+ *   less than, equal to, or greater than zero as the first triangle
+ *   sorts before, equal to, or after the second
  */
-static int usage_map_orphan(USAGE_MAP *pM) {
+static int cmp_tri(const void *pA, const void *pB) {
   
-  int result = 0;
-  int32_t full_count = 0;
-  int32_t i = 0;
-  int extra_bits = 0;
-  uint32_t mask = 0;
+  const uint16_t *pa = NULL;
+  const uint16_t *pb = NULL;
+  int i = 0;
   
-  /* Check parameter */
-  if (pM == NULL) {
+  /* Check parameters */
+  if ((pA == NULL) || (pB == NULL)) {
     abort();
   }
   
-  /* Only proceed if at least one point; else, just return result of
-   * zero */
-  if (pM->point_count > 0) {
-    /* Compute number of fully-used 32-bit blocks */
-    full_count = pM->point_count / 32;
-    
-    /* Compute number of extra bits in overflow block (if any) */
-    extra_bits = (int) (pM->point_count % 32);
-    
-    /* If at least one extra bit, compute OR mask for setting all the
-     * unused bits in the overflow block */
-    if (extra_bits > 0) {
-      mask = (UINT32_C(1) << (32 - extra_bits)) - 1;
-    }
-    
-    /* All fully-used 32-bit blocks must be all set */
-    for(i = 0; i < full_count; i++) {
-      if ((~((pM->pPointUse)[i])) != 0) {
-        result = 1;
-        break;
-      }
-    }
-    
-    /* If we didn't find any orphans in the fully-used blocks and there
-     * is an overflow block, it should be all set after adding in the
-     * OR mask we computed above */
-    if ((!result) && (extra_bits > 0)) {
-      if ((~(((pM->pPointUse)[full_count]) | mask)) != 0) {
-        result = 1;
-      }
+  pa = (const uint16_t *) pA;
+  pb = (const uint16_t *) pB;
+  
+  for(i = 0; i < 3; i++) {
+    if (pa[i] < pb[i]) {
+      return -1;
+    } else if (pa[i] > pb[i]) {
+      return 1;
     }
   }
   
-  /* Return result */
-  return result;
+  return 0;
 }
 
 /*
@@ -584,23 +744,26 @@ static int op_p(
  * 
  * v1, v2, and v3 are the parameters passed to this function from the
  * interpreter stack.  All must be in the range [0, LILAC_MESH_MAX_C] or
- * a fault occurs.  This function will perform further checks if needed
- * and report them as errors.
+ * a fault occurs.
+ * 
+ * pM is the mesh object to update, and pTriWritten must point to a
+ * variable that keeps track of how many triangles have been written
+ * into the mesh object so far.
  * 
- * pM is the mesh object to update, pTriWritten must point to a variable
- * that keeps track of how many triangles have been written into the
- * mesh object so far, and pUm is a pointer to the usage map structure
- * to update.
+ * Only the rule that all vertices refer to points that have already
+ * been defined is checked here, along with the declared triangle
+ * count.  The other triangle rules are checked in bulk over the whole
+ * triangle list with check_tris() once interpretation stops, which
+ * gives the same result as checking each triangle as it arrives.  If
+ * the triangle count is exceeded, the rules that precede the count
+ * check are applied to the extra triangle with tri_error() so that the
+ * same error is reported.
  * 
  * pErrCode must point to a variable to receive an error code if there
  * is a failure.  Note that this function does not have a way of setting
  * the line number of an error, so the caller is expected to do that in
  * case of error.
  * 
- * If an error occurs, the usage map may have already been updated, or
- * partially updated, even though the changes have not been made to the
- * mesh object.
- * 
  * Parameters:
  * 
  *   v1 - index of the first point vertex
@@ -616,8 +779,6 @@ static int op_p(
  *   pTriWritten - pointer to variable tracking number of triangles
  *   written
  * 
- *   pUm - pointer to the usage map structure
- * 
  *   pErrCode - pointer to variable to receive error code
  * 
  * Return:
@@ -631,146 +792,48 @@ static int op_t(
     LILAC_MESH * pM,
     int32_t      ptsWritten,
     int32_t    * pTriWritten,
-    USAGE_MAP  * pUm,
     int        * pErrCode) {
   
   int status = 1;
-  
-  LILAC_MESH_POINT *pA = NULL;
-  LILAC_MESH_POINT *pB = NULL;
-  LILAC_MESH_POINT *pC = NULL;
-  
   uint16_t *pt = NULL;
+  uint16_t tv[3];
+  
+  /* Initialize array */
+  memset(tv, 0, sizeof(tv));
   
-  double v1x = 0.0;
-  double v1y = 0.0;
-  double v2x = 0.0;
-  double v2y = 0.0;
-  double v3x = 0.0;
-  double v3y = 0.0;
-  double k = 0.0;
-
   /* Check parameters */
   if ((v1 > LILAC_MESH_MAX_C) ||
       (v2 > LILAC_MESH_MAX_C) ||
       (v3 > LILAC_MESH_MAX_C) ||
       (ptsWritten < 0) || (ptsWritten > LILAC_MESH_MAX_POINTS) ||
-      (pM == NULL) || (pTriWritten == NULL) ||
-      (pUm == NULL) || (pErrCode == NULL)) {
+      (pM == NULL) || (pTriWritten == NULL) || (pErrCode == NULL)) {
     abort();
   }
-
+  
   /* Verify that all vertex points have been defined already */
   if ((v1 >= ptsWritten) || (v2 >= ptsWritten) || (v3 >= ptsWritten)) {
     status = 0;
     *pErrCode = LILAC_MESH_ERR_PTREF;
   }
   
-  /* Verify that no two points are the same */
-  if (status) {
-    if ((v1 == v2) || (v2 == v3) || (v1 == v3)) {
-      status = 0;
-      *pErrCode = LILAC_MESH_ERR_VXDUP;
-    }
-  }
-  
-  /* Verify that the first vertex has the lowest numeric value */
-  if (status) {
-    if ((v2 < v1) || (v3 < v1)) {
-      status = 0;
-      *pErrCode = LILAC_MESH_ERR_VXORD;
-    }
-  }
-  
-  /* Verify that vertices are in counter-clockwise order */
-  if (status) {
-    /* Get references to each point structure */
-    pA = &((pM->pPoints)[v1]);
-    pB = &((pM->pPoints)[v2]);
-    pC = &((pM->pPoints)[v3]);
-    
-    /* Get vertex coordinates in normalized floating-point space */
-    v1x = ((double) pA->x) / ((double) LILAC_MESH_MAX_C);
-    v1y = ((double) pA->y) / ((double) LILAC_MESH_MAX_C);
-    
-    v2x = ((double) pB->x) / ((double) LILAC_MESH_MAX_C);
-    v2y = ((double) pB->y) / ((double) LILAC_MESH_MAX_C);
-    
-    v3x = ((double) pC->x) / ((double) LILAC_MESH_MAX_C);
-    v3y = ((double) pC->y) / ((double) LILAC_MESH_MAX_C);
-    
-    /* Compute the cross product (V2-V1)x(V3-V1) to make sure that the
-     * Z-axis vector has a magnitude greater than zero, ensuring that
-     * the points on the triangle are not colinear and that they are in
-     * counter-clockwise order; since the Z coordinates of our 2D points
-     * are all zero, the X-axis and Y-axis vectors of the cross product
-     * will always have zero magnitude, so we just need to compute the
-     * Z-axis vector, which is ((x2-x1)*(y3-y1) - (y2-y1)*(x3-x1)), and
-     * make sure this is greater than zero */
-    k = ((v2x - v1x) * (v3y - v1y)) - ((v2y - v1y) * (v3x - v1x));
-    if (!(k > 0.0)) {
-      status = 0;
-      *pErrCode = LILAC_MESH_ERR_ORIENT;
-    }
-  }
-
-  /* If this is not the first triangle, check that this triangle is
-   * properly sorted relative to the previous triangle */
-  if (status && (*pTriWritten > 0)) {
-    /* Get reference to previous triangle vertices */
-    pt = &((pM->pTris)[(*pTriWritten - 1) * 3]);
-    
-    /* Check ordering */
-    if (pt[0] > v1) {
-      status = 0;
-      *pErrCode = LILAC_MESH_ERR_TRSORT;
-    
-    } else if (pt[0] == v1) {
-      if (pt[1] >= v2) {
-        status = 0;
-        *pErrCode = LILAC_MESH_ERR_TRSORT;
-      }
-    }
-  }
-  
-  /* Make sure we have room for another triangle */
+  /* Make sure we have room for another triangle, reporting any earlier
+   * rule the extra triangle breaks instead */
   if (status && (*pTriWritten >= pM->tri_count)) {
     status = 0;
-    *pErrCode = LILAC_MESH_ERR_TROVER;
-  }
-
-  /* Mark the directed edges and check that no directed edge already
-   * used by another triangle */
-  if (status) {
-    if (!usage_map_edge(pUm, v1, v2)) {
-      status = 0;
-      *pErrCode = LILAC_MESH_ERR_DUPEDG;
-    }
-  }
-
-  if (status) {
-    if (!usage_map_edge(pUm, v2, v3)) {
-      status = 0;
-      *pErrCode = LILAC_MESH_ERR_DUPEDG;
-    }
-  }
-
-  if (status) {
-    if (!usage_map_edge(pUm, v3, v1)) {
-      status = 0;
-      *pErrCode = LILAC_MESH_ERR_DUPEDG;
+    
+    tv[0] = v1;
+    tv[1] = v2;
+    tv[2] = v3;
+    *pErrCode = tri_error(pM, tv,
+                  ((*pTriWritten > 0) ?
+                    &((pM->pTris)[(*pTriWritten - 1) * 3]) : NULL));
+    if (*pErrCode == LILAC_MESH_ERR_OK) {
+      *pErrCode = LILAC_MESH_ERR_TROVER;
     }
   }
-
-  /* Mark the vertex points as referenced in the usage map */
-  if (status) {
-    usage_map_point(pUm, v1);
-    usage_map_point(pUm, v2);
-    usage_map_point(pUm, v3);
-  }
-
-  /* Finally, add the triangle to the triangle list and updated the
-   * triangles written count */
+  
+  /* Add the triangle to the triangle list and update the triangles
+   * written count */
   if (status) {
     pt = &((pM->pTris)[(*pTriWritten) * 3]);
     pt[0] = v1;
@@ -1037,25 +1100,27 @@ LILAC_MESH *lilac_mesh_new(SNSOURCE *pIn, int *pErrCode, long *pLine) {
   int32_t points_written = 0;
   int32_t tris_written = 0;
   
+  int terr = LILAC_MESH_ERR_OK;
+  int32_t where = -1;
+  
   uint16_t st[MAX_SN_STACK];
   int st_count = 0;
   
   SNPARSER *pSn = NULL;
   LILAC_MESH *pM = NULL;
+  long *pTriLine = NULL;
   
   SNENTITY ent;
-  USAGE_MAP um;
   
   /* Initialize structures and arrays */
   memset(&ent, 0, sizeof(SNENTITY));
   memset(st, 0, MAX_SN_STACK * sizeof(uint16_t));
-  usage_map_init(&um);
   
   /* Check required parameter */
   if (pIn == NULL) {
     abort();
   }
-
+  
   /* If optional parameter(s) not provided, redirect to dummy vars */
   if (pErrCode == NULL) {
     pErrCode = &i_dummy;
@@ -1070,26 +1135,21 @@ LILAC_MESH *lilac_mesh_new(SNSOURCE *pIn, int *pErrCode, long *pLine) {
   
   /* Allocate a Shastina parser */
   pSn = snparser_alloc();
-
+  
   /* Begin by reading the header and getting dimension information */
   if (!readHeader(
         pSn, pIn, &point_count, &tri_count, pErrCode, pLine)) {
     status = 0;
   }
-
-  /* Prepare the usage map using the point count */
-  if (status) {
-    usage_map_dim(&um, point_count);
-  }
-
+  
   /* Allocate the Lilac mesh structure */
   if (status) {
     /* Allocate and clear the structure memory */
-    pM = (LILAC_MESH *) malloc(sizeof(LILAC_MESH));
+    pM = (LILAC_MESH *) lilac_mesh_mem_alloc(
+                          LILAC_MESH_MEM_MESH, 1, sizeof(LILAC_MESH));
     if (pM == NULL) {
       abort();
     }
-    memset(pM, 0, sizeof(LILAC_MESH));
     
     /* Write the point and triangle counts in and initialize pointers to
      * NULL */
@@ -1101,8 +1161,9 @@ LILAC_MESH *lilac_mesh_new(SNSOURCE *pIn, int *pErrCode, long *pLine) {
     
     /* Allocate non-empty arrays and clear to zero */
     if (point_count > 0) {
-      pM->pPoints = (LILAC_MESH_POINT *) calloc(
-                                            point_count,
+      pM->pPoints = (LILAC_MESH_POINT *) lilac_mesh_mem_alloc(
+                                            LILAC_MESH_MEM_MESH,
+                                            (size_t) point_count,
                                             sizeof(LILAC_MESH_POINT));
       if (pM->pPoints == NULL) {
         abort();
@@ -1110,22 +1171,32 @@ LILAC_MESH *lilac_mesh_new(SNSOURCE *pIn, int *pErrCode, long *pLine) {
     }
     
     if (tri_count > 0) {
-      pM->pTris = (uint16_t *) calloc(
-                                  (tri_count * 3),
+      pM->pTris = (uint16_t *) lilac_mesh_mem_alloc(
+                                  LILAC_MESH_MEM_MESH,
+                                  (size_t) (tri_count * 3),
                                   sizeof(uint16_t));
       if (pM->pTris == NULL) {
         abort();
       }
+      
+      /* Line number of each triangle, for reporting the errors found
+       * when the triangles are checked in bulk */
+      pTriLine = (long *) lilac_mesh_mem_alloc(
+                            LILAC_MESH_MEM_WORK,
+                            (size_t) tri_count, sizeof(long));
+      if (pTriLine == NULL) {
+        abort();
+      }
     }
   }
-
+  
   /* Interpret the Shastina mesh file */
   if (status) {
     /* Go through tokens until EOF or error */
     for(snparser_read(pSn, &ent, pIn);
         ent.status > 0;
         snparser_read(pSn, &ent, pIn)) {
-
+  
       /* We read an entity (after the header), so handle the specific
        * type of entity */
       if (ent.status == SNENTITY_NUMERIC) {
@@ -1199,10 +1270,12 @@ LILAC_MESH *lilac_mesh_new(SNSOURCE *pIn, int *pErrCode, long *pLine) {
                     pM,
                     points_written,
                     &tris_written,
-                    &um,
                     pErrCode)) {
               status = 0;
               *pLine = snparser_count(pSn);
+            
+            } else {
+              pTriLine[tris_written - 1] = snparser_count(pSn);
             }
           }
           
@@ -1238,6 +1311,16 @@ LILAC_MESH *lilac_mesh_new(SNSOURCE *pIn, int *pErrCode, long *pLine) {
       *pLine = snparser_count(pSn);
     }
     
+    /* Check the rules of all the triangles written in bulk; triangles
+     * come earlier in the file than anything that stopped the
+     * interpreter, so an error in a triangle takes precedence */
+    terr = check_tris(pM, tris_written, status, &where);
+    if ((terr != LILAC_MESH_ERR_OK) && (terr != LILAC_MESH_ERR_ORPHAN)) {
+      status = 0;
+      *pErrCode = terr;
+      *pLine = pTriLine[where];
+    }
+    
     /* If we got here successfully, we read the EOF token, so make sure
      * that stack is empty and everything has been written */
     if (status && (st_count > 0)) {
@@ -1258,16 +1341,17 @@ LILAC_MESH *lilac_mesh_new(SNSOURCE *pIn, int *pErrCode, long *pLine) {
       *pLine = 0;
     }
     
-    /* Check for orphan points */
-    if (status && usage_map_orphan(&um)) {
+    /* Check for orphan points, which check_tris() found above */
+    if (status && (terr == LILAC_MESH_ERR_ORPHAN)) {
       status = 0;
       *pErrCode = LILAC_MESH_ERR_ORPHAN;
       *pLine = 0;
     }
   }
-
-  /* Reset usage map to release any memory */
-  usage_map_reset(&um);
+  
+  /* Release the triangle line numbers */
+  lilac_mesh_mem_free(pTriLine);
+  pTriLine = NULL;
   
   /* Free parser if allocated */
   snparser_free(pSn);
@@ -1290,6 +1374,253 @@ LILAC_MESH *lilac_mesh_new(SNSOURCE *pIn, int *pErrCode, long *pLine) {
   return pM;
 }
 
+/*
+ * lilac_mesh_dim function.
+ */
+int lilac_mesh_dim(
+    SNSOURCE * pIn,
+    int32_t  * pPoints,
+    int32_t  * pTris,
+    int      * pErrCode,
+    long     * pLine) {
+  
+  int status = 0;
+  int i_dummy = 0;
+  long l_dummy = 0;
+  int32_t point_count = 0;
+  int32_t tri_count = 0;
+  SNPARSER *pSn = NULL;
+  
+  /* Check parameters */
+  if ((pIn == NULL) || (pPoints == NULL) || (pTris == NULL)) {
+    abort();
+  }
+  
+  if (pErrCode == NULL) {
+    pErrCode = &i_dummy;
+  }
+  if (pLine == NULL) {
+    pLine = &l_dummy;
+  }
+  
+  *pErrCode = LILAC_MESH_ERR_OK;
+  *pLine = 0;
+  
+  /* Read the header */
+  pSn = snparser_alloc();
+  status = readHeader(
+              pSn, pIn, &point_count, &tri_count, pErrCode, pLine);
+  snparser_free(pSn);
+  pSn = NULL;
+  
+  if (status) {
+    *pPoints = point_count;
+    *pTris = tri_count;
+  }
+  
+  return status;
+}
+
+/*
+ * lilac_mesh_check function.
+ */
+int lilac_mesh_check(const LILAC_MESH *pMesh, int32_t *pIndex) {
+  
+  int err = LILAC_MESH_ERR_OK;
+  int32_t where = -1;
+  int32_t i = 0;
+  
+  const LILAC_MESH_POINT *pp = NULL;
+  
+  /* Check parameter */
+  if (pMesh == NULL) {
+    abort();
+  }
+  
+  /* Check the counts */
+  if ((pMesh->point_count < 0) ||
+      (pMesh->point_count > LILAC_MESH_MAX_POINTS)) {
+    err = LILAC_MESH_ERR_PCOUNT;
+  
+  } else if ((pMesh->tri_count < 0) ||
+              (pMesh->tri_count > LILAC_MESH_MAX_TRIS)) {
+    err = LILAC_MESH_ERR_TCOUNT;
+  }
+  
+  /* The arrays must be present exactly when not empty */
+  if (!err) {
+    if (((pMesh->point_count > 0) && (pMesh->pPoints == NULL)) ||
+        ((pMesh->tri_count > 0) && (pMesh->pTris == NULL))) {
+      abort();
+    }
+  }
+  
+  /* Check each point with the rules of op_p() */
+  for(i = 0; (!err) && (i < pMesh->point_count); i++) {
+    pp = &((pMesh->pPoints)[i]);
+    
+    if ((pp->normd > LILAC_MESH_MAX_C) || (pp->norma > LILAC_MESH_MAX_C) ||
+        (pp->x > LILAC_MESH_MAX_C) || (pp->y > LILAC_MESH_MAX_C)) {
+      err = LILAC_MESH_ERR_NUMBER;
+    
+    } else if ((pp->normd == 0) && (pp->norma != 0)) {
+      err = LILAC_MESH_ERR_NORMDA;
+    
+    } else if (pp->norma >= LILAC_MESH_MAX_C) {
+      err = LILAC_MESH_ERR_NORM2P;
+    }
+    
+    if (err) {
+      where = i;
+    }
+  }
+  
+  /* Check all the triangles in bulk, and then check for orphan
+   * points */
+  if (!err) {
+    err = check_tris(pMesh, pMesh->tri_count, 1, &where);
+  }
+  
+  if (pIndex != NULL) {
+    *pIndex = where;
+  }
+  return err;
+}
+
+/*
+ * lilac_mesh_from_arrays function.
+ */
+LILAC_MESH *lilac_mesh_from_arrays(
+    const LILAC_MESH_POINT * pPoints,
+          int32_t            point_count,
+    const uint16_t         * pTris,
+          int32_t            tri_count,
+          int                flags,
+          int              * pErrCode) {
+  
+  int i_dummy = 0;
+  int32_t i = 0;
+  uint16_t v = 0;
+  
+  uint16_t *pt = NULL;
+  LILAC_MESH *pM = NULL;
+  
+  /* Check parameters */
+  if ((flags & ~LILAC_MESH_CANONICAL) != 0) {
+    abort();
+  }
+  
+  if (pErrCode == NULL) {
+    pErrCode = &i_dummy;
+  }
+  *pErrCode = LILAC_MESH_ERR_OK;
+  
+  /* Check the counts */
+  if ((point_count < 0) || (point_count > LILAC_MESH_MAX_POINTS)) {
+    *pErrCode = LILAC_MESH_ERR_PCOUNT;
+    return NULL;
+  }
+  if ((tri_count < 0) || (tri_count > LILAC_MESH_MAX_TRIS)) {
+    *pErrCode = LILAC_MESH_ERR_TCOUNT;
+    return NULL;
+  }
+  
+  if (((point_count > 0) && (pPoints == NULL)) ||
+      ((tri_count > 0) && (pTris == NULL))) {
+    abort();
+  }
+  
+  /* Allocate the mesh and copy the arrays */
+  pM = (LILAC_MESH *) lilac_mesh_mem_alloc(
+                        LILAC_MESH_MEM_MESH, 1, sizeof(LILAC_MESH));
+  if (pM == NULL) {
+    abort();
+  }
+  pM->point_count = point_count;
+  pM->tri_count = tri_count;
+  
+  if (point_count > 0) {
+    pM->pPoints = (LILAC_MESH_POINT *) lilac_mesh_mem_alloc(
+                    LILAC_MESH_MEM_MESH,
+                    (size_t) point_count, sizeof(LILAC_MESH_POINT));
+    if (pM->pPoints == NULL) {
+      abort();
+    }
+    memcpy(pM->pPoints, pPoints,
+            ((size_t) point_count) * sizeof(LILAC_MESH_POINT));
+  }
+  
+  if (tri_count > 0) {
+    pM->pTris = (uint16_t *) lilac_mesh_mem_alloc(
+                    LILAC_MESH_MEM_MESH,
+                    ((size_t) tri_count) * 3, sizeof(uint16_t));
+    if (pM->pTris == NULL) {
+      abort();
+    }
+    memcpy(pM->pTris, pTris,
+            ((size_t) tri_count) * 3 * sizeof(uint16_t));
+  }
+  
+  /* If requested, rotate each triangle so that its lowest vertex comes
+   * first, which keeps the winding, and then sort the triangles */
+  if ((flags & LILAC_MESH_CANONICAL) && (tri_count > 0)) {
+    for(i = 0; i < tri_count; i++) {
+      pt = &((pM->pTris)[i * 3]);
+      while ((pt[1] < pt[0]) || (pt[2] < pt[0])) {
+        v = pt[0];
+        pt[0] = pt[1];
+        pt[1] = pt[2];
+        pt[2] = v;
+      }
+    }
+    
+    qsort(pM->pTris, (size_t) tri_count, 3 * sizeof(uint16_t), &cmp_tri);
+  }
+  
+  /* Check the mesh */
+  *pErrCode = lilac_mesh_check(pM, NULL);
+  if (*pErrCode != LILAC_MESH_ERR_OK) {
+    lilac_mesh_free(pM);
+    pM = NULL;
+  }
+  
+  return pM;
+}
+
+/*
+ * lilac_mesh_write function.
+ */
+int lilac_mesh_write(const LILAC_MESH *pMesh, FILE *pOut) {
+  
+  int32_t i = 0;
+  const LILAC_MESH_POINT *pp = NULL;
+  const uint16_t *pt = NULL;
+  
+  /* Check parameters */
+  if ((pMesh == NULL) || (pOut == NULL)) {
+    abort();
+  }
+  
+  fprintf(pOut, "%%lilac-mesh;\n%%dim %ld %ld;\n",
+            (long) pMesh->point_count, (long) pMesh->tri_count);
+  
+  for(i = 0; i < pMesh->point_count; i++) {
+    pp = &((pMesh->pPoints)[i]);
+    fprintf(pOut, "%d %d %d %d p\n",
+              (int) pp->normd, (int) pp->norma,
+              (int) pp->x, (int) pp->y);
+  }
+  
+  for(i = 0; i < pMesh->tri_count; i++) {
+    pt = &((pMesh->pTris)[i * 3]);
+    fprintf(pOut, "%d %d %d t\n", (int) pt[0], (int) pt[1], (int) pt[2]);
+  }
+  
+  fprintf(pOut, "|;\n");
+  
+  return !ferror(pOut);
+}
+
 /*
  * lilac_mesh_free function.
  */
@@ -1300,21 +1631,226 @@ void lilac_mesh_free(LILAC_MESH *pLm) {
   
     /* Free the arrays if allocated */
     if (pLm->pPoints != NULL) {
-      free(pLm->pPoints);
+      lilac_mesh_mem_free(pLm->pPoints);
       pLm->pPoints = NULL;
     }
   
     if (pLm->pTris != NULL) {
-      free(pLm->pTris);
+      lilac_mesh_mem_free(pLm->pTris);
       pLm->pTris = NULL;
     }
   
     /* Free the main structure */
-    free(pLm);
+    lilac_mesh_mem_free(pLm);
     pLm = NULL;
   }
 }
 
+/*
+ * lilac_mesh_mem_hook function.
+ */
+void lilac_mesh_mem_hook(
+    LILAC_MESH_ALLOC_FN   fAlloc,
+    LILAC_MESH_FREE_FN    fFree,
+    void                * pCustom) {
+  
+  /* Check parameters */
+  if ((fAlloc == NULL) != (fFree == NULL)) {
+    abort();
+  }
+  
+  if (pthread_mutex_lock(&m_mem_lock)) {
+    abort();
+  }
+  
+  /* Blocks from one allocator can't be released by another */
+  if (m_mem_blocks != 0) {
+    abort();
+  }
+  
+  m_fAlloc = fAlloc;
+  m_fFree = fFree;
+  m_pMemCustom = pCustom;
+  
+  if (pthread_mutex_unlock(&m_mem_lock)) {
+    abort();
+  }
+}
+
+/*
+ * lilac_mesh_mem_alloc function.
+ */
+void *lilac_mesh_mem_alloc(int sys, size_t count, size_t size) {
+  
+  size_t bytes = 0;
+  MEM_HEADER *ph = NULL;
+  
+  /* Check parameters */
+  if ((sys < 0) || (sys >= LILAC_MESH_MEM_COUNT) ||
+      (count < 1) || (size < 1)) {
+    abort();
+  }
+  
+  /* Check for overflow, leaving room for the header */
+  if (count > (SIZE_MAX - sizeof(MEM_HEADER)) / size) {
+    return NULL;
+  }
+  bytes = count * size;
+  
+  /* Allocate and clear the block; calloc() can often skip the clearing
+   * for large blocks, since fresh pages are already zero */
+  if (m_fAlloc == NULL) {
+    ph = (MEM_HEADER *) calloc(1, sizeof(MEM_HEADER) + bytes);
+  } else {
+    ph = (MEM_HEADER *) (*m_fAlloc)(sizeof(MEM_HEADER) + bytes,
+                                    m_pMemCustom);
+    if (ph != NULL) {
+      memset(ph, 0, sizeof(MEM_HEADER) + bytes);
+    }
+  }
+  if (ph == NULL) {
+    return NULL;
+  }
+  
+  ph->h.size = bytes;
+  ph->h.sys = sys;
+  
+  /* Update the counters */
+  if (pthread_mutex_lock(&m_mem_lock)) {
+    abort();
+  }
+  
+  m_mem_cur[sys] += bytes;
+  if (m_mem_cur[sys] > m_mem_peak[sys]) {
+    m_mem_peak[sys] = m_mem_cur[sys];
+  }
+  
+  m_mem_total += bytes;
+  if (m_mem_total > m_mem_total_peak) {
+    m_mem_total_peak = m_mem_total;
+  }
+  
+  m_mem_blocks++;
+  
+  if (pthread_mutex_unlock(&m_mem_lock)) {
+    abort();
+  }
+  
+  return (void *) (ph + 1);
+}
+
+/*
+ * lilac_mesh_mem_free function.
+ */
+void lilac_mesh_mem_free(void *p) {
+  
+  MEM_HEADER *ph = NULL;
+  
+  /* Ignore NULL */
+  if (p == NULL) {
+    return;
+  }
+  ph = ((MEM_HEADER *) p) - 1;
+  
+  /* Update the counters */
+  if (pthread_mutex_lock(&m_mem_lock)) {
+    abort();
+  }
+  
+  if ((m_mem_blocks < 1) || (m_mem_cur[ph->h.sys] < ph->h.size)) {
+    abort();
+  }
+  m_mem_cur[ph->h.sys] -= ph->h.size;
+  m_mem_total -= ph->h.size;
+  m_mem_blocks--;
+  
+  if (pthread_mutex_unlock(&m_mem_lock)) {
+    abort();
+  }
+  
+  /* Release the block */
+  if (m_fFree == NULL) {
+    free(ph);
+  } else {
+    (*m_fFree)(ph, m_pMemCustom);
+  }
+}
+
+/*
+ * lilac_mesh_mem_stats function.
+ */
+void lilac_mesh_mem_stats(int sys, size_t *pCurrent, size_t *pPeak) {
+  
+  size_t cur = 0;
+  size_t peak = 0;
+  
+  /* Check parameters */
+  if ((sys != LILAC_MESH_MEM_ALL) &&
+      ((sys < 0) || (sys >= LILAC_MESH_MEM_COUNT))) {
+    abort();
+  }
+  
+  /* Read the counters */
+  if (pthread_mutex_lock(&m_mem_lock)) {
+    abort();
+  }
+  
+  if (sys == LILAC_MESH_MEM_ALL) {
+    cur = m_mem_total;
+    peak = m_mem_total_peak;
+  } else {
+    cur = m_mem_cur[sys];
+    peak = m_mem_peak[sys];
+  }
+  
+  if (pthread_mutex_unlock(&m_mem_lock)) {
+    abort();
+  }
+  
+  if (pCurrent != NULL) {
+    *pCurrent = cur;
+  }
+  if (pPeak != NULL) {
+    *pPeak = peak;
+  }
+}
+
+/*
+ * lilac_mesh_mem_name function.
+ */
+const char *lilac_mesh_mem_name(int sys) {
+  
+  const char *pResult = NULL;
+  
+  switch (sys) {
+  
+    case LILAC_MESH_MEM_ALL:
+      pResult = "total";
+      break;
+  
+    case LILAC_MESH_MEM_MESH:
+      pResult = "mesh";
+      break;
+  
+    case LILAC_MESH_MEM_WORK:
+      pResult = "work";
+      break;
+  
+    case LILAC_MESH_MEM_FRAME:
+      pResult = "frame";
+      break;
+  
+    case LILAC_MESH_MEM_VERTEX:
+      pResult = "vertex";
+      break;
+  
+    default:
+      abort();
+  }
+  
+  return pResult;
+}
+
 /*
  * lilac_mesh_errstr function.
  */
@@ -1428,6 +1964,10 @@ const char *lilac_mesh_errstr(int code) {
       pResult = "Same directed triangle edge used more than once";
       break;
     
+    case LILAC_MESH_ERR_PACKED:
+      pResult = "Invalid or corrupted compact binary mesh";
+      break;
+    
     default:
       if (code < 0) {
         pResult = snerror_str(code);
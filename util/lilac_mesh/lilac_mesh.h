@@ -8,6 +8,11 @@
  * Lilac module for parsing a Shastina mesh file into memory.
  * 
  * This module must be compiled together with the Shastina library.
+ * 
+ * The memory this module allocates for meshes is counted, together with
+ * memory that clients allocate through lilac_mesh_mem_alloc(), so that
+ * programs can report their current and peak memory use.  The counters
+ * are protected by a mutex, so this module requires pthreads.
  */
 
 /*
@@ -17,6 +22,7 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 #include "shastina.h"
 
 /*
@@ -61,6 +67,7 @@
 #define LILAC_MESH_ERR_TRSORT (24)  /* Invalid triangle sorting */
 #define LILAC_MESH_ERR_DUPEDG (25)  /* Duplicated directed edge */
 #define LILAC_MESH_ERR_TROVER (26)  /* Too many triangles defined */
+#define LILAC_MESH_ERR_PACKED (27)  /* Invalid compact binary mesh */
 
 /*
  * Constants
@@ -79,10 +86,6 @@
  * 
  * This must be in unsigned 16-bit range.  It must also not exceed the
  * value of LILAC_MESH_MAX_C.
- * 
- * To check for unique edges, a bitmap is constructed that has as many
- * bits as this constant value squared, so be careful not to set this
- * too high.
  */
 #define LILAC_MESH_MAX_POINTS (1024)
 
@@ -93,11 +96,61 @@
  */
 #define LILAC_MESH_MAX_TRIS (1024)
 
+/*
+ * Flags for lilac_mesh_from_arrays().
+ * 
+ * LILAC_MESH_CANONICAL rotates the vertices of each triangle so that
+ * the vertex with the lowest index comes first, keeping the winding,
+ * and then sorts the triangles into the required order before the mesh
+ * is checked.
+ */
+#define LILAC_MESH_CANONICAL (1)
+
+/*
+ * Memory subsystems for lilac_mesh_mem_alloc().
+ * 
+ * Every counted allocation belongs to one subsystem, and the current
+ * and peak number of bytes is tracked separately for each one.
+ * 
+ * LILAC_MESH_MEM_MESH is mesh objects, which this module allocates
+ * itself.  LILAC_MESH_MEM_WORK is temporary memory used while parsing
+ * and validating meshes, including the edge usage map.  The last two
+ * are for renderers: LILAC_MESH_MEM_FRAME is pixel buffers, and
+ * LILAC_MESH_MEM_VERTEX is converted vertices, edge tables, and the
+ * rest of the state built for each frame.
+ * 
+ * LILAC_MESH_MEM_ALL may be passed to lilac_mesh_mem_stats() to get the
+ * totals over all subsystems.
+ */
+#define LILAC_MESH_MEM_MESH   (0)
+#define LILAC_MESH_MEM_WORK   (1)
+#define LILAC_MESH_MEM_FRAME  (2)
+#define LILAC_MESH_MEM_VERTEX (3)
+
+#define LILAC_MESH_MEM_COUNT  (4)
+#define LILAC_MESH_MEM_ALL    (-1)
+
 /*
  * Type declarations
  * -----------------
  */
 
+/*
+ * Function pointer types for a custom allocator installed with
+ * lilac_mesh_mem_hook().
+ * 
+ * The allocation function receives a byte count that is never zero and
+ * returns a pointer to at least that many bytes, aligned for any type,
+ * or NULL if it fails.  The memory need not be cleared.  The free
+ * function releases a pointer returned by the allocation function.
+ * Both receive the custom pointer that was passed to the hook.
+ * 
+ * The functions are called from whatever thread allocates, so they must
+ * be thread-safe if the client allocates from several threads.
+ */
+typedef void *(*LILAC_MESH_ALLOC_FN)(size_t size, void *pCustom);
+typedef void (*LILAC_MESH_FREE_FN)(void *p, void *pCustom);
+
 /*
  * Structure representing a point within a Lilac mesh.
  */
@@ -306,6 +359,155 @@ typedef struct {
  */
 LILAC_MESH *lilac_mesh_new(SNSOURCE *pIn, int *pErrCode, long *pLine);
 
+/*
+ * Read only the header of a Lilac mesh file.
+ * 
+ * This reads the signature and the %dim metacommand exactly as
+ * lilac_mesh_new() does, and stops there.  The rest of the file is not
+ * read, so this is much faster than loading the mesh when only the
+ * point and triangle counts are needed.  The counts are not checked
+ * against the rest of the file.
+ * 
+ * pIn, pErrCode, and pLine have the same meaning as for
+ * lilac_mesh_new().
+ * 
+ * Parameters:
+ * 
+ *   pIn - the Shastina source to read the Lilac mesh file from
+ * 
+ *   pPoints - receives the point count
+ * 
+ *   pTris - receives the triangle count
+ * 
+ *   pErrCode - pointer to variable to receive the error code status of
+ *   the operation, or NULL
+ * 
+ *   pLine - pointer to variable to receive a line number, or NULL
+ * 
+ * Return:
+ * 
+ *   non-zero if successful, zero if the header is invalid
+ */
+int lilac_mesh_dim(
+    SNSOURCE * pIn,
+    int32_t  * pPoints,
+    int32_t  * pTris,
+    int      * pErrCode,
+    long     * pLine);
+
+/*
+ * Check that a Lilac mesh object satisfies all the rules of the Lilac
+ * mesh format.
+ * 
+ * This applies exactly the rules that lilac_mesh_new() enforces while
+ * parsing, but to a mesh that is already complete in memory, such as a
+ * mesh decoded from another format.  The point and triangle counts must
+ * be within the limits, every point must have values in range with a
+ * valid normal, and the triangle list must satisfy all the rules given
+ * for the pTris field of the LILAC_MESH structure, with no orphan
+ * points.
+ * 
+ * Points are checked first in order, then triangles in order, and the
+ * first problem found is reported with the same error code that
+ * lilac_mesh_new() would report for it.  The triangle rules are checked
+ * in bulk passes over the whole triangle list, with exact integer
+ * orientation tests in blocks and a counting sort of the directed edges
+ * by starting point, so the time is linear in the size of the mesh.
+ * lilac_mesh_new() uses the same passes once it has read all the
+ * triangles.  Values out of range are reported as
+ * LILAC_MESH_ERR_NUMBER.  The orphan check comes last.
+ * 
+ * pIndex, if not NULL, receives the index of the point or triangle
+ * that failed a check, or -1 if there was no error or the error does
+ * not belong to a single point or triangle.
+ * 
+ * Parameters:
+ * 
+ *   pMesh - the mesh object to check
+ * 
+ *   pIndex - pointer to variable to receive the failing index, or NULL
+ * 
+ * Return:
+ * 
+ *   LILAC_MESH_ERR_OK if the mesh is valid, or an error code
+ */
+int lilac_mesh_check(const LILAC_MESH *pMesh, int32_t *pIndex);
+
+/*
+ * Create a Lilac mesh object from point and triangle arrays in memory.
+ * 
+ * This is for programs that generate meshes, so they do not have to
+ * write a Shastina mesh file and parse it again to get a validated mesh
+ * object.  The arrays are copied into a new mesh object, which is then
+ * checked with lilac_mesh_check().  The arrays are in the same form as
+ * the pPoints and pTris fields of the LILAC_MESH structure, and they
+ * remain owned by the caller.
+ * 
+ * flags is zero or LILAC_MESH_CANONICAL.  With zero, the arrays must
+ * already satisfy all the rules of the mesh format.  With
+ * LILAC_MESH_CANONICAL, the vertices of each triangle may start at any
+ * vertex and the triangles may be in any order, and they are put into
+ * the canonical form before the check.  The winding of triangles is
+ * never changed, so clockwise triangles are still errors.  A fault
+ * occurs if any other flag is set.
+ * 
+ * pErrCode, if not NULL, points to a variable to receive the error code
+ * status upon return.  Counts out of range are reported as
+ * LILAC_MESH_ERR_PCOUNT and LILAC_MESH_ERR_TCOUNT.  Other problems are
+ * reported with the error codes from lilac_mesh_check(), which are the
+ * same that lilac_mesh_new() reports for a mesh file with the same
+ * points and triangles.
+ * 
+ * Upon success, the return value is a dynamically allocated mesh object
+ * that should eventually be freed with lilac_mesh_free().  Upon failure,
+ * the return value is NULL.
+ * 
+ * Parameters:
+ * 
+ *   pPoints - the points, which may be NULL only if point_count is zero
+ * 
+ *   point_count - the number of points
+ * 
+ *   pTris - the vertex indices of the triangles, three for each
+ *   triangle, which may be NULL only if tri_count is zero
+ * 
+ *   tri_count - the number of triangles
+ * 
+ *   flags - zero or LILAC_MESH_CANONICAL
+ * 
+ *   pErrCode - pointer to variable to receive the error code status of
+ *   the operation, or NULL
+ * 
+ * Return:
+ * 
+ *   a new Lilac mesh object or NULL if failure
+ */
+LILAC_MESH *lilac_mesh_from_arrays(
+    const LILAC_MESH_POINT * pPoints,
+          int32_t            point_count,
+    const uint16_t         * pTris,
+          int32_t            tri_count,
+          int                flags,
+          int              * pErrCode);
+
+/*
+ * Write a mesh as a Shastina mesh file.
+ * 
+ * The mesh is written in the plain form that lilac_parse_text() can
+ * tokenize in parallel, with one point or triangle per line.
+ * 
+ * Parameters:
+ * 
+ *   pMesh - the mesh
+ * 
+ *   pOut - the file to write to
+ * 
+ * Return:
+ * 
+ *   non-zero if successful, zero if an I/O error occurred
+ */
+int lilac_mesh_write(const LILAC_MESH *pMesh, FILE *pOut);
+
 /*
  * Free an allocated Lilac mesh object.
  * 
@@ -317,6 +519,106 @@ LILAC_MESH *lilac_mesh_new(SNSOURCE *pIn, int *pErrCode, long *pLine);
  */
 void lilac_mesh_free(LILAC_MESH *pLm);
 
+/*
+ * Install a custom allocator for all counted memory.
+ * 
+ * This must be called before any counted memory is allocated, or after
+ * all of it has been freed, or a fault occurs.  Mesh objects are
+ * counted memory, so this is normally called at the start of the
+ * program.  Passing NULL for both functions restores the default of
+ * malloc() and free().  A fault occurs if only one function is NULL.
+ * 
+ * Parameters:
+ * 
+ *   fAlloc - the allocation function, or NULL
+ * 
+ *   fFree - the free function, or NULL
+ * 
+ *   pCustom - custom pointer passed through to both functions
+ */
+void lilac_mesh_mem_hook(
+    LILAC_MESH_ALLOC_FN   fAlloc,
+    LILAC_MESH_FREE_FN    fFree,
+    void                * pCustom);
+
+/*
+ * Allocate counted memory for a subsystem.
+ * 
+ * The memory holds count elements of the given size and is cleared to
+ * zero, like calloc().  It must be released with lilac_mesh_mem_free()
+ * and never with free().  The bytes are added to the current count of
+ * the subsystem, and its peak is raised if the current count exceeds
+ * it.
+ * 
+ * A fault occurs if the subsystem is not one of the LILAC_MESH_MEM
+ * constants other than LILAC_MESH_MEM_ALL, or if count or size is zero.
+ * 
+ * Parameters:
+ * 
+ *   sys - the subsystem the memory is counted against
+ * 
+ *   count - the number of elements
+ * 
+ *   size - the size of each element in bytes
+ * 
+ * Return:
+ * 
+ *   the allocated memory, or NULL if the allocator failed or the total
+ *   size overflows
+ */
+void *lilac_mesh_mem_alloc(int sys, size_t count, size_t size);
+
+/*
+ * Release counted memory.
+ * 
+ * The bytes are subtracted from the current count of the subsystem the
+ * memory was allocated for.  If NULL is passed, the call is ignored.
+ * 
+ * Parameters:
+ * 
+ *   p - memory from lilac_mesh_mem_alloc(), or NULL
+ */
+void lilac_mesh_mem_free(void *p);
+
+/*
+ * Get the memory counters of a subsystem.
+ * 
+ * The counts are of the bytes requested by clients and do not include
+ * the small header that is stored in front of each block.  The peak is
+ * the highest current count since the program started.  For
+ * LILAC_MESH_MEM_ALL, the current count is the sum over all subsystems
+ * and the peak is the highest that sum has been, which may be less than
+ * the sum of the peaks.
+ * 
+ * Parameters:
+ * 
+ *   sys - the subsystem, or LILAC_MESH_MEM_ALL
+ * 
+ *   pCurrent - receives the number of bytes currently allocated, or
+ *   NULL
+ * 
+ *   pPeak - receives the peak number of bytes allocated, or NULL
+ */
+void lilac_mesh_mem_stats(int sys, size_t *pCurrent, size_t *pPeak);
+
+/*
+ * Return the name of a memory subsystem.
+ * 
+ * The name is a short lowercase word such as "mesh" that is suitable
+ * for statistics output.  LILAC_MESH_MEM_ALL is named "total".  The
+ * string is statically allocated.  A fault occurs if the subsystem is
+ * not recognized.
+ * 
+ * Parameters:
+ * 
+ *   sys - the subsystem, or LILAC_MESH_MEM_ALL
+ * 
+ * Return:
+ * 
+ *   the name of the subsystem
+ */
+const char *lilac_mesh_mem_name(int sys);
+
 /*
  * Given an error code from Lilac mesh or Shastina, return an error
  * message corresponding to that code.
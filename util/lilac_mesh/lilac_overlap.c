@@ -0,0 +1,284 @@
+/*
+ * lilac_overlap.c
+ * ===============
+ * 
+ * Implementation of lilac_overlap.h
+ * 
+ * See the header for further information.
+ */
+
+#include "lilac_overlap.h"
+
+#include <stdlib.h>
+
+/*
+ * Type declarations
+ * -----------------
+ */
+
+/*
+ * The bounding box of a triangle, along with the triangle index.
+ */
+typedef struct {
+  int32_t x_min;
+  int32_t x_max;
+  int32_t y_min;
+  int32_t y_max;
+  int32_t tri;
+} TRI_BOX;
+
+/*
+ * Local functions
+ * ---------------
+ */
+
+/* Prototypes */
+static int32_t orient(
+    const LILAC_MESH_POINT * pa,
+    const LILAC_MESH_POINT * pb,
+    const LILAC_MESH_POINT * pc);
+
+static int separates(
+    const LILAC_MESH * pM,
+    const uint16_t   * pa,
+    const uint16_t   * pb);
+
+static int cmp_box(const void *pA, const void *pB);
+
+/*
+ * Compute the orientation of three points.
+ * 
+ * Coordinates are at most LILAC_MESH_MAX_C, so the cross product is
+ * computed exactly in 32-bit integers.
+ * 
+ * Parameters:
+ * 
+ *   pa - the first point
+ * 
+ *   pb - the second point
+ * 
+ *   pc - the third point
+ * 
+ * Return:
+ * 
+ *   greater than zero if counter-clockwise, less than zero if
+ *   clockwise, or zero if colinear
+ */
+static int32_t orient(
+    const LILAC_MESH_POINT * pa,
+    const LILAC_MESH_POINT * pb,
+    const LILAC_MESH_POINT * pc) {
+  
+  return (((int32_t) pb->x) - ((int32_t) pa->x)) *
+            (((int32_t) pc->y) - ((int32_t) pa->y)) -
+          (((int32_t) pb->y) - ((int32_t) pa->y)) *
+            (((int32_t) pc->x) - ((int32_t) pa->x));
+}
+
+/*
+ * Check whether the line through an edge of one triangle separates it
+ * from another triangle.
+ * 
+ * Both triangles are counter-clockwise, so the interior of a triangle
+ * is on the left of each of its edges.  The edge separates the
+ * triangles if all three points of the other triangle are on the right
+ * of the edge or on its line.
+ * 
+ * Two convex polygons have disjoint interiors exactly when the line
+ * through some edge of one of them separates them in this way, so the
+ * triangles overlap exactly when this function returns zero both ways.
+ * 
+ * Parameters:
+ * 
+ *   pM - the mesh
+ * 
+ *   pa - the vertices of the triangle whose edges are tested
+ * 
+ *   pb - the vertices of the other triangle
+ * 
+ * Return:
+ * 
+ *   non-zero if an edge of the first triangle separates the triangles
+ */
+static int separates(
+    const LILAC_MESH * pM,
+    const uint16_t   * pa,
+    const uint16_t   * pb) {
+  
+  int k = 0;
+  int j = 0;
+  const LILAC_MESH_POINT *p1 = NULL;
+  const LILAC_MESH_POINT *p2 = NULL;
+  
+  for(k = 0; k < 3; k++) {
+    p1 = &((pM->pPoints)[pa[k]]);
+    p2 = &((pM->pPoints)[pa[(k + 1) % 3]]);
+  
+    for(j = 0; j < 3; j++) {
+      if (orient(p1, p2, &((pM->pPoints)[pb[j]])) > 0) {
+        break;
+      }
+    }
+    if (j >= 3) {
+      return 1;
+    }
+  }
+  
+  return 0;
+}
+
+/*
+ * Comparison function for sorting bounding boxes by their left side.
+ * 
+ * Ties are broken by triangle index so that the sort is deterministic.
+ * 
+ * Parameters:
+ * 
+ *   pA - the first box
+ * 
+ *   pB - the second box
+ * 
+ * Return:
+ * 
+ *   less than, equal to, or greater than zero
+ */
+static int cmp_box(const void *pA, const void *pB) {
+  
+  const TRI_BOX *pa = NULL;
+  const TRI_BOX *pb = NULL;
+  
+  pa = (const TRI_BOX *) pA;
+  pb = (const TRI_BOX *) pB;
+  
+  if (pa->x_min != pb->x_min) {
+    return (pa->x_min < pb->x_min) ? -1 : 1;
+  }
+  return (pa->tri < pb->tri) ? -1 : ((pa->tri > pb->tri) ? 1 : 0);
+}
+
+/*
+ * Public function implementations
+ * -------------------------------
+ * 
+ * See the header for specifications
+ */
+
+/*
+ * lilac_overlap_find function.
+ */
+int lilac_overlap_find(
+    const LILAC_MESH * pMesh,
+          int32_t    * pFirst,
+          int32_t    * pSecond) {
+  
+  int found = 0;
+  int32_t i = 0;
+  int32_t j = 0;
+  int32_t k = 0;
+  int32_t active_count = 0;
+  int32_t v = 0;
+  const uint16_t *pt = NULL;
+  const uint16_t *pu = NULL;
+  const LILAC_MESH_POINT *pp = NULL;
+  const TRI_BOX *pb = NULL;
+  const TRI_BOX *pc = NULL;
+  
+  TRI_BOX *pBoxes = NULL;
+  int32_t *pActive = NULL;
+  
+  /* Check parameter */
+  if (pMesh == NULL) {
+    abort();
+  }
+  
+  if (pMesh->tri_count < 2) {
+    return 0;
+  }
+  
+  /* Compute the bounding boxes and sort them by left side */
+  pBoxes = (TRI_BOX *) calloc(
+              (size_t) pMesh->tri_count, sizeof(TRI_BOX));
+  pActive = (int32_t *) calloc(
+              (size_t) pMesh->tri_count, sizeof(int32_t));
+  if ((pBoxes == NULL) || (pActive == NULL)) {
+    abort();
+  }
+  
+  for(i = 0; i < pMesh->tri_count; i++) {
+    pt = &((pMesh->pTris)[i * 3]);
+    pp = &((pMesh->pPoints)[pt[0]]);
+    pBoxes[i].x_min = pp->x;
+    pBoxes[i].x_max = pp->x;
+    pBoxes[i].y_min = pp->y;
+    pBoxes[i].y_max = pp->y;
+    pBoxes[i].tri = i;
+  
+    for(k = 1; k < 3; k++) {
+      pp = &((pMesh->pPoints)[pt[k]]);
+      if (pp->x < pBoxes[i].x_min) {
+        pBoxes[i].x_min = pp->x;
+      }
+      if (pp->x > pBoxes[i].x_max) {
+        pBoxes[i].x_max = pp->x;
+      }
+      if (pp->y < pBoxes[i].y_min) {
+        pBoxes[i].y_min = pp->y;
+      }
+      if (pp->y > pBoxes[i].y_max) {
+        pBoxes[i].y_max = pp->y;
+      }
+    }
+  }
+  
+  qsort(pBoxes, (size_t) pMesh->tri_count, sizeof(TRI_BOX), &cmp_box);
+  
+  /* Sweep from left to right, keeping the boxes that still reach past
+   * the left side of the current box active; boxes that only touch
+   * can't have overlapping interiors */
+  for(i = 0; (i < pMesh->tri_count) && (!found); i++) {
+    pb = &(pBoxes[i]);
+    pt = &((pMesh->pTris)[pb->tri * 3]);
+  
+    v = 0;
+    for(j = 0; j < active_count; j++) {
+      pc = &(pBoxes[pActive[j]]);
+      if (pc->x_max <= pb->x_min) {
+        continue;
+      }
+      pActive[v] = pActive[j];
+      v++;
+  
+      if ((!found) &&
+          (pc->y_min < pb->y_max) && (pb->y_min < pc->y_max)) {
+        pu = &((pMesh->pTris)[pc->tri * 3]);
+        if ((!separates(pMesh, pt, pu)) && (!separates(pMesh, pu, pt))) {
+          found = 1;
+          if (pc->tri < pb->tri) {
+            if (pFirst != NULL) {
+              *pFirst = pc->tri;
+            }
+            if (pSecond != NULL) {
+              *pSecond = pb->tri;
+            }
+          } else {
+            if (pFirst != NULL) {
+              *pFirst = pb->tri;
+            }
+            if (pSecond != NULL) {
+              *pSecond = pc->tri;
+            }
+          }
+        }
+      }
+    }
+    active_count = v;
+  
+    pActive[active_count] = i;
+    active_count++;
+  }
+  
+  free(pBoxes);
+  free(pActive);
+  
+  return found;
+}
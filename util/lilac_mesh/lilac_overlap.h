@@ -0,0 +1,71 @@
+#ifndef LILAC_OVERLAP_H_INCLUDED
+#define LILAC_OVERLAP_H_INCLUDED
+
+/*
+ * lilac_overlap.h
+ * ===============
+ * 
+ * Lilac module for detecting overlapping triangles in a mesh.
+ * 
+ * The rules of the mesh format enforced by lilac_mesh_new() do not
+ * prevent two triangles from covering the same area.  Renderers draw
+ * the triangles in order, so overlapping triangles silently overwrite
+ * each other.  This module finds such triangles.
+ * 
+ * Two triangles overlap if their interiors intersect.  Triangles that
+ * only share an edge, share a vertex, or touch along a boundary do not
+ * overlap.  The test is exact, using integer arithmetic on the mesh
+ * coordinates.
+ * 
+ * The triangles are sorted by the left side of their bounding boxes and
+ * swept from left to right, and only pairs whose bounding boxes
+ * intersect are tested.  For meshes without long, thin triangles that
+ * span most of the mesh, this takes O(n log n) time.
+ * 
+ * This module only depends on the types declared in lilac_mesh.h.
+ */
+
+/*
+ * Imports
+ * -------
+ */
+
+#include <stdint.h>
+#include "lilac_mesh.h"
+
+/*
+ * Public functions
+ * ----------------
+ */
+
+/*
+ * Find a pair of overlapping triangles in a mesh.
+ * 
+ * The mesh must satisfy all the rules of the mesh format, which is
+ * always the case for meshes from lilac_mesh_new(), or the result is
+ * undefined.  In particular, every triangle must be counter-clockwise
+ * and not degenerate.
+ * 
+ * If an overlapping pair is found, the indices of the two triangles
+ * are written to pFirst and pSecond, with the lower index in pFirst.
+ * Which pair is reported when there are several is not specified.
+ * 
+ * Parameters:
+ * 
+ *   pMesh - the mesh to check
+ * 
+ *   pFirst - receives the index of the first triangle, or NULL
+ * 
+ *   pSecond - receives the index of the second triangle, or NULL
+ * 
+ * Return:
+ * 
+ *   non-zero if an overlapping pair was found, zero if no triangles
+ *   overlap
+ */
+int lilac_overlap_find(
+    const LILAC_MESH * pMesh,
+          int32_t    * pFirst,
+          int32_t    * pSecond);
+
+#endif
@@ -0,0 +1,495 @@
+/*
+ * lilac_pack.c
+ * ============
+ * 
+ * Implementation of lilac_pack.h
+ * 
+ * See the header for further information.
+ */
+
+#include "lilac_pack.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Constants
+ * ---------
+ */
+
+/*
+ * The signature at the start of compact meshes, followed by the format
+ * version byte.
+ */
+#define PACK_MAGIC "\x89LMP"
+#define PACK_MAGIC_LEN (4)
+#define PACK_VERSION (1)
+
+/*
+ * The length of the fixed header, which is the signature and the
+ * version byte.
+ */
+#define PACK_HEADER_LEN (5)
+
+/*
+ * The maximum length in bytes of an encoded variable-length integer.
+ * 
+ * All values in the format are at most LILAC_MESH_MAX_C * 2, which fits
+ * in three bytes.  Longer encodings are rejected.
+ */
+#define VARINT_MAX (3)
+
+/*
+ * The range of normal angles, which wrap around at this value.
+ */
+#define ANGLE_RANGE (LILAC_MESH_MAX_C)
+
+/*
+ * Local functions
+ * ---------------
+ */
+
+/* Prototypes */
+static uint32_t zigzag(int32_t v);
+static int32_t unzigzag(uint32_t z);
+
+static unsigned char *put_varint(unsigned char *pc, uint32_t v);
+static int get_varint(
+    const unsigned char ** ppc,
+    const unsigned char  * pEnd,
+    uint32_t             * pv);
+
+/*
+ * Map a signed delta to an unsigned value so that deltas of small
+ * magnitude become small values: 0, -1, 1, -2, 2 ... map to 0, 1, 2, 3,
+ * 4 ...
+ * 
+ * Parameters:
+ * 
+ *   v - the signed delta
+ * 
+ * Return:
+ * 
+ *   the unsigned value
+ */
+static uint32_t zigzag(int32_t v) {
+  if (v < 0) {
+    return (((uint32_t) (-(v + 1))) << 1) | 1;
+  }
+  return ((uint32_t) v) << 1;
+}
+
+/*
+ * Invert zigzag().
+ * 
+ * Parameters:
+ * 
+ *   z - the unsigned value, which must be at most INT32_MAX
+ * 
+ * Return:
+ * 
+ *   the signed delta
+ */
+static int32_t unzigzag(uint32_t z) {
+  if (z & 1) {
+    return -((int32_t) (z >> 1)) - 1;
+  }
+  return (int32_t) (z >> 1);
+}
+
+/*
+ * Write a variable-length integer.
+ * 
+ * Each byte holds seven bits of the value, least significant group
+ * first, with the high bit set on every byte except the last.
+ * 
+ * Parameters:
+ * 
+ *   pc - the output position, with room for at least VARINT_MAX bytes
+ * 
+ *   v - the value, which must fit in VARINT_MAX bytes
+ * 
+ * Return:
+ * 
+ *   the output position after the written integer
+ */
+static unsigned char *put_varint(unsigned char *pc, uint32_t v) {
+  while (v >= 0x80) {
+    *(pc++) = (unsigned char) ((v & 0x7f) | 0x80);
+    v >>= 7;
+  }
+  *(pc++) = (unsigned char) v;
+  return pc;
+}
+
+/*
+ * Read a variable-length integer.
+ * 
+ * Parameters:
+ * 
+ *   ppc - the input position, which is advanced past the integer
+ * 
+ *   pEnd - the end of the input
+ * 
+ *   pv - receives the value
+ * 
+ * Return:
+ * 
+ *   non-zero if successful, zero if the input ends within the integer
+ *   or the integer is longer than VARINT_MAX bytes
+ */
+static int get_varint(
+    const unsigned char ** ppc,
+    const unsigned char  * pEnd,
+    uint32_t             * pv) {
+  
+  const unsigned char *pc = NULL;
+  uint32_t v = 0;
+  int shift = 0;
+  int c = 0;
+  
+  pc = *ppc;
+  
+  /* Almost all values are a single byte */
+  if ((pc < pEnd) && (!(*pc & 0x80))) {
+    *pv = *pc;
+    *ppc = pc + 1;
+    return 1;
+  }
+  
+  for(shift = 0; shift < 7 * VARINT_MAX; shift += 7) {
+    if (pc >= pEnd) {
+      return 0;
+    }
+    c = *(pc++);
+    v |= ((uint32_t) (c & 0x7f)) << shift;
+    if (!(c & 0x80)) {
+      *pv = v;
+      *ppc = pc;
+      return 1;
+    }
+  }
+  
+  return 0;
+}
+
+/*
+ * Public function implementations
+ * -------------------------------
+ * 
+ * See the header for specifications
+ */
+
+/*
+ * lilac_pack_detect function.
+ */
+int lilac_pack_detect(const unsigned char *pData, size_t len) {
+  
+  /* Check parameters */
+  if ((pData == NULL) && (len > 0)) {
+    abort();
+  }
+  
+  if ((len >= PACK_MAGIC_LEN) &&
+      (memcmp(pData, PACK_MAGIC, PACK_MAGIC_LEN) == 0)) {
+    return 1;
+  }
+  return 0;
+}
+
+/*
+ * lilac_pack_decode function.
+ */
+LILAC_MESH *lilac_pack_decode(
+    const unsigned char * pData,
+          size_t          len,
+          int           * pErrCode) {
+  
+  int err = LILAC_MESH_ERR_OK;
+  int32_t i = 0;
+  int32_t d = 0;
+  int32_t point_count = 0;
+  int32_t tri_count = 0;
+  int32_t x = 0;
+  int32_t y = 0;
+  int32_t normd = 0;
+  int32_t norma = 0;
+  int32_t v1 = 0;
+  int32_t v2 = 0;
+  int32_t v3 = 0;
+  uint32_t u = 0;
+  uint32_t w = 0;
+  
+  const unsigned char *pc = NULL;
+  const unsigned char *pEnd = NULL;
+  LILAC_MESH_POINT *pp = NULL;
+  uint16_t *pt = NULL;
+  LILAC_MESH *pM = NULL;
+  
+  /* Check parameters */
+  if ((pData == NULL) && (len > 0)) {
+    abort();
+  }
+  
+  pc = pData;
+  pEnd = pData + len;
+  
+  /* Check the header */
+  if ((len < PACK_HEADER_LEN) || (!lilac_pack_detect(pData, len)) ||
+      (pData[PACK_MAGIC_LEN] != PACK_VERSION)) {
+    err = LILAC_MESH_ERR_PACKED;
+  } else {
+    pc += PACK_HEADER_LEN;
+  }
+  
+  /* Read the counts */
+  if (!err) {
+    if ((!get_varint(&pc, pEnd, &u)) || (!get_varint(&pc, pEnd, &w))) {
+      err = LILAC_MESH_ERR_PACKED;
+  
+    } else if (u > LILAC_MESH_MAX_POINTS) {
+      err = LILAC_MESH_ERR_PCOUNT;
+  
+    } else if (w > LILAC_MESH_MAX_TRIS) {
+      err = LILAC_MESH_ERR_TCOUNT;
+  
+    } else {
+      point_count = (int32_t) u;
+      tri_count = (int32_t) w;
+    }
+  }
+  
+  /* Allocate the mesh */
+  if (!err) {
+    pM = (LILAC_MESH *) lilac_mesh_mem_alloc(
+                          LILAC_MESH_MEM_MESH, 1, sizeof(LILAC_MESH));
+    if (pM == NULL) {
+      abort();
+    }
+    pM->point_count = point_count;
+    pM->tri_count = tri_count;
+  
+    if (point_count > 0) {
+      pM->pPoints = (LILAC_MESH_POINT *) lilac_mesh_mem_alloc(
+                        LILAC_MESH_MEM_MESH,
+                        (size_t) point_count, sizeof(LILAC_MESH_POINT));
+      if (pM->pPoints == NULL) {
+        abort();
+      }
+    }
+    if (tri_count > 0) {
+      pM->pTris = (uint16_t *) lilac_mesh_mem_alloc(
+                        LILAC_MESH_MEM_MESH,
+                        ((size_t) tri_count) * 3, sizeof(uint16_t));
+      if (pM->pTris == NULL) {
+        abort();
+      }
+    }
+  }
+  
+  /* Decode the points, each as deltas from the previous point, with
+   * the normal angle wrapping around */
+  for(i = 0; (!err) && (i < point_count); i++) {
+    pp = &((pM->pPoints)[i]);
+  
+    if (!get_varint(&pc, pEnd, &u)) {
+      err = LILAC_MESH_ERR_PACKED;
+      break;
+    }
+    x += unzigzag(u);
+  
+    if (!get_varint(&pc, pEnd, &u)) {
+      err = LILAC_MESH_ERR_PACKED;
+      break;
+    }
+    y += unzigzag(u);
+  
+    if (!get_varint(&pc, pEnd, &u)) {
+      err = LILAC_MESH_ERR_PACKED;
+      break;
+    }
+    normd += unzigzag(u);
+  
+    if (!get_varint(&pc, pEnd, &u)) {
+      err = LILAC_MESH_ERR_PACKED;
+      break;
+    }
+    norma += unzigzag(u);
+    if (norma < 0) {
+      norma += ANGLE_RANGE;
+    } else if (norma >= ANGLE_RANGE) {
+      norma -= ANGLE_RANGE;
+    }
+  
+    if ((x < 0) || (x > LILAC_MESH_MAX_C) ||
+        (y < 0) || (y > LILAC_MESH_MAX_C) ||
+        (normd < 0) || (normd > LILAC_MESH_MAX_C) ||
+        (norma < 0) || (norma >= ANGLE_RANGE)) {
+      err = LILAC_MESH_ERR_PACKED;
+      break;
+    }
+  
+    pp->x = (uint16_t) x;
+    pp->y = (uint16_t) y;
+    pp->normd = (uint16_t) normd;
+    pp->norma = (uint16_t) norma;
+  }
+  
+  /* Decode the triangles; the first vertex is a delta from the previous
+   * first vertex, the second vertex is a delta from the previous second
+   * vertex if the first vertex is the same and otherwise from the first
+   * vertex, and the third vertex is a non-zero delta from the second */
+  for(i = 0; (!err) && (i < tri_count); i++) {
+    pt = &((pM->pTris)[i * 3]);
+  
+    if (!get_varint(&pc, pEnd, &u)) {
+      err = LILAC_MESH_ERR_PACKED;
+      break;
+    }
+    if ((i > 0) && (u == 0)) {
+      if (!get_varint(&pc, pEnd, &w)) {
+        err = LILAC_MESH_ERR_PACKED;
+        break;
+      }
+      v2 = v2 + 1 + ((int32_t) w);
+  
+    } else {
+      v1 += (int32_t) u;
+      if (!get_varint(&pc, pEnd, &w)) {
+        err = LILAC_MESH_ERR_PACKED;
+        break;
+      }
+      v2 = v1 + 1 + ((int32_t) w);
+    }
+  
+    if (!get_varint(&pc, pEnd, &u)) {
+      err = LILAC_MESH_ERR_PACKED;
+      break;
+    }
+    d = unzigzag(u + 1);
+    v3 = v2 + d;
+  
+    if ((v1 > LILAC_MESH_MAX_C) || (v2 > LILAC_MESH_MAX_C) ||
+        (v3 < 0) || (v3 > LILAC_MESH_MAX_C)) {
+      err = LILAC_MESH_ERR_PACKED;
+      break;
+    }
+  
+    pt[0] = (uint16_t) v1;
+    pt[1] = (uint16_t) v2;
+    pt[2] = (uint16_t) v3;
+  }
+  
+  /* The data must end exactly after the mesh */
+  if ((!err) && (pc != pEnd)) {
+    err = LILAC_MESH_ERR_PACKED;
+  }
+  
+  /* Check all the mesh rules on the decoded mesh */
+  if (!err) {
+    err = lilac_mesh_check(pM, NULL);
+  }
+  
+  if (err) {
+    lilac_mesh_free(pM);
+    pM = NULL;
+  }
+  
+  if (pErrCode != NULL) {
+    *pErrCode = err;
+  }
+  return pM;
+}
+
+/*
+ * lilac_pack_encode function.
+ */
+unsigned char *lilac_pack_encode(const LILAC_MESH *pMesh, size_t *pLen) {
+  
+  int32_t i = 0;
+  int32_t d = 0;
+  int32_t v1 = 0;
+  int32_t v2 = 0;
+  size_t cap = 0;
+  unsigned char *pBuf = NULL;
+  unsigned char *pc = NULL;
+  const LILAC_MESH_POINT *pp = NULL;
+  const LILAC_MESH_POINT *pq = NULL;
+  const uint16_t *pt = NULL;
+  LILAC_MESH_POINT zero;
+  
+  memset(&zero, 0, sizeof(LILAC_MESH_POINT));
+  
+  /* Check parameters */
+  if ((pMesh == NULL) || (pLen == NULL)) {
+    abort();
+  }
+  if (lilac_mesh_check(pMesh, NULL) != LILAC_MESH_ERR_OK) {
+    abort();
+  }
+  
+  /* Allocate for the longest possible encoding */
+  cap = PACK_HEADER_LEN + (2 * VARINT_MAX) +
+          (((size_t) pMesh->point_count) * 4 * VARINT_MAX) +
+          (((size_t) pMesh->tri_count) * 3 * VARINT_MAX);
+  pBuf = (unsigned char *) malloc(cap);
+  if (pBuf == NULL) {
+    abort();
+  }
+  pc = pBuf;
+  
+  /* Write the header and the counts */
+  memcpy(pc, PACK_MAGIC, PACK_MAGIC_LEN);
+  pc += PACK_MAGIC_LEN;
+  *(pc++) = PACK_VERSION;
+  
+  pc = put_varint(pc, (uint32_t) pMesh->point_count);
+  pc = put_varint(pc, (uint32_t) pMesh->tri_count);
+  
+  /* Write the points as deltas from the previous point, taking the
+   * shorter way around for the normal angle */
+  pq = &zero;
+  for(i = 0; i < pMesh->point_count; i++) {
+    pp = &((pMesh->pPoints)[i]);
+  
+    pc = put_varint(pc, zigzag(((int32_t) pp->x) - ((int32_t) pq->x)));
+    pc = put_varint(pc, zigzag(((int32_t) pp->y) - ((int32_t) pq->y)));
+    pc = put_varint(pc,
+            zigzag(((int32_t) pp->normd) - ((int32_t) pq->normd)));
+  
+    d = ((int32_t) pp->norma) - ((int32_t) pq->norma);
+    if (d >= ANGLE_RANGE / 2) {
+      d -= ANGLE_RANGE;
+    } else if (d < -(ANGLE_RANGE / 2)) {
+      d += ANGLE_RANGE;
+    }
+    pc = put_varint(pc, zigzag(d));
+  
+    pq = pp;
+  }
+  
+  /* Write the triangles, which are sorted so that none of the deltas
+   * are negative except the third vertex delta, which is never zero */
+  for(i = 0; i < pMesh->tri_count; i++) {
+    pt = &((pMesh->pTris)[i * 3]);
+  
+    if ((i > 0) && (pt[0] == v1)) {
+      pc = put_varint(pc, 0);
+      pc = put_varint(pc, (uint32_t) (pt[1] - v2 - 1));
+  
+    } else {
+      pc = put_varint(pc, (uint32_t) (pt[0] - v1));
+      pc = put_varint(pc, (uint32_t) (pt[1] - pt[0] - 1));
+    }
+  
+    pc = put_varint(pc,
+            zigzag(((int32_t) pt[2]) - ((int32_t) pt[1])) - 1);
+  
+    v1 = pt[0];
+    v2 = pt[1];
+  }
+  
+  *pLen = (size_t) (pc - pBuf);
+  return pBuf;
+}
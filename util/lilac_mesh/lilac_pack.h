@@ -0,0 +1,116 @@
+#ifndef LILAC_PACK_H_INCLUDED
+#define LILAC_PACK_H_INCLUDED
+
+/*
+ * lilac_pack.h
+ * ============
+ * 
+ * Lilac module for the compact binary mesh format.
+ * 
+ * Compact meshes store the same information as Shastina mesh files in
+ * a fraction of the space.  The canonical triangle order makes the
+ * triangle list highly predictable, so vertex indices are stored as
+ * small deltas, and point values are stored as deltas from the previous
+ * point.  All deltas are variable-length integers, so most of them take
+ * a single byte.  See MeshCompact.md in the documentation folder for the
+ * exact format.
+ * 
+ * Compact meshes are decoded from memory directly into a LILAC_MESH
+ * structure without any parsing, and the decoded mesh is validated with
+ * lilac_mesh_check(), so it satisfies all the rules of the Lilac mesh
+ * format just like a mesh from lilac_mesh_new().
+ * 
+ * Compact meshes may themselves be compressed with gzip or Zstandard,
+ * which encodes the remaining redundancy further.  lilac_source_read()
+ * decompresses them transparently.
+ * 
+ * This module must be compiled together with lilac_mesh.c.
+ */
+
+/*
+ * Imports
+ * -------
+ */
+
+#include <stddef.h>
+#include "lilac_mesh.h"
+
+/*
+ * Public functions
+ * ----------------
+ */
+
+/*
+ * Check whether data in memory is a compact binary mesh.
+ * 
+ * Only the signature at the start of the data is examined.
+ * 
+ * Parameters:
+ * 
+ *   pData - the data, which may be NULL only if len is zero
+ * 
+ *   len - the length of the data in bytes
+ * 
+ * Return:
+ * 
+ *   non-zero if the data begins with the compact mesh signature, zero
+ *   otherwise
+ */
+int lilac_pack_detect(const unsigned char *pData, size_t len);
+
+/*
+ * Decode a compact binary mesh from memory.
+ * 
+ * pErrCode, if not NULL, points to a variable to receive the error code
+ * status upon return.  Malformed or truncated data, and data that
+ * continues after the end of the mesh, is reported as
+ * LILAC_MESH_ERR_PACKED.  A decoded mesh that breaks the rules of the
+ * mesh format is reported with the error code from lilac_mesh_check().
+ * 
+ * Upon success, the return value is a dynamically allocated mesh object
+ * that should eventually be freed with lilac_mesh_free().  Upon failure,
+ * the return value is NULL.
+ * 
+ * Parameters:
+ * 
+ *   pData - the compact mesh data, which may be NULL only if len is
+ *   zero
+ * 
+ *   len - the length of the data in bytes
+ * 
+ *   pErrCode - pointer to variable to receive the error code status of
+ *   the operation, or NULL
+ * 
+ * Return:
+ * 
+ *   a new Lilac mesh object or NULL if failure
+ */
+LILAC_MESH *lilac_pack_decode(
+    const unsigned char * pData,
+          size_t          len,
+          int           * pErrCode);
+
+/*
+ * Encode a mesh in the compact binary mesh format.
+ * 
+ * The mesh must satisfy all the rules of the Lilac mesh format, which
+ * is always the case for meshes from lilac_mesh_new() and
+ * lilac_pack_decode().  A fault occurs if lilac_mesh_check() fails on
+ * the mesh.
+ * 
+ * The encoded data is returned in a newly allocated buffer, which the
+ * caller must eventually free().
+ * 
+ * Parameters:
+ * 
+ *   pMesh - the mesh to encode
+ * 
+ *   pLen - receives the length of the encoded data in bytes
+ * 
+ * Return:
+ * 
+ *   the encoded data
+ */
+unsigned char *lilac_pack_encode(const LILAC_MESH *pMesh, size_t *pLen);
+
+#endif
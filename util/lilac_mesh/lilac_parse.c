@@ -0,0 +1,871 @@
+/*
+ * lilac_parse.c
+ * =============
+ * 
+ * Implementation of lilac_parse.h
+ * 
+ * See the header for further information.
+ */
+
+#include "lilac_parse.h"
+#include "lilac_pack.h"
+#include "lilac_source.h"
+#include "lilac_trace.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Constants
+ * ---------
+ */
+
+/*
+ * The minimum number of bytes of text for each tokenizing thread.
+ * 
+ * Below this, starting a thread costs more than it saves.  It may be
+ * overridden when compiling, which is mainly useful for testing the
+ * chunk boundaries on small meshes.
+ */
+#ifndef LILAC_PARSE_CHUNK_MIN
+#define LILAC_PARSE_CHUNK_MIN (65536)
+#endif
+
+/*
+ * The maximum height of the interpreter stack, which must match the
+ * Shastina parser in lilac_mesh.c.
+ */
+#define MAX_SN_STACK (16)
+
+/*
+ * The maximum length of a numeric token in the fast path.
+ * 
+ * Longer tokens, which can only be numbers with many leading zeros, are
+ * left to the Shastina parser.
+ */
+#define TOKEN_MAX (8)
+
+/*
+ * Token values for the operations.  Numeric tokens are their value,
+ * which is never negative.
+ */
+#define TOK_P (-1)
+#define TOK_T (-2)
+
+/*
+ * Type declarations
+ * -----------------
+ */
+
+/*
+ * Structure for a chunk of the mesh body that is tokenized by a single
+ * thread.
+ */
+typedef struct {
+  
+  /*
+   * The text of the chunk, from pStart up to but excluding pEnd.
+   */
+  const unsigned char *pStart;
+  const unsigned char *pEnd;
+  
+  /*
+   * The tokens of the chunk, with tok_count tokens in use.  The array
+   * is allocated large enough for the most tokens the chunk could hold.
+   */
+  int32_t *pTok;
+  size_t tok_count;
+  
+  /*
+   * Non-zero if the chunk holds anything outside of the fast path, in
+   * which case the tokens are incomplete.
+   */
+  int fail;
+  
+  /*
+   * Non-zero if the chunk holds the |; marker, which ends the tokens.
+   */
+  int end;
+  
+  /*
+   * The index of the chunk, and the thread handle if the chunk is
+   * tokenized on its own thread.
+   */
+  int index;
+  pthread_t thread;
+  
+} CHUNK;
+
+/*
+ * Structure for reading text in memory as a Shastina source.
+ */
+typedef struct {
+  const unsigned char *pData;
+  size_t len;
+  size_t pos;
+} MEMSRC;
+
+/*
+ * Local functions
+ * ---------------
+ */
+
+/* Prototypes */
+static int memsrc_read(void *pCustom);
+static int memsrc_close(void *pCustom);
+static int memsrc_rewind(void *pCustom);
+
+static int isSpace(int c);
+static const unsigned char *skipSpace(
+    const unsigned char * pc,
+    const unsigned char * pEnd);
+static const unsigned char *readCount(
+    const unsigned char * pc,
+    const unsigned char * pEnd,
+    int32_t             * pv);
+static const unsigned char *readHeader(
+    const unsigned char * pc,
+    const unsigned char * pEnd,
+    int32_t             * pPoints,
+    int32_t             * pTris);
+
+static void chunk_run(CHUNK *pk);
+static void *chunk_thread(void *pArg);
+
+static LILAC_MESH *merge(
+    CHUNK   * pChunks,
+    int       count,
+    int32_t   point_count,
+    int32_t   tri_count);
+
+static LILAC_MESH *parseSerial(
+    const unsigned char * pData,
+          size_t          len,
+          int           * pErrCode,
+          long          * pLine);
+
+/*
+ * Shastina read function for text in memory.
+ * 
+ * Parameters:
+ * 
+ *   pCustom - the MEMSRC structure
+ * 
+ * Return:
+ * 
+ *   the next byte, or SNERR_EOF
+ */
+static int memsrc_read(void *pCustom) {
+  
+  MEMSRC *pm = NULL;
+  
+  pm = (MEMSRC *) pCustom;
+  if (pm->pos >= pm->len) {
+    return SNERR_EOF;
+  }
+  return (int) (pm->pData[(pm->pos)++]);
+}
+
+/*
+ * Shastina close function for text in memory.
+ * 
+ * The MEMSRC structure is owned by the caller, so there is nothing to
+ * release.
+ * 
+ * Parameters:
+ * 
+ *   pCustom - the MEMSRC structure
+ * 
+ * Return:
+ * 
+ *   non-zero
+ */
+static int memsrc_close(void *pCustom) {
+  (void) pCustom;
+  return 1;
+}
+
+/*
+ * Shastina rewind function for text in memory.
+ * 
+ * Parameters:
+ * 
+ *   pCustom - the MEMSRC structure
+ * 
+ * Return:
+ * 
+ *   non-zero
+ */
+static int memsrc_rewind(void *pCustom) {
+  
+  MEMSRC *pm = NULL;
+  
+  pm = (MEMSRC *) pCustom;
+  pm->pos = 0;
+  return 1;
+}
+
+/*
+ * Check whether a byte is whitespace in the fast path.
+ * 
+ * Parameters:
+ * 
+ *   c - the byte
+ * 
+ * Return:
+ * 
+ *   non-zero if space, tab, carriage return, or line feed
+ */
+static int isSpace(int c) {
+  return ((c == ' ') || (c == '\t') || (c == '\r') || (c == '\n'));
+}
+
+/*
+ * Skip whitespace.
+ * 
+ * Parameters:
+ * 
+ *   pc - the current position
+ * 
+ *   pEnd - the end of the text
+ * 
+ * Return:
+ * 
+ *   the position of the first byte that is not whitespace, or pEnd
+ */
+static const unsigned char *skipSpace(
+    const unsigned char * pc,
+    const unsigned char * pEnd) {
+  
+  while ((pc < pEnd) && isSpace(*pc)) {
+    pc++;
+  }
+  return pc;
+}
+
+/*
+ * Read a count in the dimension metacommand of the header.
+ * 
+ * Parameters:
+ * 
+ *   pc - the current position, which must be the first digit
+ * 
+ *   pEnd - the end of the text
+ * 
+ *   pv - receives the count
+ * 
+ * Return:
+ * 
+ *   the position after the count, or NULL if there is no count of at
+ *   most TOKEN_MAX digits here
+ */
+static const unsigned char *readCount(
+    const unsigned char * pc,
+    const unsigned char * pEnd,
+    int32_t             * pv) {
+  
+  int32_t v = 0;
+  int n = 0;
+  
+  for(n = 0; (pc < pEnd) && (*pc >= '0') && (*pc <= '9'); n++) {
+    if (n >= TOKEN_MAX) {
+      return NULL;
+    }
+    v = (v * 10) + (*pc - '0');
+    pc++;
+  }
+  if (n < 1) {
+    return NULL;
+  }
+  
+  *pv = v;
+  return pc;
+}
+
+/*
+ * Read the header in the exact form that the Lilac tools write it.
+ * 
+ * The header must be "%lilac-mesh;" at the very start of the text,
+ * followed by whitespace and then "%dim" with both counts separated by
+ * whitespace and the semicolon right after the second count.  The
+ * counts must be within the mesh limits.
+ * 
+ * Parameters:
+ * 
+ *   pc - the start of the text
+ * 
+ *   pEnd - the end of the text
+ * 
+ *   pPoints - receives the point count
+ * 
+ *   pTris - receives the triangle count
+ * 
+ * Return:
+ * 
+ *   the position after the header, or NULL if the header is not in the
+ *   expected form, which includes every header with an error
+ */
+static const unsigned char *readHeader(
+    const unsigned char * pc,
+    const unsigned char * pEnd,
+    int32_t             * pPoints,
+    int32_t             * pTris) {
+  
+  const unsigned char *pq = NULL;
+  
+  /* Signature */
+  if (((size_t) (pEnd - pc) < 12) || (memcmp(pc, "%lilac-mesh;", 12) != 0)) {
+    return NULL;
+  }
+  pc += 12;
+  
+  /* Dimensions */
+  pq = skipSpace(pc, pEnd);
+  if ((pq == pc) || ((size_t) (pEnd - pq) < 4) ||
+      (memcmp(pq, "%dim", 4) != 0)) {
+    return NULL;
+  }
+  pc = pq + 4;
+  
+  pq = skipSpace(pc, pEnd);
+  if (pq == pc) {
+    return NULL;
+  }
+  pc = readCount(pq, pEnd, pPoints);
+  if (pc == NULL) {
+    return NULL;
+  }
+  
+  pq = skipSpace(pc, pEnd);
+  if (pq == pc) {
+    return NULL;
+  }
+  pc = readCount(pq, pEnd, pTris);
+  if ((pc == NULL) || (pc >= pEnd) || (*pc != ';')) {
+    return NULL;
+  }
+  pc++;
+  
+  if ((*pPoints > LILAC_MESH_MAX_POINTS) || (*pTris > LILAC_MESH_MAX_TRIS)) {
+    return NULL;
+  }
+  
+  return pc;
+}
+
+/*
+ * Tokenize a chunk of the mesh body.
+ * 
+ * Tokens are separated by whitespace.  A token starting with # is a
+ * comment up to the end of the line.  Tokens of decimal digits are
+ * numbers, "p" and "t" are operations, and "|;" ends the mesh.
+ * Anything else sets the fail flag.
+ * 
+ * Parameters:
+ * 
+ *   pk - the chunk
+ */
+static void chunk_run(CHUNK *pk) {
+  
+  const unsigned char *pc = NULL;
+  const unsigned char *pEnd = NULL;
+  const unsigned char *pq = NULL;
+  int32_t v = 0;
+  size_t n = 0;
+  int32_t *pTok = NULL;
+  double start = 0.0;
+  
+  start = lilac_trace_now();
+  
+  pc = pk->pStart;
+  pEnd = pk->pEnd;
+  pTok = pk->pTok;
+  
+  while (pc < pEnd) {
+    /* Skip whitespace */
+    if (isSpace(*pc)) {
+      pc++;
+      continue;
+    }
+  
+    /* Skip comments, which always end within the chunk, because chunks
+     * only begin after a line feed */
+    if (*pc == '#') {
+      while ((pc < pEnd) && (*pc != '\n')) {
+        pc++;
+      }
+      continue;
+    }
+  
+    /* Find the end of the token */
+    for(pq = pc; (pq < pEnd) && (!isSpace(*pq)); pq++);
+  
+    /* Numbers */
+    if ((*pc >= '0') && (*pc <= '9')) {
+      if (pq - pc > TOKEN_MAX) {
+        pk->fail = 1;
+        break;
+      }
+      v = 0;
+      for( ; pc < pq; pc++) {
+        if ((*pc < '0') || (*pc > '9')) {
+          break;
+        }
+        v = (v * 10) + (*pc - '0');
+      }
+      if ((pc < pq) || (v > LILAC_MESH_MAX_C)) {
+        pk->fail = 1;
+        break;
+      }
+      pTok[n++] = v;
+  
+    /* Operations */
+    } else if ((pq - pc == 1) && (*pc == 'p')) {
+      pTok[n++] = TOK_P;
+      pc = pq;
+  
+    } else if ((pq - pc == 1) && (*pc == 't')) {
+      pTok[n++] = TOK_T;
+      pc = pq;
+  
+    /* End of the mesh */
+    } else if ((pq - pc == 2) && (pc[0] == '|') && (pc[1] == ';')) {
+      pk->end = 1;
+      break;
+  
+    } else {
+      pk->fail = 1;
+      break;
+    }
+  }
+  
+  pk->tok_count = n;
+  
+  lilac_trace_span("tokenize", start, "bytes", (long) (pEnd - pk->pStart));
+}
+
+/*
+ * Thread function for tokenizing a chunk.
+ * 
+ * Parameters:
+ * 
+ *   pArg - the chunk
+ * 
+ * Return:
+ * 
+ *   NULL
+ */
+static void *chunk_thread(void *pArg) {
+  lilac_trace_thread("tokenize", (long) ((CHUNK *) pArg)->index);
+  chunk_run((CHUNK *) pArg);
+  return NULL;
+}
+
+/*
+ * Run the tokens of all chunks through the interpreter stack in file
+ * order, building and validating the mesh.
+ * 
+ * Tokens after the chunk holding the |; marker are ignored.  This does
+ * not report errors, because any error is reported by the Shastina
+ * parser instead.
+ * 
+ * Parameters:
+ * 
+ *   pChunks - the tokenized chunks
+ * 
+ *   count - the number of chunks
+ * 
+ *   point_count - the point count from the header
+ * 
+ *   tri_count - the triangle count from the header
+ * 
+ * Return:
+ * 
+ *   the mesh, or NULL if the tokens are incomplete or the mesh has any
+ *   error
+ */
+static LILAC_MESH *merge(
+    CHUNK   * pChunks,
+    int       count,
+    int32_t   point_count,
+    int32_t   tri_count) {
+  
+  int status = 1;
+  int ended = 0;
+  int k = 0;
+  int st_count = 0;
+  size_t j = 0;
+  int32_t tok = 0;
+  int32_t pts = 0;
+  int32_t tris = 0;
+  int32_t st[MAX_SN_STACK];
+  double start = 0.0;
+  
+  const CHUNK *pk = NULL;
+  LILAC_MESH_POINT *pp = NULL;
+  uint16_t *pt = NULL;
+  LILAC_MESH *pM = NULL;
+  
+  memset(st, 0, sizeof(st));
+  start = lilac_trace_now();
+  
+  /* Allocate the mesh */
+  pM = (LILAC_MESH *) lilac_mesh_mem_alloc(
+                        LILAC_MESH_MEM_MESH, 1, sizeof(LILAC_MESH));
+  if (pM == NULL) {
+    abort();
+  }
+  pM->point_count = point_count;
+  pM->tri_count = tri_count;
+  
+  if (point_count > 0) {
+    pM->pPoints = (LILAC_MESH_POINT *) lilac_mesh_mem_alloc(
+                    LILAC_MESH_MEM_MESH,
+                    (size_t) point_count, sizeof(LILAC_MESH_POINT));
+    if (pM->pPoints == NULL) {
+      abort();
+    }
+  }
+  if (tri_count > 0) {
+    pM->pTris = (uint16_t *) lilac_mesh_mem_alloc(
+                    LILAC_MESH_MEM_MESH,
+                    ((size_t) tri_count) * 3, sizeof(uint16_t));
+    if (pM->pTris == NULL) {
+      abort();
+    }
+  }
+  
+  /* Interpret the tokens */
+  for(k = 0; status && (!ended) && (k < count); k++) {
+    pk = &(pChunks[k]);
+    if (pk->fail) {
+      status = 0;
+      break;
+    }
+  
+    for(j = 0; j < pk->tok_count; j++) {
+      tok = (pk->pTok)[j];
+  
+      if (tok >= 0) {
+        if (st_count >= MAX_SN_STACK) {
+          status = 0;
+          break;
+        }
+        st[st_count++] = tok;
+  
+      } else if (tok == TOK_P) {
+        if ((st_count < 4) || (pts >= point_count)) {
+          status = 0;
+          break;
+        }
+        st_count -= 4;
+        pp = &((pM->pPoints)[pts++]);
+        pp->normd = (uint16_t) st[st_count];
+        pp->norma = (uint16_t) st[st_count + 1];
+        pp->x = (uint16_t) st[st_count + 2];
+        pp->y = (uint16_t) st[st_count + 3];
+  
+      } else {
+        if ((st_count < 3) || (tris >= tri_count)) {
+          status = 0;
+          break;
+        }
+        st_count -= 3;
+  
+        /* Triangles may only use points that are already defined */
+        if ((st[st_count] >= pts) || (st[st_count + 1] >= pts) ||
+            (st[st_count + 2] >= pts)) {
+          status = 0;
+          break;
+        }
+  
+        pt = &((pM->pTris)[(tris++) * 3]);
+        pt[0] = (uint16_t) st[st_count];
+        pt[1] = (uint16_t) st[st_count + 1];
+        pt[2] = (uint16_t) st[st_count + 2];
+      }
+    }
+  
+    if (pk->end) {
+      ended = 1;
+    }
+  }
+  
+  /* The marker must have been found with everything defined and the
+   * stack empty, and the mesh must be valid */
+  if (status) {
+    if ((!ended) || (st_count > 0) ||
+        (pts != point_count) || (tris != tri_count)) {
+      status = 0;
+    }
+  }
+  
+  lilac_trace_span("interpret", start, "tris", (long) tris);
+  
+  if (status) {
+    start = lilac_trace_now();
+    if (lilac_mesh_check(pM, NULL) != LILAC_MESH_ERR_OK) {
+      status = 0;
+    }
+    lilac_trace_span("validate", start, NULL, 0);
+  }
+  
+  if (!status) {
+    lilac_mesh_free(pM);
+    pM = NULL;
+  }
+  
+  return pM;
+}
+
+/*
+ * Parse text in memory with the Shastina parser.
+ * 
+ * Parameters:
+ * 
+ *   pData - the mesh file text
+ * 
+ *   len - the length of the text in bytes
+ * 
+ *   pErrCode - receives the error code
+ * 
+ *   pLine - receives the line number
+ * 
+ * Return:
+ * 
+ *   a new Lilac mesh object or NULL if failure
+ */
+static LILAC_MESH *parseSerial(
+    const unsigned char * pData,
+          size_t          len,
+          int           * pErrCode,
+          long          * pLine) {
+  
+  MEMSRC ms;
+  SNSOURCE *pSrc = NULL;
+  LILAC_MESH *pM = NULL;
+  double start = 0.0;
+  
+  memset(&ms, 0, sizeof(MEMSRC));
+  start = lilac_trace_now();
+  ms.pData = pData;
+  ms.len = len;
+  ms.pos = 0;
+  
+  pSrc = snsource_custom(
+            &memsrc_read, &memsrc_close, &memsrc_rewind, &ms);
+  pM = lilac_mesh_new(pSrc, pErrCode, pLine);
+  snsource_free(pSrc);
+  pSrc = NULL;
+  
+  lilac_trace_span("shastina parse", start, NULL, 0);
+  
+  return pM;
+}
+
+/*
+ * Public function implementations
+ * -------------------------------
+ * 
+ * See the header for specifications
+ */
+
+/*
+ * lilac_parse_text function.
+ */
+LILAC_MESH *lilac_parse_text(
+    const unsigned char * pData,
+          size_t          len,
+          int             threads,
+          int           * pErrCode,
+          long          * pLine) {
+  
+  int k = 0;
+  int count = 0;
+  int i_dummy = 0;
+  long l_dummy = 0;
+  int32_t point_count = 0;
+  int32_t tri_count = 0;
+  size_t body_len = 0;
+  size_t share = 0;
+  double start = 0.0;
+  
+  const unsigned char *pEnd = NULL;
+  const unsigned char *pBody = NULL;
+  const unsigned char *pc = NULL;
+  CHUNK *pChunks = NULL;
+  LILAC_MESH *pM = NULL;
+  
+  /* Check parameters */
+  if (((pData == NULL) && (len > 0)) ||
+      (threads < 1) || (threads > LILAC_PARSE_MAX_THREADS)) {
+    abort();
+  }
+  
+  if (pErrCode == NULL) {
+    pErrCode = &i_dummy;
+  }
+  if (pLine == NULL) {
+    pLine = &l_dummy;
+  }
+  
+  *pErrCode = LILAC_MESH_ERR_OK;
+  *pLine = 0;
+  
+  /* Read the header in the fast path */
+  start = lilac_trace_now();
+  pEnd = pData + len;
+  if (len > 0) {
+    pBody = readHeader(pData, pEnd, &point_count, &tri_count);
+  }
+  lilac_trace_span("header", start, NULL, 0);
+  
+  /* Split the body into chunks of at least the minimum size, each
+   * beginning just after a line feed */
+  if (pBody != NULL) {
+    body_len = (size_t) (pEnd - pBody);
+    count = (int) (body_len / LILAC_PARSE_CHUNK_MIN);
+    if (count > threads) {
+      count = threads;
+    }
+    if (count < 1) {
+      count = 1;
+    }
+    share = body_len / ((size_t) count);
+  
+    pChunks = (CHUNK *) lilac_mesh_mem_alloc(
+                          LILAC_MESH_MEM_WORK, (size_t) count, sizeof(CHUNK));
+    if (pChunks == NULL) {
+      abort();
+    }
+  
+    pc = pBody;
+    for(k = 0; k < count; k++) {
+      pChunks[k].index = k;
+      pChunks[k].pStart = pc;
+      if (k < count - 1) {
+        pc = pBody + (share * ((size_t) (k + 1)));
+        if (pc < pChunks[k].pStart) {
+          pc = pChunks[k].pStart;
+        }
+        while ((pc < pEnd) && (*pc != '\n')) {
+          pc++;
+        }
+        if (pc < pEnd) {
+          pc++;
+        }
+      } else {
+        pc = pEnd;
+      }
+      pChunks[k].pEnd = pc;
+  
+      /* Every token takes at least two bytes with its separator */
+      pChunks[k].pTok = (int32_t *) lilac_mesh_mem_alloc(
+            LILAC_MESH_MEM_WORK,
+            (((size_t) (pChunks[k].pEnd - pChunks[k].pStart)) / 2) + 1,
+            sizeof(int32_t));
+      if (pChunks[k].pTok == NULL) {
+        abort();
+      }
+    }
+  
+    /* Tokenize the first chunk on this thread and the rest on their
+     * own threads */
+    for(k = 1; k < count; k++) {
+      if (pthread_create(&(pChunks[k].thread), NULL,
+                          &chunk_thread, &(pChunks[k]))) {
+        abort();
+      }
+    }
+    chunk_run(&(pChunks[0]));
+    for(k = 1; k < count; k++) {
+      if (pthread_join(pChunks[k].thread, NULL)) {
+        abort();
+      }
+    }
+  
+    /* Interpret and validate */
+    pM = merge(pChunks, count, point_count, tri_count);
+  
+    for(k = 0; k < count; k++) {
+      lilac_mesh_mem_free(pChunks[k].pTok);
+      pChunks[k].pTok = NULL;
+    }
+    lilac_mesh_mem_free(pChunks);
+    pChunks = NULL;
+  }
+  
+  /* Anything the fast path could not handle, including every error, is
+   * parsed again by the Shastina parser */
+  if (pM == NULL) {
+    pM = parseSerial(pData, len, pErrCode, pLine);
+  }
+  
+  return pM;
+}
+
+/*
+ * lilac_parse_load function.
+ */
+LILAC_MESH *lilac_parse_load(
+    const char * pPath,
+          int    threads,
+          int  * pSrcErr,
+          int  * pErrCode,
+          long * pLine) {
+  
+  int i_dummy = 0;
+  int j_dummy = 0;
+  long l_dummy = 0;
+  size_t len = 0;
+  double start = 0.0;
+  unsigned char *pData = NULL;
+  LILAC_MESH *pM = NULL;
+  
+  /* Check parameters */
+  if ((pPath == NULL) ||
+      (threads < 1) || (threads > LILAC_PARSE_MAX_THREADS)) {
+    abort();
+  }
+  
+  if (pSrcErr == NULL) {
+    pSrcErr = &i_dummy;
+  }
+  if (pErrCode == NULL) {
+    pErrCode = &j_dummy;
+  }
+  if (pLine == NULL) {
+    pLine = &l_dummy;
+  }
+  
+  *pSrcErr = LILAC_SOURCE_ERR_OK;
+  *pErrCode = LILAC_MESH_ERR_OK;
+  *pLine = 0;
+  
+  /* Read the whole mesh into memory, decompressing it if it is
+   * compressed */
+  start = lilac_trace_now();
+  pData = lilac_source_read(pPath, &len, pSrcErr);
+  if (pData == NULL) {
+    return NULL;
+  }
+  lilac_trace_span("read mesh", start, "bytes", (long) len);
+  
+  /* Decode compact binary meshes directly, and parse everything else as
+   * Shastina text */
+  if (lilac_pack_detect(pData, len)) {
+    start = lilac_trace_now();
+    pM = lilac_pack_decode(pData, len, pErrCode);
+    lilac_trace_span("decode compact", start, NULL, 0);
+  
+  } else {
+    pM = lilac_parse_text(pData, len, threads, pErrCode, pLine);
+  }
+  
+  free(pData);
+  pData = NULL;
+  
+  return pM;
+}
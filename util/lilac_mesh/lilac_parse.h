@@ -0,0 +1,144 @@
+#ifndef LILAC_PARSE_H_INCLUDED
+#define LILAC_PARSE_H_INCLUDED
+
+/*
+ * lilac_parse.h
+ * =============
+ * 
+ * Lilac module for parsing Shastina mesh files in memory, with the body
+ * of the mesh tokenized in parallel.
+ * 
+ * The text after the header is split into chunks at line breaks, and
+ * the chunks are tokenized on separate threads into numbers and
+ * operations.  The tokens are then run through the interpreter stack in
+ * file order on one thread, and the complete mesh is validated with
+ * lilac_mesh_check().
+ * 
+ * The parallel tokenizer only understands the plain form of mesh files
+ * that the Lilac tools write:  a header of exactly "%lilac-mesh;" and
+ * "%dim" metacommands, unsigned decimal numbers, the "p" and "t"
+ * operations, comment lines, and the "|;" marker.  Whenever it meets
+ * anything else, or whenever the mesh has any error at all, the whole
+ * file is parsed again with lilac_mesh_new() and its result is
+ * returned.  Parsing therefore always gives exactly the same mesh,
+ * error code, and line number as the Shastina parser.
+ * 
+ * When tracing is on, the header, the tokenizing of each chunk, the
+ * interpreting, the validation, and any fallback to the Shastina parser
+ * are recorded as spans with the lilac_trace module.
+ * 
+ * lilac_parse_load() is the common way for programs to load a mesh.  It
+ * reads a mesh file or archive reference with lilac_source_read(), and
+ * then decodes it with lilac_pack_decode() if it is a compact binary
+ * mesh, or parses it with lilac_parse_text() otherwise.
+ * 
+ * This module must be compiled together with lilac_mesh.c,
+ * lilac_pack.c, lilac_source.c and its dependencies, lilac_trace.c, and
+ * the Shastina library, and it requires pthreads.
+ */
+
+/*
+ * Imports
+ * -------
+ */
+
+#include <stddef.h>
+#include "lilac_mesh.h"
+
+/*
+ * Constants
+ * ---------
+ */
+
+/*
+ * The maximum number of threads that may be used for tokenizing.
+ */
+#define LILAC_PARSE_MAX_THREADS (64)
+
+/*
+ * Public functions
+ * ----------------
+ */
+
+/*
+ * Parse a Shastina mesh file in memory.
+ * 
+ * threads is the maximum number of threads to tokenize with, including
+ * the calling thread.  Each thread gets at least a minimum amount of
+ * text, so small meshes are always tokenized on the calling thread
+ * alone.  Pass one to never start any threads.
+ * 
+ * pErrCode and pLine have the same meaning as for lilac_mesh_new(), and
+ * the return value is also the same.  Nothing after the |; marker is
+ * examined.
+ * 
+ * Parameters:
+ * 
+ *   pData - the mesh file text, which may be NULL only if len is zero
+ * 
+ *   len - the length of the text in bytes
+ * 
+ *   threads - the maximum number of threads, in range 1 to
+ *   LILAC_PARSE_MAX_THREADS
+ * 
+ *   pErrCode - pointer to variable to receive the error code status of
+ *   the operation, or NULL
+ * 
+ *   pLine - pointer to variable to receive a line number, or NULL
+ * 
+ * Return:
+ * 
+ *   a new Lilac mesh object or NULL if failure
+ */
+LILAC_MESH *lilac_parse_text(
+    const unsigned char * pData,
+          size_t          len,
+          int             threads,
+          int           * pErrCode,
+          long          * pLine);
+
+/*
+ * Load a mesh in either the Shastina text format or the compact binary
+ * format.
+ * 
+ * The path is interpreted just as for lilac_source_read(), so it may be
+ * a compressed file or an archive reference.  Text meshes are parsed
+ * with lilac_parse_text() using up to the given number of threads.
+ * 
+ * There are two kinds of failure.  If the mesh data can't be read,
+ * pSrcErr receives a lilac_source error code, and pErrCode receives
+ * LILAC_MESH_ERR_OK.  If the data was read but is not a valid mesh,
+ * pSrcErr receives LILAC_SOURCE_ERR_OK, and pErrCode and pLine receive
+ * the error code and line number just as for lilac_parse_text().  The
+ * line number is only set for text meshes, and is zero otherwise.
+ * 
+ * When tracing is on, reading the data and decoding a compact mesh are
+ * recorded as spans.
+ * 
+ * Parameters:
+ * 
+ *   pPath - the path to the mesh
+ * 
+ *   threads - the maximum number of threads, in range 1 to
+ *   LILAC_PARSE_MAX_THREADS
+ * 
+ *   pSrcErr - pointer to variable to receive the lilac_source error
+ *   code, or NULL
+ * 
+ *   pErrCode - pointer to variable to receive the mesh error code, or
+ *   NULL
+ * 
+ *   pLine - pointer to variable to receive a line number, or NULL
+ * 
+ * Return:
+ * 
+ *   a new Lilac mesh object or NULL if failure
+ */
+LILAC_MESH *lilac_parse_load(
+    const char * pPath,
+          int    threads,
+          int  * pSrcErr,
+          int  * pErrCode,
+          long * pLine);
+
+#endif
@@ -0,0 +1,953 @@
+/*
+ * lilac_source.c
+ * ==============
+ * 
+ * Implementation of lilac_source.h
+ * 
+ * See the header for further information.
+ */
+
+#include "lilac_source.h"
+#include "lilac_archive.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#ifdef LILAC_SOURCE_ZSTD
+#include <zstd.h>
+#endif
+
+/*
+ * Constants
+ * ---------
+ */
+
+/*
+ * The size in bytes of the compressed and decompressed data buffers.
+ */
+#define BUF_SIZE (16384)
+
+/*
+ * Data formats.
+ * 
+ * FORMAT_PLAIN is uncompressed data.  Shastina sources for uncompressed
+ * files use the standard Shastina file source instead of this module.
+ */
+#define FORMAT_PLAIN (0)
+#define FORMAT_GZIP  (1)
+#define FORMAT_ZSTD  (2)
+
+/*
+ * Type declarations
+ * -----------------
+ */
+
+/*
+ * Structure storing the state of a decompressing source.
+ * 
+ * This is the custom data pointer of the Shastina source, and it is
+ * also used directly when reading a whole mesh into memory.
+ */
+typedef struct {
+  
+  /*
+   * The input file, which is owned by this structure, or NULL if the
+   * input is in memory.
+   */
+  FILE *pIn;
+  
+  /*
+   * The input data in memory, used if pIn is NULL.  mem_pos is the
+   * position of the next byte to read.
+   */
+  const unsigned char *pMem;
+  size_t mem_len;
+  size_t mem_pos;
+  
+  /*
+   * The archive that holds the input data in memory, which is owned by
+   * this structure, or NULL.
+   */
+  LILAC_ARCHIVE *pArc;
+  
+  /*
+   * The data format, one of the FORMAT_ constants.
+   */
+  int format;
+  
+  /*
+   * Non-zero once the end of the decompressed data has been reached,
+   * or an error occurred.  In either case, err holds the value that
+   * all further reads return.
+   */
+  int done;
+  int err;
+  
+  /*
+   * Non-zero once the compressed file has been read to the end.
+   */
+  int in_eof;
+  
+  /*
+   * Non-zero if the decompressor is at the end of a gzip member or a
+   * Zstandard frame, where the compressed file may validly end.
+   */
+  int member_end;
+  
+  /*
+   * The decompressor state for the format.
+   */
+  z_stream zs;
+#ifdef LILAC_SOURCE_ZSTD
+  ZSTD_DStream *pZstd;
+  ZSTD_inBuffer zin;
+#endif
+  
+  /*
+   * The decompressed data that has not been read yet is the range of
+   * the output buffer from out_pos up to but excluding out_len.
+   */
+  size_t out_pos;
+  size_t out_len;
+  
+  /*
+   * The compressed and decompressed data buffers.
+   */
+  unsigned char in_buf[BUF_SIZE];
+  unsigned char out_buf[BUF_SIZE];
+  
+} LILAC_SOURCE;
+
+/*
+ * Local functions
+ * ---------------
+ */
+
+/* Prototypes */
+static int zsrc_detect(const unsigned char *pMagic, size_t len);
+static LILAC_SOURCE *zsrc_new(
+    FILE                * pIn,
+    const unsigned char * pMem,
+    size_t                mem_len,
+    LILAC_ARCHIVE       * pArc,
+    int                 * pErr);
+static LILAC_SOURCE *zsrc_open(const char *pPath, int *pErr);
+static SNSOURCE *zsrc_source(LILAC_SOURCE *pS);
+
+static int zsrc_start(LILAC_SOURCE *pS);
+static void zsrc_stop(LILAC_SOURCE *pS);
+static size_t zsrc_input(LILAC_SOURCE *pS);
+static int zsrc_fill(LILAC_SOURCE *pS);
+
+static int zsrc_read(void *pCustom);
+static int zsrc_close(void *pCustom);
+static int zsrc_rewind(void *pCustom);
+
+/*
+ * Detect the data format from the magic bytes at the start of the data.
+ * 
+ * Parameters:
+ * 
+ *   pMagic - the first bytes of the data
+ * 
+ *   len - the number of bytes available, which may be fewer than four
+ *   for short data
+ * 
+ * Return:
+ * 
+ *   one of the FORMAT_ constants
+ */
+static int zsrc_detect(const unsigned char *pMagic, size_t len) {
+  
+  if ((len >= 2) && (pMagic[0] == 0x1f) && (pMagic[1] == 0x8b)) {
+    return FORMAT_GZIP;
+  
+  } else if ((len >= 4) && (pMagic[0] == 0x28) &&
+              (pMagic[1] == 0xb5) && (pMagic[2] == 0x2f) &&
+              (pMagic[3] == 0xfd)) {
+    return FORMAT_ZSTD;
+  }
+  
+  return FORMAT_PLAIN;
+}
+
+/*
+ * Create the source state for a file or for data in memory.
+ * 
+ * Exactly one of pIn and pMem must be non-NULL, except that pMem may
+ * also be NULL if mem_len is zero.  The file must be positioned at the
+ * start.  The new state takes ownership of the file and of the archive
+ * if not NULL; upon failure, they are released here.  Release the state
+ * with zsrc_close().
+ * 
+ * Parameters:
+ * 
+ *   pIn - the input file, or NULL
+ * 
+ *   pMem - the input data in memory, or NULL
+ * 
+ *   mem_len - the length of the input data in memory
+ * 
+ *   pArc - the archive holding the input data in memory, or NULL
+ * 
+ *   pErr - receives a LILAC_SOURCE_ERR_ code
+ * 
+ * Return:
+ * 
+ *   the new source state, or NULL if failure
+ */
+static LILAC_SOURCE *zsrc_new(
+    FILE                * pIn,
+    const unsigned char * pMem,
+    size_t                mem_len,
+    LILAC_ARCHIVE       * pArc,
+    int                 * pErr) {
+  
+  int status = 1;
+  int format = FORMAT_PLAIN;
+  size_t len = 0;
+  unsigned char magic[4];
+  LILAC_SOURCE *pS = NULL;
+  
+  memset(magic, 0, sizeof(magic));
+  *pErr = LILAC_SOURCE_ERR_OK;
+  
+  /* Get the magic bytes, which may be fewer than four in short data;
+   * files are returned to the start afterwards */
+  if (pIn != NULL) {
+    len = fread(magic, 1, sizeof(magic), pIn);
+    if (ferror(pIn) || fseek(pIn, 0, SEEK_SET)) {
+      status = 0;
+      *pErr = LILAC_SOURCE_ERR_READ;
+    }
+  
+  } else {
+    len = mem_len;
+    if (len > sizeof(magic)) {
+      len = sizeof(magic);
+    }
+    if (len > 0) {
+      memcpy(magic, pMem, len);
+    }
+  }
+  
+  /* Detect the format */
+  if (status) {
+    format = zsrc_detect(magic, len);
+#ifndef LILAC_SOURCE_ZSTD
+    if (format == FORMAT_ZSTD) {
+      status = 0;
+      *pErr = LILAC_SOURCE_ERR_NOZSTD;
+    }
+#endif
+  }
+  
+  /* Allocate the state, which takes ownership of the file and the
+   * archive */
+  if (status) {
+    pS = (LILAC_SOURCE *) calloc(1, sizeof(LILAC_SOURCE));
+    if (pS == NULL) {
+      abort();
+    }
+    pS->pIn = pIn;
+    pS->pMem = pMem;
+    pS->mem_len = mem_len;
+    pS->pArc = pArc;
+    pS->format = format;
+    pIn = NULL;
+    pArc = NULL;
+    
+    if (!zsrc_start(pS)) {
+      status = 0;
+      *pErr = LILAC_SOURCE_ERR_INIT;
+      zsrc_close(pS);
+      pS = NULL;
+    }
+  }
+  
+  /* Clean up on failure */
+  if (!status) {
+    if (pIn != NULL) {
+      fclose(pIn);
+      pIn = NULL;
+    }
+    lilac_archive_close(pArc);
+    pArc = NULL;
+  }
+  
+  return pS;
+}
+
+/*
+ * Create the source state for a mesh path.
+ * 
+ * The path is either an archive reference or an ordinary file path.
+ * Release the state with zsrc_close().
+ * 
+ * Parameters:
+ * 
+ *   pPath - the mesh path
+ * 
+ *   pErr - receives a LILAC_SOURCE_ERR_ code
+ * 
+ * Return:
+ * 
+ *   the new source state, or NULL if failure
+ */
+static LILAC_SOURCE *zsrc_open(const char *pPath, int *pErr) {
+  
+  int32_t i = 0;
+  size_t len = 0;
+  char *pArcPath = NULL;
+  const char *pName = NULL;
+  const unsigned char *pData = NULL;
+  FILE *pIn = NULL;
+  LILAC_ARCHIVE *pArc = NULL;
+  LILAC_SOURCE *pS = NULL;
+  
+  *pErr = LILAC_SOURCE_ERR_OK;
+  
+  /* Archive references read the mesh data in place from the memory
+   * mapping of the archive, which the state takes ownership of */
+  if (lilac_archive_ref(pPath, &pArcPath, &pName)) {
+    pArc = lilac_archive_open(pArcPath, NULL);
+    free(pArcPath);
+    pArcPath = NULL;
+    
+    if (pArc == NULL) {
+      *pErr = LILAC_SOURCE_ERR_ARCHIVE;
+    } else {
+      i = lilac_archive_find(pArc, pName);
+      if (i < 0) {
+        *pErr = LILAC_SOURCE_ERR_NOENT;
+        lilac_archive_close(pArc);
+        pArc = NULL;
+      }
+    }
+    
+    if (pArc != NULL) {
+      pData = lilac_archive_data(pArc, i, &len);
+      pS = zsrc_new(NULL, pData, len, pArc, pErr);
+      pArc = NULL;
+    }
+  
+  /* Everything else is an ordinary file */
+  } else {
+    pIn = fopen(pPath, "rb");
+    if (pIn == NULL) {
+      *pErr = LILAC_SOURCE_ERR_OPEN;
+    } else {
+      pS = zsrc_new(pIn, NULL, 0, NULL, pErr);
+      pIn = NULL;
+    }
+  }
+  
+  return pS;
+}
+
+/*
+ * Wrap source state in a Shastina source.
+ * 
+ * Uncompressed files are handed over to the standard Shastina file
+ * source and the state is released.  Everything else uses a custom
+ * source that takes ownership of the state.
+ * 
+ * Parameters:
+ * 
+ *   pS - the source state
+ * 
+ * Return:
+ * 
+ *   the new Shastina source
+ */
+static SNSOURCE *zsrc_source(LILAC_SOURCE *pS) {
+  
+  SNSOURCE *pSrc = NULL;
+  
+  if ((pS->format == FORMAT_PLAIN) && (pS->pIn != NULL)) {
+    pSrc = snsource_file(pS->pIn, 1);
+    pS->pIn = NULL;
+    zsrc_close(pS);
+    pS = NULL;
+  
+  } else {
+    pSrc = snsource_custom(&zsrc_read, &zsrc_close, &zsrc_rewind, pS);
+    pS = NULL;
+  }
+  
+  return pSrc;
+}
+
+/*
+ * Start the decompressor of a source at the beginning of the input.
+ * 
+ * If the input is a file, it must be positioned at the start.
+ * 
+ * Parameters:
+ * 
+ *   pS - the source state
+ * 
+ * Return:
+ * 
+ *   non-zero if successful, zero if the decompressor could not be
+ *   initialized
+ */
+static int zsrc_start(LILAC_SOURCE *pS) {
+  
+  pS->done = 0;
+  pS->err = 0;
+  pS->in_eof = 0;
+  pS->member_end = 0;
+  pS->out_pos = 0;
+  pS->out_len = 0;
+  pS->mem_pos = 0;
+  
+  if (pS->format == FORMAT_PLAIN) {
+    return 1;
+    
+  } else if (pS->format == FORMAT_GZIP) {
+    memset(&(pS->zs), 0, sizeof(z_stream));
+    pS->zs.next_in = pS->in_buf;
+    pS->zs.avail_in = 0;
+  
+    /* Window bits of 16 + MAX_WBITS selects the gzip wrapper */
+    if (inflateInit2(&(pS->zs), 16 + MAX_WBITS) != Z_OK) {
+      return 0;
+    }
+    return 1;
+  
+#ifdef LILAC_SOURCE_ZSTD
+  } else if (pS->format == FORMAT_ZSTD) {
+    pS->pZstd = ZSTD_createDStream();
+    if (pS->pZstd == NULL) {
+      return 0;
+    }
+    if (ZSTD_isError(ZSTD_initDStream(pS->pZstd))) {
+      ZSTD_freeDStream(pS->pZstd);
+      pS->pZstd = NULL;
+      return 0;
+    }
+    pS->zin.src = pS->in_buf;
+    pS->zin.size = 0;
+    pS->zin.pos = 0;
+    return 1;
+#endif
+  }
+  
+  return 0;
+}
+
+/*
+ * Release the decompressor of a source.
+ * 
+ * Parameters:
+ * 
+ *   pS - the source state
+ */
+static void zsrc_stop(LILAC_SOURCE *pS) {
+  
+  if (pS->format == FORMAT_GZIP) {
+    inflateEnd(&(pS->zs));
+  
+#ifdef LILAC_SOURCE_ZSTD
+  } else if (pS->format == FORMAT_ZSTD) {
+    if (pS->pZstd != NULL) {
+      ZSTD_freeDStream(pS->pZstd);
+      pS->pZstd = NULL;
+    }
+#endif
+  }
+}
+
+/*
+ * Read the next block of compressed data into the input buffer.
+ * 
+ * Sets in_eof at the end of the input and err on an I/O error.
+ * 
+ * Parameters:
+ * 
+ *   pS - the source state
+ * 
+ * Return:
+ * 
+ *   the number of bytes read, which is zero at the end of the file or
+ *   on error
+ */
+static size_t zsrc_input(LILAC_SOURCE *pS) {
+  
+  size_t len = 0;
+  
+  if (pS->in_eof) {
+    return 0;
+  }
+  
+  /* Input in memory is copied in blocks, so that it is handled just
+   * like input from a file */
+  if (pS->pIn == NULL) {
+    len = pS->mem_len - pS->mem_pos;
+    if (len > BUF_SIZE) {
+      len = BUF_SIZE;
+    }
+    if (len < 1) {
+      pS->in_eof = 1;
+      return 0;
+    }
+    memcpy(pS->in_buf, pS->pMem + pS->mem_pos, len);
+    pS->mem_pos += len;
+    return len;
+  }
+  
+  len = fread(pS->in_buf, 1, BUF_SIZE, pS->pIn);
+  if (len < BUF_SIZE) {
+    if (ferror(pS->pIn)) {
+      pS->err = SNERR_IOERR;
+      return 0;
+    }
+    if (len < 1) {
+      pS->in_eof = 1;
+    }
+  }
+  
+  return len;
+}
+
+/*
+ * Decompress more data into the output buffer.
+ * 
+ * The output buffer must be empty.  Upon return, either the output
+ * buffer has at least one byte, or done is set with err holding
+ * SNERR_EOF or SNERR_IOERR.
+ * 
+ * Parameters:
+ * 
+ *   pS - the source state
+ * 
+ * Return:
+ * 
+ *   non-zero if data is available, zero if done
+ */
+static int zsrc_fill(LILAC_SOURCE *pS) {
+  
+  int retval = 0;
+  size_t len = 0;
+#ifdef LILAC_SOURCE_ZSTD
+  size_t zr = 0;
+  ZSTD_outBuffer zout;
+#endif
+  
+  pS->out_pos = 0;
+  pS->out_len = 0;
+  
+  while ((pS->out_len < 1) && (!(pS->done))) {
+  
+    if (pS->format == FORMAT_GZIP) {
+      /* Refill the input buffer if empty */
+      if (pS->zs.avail_in < 1) {
+        len = zsrc_input(pS);
+        if (pS->err) {
+          break;
+        }
+        if (len < 1) {
+          /* End of file is only valid at the end of a member */
+          if (!(pS->member_end)) {
+            pS->err = SNERR_IOERR;
+          }
+          break;
+        }
+        pS->zs.next_in = pS->in_buf;
+        pS->zs.avail_in = (uInt) len;
+      }
+  
+      /* More input after the end of a member begins another member */
+      if (pS->member_end) {
+        if (inflateReset(&(pS->zs)) != Z_OK) {
+          pS->err = SNERR_IOERR;
+          break;
+        }
+        pS->member_end = 0;
+      }
+  
+      pS->zs.next_out = pS->out_buf;
+      pS->zs.avail_out = BUF_SIZE;
+  
+      retval = inflate(&(pS->zs), Z_NO_FLUSH);
+      if (retval == Z_STREAM_END) {
+        pS->member_end = 1;
+      } else if ((retval != Z_OK) && (retval != Z_BUF_ERROR)) {
+        pS->err = SNERR_IOERR;
+        break;
+      }
+  
+      pS->out_len = BUF_SIZE - pS->zs.avail_out;
+  
+#ifdef LILAC_SOURCE_ZSTD
+    } else if (pS->format == FORMAT_ZSTD) {
+      /* Refill the input buffer if empty */
+      if (pS->zin.pos >= pS->zin.size) {
+        len = zsrc_input(pS);
+        if (pS->err) {
+          break;
+        }
+        if (len < 1) {
+          /* End of file is only valid at the end of a frame */
+          if (!(pS->member_end)) {
+            pS->err = SNERR_IOERR;
+          }
+          break;
+        }
+        pS->zin.src = pS->in_buf;
+        pS->zin.size = len;
+        pS->zin.pos = 0;
+      }
+  
+      zout.dst = pS->out_buf;
+      zout.size = BUF_SIZE;
+      zout.pos = 0;
+  
+      zr = ZSTD_decompressStream(pS->pZstd, &zout, &(pS->zin));
+      if (ZSTD_isError(zr)) {
+        pS->err = SNERR_IOERR;
+        break;
+      }
+  
+      /* A return of zero means a frame was completely decoded, and the
+       * stream continues with the next frame by itself */
+      pS->member_end = (zr == 0);
+  
+      pS->out_len = zout.pos;
+#endif
+  
+    } else {
+      pS->err = SNERR_IOERR;
+      break;
+    }
+  }
+  
+  /* If no data is available, then the source is done */
+  if (pS->out_len < 1) {
+    pS->done = 1;
+    if (!(pS->err)) {
+      pS->err = SNERR_EOF;
+    }
+    return 0;
+  }
+  
+  return 1;
+}
+
+/*
+ * Shastina read function for custom sources.
+ * 
+ * Parameters:
+ * 
+ *   pCustom - the source state
+ * 
+ * Return:
+ * 
+ *   the next decompressed byte, or SNERR_EOF or SNERR_IOERR
+ */
+static int zsrc_read(void *pCustom) {
+  
+  LILAC_SOURCE *pS = NULL;
+  
+  pS = (LILAC_SOURCE *) pCustom;
+  
+  /* Uncompressed data in memory is read directly */
+  if (pS->format == FORMAT_PLAIN) {
+    if (pS->mem_pos >= pS->mem_len) {
+      return SNERR_EOF;
+    }
+    return (int) (pS->pMem[(pS->mem_pos)++]);
+  }
+  
+  if (pS->out_pos >= pS->out_len) {
+    if (pS->done) {
+      return pS->err;
+    }
+    if (!zsrc_fill(pS)) {
+      return pS->err;
+    }
+  }
+  
+  return (int) (pS->out_buf[(pS->out_pos)++]);
+}
+
+/*
+ * Shastina close function for custom sources.
+ * 
+ * Parameters:
+ * 
+ *   pCustom - the source state
+ * 
+ * Return:
+ * 
+ *   non-zero if successful, zero if the file could not be closed
+ */
+static int zsrc_close(void *pCustom) {
+  
+  LILAC_SOURCE *pS = NULL;
+  int result = 1;
+  
+  pS = (LILAC_SOURCE *) pCustom;
+  
+  zsrc_stop(pS);
+  if (pS->pIn != NULL) {
+    if (fclose(pS->pIn)) {
+      result = 0;
+    }
+    pS->pIn = NULL;
+  }
+  
+  lilac_archive_close(pS->pArc);
+  pS->pArc = NULL;
+  
+  free(pS);
+  return result;
+}
+
+/*
+ * Shastina rewind function for custom sources.
+ * 
+ * Parameters:
+ * 
+ *   pCustom - the source state
+ * 
+ * Return:
+ * 
+ *   non-zero if successful, zero if failure
+ */
+static int zsrc_rewind(void *pCustom) {
+  
+  LILAC_SOURCE *pS = NULL;
+  
+  pS = (LILAC_SOURCE *) pCustom;
+  
+  zsrc_stop(pS);
+  if ((pS->pIn != NULL) && fseek(pS->pIn, 0, SEEK_SET)) {
+    pS->done = 1;
+    pS->err = SNERR_IOERR;
+    return 0;
+  }
+  
+  if (!zsrc_start(pS)) {
+    pS->done = 1;
+    pS->err = SNERR_IOERR;
+    return 0;
+  }
+  
+  return 1;
+}
+
+/*
+ * Public function implementations
+ * -------------------------------
+ * 
+ * See the header for specifications
+ */
+
+/*
+ * lilac_source_open function.
+ */
+SNSOURCE *lilac_source_open(const char *pPath, int *pErrCode) {
+  
+  int err = LILAC_SOURCE_ERR_OK;
+  LILAC_SOURCE *pS = NULL;
+  SNSOURCE *pSrc = NULL;
+  
+  /* Check parameters */
+  if (pPath == NULL) {
+    abort();
+  }
+  
+  pS = zsrc_open(pPath, &err);
+  if (pS != NULL) {
+    pSrc = zsrc_source(pS);
+    pS = NULL;
+  }
+  
+  if (pErrCode != NULL) {
+    *pErrCode = err;
+  }
+  return pSrc;
+}
+
+/*
+ * lilac_source_memory function.
+ */
+SNSOURCE *lilac_source_memory(
+    const unsigned char * pData,
+          size_t          len,
+          int           * pErrCode) {
+  
+  int err = LILAC_SOURCE_ERR_OK;
+  LILAC_SOURCE *pS = NULL;
+  SNSOURCE *pSrc = NULL;
+  
+  /* Check parameters */
+  if ((pData == NULL) && (len > 0)) {
+    abort();
+  }
+  
+  pS = zsrc_new(NULL, pData, len, NULL, &err);
+  if (pS != NULL) {
+    pSrc = zsrc_source(pS);
+    pS = NULL;
+  }
+  
+  if (pErrCode != NULL) {
+    *pErrCode = err;
+  }
+  return pSrc;
+}
+
+/*
+ * lilac_source_read function.
+ */
+unsigned char *lilac_source_read(
+    const char   * pPath,
+          size_t * pLen,
+          int    * pErrCode) {
+  
+  int err = LILAC_SOURCE_ERR_OK;
+  size_t len = 0;
+  size_t cap = 0;
+  size_t got = 0;
+  unsigned char *pBuf = NULL;
+  unsigned char *pNew = NULL;
+  LILAC_SOURCE *pS = NULL;
+  
+  /* Check parameters */
+  if ((pPath == NULL) || (pLen == NULL)) {
+    abort();
+  }
+  
+  pS = zsrc_open(pPath, &err);
+  
+  /* Uncompressed data in memory is copied in one go */
+  if ((pS != NULL) && (pS->format == FORMAT_PLAIN) && (pS->pIn == NULL)) {
+    cap = pS->mem_len + 1;
+    pBuf = (unsigned char *) malloc(cap);
+    if (pBuf == NULL) {
+      abort();
+    }
+    if (pS->mem_len > 0) {
+      memcpy(pBuf, pS->pMem, pS->mem_len);
+    }
+    len = pS->mem_len;
+  
+  /* Everything else is read in blocks, doubling the buffer as needed
+   * and always leaving room for the terminating zero */
+  } else if (pS != NULL) {
+    for( ; ; ) {
+      if (len + BUF_SIZE + 1 > cap) {
+        if (cap < 1) {
+          cap = 4 * BUF_SIZE;
+        }
+        while (len + BUF_SIZE + 1 > cap) {
+          cap *= 2;
+        }
+        pNew = (unsigned char *) realloc(pBuf, cap);
+        if (pNew == NULL) {
+          abort();
+        }
+        pBuf = pNew;
+        pNew = NULL;
+      }
+      
+      if (pS->format == FORMAT_PLAIN) {
+        got = fread(pBuf + len, 1, BUF_SIZE, pS->pIn);
+        if (ferror(pS->pIn)) {
+          err = LILAC_SOURCE_ERR_DATA;
+          break;
+        }
+      
+      } else {
+        if (!zsrc_fill(pS)) {
+          if (pS->err != SNERR_EOF) {
+            err = LILAC_SOURCE_ERR_DATA;
+          }
+          break;
+        }
+        got = pS->out_len;
+        memcpy(pBuf + len, pS->out_buf, got);
+      }
+      
+      if (got < 1) {
+        break;
+      }
+      len += got;
+    }
+  }
+  
+  if (pS != NULL) {
+    zsrc_close(pS);
+    pS = NULL;
+  }
+  
+  /* Release the buffer on failure, else terminate it */
+  if (err != LILAC_SOURCE_ERR_OK) {
+    free(pBuf);
+    pBuf = NULL;
+    len = 0;
+  
+  } else {
+    pBuf[len] = 0;
+  }
+  
+  *pLen = len;
+  if (pErrCode != NULL) {
+    *pErrCode = err;
+  }
+  return pBuf;
+}
+
+/*
+ * lilac_source_errstr function.
+ */
+const char *lilac_source_errstr(int code) {
+  
+  const char *pResult = NULL;
+  
+  switch (code) {
+  
+    case LILAC_SOURCE_ERR_OK:
+      pResult = "No error";
+      break;
+  
+    case LILAC_SOURCE_ERR_OPEN:
+      pResult = "Can't open mesh file";
+      break;
+  
+    case LILAC_SOURCE_ERR_READ:
+      pResult = "Can't read mesh file header";
+      break;
+  
+    case LILAC_SOURCE_ERR_NOZSTD:
+      pResult = "Zstandard mesh files are not supported by this build";
+      break;
+  
+    case LILAC_SOURCE_ERR_INIT:
+      pResult = "Failed to initialize decompression";
+      break;
+  
+    case LILAC_SOURCE_ERR_ARCHIVE:
+      pResult = "Can't open mesh archive";
+      break;
+  
+    case LILAC_SOURCE_ERR_NOENT:
+      pResult = "Mesh name not found in archive";
+      break;
+  
+    case LILAC_SOURCE_ERR_DATA:
+      pResult = "Failed to read or decompress mesh data";
+      break;
+  
+    default:
+      pResult = "Unknown error";
+  }
+  
+  return pResult;
+}
@@ -0,0 +1,182 @@
+#ifndef LILAC_SOURCE_H_INCLUDED
+#define LILAC_SOURCE_H_INCLUDED
+
+/*
+ * lilac_source.h
+ * ==============
+ * 
+ * Lilac module for opening mesh files as Shastina sources, with
+ * transparent decompression of compressed mesh files.
+ * 
+ * The compression format is detected from the magic bytes at the start
+ * of the file, so the file name does not matter.  Compressed files are
+ * decompressed while they are read, without any temporary files.
+ * 
+ * The following formats are supported:
+ * 
+ * - Uncompressed files
+ * - gzip files, including files of several concatenated gzip members
+ * - Zstandard files, only if LILAC_SOURCE_ZSTD is defined
+ * 
+ * Paths may also be archive references of the form "meshes.lma:name",
+ * which read the named mesh from a Lilac mesh archive in place through
+ * the memory mapping of the archive.  The stored mesh may be compressed
+ * in any of the formats above.  See lilac_archive.h for details.
+ * 
+ * This module must be compiled together with the Shastina library,
+ * lilac_archive.c, and zlib (-lz).  To support Zstandard files, define
+ * LILAC_SOURCE_ZSTD when compiling (-DLILAC_SOURCE_ZSTD) and also link
+ * with libzstd (-lzstd).
+ */
+
+/*
+ * Imports
+ * -------
+ */
+
+#include <stddef.h>
+
+#include "shastina.h"
+
+/*
+ * Error codes
+ * -----------
+ * 
+ * Zero means no error, and is defined here as LILAC_SOURCE_ERR_OK.
+ * 
+ * Error codes can be converted into error message strings using
+ * lilac_source_errstr().
+ */
+
+#define LILAC_SOURCE_ERR_OK      (0)   /* No error */
+#define LILAC_SOURCE_ERR_OPEN    (1)   /* Can't open file */
+#define LILAC_SOURCE_ERR_READ    (2)   /* Can't read file header */
+#define LILAC_SOURCE_ERR_NOZSTD  (3)   /* Zstandard not supported */
+#define LILAC_SOURCE_ERR_INIT    (4)   /* Decompressor init failed */
+#define LILAC_SOURCE_ERR_ARCHIVE (5)   /* Can't open archive */
+#define LILAC_SOURCE_ERR_NOENT   (6)   /* Mesh not found in archive */
+#define LILAC_SOURCE_ERR_DATA    (7)   /* Read or decompression failed */
+
+/*
+ * Public functions
+ * ----------------
+ */
+
+/*
+ * Open a mesh file as a Shastina source.
+ * 
+ * If the path is an archive reference (see lilac_archive_ref()), the
+ * archive is opened and the named mesh is read from it.  Otherwise, the
+ * file is opened in binary mode.  Either way, the first bytes of the
+ * mesh are examined to determine whether it is compressed.  The
+ * returned source reads the decompressed data in every case, so it can
+ * be passed directly to lilac_mesh_new().
+ * 
+ * Decompression errors that occur while reading, such as corrupted or
+ * truncated data, are reported to the Shastina parser as I/O errors.
+ * 
+ * pErrCode, if not NULL, points to a variable to receive the error code
+ * status upon return.  If the function is successful, a value of
+ * LILAC_SOURCE_ERR_OK (zero) will be written into the variable.
+ * 
+ * Upon success, the return value is a new Shastina source that owns the
+ * underlying file or archive.  It should eventually be freed with
+ * snsource_free(), which also closes the file or archive.  Upon failure,
+ * the return value is NULL.
+ * 
+ * Parameters:
+ * 
+ *   pPath - the path to the mesh file
+ * 
+ *   pErrCode - pointer to variable to receive the error code status of
+ *   the operation, or NULL
+ * 
+ * Return:
+ * 
+ *   a new Shastina source or NULL if failure
+ */
+SNSOURCE *lilac_source_open(const char *pPath, int *pErrCode);
+
+/*
+ * Open mesh data in memory as a Shastina source.
+ * 
+ * The data may be compressed in any of the supported formats, which is
+ * detected from its first bytes just as for lilac_source_open().  The
+ * data is not copied, so it must remain valid and unchanged until the
+ * returned source is freed with snsource_free().
+ * 
+ * Parameters:
+ * 
+ *   pData - the mesh data, which may be NULL only if len is zero
+ * 
+ *   len - the length of the mesh data in bytes
+ * 
+ *   pErrCode - pointer to variable to receive the error code status of
+ *   the operation, or NULL
+ * 
+ * Return:
+ * 
+ *   a new Shastina source or NULL if failure
+ */
+SNSOURCE *lilac_source_memory(
+    const unsigned char * pData,
+          size_t          len,
+          int           * pErrCode);
+
+/*
+ * Read a whole mesh into memory.
+ * 
+ * The path is interpreted just as for lilac_source_open(), and the
+ * returned buffer holds the complete decompressed mesh data.  This is
+ * used for mesh formats that are decoded from memory rather than parsed
+ * through Shastina, such as compact binary meshes (see lilac_pack.h).
+ * 
+ * The buffer always has one extra byte of value zero after the end of
+ * the data, which is not included in the length.  The caller must
+ * eventually free() the buffer.
+ * 
+ * Unlike lilac_source_open(), decompression errors are detected here
+ * and reported as LILAC_SOURCE_ERR_DATA.
+ * 
+ * Parameters:
+ * 
+ *   pPath - the path to the mesh file
+ * 
+ *   pLen - receives the length of the mesh data in bytes
+ * 
+ *   pErrCode - pointer to variable to receive the error code status of
+ *   the operation, or NULL
+ * 
+ * Return:
+ * 
+ *   the mesh data, or NULL if failure
+ */
+unsigned char *lilac_source_read(
+    const char   * pPath,
+          size_t * pLen,
+          int    * pErrCode);
+
+/*
+ * Given an error code from this module, return an error message
+ * corresponding to that code.
+ * 
+ * The string has the first letter capitalized, but no punctuation or
+ * line break at the end.
+ * 
+ * If the given code is not recognized, "Unknown error" is returned.  If
+ * the given code is LILAC_SOURCE_ERR_OK (0), "No error" is returned.
+ * 
+ * The returned string is statically allocated.  The client should not
+ * attempt to free it.
+ * 
+ * Parameters:
+ * 
+ *   code - the error code
+ * 
+ * Return:
+ * 
+ *   an error message
+ */
+const char *lilac_source_errstr(int code);
+
+#endif
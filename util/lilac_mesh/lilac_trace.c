@@ -0,0 +1,431 @@
+/*
+ * lilac_trace.c
+ * =============
+ * 
+ * Implementation of lilac_trace.h
+ * 
+ * See the header for further information.
+ */
+
+#include "lilac_trace.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Constants
+ * ---------
+ */
+
+/*
+ * The maximum length of a thread name, including the index and the
+ * terminating nul.
+ */
+#define MAX_THREAD_NAME (48)
+
+/*
+ * The initial capacity of the span array.
+ */
+#define INIT_CAP (1024)
+
+/*
+ * Type declarations
+ * -----------------
+ */
+
+/*
+ * A recorded span.
+ * 
+ * ts is the start time and dur the duration, both in microseconds, and
+ * tid is the index of the thread in the thread table.
+ */
+typedef struct {
+  const char *pName;
+  const char *pArgName;
+  long arg;
+  double ts;
+  double dur;
+  int tid;
+} SPAN;
+
+/*
+ * A thread in the thread table.
+ * 
+ * Each entry is one row of the timeline.  bound is set while the entry
+ * belongs to the thread in the thread field.  Entries are unbound when
+ * another entry is given to the same thread by name, since thread
+ * handles are reused after threads end.  named is set once the entry
+ * was given a name with lilac_trace_thread().
+ */
+typedef struct {
+  pthread_t thread;
+  int bound;
+  int named;
+  char name[MAX_THREAD_NAME];
+} THREAD;
+
+/*
+ * Local data
+ * ----------
+ */
+
+/*
+ * The tracing state.
+ * 
+ * m_on is set while tracing, and pOut is the trace file.  m_origin is
+ * the monotonic clock reading in seconds when tracing started.  The
+ * spans and the thread table are protected by m_lock.
+ */
+static int m_on = 0;
+static FILE *pOut = NULL;
+static double m_origin = 0.0;
+static pthread_mutex_t m_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static SPAN *pSpans = NULL;
+static long m_span_count = 0;
+static long m_span_cap = 0;
+
+static THREAD m_threads[LILAC_TRACE_MAX_THREADS];
+static int m_thread_count = 0;
+
+/*
+ * Local functions
+ * ---------------
+ */
+
+/* Prototypes */
+static double clockNow(void);
+static int threadIndex(void);
+static void writeString(const char *pStr);
+
+/*
+ * Read the monotonic clock.
+ * 
+ * Return:
+ * 
+ *   the clock reading in seconds
+ */
+static double clockNow(void) {
+  
+  struct timespec ts;
+  
+  memset(&ts, 0, sizeof(struct timespec));
+  if (clock_gettime(CLOCK_MONOTONIC, &ts)) {
+    abort();
+  }
+  
+  return ((double) ts.tv_sec) + (((double) ts.tv_nsec) / 1000000000.0);
+}
+
+/*
+ * Find the calling thread in the thread table, adding it if it is not
+ * there yet.
+ * 
+ * The caller must hold m_lock.
+ * 
+ * Return:
+ * 
+ *   the index of the thread
+ */
+static int threadIndex(void) {
+  
+  int i = 0;
+  pthread_t self;
+  
+  self = pthread_self();
+  for(i = 0; i < m_thread_count; i++) {
+    if (m_threads[i].bound && pthread_equal(m_threads[i].thread, self)) {
+      return i;
+    }
+  }
+  
+  if (m_thread_count >= LILAC_TRACE_MAX_THREADS) {
+    return LILAC_TRACE_MAX_THREADS - 1;
+  }
+  
+  m_threads[m_thread_count].thread = self;
+  m_threads[m_thread_count].bound = 1;
+  m_threads[m_thread_count].named = 0;
+  sprintf(m_threads[m_thread_count].name, "thread %d", m_thread_count);
+  m_thread_count++;
+  
+  return m_thread_count - 1;
+}
+
+/*
+ * Write a string to the trace file as a JSON string literal.
+ * 
+ * Quotes and backslashes are escaped, and control characters are
+ * dropped.
+ * 
+ * Parameters:
+ * 
+ *   pStr - the string
+ */
+static void writeString(const char *pStr) {
+  
+  putc('"', pOut);
+  for( ; *pStr != 0; pStr++) {
+    if ((*pStr == '"') || (*pStr == '\\')) {
+      putc('\\', pOut);
+      putc(*pStr, pOut);
+    } else if (((unsigned char) *pStr) >= 0x20) {
+      putc(*pStr, pOut);
+    }
+  }
+  putc('"', pOut);
+}
+
+/*
+ * Public function implementations
+ * -------------------------------
+ * 
+ * See the header for specifications
+ */
+
+/*
+ * lilac_trace_open function.
+ */
+int lilac_trace_open(const char *pPath) {
+  
+  /* Check state and parameter */
+  if (m_on || (pPath == NULL)) {
+    abort();
+  }
+  
+  pOut = fopen(pPath, "wb");
+  if (pOut == NULL) {
+    return 0;
+  }
+  
+  pSpans = (SPAN *) malloc(((size_t) INIT_CAP) * sizeof(SPAN));
+  if (pSpans == NULL) {
+    abort();
+  }
+  m_span_count = 0;
+  m_span_cap = INIT_CAP;
+  
+  m_thread_count = 0;
+  m_origin = clockNow();
+  m_on = 1;
+  
+  /* Register the calling thread as thread zero */
+  if (pthread_mutex_lock(&m_lock)) {
+    abort();
+  }
+  threadIndex();
+  if (pthread_mutex_unlock(&m_lock)) {
+    abort();
+  }
+  
+  return 1;
+}
+
+/*
+ * lilac_trace_on function.
+ */
+int lilac_trace_on(void) {
+  return m_on;
+}
+
+/*
+ * lilac_trace_now function.
+ */
+double lilac_trace_now(void) {
+  
+  if (!m_on) {
+    return 0.0;
+  }
+  return (clockNow() - m_origin) * 1000000.0;
+}
+
+/*
+ * lilac_trace_span function.
+ */
+void lilac_trace_span(
+    const char * pName,
+          double start,
+    const char * pArgName,
+          long   arg) {
+  
+  double now = 0.0;
+  SPAN *ps = NULL;
+  
+  if (!m_on) {
+    return;
+  }
+  
+  /* Check parameter */
+  if (pName == NULL) {
+    abort();
+  }
+  
+  now = lilac_trace_now();
+  
+  if (pthread_mutex_lock(&m_lock)) {
+    abort();
+  }
+  
+  /* Grow the span array if full */
+  if (m_span_count >= m_span_cap) {
+    m_span_cap *= 2;
+    pSpans = (SPAN *) realloc(pSpans, ((size_t) m_span_cap) * sizeof(SPAN));
+    if (pSpans == NULL) {
+      abort();
+    }
+  }
+  
+  ps = &(pSpans[m_span_count]);
+  m_span_count++;
+  
+  ps->pName = pName;
+  ps->pArgName = pArgName;
+  ps->arg = arg;
+  ps->ts = start;
+  ps->dur = (now > start) ? (now - start) : 0.0;
+  ps->tid = threadIndex();
+  
+  if (pthread_mutex_unlock(&m_lock)) {
+    abort();
+  }
+}
+
+/*
+ * lilac_trace_thread function.
+ */
+void lilac_trace_thread(const char *pName, long index) {
+  
+  int i = 0;
+  int j = 0;
+  pthread_t self;
+  char name[MAX_THREAD_NAME];
+  
+  memset(name, 0, sizeof(name));
+  
+  if (!m_on) {
+    return;
+  }
+  
+  /* Check parameter */
+  if (pName == NULL) {
+    abort();
+  }
+  
+  if (pthread_mutex_lock(&m_lock)) {
+    abort();
+  }
+  
+  strncpy(name, pName, MAX_THREAD_NAME - 16);
+  name[MAX_THREAD_NAME - 16] = 0;
+  if (index >= 0) {
+    sprintf(name + strlen(name), " %ld", index);
+  }
+  
+  /* Reuse the row with the same name, so that threads doing the same
+   * job one after another share a row */
+  for(i = 0; i < m_thread_count; i++) {
+    if (m_threads[i].named && (strcmp(m_threads[i].name, name) == 0)) {
+      break;
+    }
+  }
+  
+  /* Release any named row the thread handle is still bound to from an
+   * earlier thread */
+  self = pthread_self();
+  for(j = 0; j < m_thread_count; j++) {
+    if (m_threads[j].bound && m_threads[j].named &&
+        pthread_equal(m_threads[j].thread, self)) {
+      m_threads[j].bound = 0;
+    }
+  }
+  
+  /* Otherwise, name the unnamed row of the thread, starting a new one
+   * if needed */
+  if (i >= m_thread_count) {
+    i = threadIndex();
+  } else {
+    for(j = 0; j < m_thread_count; j++) {
+      if (m_threads[j].bound && pthread_equal(m_threads[j].thread, self)) {
+        m_threads[j].bound = 0;
+      }
+    }
+  }
+  m_threads[i].thread = self;
+  m_threads[i].bound = 1;
+  m_threads[i].named = 1;
+  strcpy(m_threads[i].name, name);
+  
+  if (pthread_mutex_unlock(&m_lock)) {
+    abort();
+  }
+}
+
+/*
+ * lilac_trace_close function.
+ */
+int lilac_trace_close(void) {
+  
+  int status = 1;
+  int i = 0;
+  long j = 0;
+  const SPAN *ps = NULL;
+  
+  if (!m_on) {
+    return 1;
+  }
+  m_on = 0;
+  
+  /* Write the thread names as metadata events and then the spans as
+   * complete events */
+  fprintf(pOut, "{\"traceEvents\":[\n");
+  
+  for(i = 0; i < m_thread_count; i++) {
+    fprintf(pOut,
+      "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+      "\"args\":{\"name\":", i);
+    writeString(m_threads[i].name);
+    fprintf(pOut, "}},\n");
+  }
+  
+  for(j = 0; j < m_span_count; j++) {
+    ps = &(pSpans[j]);
+    fprintf(pOut, "{\"name\":");
+    writeString(ps->pName);
+    fprintf(pOut, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+              "\"ts\":%.3f,\"dur\":%.3f",
+              ps->tid, ps->ts, ps->dur);
+    if (ps->pArgName != NULL) {
+      fprintf(pOut, ",\"args\":{");
+      writeString(ps->pArgName);
+      fprintf(pOut, ":%ld}", ps->arg);
+    }
+    fprintf(pOut, "},\n");
+  }
+  
+  /* The last event is the end of the trace on thread zero, which also
+   * avoids a trailing comma */
+  fprintf(pOut,
+    "{\"name\":\"trace end\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,"
+    "\"tid\":0,\"ts\":%.3f}\n"
+    "],\"displayTimeUnit\":\"ms\"}\n",
+    (clockNow() - m_origin) * 1000000.0);
+  
+  if (ferror(pOut)) {
+    status = 0;
+  }
+  if (fclose(pOut)) {
+    status = 0;
+  }
+  pOut = NULL;
+  
+  free(pSpans);
+  pSpans = NULL;
+  m_span_count = 0;
+  m_span_cap = 0;
+  m_thread_count = 0;
+  
+  return status;
+}
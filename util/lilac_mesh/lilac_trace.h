@@ -0,0 +1,140 @@
+#ifndef LILAC_TRACE_H_INCLUDED
+#define LILAC_TRACE_H_INCLUDED
+
+/*
+ * lilac_trace.h
+ * =============
+ * 
+ * Lilac module for recording timelines in the Chrome trace event
+ * format.
+ * 
+ * Aggregate timings do not show where threads stall or wait on each
+ * other.  When tracing is started with lilac_trace_open(), every span
+ * recorded with lilac_trace_span() is kept in memory with the thread
+ * that recorded it, and lilac_trace_close() writes them all as a JSON
+ * trace file.  Trace files can be opened in the Chrome trace viewer
+ * (chrome://tracing) or in Perfetto, which show one timeline row per
+ * thread.
+ * 
+ * Tracing is process-wide.  Until it is started, all the functions of
+ * this module do nothing and cost only a check of a flag, so modules
+ * and programs may record spans unconditionally.  Spans may be recorded
+ * from any thread.
+ * 
+ * This module requires POSIX for clock_gettime() and pthreads.
+ */
+
+/*
+ * Constants
+ * ---------
+ */
+
+/*
+ * The maximum number of distinct threads that can be told apart in a
+ * trace.  Spans from any further threads are recorded on the last one.
+ */
+#define LILAC_TRACE_MAX_THREADS (256)
+
+/*
+ * Public functions
+ * ----------------
+ */
+
+/*
+ * Start tracing to a file.
+ * 
+ * The file is created right away, so that an invalid path is reported
+ * before any work is done, but it is only written by
+ * lilac_trace_close().  The calling thread becomes thread zero of the
+ * trace and the time of this call is time zero.  A fault occurs if
+ * tracing was already started.
+ * 
+ * Parameters:
+ * 
+ *   pPath - the path of the trace file to create or overwrite
+ * 
+ * Return:
+ * 
+ *   non-zero if successful, zero if the file could not be created
+ */
+int lilac_trace_open(const char *pPath);
+
+/*
+ * Check whether tracing is on.
+ * 
+ * Return:
+ * 
+ *   non-zero if tracing was started and not yet closed
+ */
+int lilac_trace_on(void);
+
+/*
+ * Get the current trace time.
+ * 
+ * Pass the result to lilac_trace_span() when the span ends.
+ * 
+ * Return:
+ * 
+ *   the time in microseconds since tracing started, or zero if tracing
+ *   is off
+ */
+double lilac_trace_now(void);
+
+/*
+ * Record a span that ends now on the calling thread.
+ * 
+ * The name and argument name must remain valid until the trace is
+ * closed, so they should normally be string literals.  If pArgName is
+ * not NULL, arg is attached to the span under that name, such as the
+ * index of the triangle or band that the span processed.  The call is
+ * ignored if tracing is off.
+ * 
+ * Parameters:
+ * 
+ *   pName - the name of the span
+ * 
+ *   start - the start time of the span from lilac_trace_now()
+ * 
+ *   pArgName - the name of the argument, or NULL
+ * 
+ *   arg - the argument value, ignored if pArgName is NULL
+ */
+void lilac_trace_span(
+    const char * pName,
+          double start,
+    const char * pArgName,
+          long   arg);
+
+/*
+ * Name the calling thread in the trace.
+ * 
+ * The thread is shown as the name followed by the index, such as
+ * "render 3".  A negative index is left out.  The name is copied and
+ * truncated if it is very long.  Threads given the same name share one
+ * row of the timeline, which suits threads that do the same job one
+ * after another, and threads that are never named get a row each.  The
+ * call is ignored if tracing is off.
+ * 
+ * Parameters:
+ * 
+ *   pName - the name of the thread
+ * 
+ *   index - the index of the thread, or negative
+ */
+void lilac_trace_thread(const char *pName, long index);
+
+/*
+ * Stop tracing and write the trace file.
+ * 
+ * All recorded spans are written and released.  No other thread may be
+ * recording spans during this call.  If tracing is off, nothing is done
+ * and the call succeeds.
+ * 
+ * Return:
+ * 
+ *   non-zero if successful, zero if there was an I/O error writing the
+ *   trace file
+ */
+int lilac_trace_close(void);
+
+#endif
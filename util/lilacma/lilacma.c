@@ -0,0 +1,555 @@
+/*
+ * lilacma.c
+ * =========
+ * 
+ * Utility program that creates, lists, and extracts Lilac mesh
+ * archives.
+ * 
+ * Syntax
+ * ------
+ * 
+ *   lilacma add [archive] [file] ...
+ *   lilacma list [archive]
+ *   lilacma extract [archive] [name]
+ * 
+ * [archive] is the path to a Lilac mesh archive.  See MeshArchive.md in
+ * the documentation folder for the archive format.
+ * 
+ * The "add" command appends each [file] to the archive, creating the
+ * archive if it does not exist yet.  Each mesh is named after the last
+ * component of its file path, so "meshes/face01.lilacme" is stored as
+ * "face01.lilacme".  The files are stored byte for byte, so they may be
+ * compressed.  Names that already exist in the archive are an error,
+ * as are two files with the same name.  Every file is read and every
+ * name is checked before anything is written, so if any file fails,
+ * the archive is left unchanged (or not created).  The new meshes are
+ * written after the old index, which stays in effect until the new
+ * index has been flushed to the disk.  If writing fails or the program
+ * is killed, the archive keeps its old contents, or is left empty if
+ * it was just created.  The files are held in memory together while
+ * they are added.
+ * 
+ * The "list" command prints the name and the length in bytes of every
+ * mesh in the archive to standard output, one per line, in ascending
+ * order of name.
+ * 
+ * The "extract" command copies the data of the named mesh to standard
+ * output byte for byte.
+ * 
+ * Meshes can also be read directly from an archive by lilacme2png and
+ * lilacme2json, by giving the archive path, a colon, and the mesh name
+ * as input, such as "meshes.lma:face01.lilacme".
+ * 
+ * Compilation
+ * -----------
+ * 
+ * Build this program together with the lilac_archive.c module of Lilac.
+ * It requires POSIX.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lilac_archive.h"
+
+/*
+ * Local data
+ * ----------
+ */
+
+/*
+ * The name of this executable module.
+ * 
+ * This is set at the start of the program entrypoint.  It should be
+ * included in error reports from the program.
+ */
+static const char *pModule = NULL;
+
+/*
+ * Local functions
+ * ---------------
+ */
+
+/* Prototypes */
+static unsigned char *readFile(const char *pPath, size_t *pLen);
+static const char *baseName(const char *pPath);
+static int cmpName(const void *pA, const void *pB);
+
+static int cmdAdd(const char *pArcPath, int count, char **ppFiles);
+static int cmdList(const char *pArcPath);
+static int cmdExtract(const char *pArcPath, const char *pName);
+
+/*
+ * Read a whole file into memory.
+ * 
+ * Parameters:
+ * 
+ *   pPath - the path to the file
+ * 
+ *   pLen - receives the length of the file in bytes
+ * 
+ * Return:
+ * 
+ *   a newly allocated buffer holding the file, which the caller must
+ *   free(), or NULL if the file could not be read
+ */
+static unsigned char *readFile(const char *pPath, size_t *pLen) {
+  
+  int status = 1;
+  size_t cap = 0;
+  size_t len = 0;
+  size_t got = 0;
+  unsigned char *pBuf = NULL;
+  unsigned char *pNew = NULL;
+  FILE *pIn = NULL;
+  
+  /* Check parameters */
+  if ((pPath == NULL) || (pLen == NULL)) {
+    abort();
+  }
+  
+  /* Open the file */
+  pIn = fopen(pPath, "rb");
+  if (pIn == NULL) {
+    status = 0;
+  }
+  
+  /* Read the whole file, doubling the buffer as needed */
+  while (status) {
+    if (len >= cap) {
+      if (cap < 1) {
+        cap = 65536;
+      } else {
+        cap *= 2;
+      }
+      pNew = (unsigned char *) realloc(pBuf, cap);
+      if (pNew == NULL) {
+        abort();
+      }
+      pBuf = pNew;
+      pNew = NULL;
+    }
+  
+    got = fread(pBuf + len, 1, cap - len, pIn);
+    len += got;
+  
+    if (got < 1) {
+      if (ferror(pIn)) {
+        status = 0;
+      }
+      break;
+    }
+  }
+  
+  if (pIn != NULL) {
+    fclose(pIn);
+    pIn = NULL;
+  }
+  
+  if (!status) {
+    free(pBuf);
+    pBuf = NULL;
+    len = 0;
+  }
+  
+  *pLen = len;
+  return pBuf;
+}
+
+/*
+ * Return the last component of a file path.
+ * 
+ * Parameters:
+ * 
+ *   pPath - the file path
+ * 
+ * Return:
+ * 
+ *   pointer into the path just after the last slash, or the whole path
+ *   if it has no slash
+ */
+static const char *baseName(const char *pPath) {
+  
+  const char *pResult = NULL;
+  
+  /* Check parameter */
+  if (pPath == NULL) {
+    abort();
+  }
+  
+  pResult = strrchr(pPath, '/');
+  if (pResult != NULL) {
+    pResult++;
+  } else {
+    pResult = pPath;
+  }
+  
+  return pResult;
+}
+
+/*
+ * Compare two names for sorting with qsort().
+ * 
+ * Parameters:
+ * 
+ *   pA - pointer to the first name pointer
+ * 
+ *   pB - pointer to the second name pointer
+ * 
+ * Return:
+ * 
+ *   less than, equal to, or greater than zero as the first name sorts
+ *   before, equal to, or after the second
+ */
+static int cmpName(const void *pA, const void *pB) {
+  return strcmp(*((const char * const *) pA),
+                *((const char * const *) pB));
+}
+
+/*
+ * Perform the "add" command.
+ * 
+ * Parameters:
+ * 
+ *   pArcPath - the path to the archive
+ * 
+ *   count - the number of files to add
+ * 
+ *   ppFiles - the paths of the files to add
+ * 
+ * Return:
+ * 
+ *   non-zero if successful, zero if failure
+ */
+static int cmdAdd(const char *pArcPath, int count, char **ppFiles) {
+  
+  int status = 1;
+  int errcode = 0;
+  int i = 0;
+  FILE *pf = NULL;
+  size_t *pLens = NULL;
+  unsigned char **ppData = NULL;
+  const char **ppNames = NULL;
+  LILAC_ARCHIVE *pA = NULL;
+  LILAC_ARCHIVE_WRITER *pW = NULL;
+  
+  /* Check parameters */
+  if ((pArcPath == NULL) || (count < 0) || (ppFiles == NULL)) {
+    abort();
+  }
+  
+  /* Allocate the file table */
+  pLens = (size_t *) calloc((size_t) count + 1, sizeof(size_t));
+  ppData = (unsigned char **) calloc(
+                (size_t) count + 1, sizeof(unsigned char *));
+  ppNames = (const char **) calloc(
+                (size_t) count + 1, sizeof(const char *));
+  if ((pLens == NULL) || (ppData == NULL) || (ppNames == NULL)) {
+    abort();
+  }
+  
+  /* Read every file and check every name before writing anything, so
+   * that the command either adds all the files or changes nothing */
+  for(i = 0; i < count; i++) {
+    ppData[i] = readFile(ppFiles[i], &(pLens[i]));
+    if (ppData[i] == NULL) {
+      status = 0;
+      fprintf(stderr, "%s: Can't read file: %s\n", pModule, ppFiles[i]);
+    }
+    
+    ppNames[i] = baseName(ppFiles[i]);
+    if (!lilac_archive_valid_name(ppNames[i])) {
+      status = 0;
+      fprintf(stderr, "%s: %s: %s!\n", pModule, ppFiles[i],
+                lilac_archive_errstr(LILAC_ARCHIVE_ERR_NAME));
+    }
+  }
+  
+  /* Check that no two files have the same name */
+  if (count > 1) {
+    qsort((void *) ppNames, (size_t) count, sizeof(const char *),
+          &cmpName);
+    for(i = 1; i < count; i++) {
+      if ((strcmp(ppNames[i - 1], ppNames[i]) == 0) &&
+          ((i < 2) || (strcmp(ppNames[i - 2], ppNames[i]) != 0))) {
+        status = 0;
+        fprintf(stderr, "%s: Several files are named %s!\n",
+                  pModule, ppNames[i]);
+      }
+    }
+  }
+  
+  /* If the archive exists, check that none of the names are in it and
+   * that there is room for all the files */
+  pf = fopen(pArcPath, "rb");
+  if (pf != NULL) {
+    fclose(pf);
+    pf = NULL;
+    
+    pA = lilac_archive_open(pArcPath, &errcode);
+    if (pA == NULL) {
+      status = 0;
+      fprintf(stderr, "%s: %s!\n", pModule,
+                lilac_archive_errstr(errcode));
+    }
+    
+    for(i = 0; (pA != NULL) && (i < count); i++) {
+      if (lilac_archive_find(pA, ppNames[i]) >= 0) {
+        status = 0;
+        fprintf(stderr, "%s: %s: %s!\n", pModule, ppNames[i],
+                  lilac_archive_errstr(LILAC_ARCHIVE_ERR_DUP));
+      }
+    }
+    
+    if ((pA != NULL) &&
+        (count > LILAC_ARCHIVE_MAX_COUNT - lilac_archive_count(pA))) {
+      status = 0;
+      fprintf(stderr, "%s: %s!\n", pModule,
+                lilac_archive_errstr(LILAC_ARCHIVE_ERR_FULL));
+    }
+    
+    lilac_archive_close(pA);
+    pA = NULL;
+  
+  } else if (count > LILAC_ARCHIVE_MAX_COUNT) {
+    status = 0;
+    fprintf(stderr, "%s: %s!\n", pModule,
+              lilac_archive_errstr(LILAC_ARCHIVE_ERR_FULL));
+  }
+  
+  /* Open the archive for writing */
+  if (status) {
+    pW = lilac_archive_writer_open(pArcPath, &errcode);
+    if (pW == NULL) {
+      status = 0;
+      fprintf(stderr, "%s: %s!\n", pModule,
+                lilac_archive_errstr(errcode));
+    }
+  }
+  
+  /* Add each file; since everything was checked, only an I/O error can
+   * fail here */
+  for(i = 0; status && (i < count); i++) {
+    errcode = lilac_archive_writer_add(
+                pW, baseName(ppFiles[i]), ppData[i], pLens[i]);
+    if (errcode != LILAC_ARCHIVE_ERR_OK) {
+      status = 0;
+      fprintf(stderr, "%s: %s: %s!\n",
+                pModule, ppFiles[i], lilac_archive_errstr(errcode));
+    }
+  }
+  
+  /* Write the index */
+  if (pW != NULL) {
+    errcode = lilac_archive_writer_close(pW);
+    pW = NULL;
+    if (errcode != LILAC_ARCHIVE_ERR_OK) {
+      status = 0;
+      fprintf(stderr, "%s: %s!\n",
+                pModule, lilac_archive_errstr(errcode));
+    }
+  }
+  
+  /* Release the file table */
+  for(i = 0; i < count; i++) {
+    free(ppData[i]);
+    ppData[i] = NULL;
+  }
+  free(pLens);
+  pLens = NULL;
+  free(ppData);
+  ppData = NULL;
+  free((void *) ppNames);
+  ppNames = NULL;
+  
+  return status;
+}
+
+/*
+ * Perform the "list" command.
+ * 
+ * Parameters:
+ * 
+ *   pArcPath - the path to the archive
+ * 
+ * Return:
+ * 
+ *   non-zero if successful, zero if failure
+ */
+static int cmdList(const char *pArcPath) {
+  
+  int status = 1;
+  int errcode = 0;
+  int32_t i = 0;
+  size_t len = 0;
+  LILAC_ARCHIVE *pA = NULL;
+  
+  /* Check parameter */
+  if (pArcPath == NULL) {
+    abort();
+  }
+  
+  /* Open the archive */
+  pA = lilac_archive_open(pArcPath, &errcode);
+  if (pA == NULL) {
+    status = 0;
+    fprintf(stderr, "%s: %s!\n", pModule, lilac_archive_errstr(errcode));
+  }
+  
+  /* Print each mesh */
+  if (status) {
+    for(i = 0; i < lilac_archive_count(pA); i++) {
+      lilac_archive_data(pA, i, &len);
+      printf("%s %lu\n", lilac_archive_name(pA, i), (unsigned long) len);
+    }
+  }
+  
+  lilac_archive_close(pA);
+  pA = NULL;
+  
+  return status;
+}
+
+/*
+ * Perform the "extract" command.
+ * 
+ * Parameters:
+ * 
+ *   pArcPath - the path to the archive
+ * 
+ *   pName - the name of the mesh to extract
+ * 
+ * Return:
+ * 
+ *   non-zero if successful, zero if failure
+ */
+static int cmdExtract(const char *pArcPath, const char *pName) {
+  
+  int status = 1;
+  int errcode = 0;
+  int32_t i = 0;
+  size_t len = 0;
+  const unsigned char *pData = NULL;
+  LILAC_ARCHIVE *pA = NULL;
+  
+  /* Check parameters */
+  if ((pArcPath == NULL) || (pName == NULL)) {
+    abort();
+  }
+  
+  /* Open the archive */
+  pA = lilac_archive_open(pArcPath, &errcode);
+  if (pA == NULL) {
+    status = 0;
+    fprintf(stderr, "%s: %s!\n", pModule, lilac_archive_errstr(errcode));
+  }
+  
+  /* Find the mesh */
+  if (status) {
+    i = lilac_archive_find(pA, pName);
+    if (i < 0) {
+      status = 0;
+      fprintf(stderr, "%s: Mesh not found: %s\n", pModule, pName);
+    }
+  }
+  
+  /* Copy the mesh data to standard output */
+  if (status) {
+    pData = lilac_archive_data(pA, i, &len);
+    if (len > 0) {
+      if (fwrite(pData, 1, len, stdout) != len) {
+        status = 0;
+      }
+    }
+    if (fflush(stdout)) {
+      status = 0;
+    }
+    if (!status) {
+      fprintf(stderr, "%s: Failed to write output!\n", pModule);
+    }
+  }
+  
+  lilac_archive_close(pA);
+  pA = NULL;
+  
+  return status;
+}
+
+/*
+ * Program entrypoint
+ * ------------------
+ */
+
+int main(int argc, char *argv[]) {
+  
+  int status = 1;
+  int x = 0;
+  const char *pCmd = NULL;
+  
+  /* Get module name */
+  pModule = NULL;
+  if ((argc > 0) && (argv != NULL)) {
+    pModule = argv[0];
+  }
+  if (pModule == NULL) {
+    pModule = "lilacma";
+  }
+  
+  /* Check argv */
+  if (argc > 0) {
+    if (argv == NULL) {
+      abort();
+    }
+    for(x = 0; x < argc; x++) {
+      if (argv[x] == NULL) {
+        abort();
+      }
+    }
+  }
+  
+  /* Check that there is a command and an archive */
+  if (argc < 3) {
+    status = 0;
+    fprintf(stderr, "%s: Wrong number of arguments!\n", pModule);
+  }
+  
+  /* Perform the command */
+  if (status) {
+    pCmd = argv[1];
+  
+    if (strcmp(pCmd, "add") == 0) {
+      status = cmdAdd(argv[2], argc - 3, &(argv[3]));
+  
+    } else if (strcmp(pCmd, "list") == 0) {
+      if (argc != 3) {
+        status = 0;
+        fprintf(stderr, "%s: Wrong number of arguments!\n", pModule);
+      } else {
+        status = cmdList(argv[2]);
+      }
+  
+    } else if (strcmp(pCmd, "extract") == 0) {
+      if (argc != 4) {
+        status = 0;
+        fprintf(stderr, "%s: Wrong number of arguments!\n", pModule);
+      } else {
+        status = cmdExtract(argv[2], argv[3]);
+      }
+  
+    } else {
+      status = 0;
+      fprintf(stderr, "%s: Unknown command: %s\n", pModule, pCmd);
+    }
+  }
+  
+  /* Invert status and return */
+  if (status) {
+    status = 0;
+  } else {
+    status = 1;
+  }
+  return status;
+}
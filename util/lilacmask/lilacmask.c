@@ -0,0 +1,251 @@
+/*
+ * lilacmask.c
+ * ===========
+ * 
+ * Utility program that converts a PNG mask into a preprocessed 1-bit
+ * Lilac mask file.
+ * 
+ * Syntax
+ * ------
+ * 
+ *   lilacmask [input] [output]
+ * 
+ * [input] is the path to a PNG mask file, as accepted by lilacme2png.
+ * Each pixel is converted to a grayscale value, and grayscale values
+ * 128 or greater are white while values less than 128 are black, just
+ * as lilacme2png thresholds PNG masks.
+ * 
+ * [output] is the path to the mask file to write, which should have the
+ * extension .lmk.  lilacme2png accepts the mask file anywhere it
+ * accepts the PNG mask, renders exactly the same output, and skips
+ * decoding the PNG.  See MaskFormat.md in the documentation folder for
+ * the mask file format.
+ * 
+ * Compilation
+ * -----------
+ * 
+ * Build this program together with the lilac_mask.c module of Lilac,
+ * libsophistry, and libpng.  The lilac_mask module requires POSIX.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lilac_mask.h"
+#include "sophistry.h"
+
+/*
+ * Local data
+ * ----------
+ */
+
+/*
+ * The name of this executable module.
+ * 
+ * This is set at the start of the program entrypoint.  It should be
+ * included in error reports from the program.
+ */
+static const char *pModule = NULL;
+
+/*
+ * Local functions
+ * ---------------
+ */
+
+/* Prototypes */
+static unsigned char *readMask(
+    const char    * pPath,
+          int32_t * pw,
+          int32_t * ph);
+
+/*
+ * Read a PNG mask and threshold it into rows of mask bits.
+ * 
+ * Errors are reported on standard error.
+ * 
+ * Parameters:
+ * 
+ *   pPath - the path to the PNG mask
+ * 
+ *   pw - receives the width of the mask
+ * 
+ *   ph - receives the height of the mask
+ * 
+ * Return:
+ * 
+ *   the rows of mask bits in the layout of lilac_mask_write(), which
+ *   should eventually be freed, or NULL if failure
+ */
+static unsigned char *readMask(
+    const char    * pPath,
+          int32_t * pw,
+          int32_t * ph) {
+  
+  int status = 1;
+  int err_num = 0;
+  int32_t w = 0;
+  int32_t h = 0;
+  int32_t x = 0;
+  int32_t y = 0;
+  size_t stride = 0;
+  uint32_t *ps = NULL;
+  unsigned char *pRow = NULL;
+  unsigned char *pBits = NULL;
+  SPH_IMAGE_READER *pr = NULL;
+  SPH_ARGB col;
+  
+  /* Initialize structures */
+  memset(&col, 0, sizeof(SPH_ARGB));
+  
+  /* Check parameters */
+  if ((pPath == NULL) || (pw == NULL) || (ph == NULL)) {
+    abort();
+  }
+  
+  /* Open an image reader on the PNG mask file */
+  pr = sph_image_reader_newFromPath(pPath, &err_num);
+  if (pr == NULL) {
+    status = 0;
+    fprintf(stderr, "%s: Failed to read PNG mask file: %s!\n",
+            pModule, sph_image_errorString(err_num));
+  }
+  
+  /* Get and check the dimensions */
+  if (status) {
+    w = sph_image_reader_width(pr);
+    h = sph_image_reader_height(pr);
+    if ((w < 1) || (w > LILAC_MASK_MAX_DIM) ||
+        (h < 1) || (h > LILAC_MASK_MAX_DIM)) {
+      status = 0;
+      fprintf(stderr, "%s: Mask dimensions must be in range 1 to %d!\n",
+              pModule, (int) LILAC_MASK_MAX_DIM);
+    }
+  }
+  
+  /* Allocate the bits, all initially zero */
+  if (status) {
+    stride = lilac_mask_stride(w);
+    pBits = (unsigned char *) calloc((size_t) h, stride);
+    if (pBits == NULL) {
+      abort();
+    }
+  }
+  
+  /* Threshold each scanline, setting the bits of white pixels */
+  for(y = 0; status && (y < h); y++) {
+    ps = sph_image_reader_read(pr, &err_num);
+    if (ps == NULL) {
+      status = 0;
+      fprintf(stderr, "%s: Failed to read mask PNG scanline: %s!\n",
+              pModule, sph_image_errorString(err_num));
+      break;
+    }
+  
+    pRow = pBits + stride * ((size_t) y);
+    for(x = 0; x < w; x++) {
+      sph_argb_unpack(ps[x], &col);
+      sph_argb_downGray(&col);
+      if (col.r >= 128) {
+        pRow[x / 8] = (unsigned char) (pRow[x / 8] | (1 << (x % 8)));
+      }
+    }
+  }
+  
+  /* Release image reader */
+  if (pr != NULL) {
+    sph_image_reader_close(pr);
+    pr = NULL;
+  }
+  
+  if (!status) {
+    free(pBits);
+    pBits = NULL;
+  }
+  
+  if (status) {
+    *pw = w;
+    *ph = h;
+  }
+  return pBits;
+}
+
+/*
+ * Program entrypoint
+ * ------------------
+ */
+
+int main(int argc, char *argv[]) {
+  
+  int status = 1;
+  int x = 0;
+  int errcode = 0;
+  int32_t w = 0;
+  int32_t h = 0;
+  const char *pInPath = NULL;
+  const char *pOutPath = NULL;
+  unsigned char *pBits = NULL;
+  
+  /* Get module name */
+  pModule = NULL;
+  if ((argc > 0) && (argv != NULL)) {
+    pModule = argv[0];
+  }
+  if (pModule == NULL) {
+    pModule = "lilacmask";
+  }
+  
+  /* Check argv */
+  if (argc > 0) {
+    if (argv == NULL) {
+      abort();
+    }
+    for(x = 0; x < argc; x++) {
+      if (argv[x] == NULL) {
+        abort();
+      }
+    }
+  }
+  
+  /* Check number of parameters */
+  if (argc != 3) {
+    status = 0;
+    fprintf(stderr, "%s: Wrong number of arguments!\n", pModule);
+  }
+  
+  /* Get the program arguments */
+  if (status) {
+    pInPath = argv[1];
+    pOutPath = argv[2];
+  }
+  
+  /* Read and threshold the PNG mask */
+  if (status) {
+    pBits = readMask(pInPath, &w, &h);
+    if (pBits == NULL) {
+      status = 0;
+    }
+  }
+  
+  /* Write the mask file */
+  if (status) {
+    if (!lilac_mask_write(pOutPath, w, h, pBits, &errcode)) {
+      status = 0;
+      fprintf(stderr, "%s: %s!\n", pModule, lilac_mask_errstr(errcode));
+    }
+  }
+  
+  /* Release the bits if allocated */
+  free(pBits);
+  pBits = NULL;
+  
+  /* Invert status and return */
+  if (status) {
+    status = 0;
+  } else {
+    status = 1;
+  }
+  return status;
+}
@@ -9,26 +9,46 @@
  * ------
  * 
  *   lilacme2json [input]
+ *   lilacme2json --strict [input]
  * 
- * [input] is the path to the Lilac mesh Shastina file to interpret.
+ * [input] is the path to the Lilac mesh Shastina file to interpret.  The
+ * file may also be compressed with gzip, or with Zstandard if built
+ * with support for it, in which case it is decompressed while reading.
+ * To read a mesh stored in a Lilac mesh archive, give the archive path,
+ * a colon, and the name of the mesh, such as "meshes.lma:face01".  The
+ * mesh may also be in the compact binary mesh format, which is detected
+ * automatically.
  * 
  * The JSON conversion is written to standard output.  This JSON
  * representation is used by the Lilac mesh editor.  See the Lilac mesh
  * editor for documentation of the JSON format.
  * 
+ * With the --strict option, the mesh is also rejected if any two of its
+ * triangles overlap, which the rules of the mesh format otherwise
+ * allow.  Renderers draw overlapping triangles over each other in file
+ * order, so overlaps are usually mistakes.  The two triangles are
+ * reported on standard error.
+ * 
  * Compilation
  * -----------
  * 
- * Build this program together with the lilac_mesh.c module of Lilac and
- * Shastina.
+ * Build this program together with the lilac_mesh.c, lilac_source.c,
+ * lilac_archive.c, lilac_pack.c, lilac_parse.c, lilac_trace.c, and
+ * lilac_overlap.c modules of Lilac, Shastina, zlib, and pthreads.  To read
+ * Zstandard-compressed meshes, also define LILAC_SOURCE_ZSTD and link
+ * with libzstd.
  */
 
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "lilac_mesh.h"
+#include "lilac_overlap.h"
+#include "lilac_parse.h"
+#include "lilac_source.h"
 #include "shastina.h"
 
 /*
@@ -132,12 +152,15 @@ int main(int argc, char *argv[]) {
   
   int status = 1;
   int x = 0;
+  int srcerr = 0;
   int errcode = 0;
+  int strict = 0;
+  int argi = 1;
   long line_num = 0;
+  int32_t tri_a = 0;
+  int32_t tri_b = 0;
   const char *pPath = NULL;
   
-  FILE *pIn = NULL;
-  SNSOURCE *pSrc = NULL;
   LILAC_MESH *pMesh = NULL;
   
   /* Get module name */
@@ -161,37 +184,33 @@ int main(int argc, char *argv[]) {
     }
   }
   
+  /* Get the option, if present */
+  if ((argc > 1) && (strcmp(argv[1], "--strict") == 0)) {
+    strict = 1;
+    argi = 2;
+  }
+  
   /* Check number of parameters */
-  if (argc != 2) {
+  if (argc - argi != 1) {
     status = 0;
     fprintf(stderr, "%s: Wrong number of arguments!\n", pModule);
   }
   
   /* Get the program arguments */
   if (status) {
-    pPath = argv[1];
+    pPath = argv[argi];
   }
   
-  /* Open the input file as a Shastina source and assign ownership of
-   * the file handle to the Shastina source object */
+  /* Load the mesh in either format, decompressing it if it is
+   * compressed */
   if (status) {
-    pIn = fopen(pPath, "rb");
-    if (pIn != NULL) {
-      pSrc = snsource_file(pIn, 1);
-      pIn = NULL;
-      
-    } else {
-      status = 0;
-      fprintf(stderr, "%s: Can't open input file!\n", pModule);
-    }
-  }
-
-  /* Parse the input file and build the mesh representation */
-  if (status) {
-    pMesh = lilac_mesh_new(pSrc, &errcode, &line_num);
+    pMesh = lilac_parse_load(pPath, 1, &srcerr, &errcode, &line_num);
     if (pMesh == NULL) {
       status = 0;
-      if (line_num > 0) {
+      if (srcerr) {
+        fprintf(stderr, "%s: %s!\n",
+                  pModule, lilac_source_errstr(srcerr));
+      } else if (line_num > 0) {
         fprintf(stderr, "%s: [line %ld] %s!\n",
                   pModule, line_num, lilac_mesh_errstr(errcode));
       } else {
@@ -201,12 +220,12 @@ int main(int argc, char *argv[]) {
     }
   }
   
-  /* Consume the rest of input, making sure nothing remains in file */
-  if (status) {
-    if (snsource_consume(pSrc) <= 0) {
+  /* In strict mode, reject meshes with overlapping triangles */
+  if (status && strict) {
+    if (lilac_overlap_find(pMesh, &tri_a, &tri_b)) {
       status = 0;
-      fprintf(stderr, "%s: Failed to consume input after |;\n", 
-                pModule);
+      fprintf(stderr, "%s: Triangles %ld and %ld overlap!\n",
+                pModule, (long) tri_a, (long) tri_b);
     }
   }
   
@@ -219,11 +238,6 @@ int main(int argc, char *argv[]) {
   lilac_mesh_free(pMesh);
   pMesh = NULL;
   
-  /* Release the Shastina source if allocated, as well as any file
-   * handle owned by the source */
-  snsource_free(pSrc);
-  pSrc = NULL;
-  
   /* Invert status and return */
   if (status) {
     status = 0;
@@ -8,21 +8,146 @@
  * Syntax
  * ------
  * 
- *   lilacme2png [mode] [output] [input] [mask]
- *   lilacme2png [mode] [output] [input] [w] [h]
+ *   lilacme2png [options] [mode] [output] [input] [mask]
+ *   lilacme2png [options] [mode] [output] [input] [w] [h]
+ * 
+ * [options] is a sequence of zero or more options, each of which begins
+ * with "--".  The following options are supported:
+ * 
+ *   --interp exact
+ *   --interp fast
+ * 
+ *     Select how unit vectors are interpolated in the vector modes.  The
+ *     default "exact" performs slerp in double precision with the
+ *     standard library sin() function at every pixel.  "fast" calls
+ *     sin() and cos() only once per span and steps the slerp weights
+ *     from pixel to pixel with the angle addition formulas, and it
+ *     interpolates along triangle edges with a single-precision
+ *     polynomial approximation of the sine function.  Rendering 4000 by
+ *     4000 pixels in vector mode, "fast" takes about half the time of
+ *     "exact" on the test meshes, but it gains less where spans are only
+ *     a few pixels wide.  Scalar modes are not affected by this option.
+ * 
+ *   --interp-check
+ * 
+ *     Also render each frame a second time entirely with the exact
+ *     interpolation path into a reference buffer, compare the two
+ *     frames pixel by pixel, and report the maximum channel deviation
+ *     between the selected path and the exact path on standard error at
+ *     the end.  This is only useful together with "--interp fast", and
+ *     it needs one more pixel buffer.  With more than one thread,
+ *     overlapping triangles may be drawn in a different order in the
+ *     two renders, which also shows up as differences.  On the test
+ *     meshes rendered at 700 by 500 in the vector modes, the measured
+ *     maximum deviation of the fast path is one channel level, affecting
+ *     at most six pixels in 350,000, or about one pixel in sixty
+ *     thousand.
+ * 
+ *   --threads [n]
+ * 
+ *     Render with n threads, in range [1, 64].  The default is one.
+ *     Each triangle is a task, except that triangles covering more than
+ *     TASK_ROWS scanlines are split into several tasks of scanline
+ *     bands.  Each thread starts with an equal run of tasks in its own
+ *     deque and steals from the other threads when it runs out.  The
+ *     output is the same for any thread count, except where triangles
+ *     overlap.  Very large text meshes are also tokenized with up to n
+ *     threads.
+ * 
+ *   --stats
+ * 
+ *     Report the number of rendering tasks and the busy time and
+ *     utilization of each rendering thread on standard error, along
+ *     with the time spent rendering and the time spent writing output.
+ *     At the end, the peak and current memory of each subsystem is
+ *     reported: "mesh" for the keyframe meshes, "work" for parsing and
+ *     validating them, "frame" for the pixel buffers, and "vertex" for
+ *     the converted vertices, edge table, and rendering tasks of each
+ *     frame.  Memory used inside the image and compression libraries
+ *     and for reading files is not counted.
+ * 
+ *   --dry-run
+ * 
+ *     Load and check the meshes and read the dimensions of the mask,
+ *     then print the predicted peak memory of each subsystem and in
+ *     total on standard output, and stop without allocating the pixel
+ *     buffers or writing any output.  The vertex memory is found by
+ *     converting the vertices of every frame and counting its tasks and
+ *     edge samples, so the prediction is exact for the counted memory
+ *     of a real run with the same arguments.
+ * 
+ *   --layout linear
+ *   --layout tiled
+ * 
+ *     Select the layout of the pixel buffer while rendering.  The
+ *     default "linear" stores the buffer row by row.  "tiled" stores
+ *     the buffer as 16x16 pixel tiles, which keeps tall triangles
+ *     within far fewer cache lines and pages, and gathers the scanlines
+ *     back together as they are written.  The output is the same either
+ *     way.  Since interpolation dominates the rendering time, tiling
+ *     only pays off where memory traffic does, so compare the two on
+ *     the target machine with --stats, or under a profiler such as
+ *     "perf stat -e cache-misses" for cache behavior.
+ * 
+ *   --key [mesh]
+ * 
+ *     Add a keyframe mesh to render a sequence of frames.  [input] is
+ *     the first keyframe, and each --key option adds the next one, up
+ *     to MAX_KEYS keyframes in total.  Every keyframe must have exactly
+ *     the same triangles as [input] and differ only in the positions
+ *     and normals of its points.  The topology is checked once when the
+ *     keyframes are loaded, so each frame only converts its vertices
+ *     before rendering.
+ * 
+ *   --frames [n]
+ * 
+ *     Render a sequence of n frames, in range [1, MAX_FRAMES].  The
+ *     default is one frame for each keyframe.  The frames are spread
+ *     evenly from the first keyframe to the last, so the first and last
+ *     frames are always the first and last keyframes, and the frames in
+ *     between linearly interpolate the point positions and normals of
+ *     the two nearest keyframes, rounded to mesh units.  Interpolated
+ *     frames are not checked against the rules of the mesh format.
+ * 
+ *     Each frame is rendered with all the rendering threads, while the
+ *     previous frame is written out on a separate thread.
+ * 
+ *   --trace-out [file]
+ * 
+ *     Record a timeline of the run and write it to the given file as a
+ *     Chrome trace event JSON file, which can be opened in a trace
+ *     viewer such as chrome://tracing or Perfetto.  The timeline has a
+ *     row for each thread, with spans for reading the mesh, the header,
+ *     tokenizing, interpreting, and validating it, decoding the mask,
+ *     converting the vertices and building the edge table of each
+ *     frame, each rendering task with its triangle, and each encoded
+ *     stripe of TASK_ROWS scanlines.  The file is only written when the
+ *     program succeeds.
  * 
  * [mode] is the kind of compiled PNG file to generate.  "vector"
- * generates a PNG file that encodes vectors at each pixel.  "scalar-x"
- * generates a PNG file that encodes scalar values at each pixel, with
- * left as -1.0 and right as 1.0.  "scalar-y" generates a PNG file that
- * encodes scalar values at each pixel, with bottom as -1.0 and top as
- * 1.0.  See "MeshPNG.md" in the doc directory for further information
- * about how vector and scalar values are encoded in PNG images.
+ * generates a PNG file that encodes vectors at each pixel.  "octa"
+ * generates the same vectors in a hemi-octahedral encoding that only
+ * uses the red and green channels and has better angular precision.
+ * "scalar-x" generates a PNG file that encodes scalar values at each
+ * pixel, with left as -1.0 and right as 1.0.  "scalar-y" generates a
+ * PNG file that encodes scalar values at each pixel, with bottom as
+ * -1.0 and top as 1.0.  See "MeshPNG.md" in the doc directory for
+ * further information about how vector and scalar values are encoded in
+ * PNG images.
  * 
  * [output] is the path to the PNG image file to generate.  This path
  * must end with an extension that is a case-insensitive match for .png
+ * When rendering more than one frame, the path must contain a run of #
+ * characters, such as "turn####.png", and the last such run is replaced
+ * by the zero-padded frame number, starting at zero, in each frame.
  * 
- * [input] is the path to the Lilac mesh Shastina file to interpret.
+ * [input] is the path to the Lilac mesh Shastina file to interpret.  The
+ * file may also be compressed with gzip, or with Zstandard if built
+ * with support for it, in which case it is decompressed while reading.
+ * To read a mesh stored in a Lilac mesh archive, give the archive path,
+ * a colon, and the name of the mesh, such as "meshes.lma:face01".  The
+ * mesh may also be in the compact binary mesh format, which is detected
+ * automatically.
  * 
  * [mask], if present, is a path to an existing PNG file that will serve
  * as the mask.  The dimensions of the output PNG file will match the
@@ -33,6 +158,13 @@
  * they are also covered by the mesh, while black pixels indicate pixels
  * that are masked out, even if they are present in the mesh.
  * 
+ * [mask] may also be a preprocessed 1-bit mask file, as written by the
+ * lilacmask utility, which is detected automatically by its signature.
+ * Preprocessed masks are mapped into memory and expanded directly into
+ * the pixel buffer, which avoids decoding the PNG and converting every
+ * pixel to grayscale on each render.  See "MaskFormat.md" in the doc
+ * directory.
+ * 
  * [w] and [h] can be used instead of [mask].  Both are integer values
  * in range [1, 16384] that indicate the width and height of the output
  * PNG file.
@@ -45,23 +177,56 @@
  * - libsophistry
  * - libpng (for libsophistry)
  * - libshastina
- * - lilac_mesh
+ * - lilac_mesh, including lilac_source, lilac_archive, lilac_pack,
+ *   lilac_parse, lilac_mask, and lilac_trace
+ * - zlib (-lz) for lilac_source
  * - lm for the <math.h> library
+ * - pthreads
+ * 
+ * The pixel loops of the renderer are specialized kernels for each
+ * interpolation mode that do not validate anything per pixel, because
+ * all vertices are validated once when they are converted.  Define
+ * LILACME2PNG_DEBUG when compiling (-DLILACME2PNG_DEBUG) to compile in
+ * per-pixel assertions that every interpolated value is finite.
+ * 
+ * To read Zstandard-compressed meshes, also define LILAC_SOURCE_ZSTD
+ * (-DLILAC_SOURCE_ZSTD) and link with libzstd (-lzstd).
  */
 
 #include <ctype.h>
 #include <errno.h>
 #include <math.h>
+#include <pthread.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
+#include "lilac_mask.h"
 #include "lilac_mesh.h"
+#include "lilac_parse.h"
+#include "lilac_source.h"
+#include "lilac_trace.h"
 #include "shastina.h"
 #include "sophistry.h"
 
+/*
+ * Diagnostics
+ * -----------
+ */
+
+/*
+ * CHECK_PIXEL() asserts that an interpolated pixel vector is finite in
+ * debug builds and compiles to nothing otherwise.
+ */
+#ifdef LILACME2PNG_DEBUG
+#define CHECK_PIXEL(vx, vy, vz) checkPixel((vx), (vy), (vz))
+#else
+#define CHECK_PIXEL(vx, vy, vz)
+#endif
+
 /*
  * Constants
  * ---------
@@ -101,6 +266,66 @@
 #define MIN_SLERP_ANGLE (M_PI / 1024.0)
 #define MAX_SLERP_ANGLE (M_PI - (M_PI / 1024.0))
 
+/*
+ * Small triangle limits.
+ * 
+ * Triangles whose bounding box, after snapping the vertices to pixel
+ * centers, is at most SMALL_TRI_DIM pixels in both width and height
+ * are rendered by renderSmallTri() instead of the scanline path.
+ * 
+ * In INTER_VECTOR mode, renderSmallTri() interpolates the vertex
+ * vectors linearly and normalizes the result, which only closely
+ * matches slerp when the vectors are close together.  So in that mode,
+ * the small triangle path is only used when the dot product of each
+ * pair of vertex vectors is at least SMALL_TRI_DOT (30 degrees apart
+ * at most).
+ */
+#define SMALL_TRI_DIM (8)
+#define SMALL_TRI_DOT (0.866f)
+
+/*
+ * The maximum number of rendering threads.
+ */
+#define MAX_THREADS (64)
+
+/*
+ * The maximum number of keyframe meshes and of rendered frames.
+ */
+#define MAX_KEYS (256)
+#define MAX_FRAMES (100000)
+
+/*
+ * The number of scanlines in each rendering task of a large triangle.
+ * 
+ * Triangles that cover more scanlines than this are split into several
+ * tasks that each render a band of at most this many scanlines, so that
+ * a few huge triangles can be spread across all the threads.
+ */
+#define TASK_ROWS (64)
+
+/*
+ * Pixel buffer layouts.
+ * 
+ * LAYOUT_LINEAR stores the pixel buffer row by row.
+ * 
+ * LAYOUT_TILED stores the pixel buffer as square tiles of TILE_DIM
+ * pixels on a side.  Tiles are ordered row by row, and the pixels within
+ * each tile are also ordered row by row.  With a TILE_DIM of 16, each
+ * row of a tile is one 64-byte cache line and each tile is one
+ * kilobyte, so a tall triangle touches far fewer cache lines and pages
+ * than in the linear layout, where every scanline is a separate page
+ * for wide images.
+ * 
+ * TILE_SHIFT is the base-2 logarithm of TILE_DIM, and TILE_MASK selects
+ * the coordinate within a tile.
+ */
+#define LAYOUT_LINEAR (0)
+#define LAYOUT_TILED  (1)
+
+#define TILE_SHIFT (4)
+#define TILE_DIM   (1 << TILE_SHIFT)
+#define TILE_MASK  (TILE_DIM - 1)
+
 /*
  * Interpolation modes.
  * 
@@ -134,6 +359,19 @@
 #define VMODE_Y     (2)
 #define VMODE_3D    (3)
 
+/*
+ * Vector encodings.
+ * 
+ * VENC_XYZ encodes each unit vector in INTER_VECTOR mode as its X, Y,
+ * and Z coordinates in the red, green, and blue channels.
+ * 
+ * VENC_OCTA encodes each unit vector with the hemi-octahedral mapping in
+ * the red and green channels, leaving the blue channel zero.  See
+ * "MeshPNG.md" in the doc directory for the exact encoding.
+ */
+#define VENC_XYZ  (0)
+#define VENC_OCTA (1)
+
 /*
  * IVEC modes.
  * 
@@ -164,6 +402,20 @@
 #define IMODE_SLERP   (3)
 #define IMODE_DOUBLE  (4)
 
+/*
+ * Slerp precision modes.
+ * 
+ * SLERP_EXACT means that slerp weights are computed in double precision
+ * with the standard library sin() function.
+ * 
+ * SLERP_FAST means that the span kernels step the slerp weights from
+ * pixel to pixel with the angle addition formulas, and that vertices
+ * along edges are computed in single precision with the polynomial
+ * approximation in fastSin().
+ */
+#define SLERP_EXACT (0)
+#define SLERP_FAST  (1)
+
 /*
  * Type declarations
  * -----------------
@@ -231,7 +483,7 @@ typedef struct {
  * Use ivec_ functions to interact with this structure.
  */
 typedef struct {
-
+  
   /*
    * Copies of the vertices.
    * 
@@ -259,8 +511,119 @@ typedef struct {
    */
   double denom;
   
+  /*
+   * Non-zero if the slerp weights should be computed with the fast
+   * approximation rather than the exact method.
+   * 
+   * Only relevant if mode is IMODE_SLERP or IMODE_DOUBLE.
+   */
+  int fast;
+  
+  /*
+   * Single-precision versions of angle and (1.0 / denom), for use by the
+   * fast approximation.
+   * 
+   * Only valid if mode is IMODE_SLERP and the fast flag is set.
+   */
+  float angle_f;
+  float rdenom_f;
+  
+  /*
+   * The values of cos(angle) / denom and 1.0 / denom in double
+   * precision, which the fast span kernels use to derive the slerp
+   * weights from the cosine and sine of t * angle.
+   * 
+   * Only valid if mode is IMODE_SLERP and the fast flag is set.
+   */
+  double cot;
+  double rdenom;
+  
 } IVEC;
 
+/*
+ * Attribute plane for scalar interpolation.
+ * 
+ * In INTER_SCALAR mode, the interpolated scalar value across a triangle
+ * is an affine function of the pixel coordinates.  This structure
+ * stores that function as v(x, y) = c + (dx * x) + (dy * y), where x
+ * and y are in the graphics buffer space.
+ * 
+ * Initialize with plane_init().
+ */
+typedef struct {
+  double c;
+  double dx;
+  double dy;
+} PLANE;
+
+/*
+ * An entry in the shared edge table.
+ * 
+ * Each entry represents an undirected edge of the mesh between the
+ * points with indices i1 and i2, where i1 is less than i2.  Since the
+ * directed edges of a mesh are unique, each entry is shared by at most
+ * two triangles, which use the edge in opposite directions.
+ * 
+ * pSamples holds the interpolated vertex at each scanline the edge
+ * crosses, in exactly the form that renderPair() would compute it,
+ * with the exact crossing in the X coordinate.  y_first is the first
+ * scanline and y_count is the number of samples.  If y_count is zero,
+ * pSamples is NULL.
+ * 
+ * An entry with i1 equal to -1 is an unused slot in the hash table.
+ */
+typedef struct {
+  int32_t i1;
+  int32_t i2;
+  int32_t y_first;
+  int32_t y_count;
+  VERTEX *pSamples;
+} EDGE_ENTRY;
+
+/*
+ * A rendering task.
+ * 
+ * The task renders the scanlines from y_lo to y_hi inclusive of the
+ * triangle with index tri in the mesh.
+ */
+typedef struct {
+  int32_t tri;
+  int32_t y_lo;
+  int32_t y_hi;
+} TASK;
+
+/*
+ * A rendering thread and its work-stealing deque.
+ * 
+ * The deque is the range of tasks in the task array from head up to but
+ * excluding tail, and it is protected by lock.  The owning thread takes
+ * tasks from the head, in mesh order, while other threads that have run
+ * out of work steal tasks from the tail.
+ * 
+ * index is the index of the worker.  task_count is the total number of
+ * tasks the worker rendered, steal_count is how many of those it stole
+ * from other workers, and busy is the CPU time in seconds that its
+ * thread spent rendering.
+ */
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_t thread;
+  int32_t head;
+  int32_t tail;
+  int32_t index;
+  int32_t task_count;
+  int32_t steal_count;
+  double busy;
+} WORKER;
+
+/*
+ * Function pointer type for render kernels.
+ * 
+ * See the "Render kernels" section.
+ */
+typedef void (*KERNEL)(uint32_t *ps, int32_t x_min, int32_t x_max,
+                        const IVEC *piv);
+
 /*
  * Local data
  * ----------
@@ -281,6 +644,51 @@ static const char *pModule = NULL;
  */
 static int m_inter = INTER_UNDEF;
 static int m_vmode = VMODE_UNDEF;
+static int m_venc = VENC_XYZ;
+
+/*
+ * The slerp precision mode, which is one of the SLERP_ constants.
+ * 
+ * This is set during the program entrypoint.
+ */
+static int m_slerp = SLERP_EXACT;
+
+/*
+ * Interpolation check state.
+ * 
+ * If m_check is non-zero, then each frame is rendered a second time
+ * with the exact interpolation path into pRef, and every rendered pixel
+ * is compared against the exact reference.  m_ref is set while the
+ * reference is rendered, which makes spans use kernelGeneric() so that
+ * the reference does not depend on the specialized kernels either.
+ * m_check_count is the total number of pixels compared, m_check_diff is
+ * the number of pixels that had any channel difference, and m_check_max
+ * holds the maximum absolute deviation that was observed in the red,
+ * green, and blue channels, respectively.
+ */
+static int m_check = 0;
+static int m_ref = 0;
+static int32_t m_check_count = 0;
+static int32_t m_check_diff = 0;
+static int m_check_max[3] = {0, 0, 0};
+static uint32_t *pRef = NULL;
+
+/*
+ * Threading and statistics options.
+ * 
+ * m_threads is the number of rendering threads.  If m_stats is
+ * non-zero, then rendering statistics are reported on standard error.
+ * 
+ * These are set during the program entrypoint.
+ */
+static int32_t m_threads = 1;
+static int m_stats = 0;
+
+/*
+ * Set during the program entrypoint for a dry run, which only predicts
+ * the memory use.
+ */
+static int m_dry = 0;
 
 /*
  * The pixel buffer.
@@ -289,8 +697,13 @@ static int m_vmode = VMODE_UNDEF;
  * 
  * When initialized, m_w and m_h store the width and height in pixels of
  * the buffer.  pBuf then points to the actual pixels.  Each pixel is a
- * uint32_t value.  Within scanlines, pixels are ordered from left to
- * right, and scanlines are ordered from top to bottom.
+ * uint32_t value.
+ * 
+ * The arrangement of pixels in the buffer is selected by m_layout, which
+ * is one of the LAYOUT_ constants.  Use pixelPtr() to locate a pixel
+ * and pixelRun() to find how many pixels are contiguous in a scanline.
+ * In LAYOUT_TILED, the buffer is padded to whole tiles, and m_tiles_x
+ * is the number of tiles across the buffer.
  * 
  * Pixel values are encoded in the format expected by Sophistry.
  * 
@@ -309,6 +722,32 @@ static int m_vmode = VMODE_UNDEF;
 static int32_t m_w = 0;
 static int32_t m_h = 0;
 static uint32_t *pBuf = NULL;
+static int m_layout = LAYOUT_LINEAR;
+static int32_t m_tiles_x = 0;
+static size_t m_buf_len = 0;
+
+/*
+ * Frame sequence buffers.
+ * 
+ * When rendering more than one frame, pMaskBuf is a copy of the pixel
+ * buffer right after it was initialized from the mask or dimensions,
+ * which resets the pixel buffer before each further frame.  pBack is a
+ * second pixel buffer in the same layout that holds the previous frame
+ * while the writer thread writes it to pBackPath.  m_writing is set
+ * while the writer thread is running.  All of these have m_buf_len
+ * pixels.
+ */
+static uint32_t *pMaskBuf = NULL;
+static uint32_t *pBack = NULL;
+static char *pBackPath = NULL;
+static pthread_t m_writer;
+static int m_writing = 0;
+
+/*
+ * The Sophistry down-conversion of the output images, which is one of
+ * the SPH_IMAGE_DOWN_ constants.
+ */
+static int m_dconv = 0;
 
 /*
  * The parsed Lilac mesh.
@@ -317,6 +756,47 @@ static uint32_t *pBuf = NULL;
  */
 static LILAC_MESH *pMesh = NULL;
 
+/*
+ * The keyframe meshes.
+ * 
+ * pKeys holds m_key_count meshes that all share the triangles of pMesh,
+ * which is the first keyframe, and m_frames is the number of frames to
+ * render from them.
+ */
+static LILAC_MESH *pKeys[MAX_KEYS];
+static int32_t m_key_count = 0;
+static int32_t m_frames = 0;
+
+/*
+ * The converted vertex array.
+ * 
+ * When initialized, this has one vertex for each point in the mesh, or
+ * is NULL if the mesh has no points.
+ */
+static VERTEX *pva = NULL;
+
+/*
+ * The shared edge table.
+ * 
+ * This is an open-addressing hash table of EDGE_ENTRY structures with
+ * m_edge_cap slots, which is a power of two.  It is built before
+ * rendering with edge_table_build() and is read-only during rendering.
+ * If pEdges is NULL, renderPair() interpolates its edges itself.
+ */
+static EDGE_ENTRY *pEdges = NULL;
+static int32_t m_edge_cap = 0;
+
+/*
+ * The rendering tasks and workers.
+ * 
+ * pTasks is the array of m_task_count rendering tasks built by
+ * tasks_build(), or NULL if there are no tasks.  pWorkers is the array
+ * of m_threads workers while renderTasks() is running, or NULL.
+ */
+static TASK *pTasks = NULL;
+static int32_t m_task_count = 0;
+static WORKER *pWorkers = NULL;
+
 /*
  * Local functions
  * ---------------
@@ -332,26 +812,125 @@ static int32_t idec(int32_t v);
 
 static void checkVertex(const VERTEX *pv);
 static uint32_t vertexColor(const VERTEX *pv);
+static void checkColor(uint32_t c, uint32_t ce);
+static void checkFrame(void);
+static uint32_t scalarColor(double v);
+static uint32_t vectorChannel(float f);
+static uint32_t octaChannel(float f);
+static uint32_t vectorColor(float vx, float vy, float vz);
+#ifdef LILACME2PNG_DEBUG
+static void checkPixel(float vx, float vy, float vz);
+#endif
 static void convertVertex(VERTEX *pv, const LILAC_MESH_POINT *pp);
 
+static float fastSin(float x);
+
 static void ivec_init(IVEC *piv, const VERTEX *v1, const VERTEX *v2);
 static void ivec_compute(VERTEX *pr, const IVEC *piv, double t);
 static void ivec_atX(VERTEX *pr, const IVEC *piv, double x);
 static void ivec_atY(VERTEX *pr, const IVEC *piv, double y);
 
+static int plane_init(
+    PLANE        * pp,
+    const VERTEX * v1,
+    const VERTEX * v2,
+    const VERTEX * v3);
+
+static int pixelRange(
+    double    lo,
+    double    hi,
+    int32_t   limit,
+    int32_t * pFirst,
+    int32_t * pLast);
+static double edgeX(const VERTEX *v1, const VERTEX *v2, double y);
+
+static double spanT(const IVEC *piv, double x);
+static double spanStep(const IVEC *piv);
+static void kernelGeneric(uint32_t *ps, int32_t x_min, int32_t x_max,
+                          const IVEC *piv);
+static void kernelScalar(uint32_t *ps, int32_t x_min, int32_t x_max,
+                         const IVEC *piv);
+static void kernelVLinear(uint32_t *ps, int32_t x_min, int32_t x_max,
+                          const IVEC *piv);
+static void kernelSlerp(uint32_t *ps, int32_t x_min, int32_t x_max,
+                        const IVEC *piv);
+static void kernelSlerpFast(uint32_t *ps, int32_t x_min, int32_t x_max,
+                            const IVEC *piv);
+static void kernelDouble(uint32_t *ps, int32_t x_min, int32_t x_max,
+                         const IVEC *piv);
+static void kernelDoubleFast(uint32_t *ps, int32_t x_min, int32_t x_max,
+                             const IVEC *piv);
+
+static EDGE_ENTRY *edge_table_slot(int32_t i1, int32_t i2);
+static void edge_table_range(EDGE_ENTRY *pe);
+static void edge_table_sample(EDGE_ENTRY *pe);
+static void edge_table_build(int sample);
+static void edge_table_free(void);
+
 static void renderSpan(const VERTEX *v1, const VERTEX *v2);
 static void renderPair(
     const VERTEX * va1,
     const VERTEX * va2,
     const VERTEX * vb1,
-    const VERTEX * vb2);
-static void renderTri(
+    const VERTEX * vb2,
+    int32_t band_lo,
+    int32_t band_hi);
+static void renderPairPlane(
+    const VERTEX * va1,
+    const VERTEX * va2,
+    const VERTEX * vb1,
+    const VERTEX * vb2,
+    const PLANE  * pp,
+    int32_t band_lo,
+    int32_t band_hi);
+static int isSmallTri(
     const VERTEX * v1,
     const VERTEX * v2,
     const VERTEX * v3);
+static void renderSmallTri(
+    const VERTEX * v1,
+    const VERTEX * v2,
+    const VERTEX * v3,
+    int32_t band_lo,
+    int32_t band_hi);
+static void renderTri(
+    const VERTEX * v1,
+    const VERTEX * v2,
+    const VERTEX * v3,
+    int32_t band_lo,
+    int32_t band_hi);
+
+static double clockTime(clockid_t id);
+static int32_t tasks_scan(TASK *pOut);
+static void tasks_build(void);
+static int worker_take(WORKER *pw, TASK *pt);
+static void *worker_run(void *pArg);
+static void renderTasks(void);
+
+static size_t pixelOffset(int32_t x, int32_t y);
+static uint32_t *pixelPtr(int32_t x, int32_t y);
+static int32_t pixelRun(int32_t x);
+static size_t bufLen(void);
+static void allocBuf(void);
+static int initBufMaskFile(const char *pMaskPath);
 
 static void initBufMask(const char *pMaskPath);
 static void initBufDim(int32_t w, int32_t h);
+static void checkDim(int32_t w, int32_t h);
+static void maskDim(const char *pMaskPath);
+
+static LILAC_MESH *loadMesh(const char *pPath);
+static void keys_check(void);
+static void framePoint(LILAC_MESH_POINT *pp, int32_t i, int32_t f);
+static char *framePath(const char *pPattern, int32_t f);
+static void convertFrame(int32_t f);
+static void renderFrame(int32_t f);
+static void writeImage(const char *pPath, const uint32_t *pb);
+static void *writer_run(void *pArg);
+static void writer_start(char *pPath);
+static void writer_finish(void);
+static void dryRun(void);
+static void reportMemory(void);
 
 /*
  * Stop on an error.
@@ -587,6 +1166,10 @@ static uint32_t vertexColor(const VERTEX *pv) {
     /* Compute result */
     result = UINT32_C(0xff000000) | (gi << 16) | (gi << 8) | gi;
     
+  } else if ((m_inter == INTER_VECTOR) && (m_venc == VENC_OCTA)) {
+    /* The hemi-octahedral encoding is only computed in one place */
+    result = vectorColor(pv->vx, pv->vy, pv->vz);
+    
   } else if (m_inter == INTER_VECTOR) {
     /* Get the RGB values in floating-point space */
     rf = (float) floor((((pv->vx + 1.0f) / 2.0f) * 254.0f) + 1.0f);
@@ -639,106 +1222,402 @@ static uint32_t vertexColor(const VERTEX *pv) {
 }
 
 /*
- * Convert a lilac mesh point into a vertex that can be rendered.
- * 
- * The m_vmode state variable must be set and the graphics buffer must
- * be allocated.  This is necessary so the mesh points can be converted
- * in the appropriate way.
+ * Compare a rendered color against the color computed by the exact
+ * interpolation path and update the interpolation check state.
  * 
  * Parameters:
  * 
- *   pv - the vertex to store the converted results in
+ *   c - the packed ARGB color that was rendered
  * 
- *   pp - the lilac mesh point to convert
+ *   ce - the packed ARGB color computed by the exact path
  */
-static void convertVertex(VERTEX *pv, const LILAC_MESH_POINT *pp) {
-  
-  double ad = 0.0;
-  double aa = 0.0;
+static void checkColor(uint32_t c, uint32_t ce) {
   
-  /* Check state */
-  if (pBuf == NULL) {
-    raiseErr(__LINE__);
+  int i = 0;
+  int d = 0;
+  int differ = 0;
+  
+  /* Compare the red, green, and blue channels */
+  for(i = 0; i < 3; i++) {
+    d = ((int) ((c  >> (16 - (i * 8))) & 0xff)) -
+        ((int) ((ce >> (16 - (i * 8))) & 0xff));
+    if (d < 0) {
+      d = -d;
+    }
+    
+    if (d > 0) {
+      differ = 1;
+    }
+    if (d > m_check_max[i]) {
+      m_check_max[i] = d;
+    }
   }
   
-  /* Check parameters */
-  if ((pv == NULL) || (pp == NULL)) {
-    raiseErr(__LINE__);
+  /* Update statistics */
+  if (m_check_count < INT32_MAX) {
+    m_check_count++;
   }
+  if (differ && (m_check_diff < INT32_MAX)) {
+    m_check_diff++;
+  }
+}
+
+/*
+ * Compare the rendered frame in the pixel buffer against the exact
+ * reference frame in pRef and update the interpolation check state.
+ * 
+ * Only pixels that were rendered in either frame are compared, so
+ * masked pixels, unwritten pixels, and the padding of the tiled layout
+ * are skipped.
+ */
+static void checkFrame(void) {
   
-  /* Clear output vertex */
-  memset(pv, 0, sizeof(VERTEX));
-  
-  /* X and Y are first converted into floating point [0.0, 1.0] range */
-  pv->x = ((double) pp->x) / ((double) LILAC_MESH_MAX_C);
-  pv->y = ((double) pp->y) / ((double) LILAC_MESH_MAX_C);
-  
-  /* Y coordinate in lilac mesh has Y axis pointing upwards, while
-   * graphics buffer has Y axis pointing downwards, so invert Y */
-  pv->y = 1.0 - pv->y;
-  
-  /* Now multiply both coordinates by one less than width and height
-   * respectively to get coordinates in scale of image */
-  pv->x *= ((double) (m_w - 1));
-  pv->y *= ((double) (m_h - 1));
-  
-  /* Floor coordinates to integer and add 0.5 so they are right in the
-   * center of pixels */
-  pv->x = floor(pv->x) + 0.5;
-  pv->y = floor(pv->y) + 0.5;
-  
-  /* Get normalized normd and norma into ad and aa */
-  ad = ((double) pp->normd) / ((double) LILAC_MESH_MAX_C);
-  aa = ((double) pp->norma) / ((double) LILAC_MESH_MAX_C);
-  
-  /* Convert aa into radians */
-  aa = aa * 2.0 * M_PI;
-  
-  /* Compute the vx and vy vectors in a 2D circle using the lilac normal
-   * information */
-  pv->vx = (float) (ad * cos(aa));
-  pv->vy = (float) (ad * sin(aa));
+  size_t i = 0;
+  uint32_t c = 0;
+  uint32_t ce = 0;
   
-  /* Convert the normal depending on vector conversion mode */
-  if (m_vmode == VMODE_X) {
-    /* Just use the vx vector */
-    pv->v = pv->vx;
-    
-  } else if (m_vmode == VMODE_Y) {
-    /* Just use the vy vector */
-    pv->v = pv->vy;
-    
-  } else if (m_vmode == VMODE_3D) {
-    /* Compute vz so as to make the vector a unit vector */
-    pv->vz = 1.0f - (pv->vx * pv->vx) - (pv->vy * pv->vy);
-    if (!(pv->vz >= 0.0f)) {
-      pv->vz = 0.0f;
-    }
-    pv->vz = sqrt(pv->vz);
-    
-  } else {
-    /* m_vmode is not set */
+  /* Check state */
+  if ((pBuf == NULL) || (pRef == NULL)) {
     raiseErr(__LINE__);
   }
   
-  /* Check that the converted vertex is valid */
-  checkVertex(pv);
+  for(i = 0; i < m_buf_len; i++) {
+    c = pBuf[i];
+    ce = pRef[i];
+    if (((c != 0) && (c != UINT32_C(0xff000000))) ||
+        ((ce != 0) && (ce != UINT32_C(0xff000000)))) {
+      checkColor(c, ce);
+    }
+  }
 }
 
 /*
- * Initialize an interpolation structure.
+ * Compute a packed ARGB color from an interpolated scalar value.
  * 
- * Pass the vertices that are being interpolated.  v1 is the vertex
- * state at t=0 and v2 is the vertex state at t=1.  Both pointers may
- * indicate the same structure.
+ * The value is rounded to single precision and clamped to [-1.0, 1.0]
+ * in the same way as ivec_compute(), and then encoded with exactly the
+ * same arithmetic as vertexColor() uses in INTER_SCALAR mode.
  * 
- * Full copies of the two vertices are copied into the structure, so
- * changes to the passed structures after initialization have no effect
- * on the interpolation.
+ * Parameters:
  * 
- * m_inter must be set to determine the interpolation mode.
+ *   v - the interpolated scalar value
  * 
- * There is no need to deinitialize interpolation structures.
+ * Return:
+ * 
+ *   a packed ARGB color in Sophistry format
+ */
+static uint32_t scalarColor(double v) {
+  
+  float f = 0.0f;
+  uint32_t gi = 0;
+  
+  /* Round to float and clamp to [-1.0, 1.0] */
+  f = (float) v;
+  if (!(f >= -1.0f)) {
+    f = -1.0f;
+  } else if (!(f <= 1.0f)) {
+    f = 1.0f;
+  }
+  
+  /* Get the grayscale value, clamped to [1, 255] */
+  f = (float) floor((((f + 1.0f) / 2.0f) * 254.0f) + 1.0f);
+  if (!(f >= 1.0f)) {
+    f = 1.0f;
+  }
+  
+  gi = (uint32_t) f;
+  if (gi > 255) {
+    gi = 255;
+  }
+  
+  /* Compute result */
+  return (UINT32_C(0xff000000) | (gi << 16) | (gi << 8) | gi);
+}
+
+/*
+ * Compute a single encoded channel value in INTER_VECTOR mode.
+ * 
+ * This gives exactly the same result as vertexColor() for each of its
+ * channels.
+ * 
+ * Parameters:
+ * 
+ *   f - the vector component
+ * 
+ * Return:
+ * 
+ *   the channel value in range [1, 255]
+ */
+static uint32_t vectorChannel(float f) {
+  
+  uint32_t i = 0;
+  
+  /* Clamp before converting, so that converting truncates values that
+   * are at least one, which is the same as flooring them */
+  f = (((f + 1.0f) / 2.0f) * 254.0f) + 1.0f;
+  if (!(f >= 1.0f)) {
+    f = 1.0f;
+  }
+  
+  i = (uint32_t) f;
+  if (i > 255) {
+    i = 255;
+  }
+  
+  return i;
+}
+
+/*
+ * Compute a packed ARGB color from an interpolated unit vector.
+ * 
+ * This is the INTER_VECTOR equivalent of vertexColor() used by the
+ * render kernels.  It performs no validation.
+ * 
+ * Parameters:
+ * 
+ *   vx - the X component of the vector
+ * 
+ *   vy - the Y component of the vector
+ * 
+ *   vz - the Z component of the vector
+ * 
+ * Return:
+ * 
+ *   a packed ARGB color in Sophistry format
+ */
+static uint32_t vectorColor(float vx, float vy, float vz) {
+  
+  float s = 0.0f;
+  
+  /* Hemi-octahedral encoding projects the vector onto the octahedron
+   * |x| + |y| + z = 1 and rotates the projected X and Y by 45 degrees,
+   * which maps the hemisphere onto the full square */
+  if (m_venc == VENC_OCTA) {
+    if (!(vz >= 0.0f)) {
+      vz = 0.0f;
+    }
+    s = ((float) fabs(vx)) + ((float) fabs(vy)) + vz;
+    if (!(s > 0.0f)) {
+      raiseErr(__LINE__);
+    }
+    vx /= s;
+    vy /= s;
+    
+    return (UINT32_C(0xff000000) |
+              (octaChannel(vx + vy) << 16) |
+              (octaChannel(vx - vy) <<  8));
+  }
+  
+  return (UINT32_C(0xff000000) |
+            (vectorChannel(vx) << 16) |
+            (vectorChannel(vy) <<  8) |
+             vectorChannel(vz));
+}
+
+/*
+ * Encode a hemi-octahedral coordinate in range [-1.0, 1.0] into a color
+ * channel value in range [1, 255].
+ * 
+ * Unlike vectorChannel(), this rounds to the nearest channel value, so
+ * that decoding with (i - 128) / 127.0 has at most half a step of
+ * error.
+ * 
+ * Parameters:
+ * 
+ *   f - the coordinate
+ * 
+ * Return:
+ * 
+ *   the channel value
+ */
+static uint32_t octaChannel(float f) {
+  
+  int32_t i = 0;
+  
+  /* Clamp before converting, as in vectorChannel() */
+  f = (f * 127.0f) + 128.5f;
+  if (!(f >= 1.0f)) {
+    f = 1.0f;
+  }
+  
+  i = (int32_t) f;
+  if (i > 255) {
+    i = 255;
+  }
+  
+  return (uint32_t) i;
+}
+
+#ifdef LILACME2PNG_DEBUG
+/*
+ * Assert that an interpolated pixel vector is finite.
+ * 
+ * Only compiled in debug builds.  Use through the CHECK_PIXEL() macro.
+ * 
+ * Parameters:
+ * 
+ *   vx - the X component of the vector
+ * 
+ *   vy - the Y component of the vector
+ * 
+ *   vz - the Z component of the vector
+ */
+static void checkPixel(float vx, float vy, float vz) {
+  if (!(isfinite(vx) && isfinite(vy) && isfinite(vz))) {
+    fprintf(stderr, "%s: Numeric problem!\n", pModule);
+    raiseErr(__LINE__);
+  }
+}
+#endif
+
+/*
+ * Convert a lilac mesh point into a vertex that can be rendered.
+ * 
+ * The m_vmode state variable and the output image dimensions must be
+ * set.  This is necessary so the mesh points can be converted in the
+ * appropriate way.
+ * 
+ * Parameters:
+ * 
+ *   pv - the vertex to store the converted results in
+ * 
+ *   pp - the lilac mesh point to convert
+ */
+static void convertVertex(VERTEX *pv, const LILAC_MESH_POINT *pp) {
+  
+  double ad = 0.0;
+  double aa = 0.0;
+  
+  /* Check state */
+  if ((m_w < 1) || (m_h < 1)) {
+    raiseErr(__LINE__);
+  }
+  
+  /* Check parameters */
+  if ((pv == NULL) || (pp == NULL)) {
+    raiseErr(__LINE__);
+  }
+  
+  /* Clear output vertex */
+  memset(pv, 0, sizeof(VERTEX));
+  
+  /* X and Y are first converted into floating point [0.0, 1.0] range */
+  pv->x = ((double) pp->x) / ((double) LILAC_MESH_MAX_C);
+  pv->y = ((double) pp->y) / ((double) LILAC_MESH_MAX_C);
+  
+  /* Y coordinate in lilac mesh has Y axis pointing upwards, while
+   * graphics buffer has Y axis pointing downwards, so invert Y */
+  pv->y = 1.0 - pv->y;
+  
+  /* Now multiply both coordinates by one less than width and height
+   * respectively to get coordinates in scale of image */
+  pv->x *= ((double) (m_w - 1));
+  pv->y *= ((double) (m_h - 1));
+  
+  /* Floor coordinates to integer and add 0.5 so they are right in the
+   * center of pixels */
+  pv->x = floor(pv->x) + 0.5;
+  pv->y = floor(pv->y) + 0.5;
+  
+  /* Get normalized normd and norma into ad and aa */
+  ad = ((double) pp->normd) / ((double) LILAC_MESH_MAX_C);
+  aa = ((double) pp->norma) / ((double) LILAC_MESH_MAX_C);
+  
+  /* Convert aa into radians */
+  aa = aa * 2.0 * M_PI;
+  
+  /* Compute the vx and vy vectors in a 2D circle using the lilac normal
+   * information */
+  pv->vx = (float) (ad * cos(aa));
+  pv->vy = (float) (ad * sin(aa));
+  
+  /* Convert the normal depending on vector conversion mode */
+  if (m_vmode == VMODE_X) {
+    /* Just use the vx vector */
+    pv->v = pv->vx;
+    
+  } else if (m_vmode == VMODE_Y) {
+    /* Just use the vy vector */
+    pv->v = pv->vy;
+    
+  } else if (m_vmode == VMODE_3D) {
+    /* Compute vz so as to make the vector a unit vector */
+    pv->vz = 1.0f - (pv->vx * pv->vx) - (pv->vy * pv->vy);
+    if (!(pv->vz >= 0.0f)) {
+      pv->vz = 0.0f;
+    }
+    pv->vz = sqrt(pv->vz);
+    
+  } else {
+    /* m_vmode is not set */
+    raiseErr(__LINE__);
+  }
+  
+  /* Check that the converted vertex is valid; this is the full
+   * validation that allows the render kernels to skip all per-pixel
+   * checks */
+  checkVertex(pv);
+  
+  if (!((pv->x >= 0.0) && (pv->x <= ((double) m_w)) &&
+        (pv->y >= 0.0) && (pv->y <= ((double) m_h)))) {
+    raiseErr(__LINE__);
+  }
+  
+  if (!((pv->v  >= -1.0f) && (pv->v  <= 1.0f) &&
+        (pv->vx >= -1.0f) && (pv->vx <= 1.0f) &&
+        (pv->vy >= -1.0f) && (pv->vy <= 1.0f) &&
+        (pv->vz >=  0.0f) && (pv->vz <= 1.0f))) {
+    raiseErr(__LINE__);
+  }
+}
+
+/*
+ * Compute an approximation of the sine function in single precision.
+ * 
+ * x must be in range [0, PI].  The value is reflected into the range
+ * [0, PI/2] and then evaluated with the Taylor series of sine truncated
+ * after the x^11 term, which has an error below 6.0e-8 across the whole
+ * reflected range, so the result is as accurate as single precision
+ * allows while avoiding any call into the math library.
+ * 
+ * Parameters:
+ * 
+ *   x - the angle in radians
+ * 
+ * Return:
+ * 
+ *   the approximated sine of the angle
+ */
+static float fastSin(float x) {
+  
+  float x2 = 0.0f;
+  
+  /* Reflect into [0, PI/2] since sin(x) = sin(PI - x) */
+  if (x > ((float) M_PI_2)) {
+    x = ((float) M_PI) - x;
+  }
+  
+  /* Evaluate the odd polynomial with Horner's method in x^2 */
+  x2 = x * x;
+  return x * (1.0f + x2 * (-1.6666667e-1f + x2 * (8.3333333e-3f
+            + x2 * (-1.9841270e-4f + x2 * (2.7557319e-6f
+            + x2 * (-2.5052108e-8f))))));
+}
+
+/*
+ * Initialize an interpolation structure.
+ * 
+ * Pass the vertices that are being interpolated.  v1 is the vertex
+ * state at t=0 and v2 is the vertex state at t=1.  Both pointers may
+ * indicate the same structure.
+ * 
+ * Full copies of the two vertices are copied into the structure, so
+ * changes to the passed structures after initialization have no effect
+ * on the interpolation.
+ * 
+ * m_inter must be set to determine the interpolation mode.
+ * 
+ * There is no need to deinitialize interpolation structures.
  * 
  * Parameters:
  * 
@@ -747,6 +1626,7 @@ static void convertVertex(VERTEX *pv, const LILAC_MESH_POINT *pp) {
 static void ivec_init(IVEC *piv, const VERTEX *v1, const VERTEX *v2) {
   
   double angle = 0.0;
+  double dot = 0.0;
   
   /* Check parameters */
   if (piv == NULL) {
@@ -786,6 +1666,7 @@ static void ivec_init(IVEC *piv, const VERTEX *v1, const VERTEX *v2) {
       angle = 1.0;
     }
     
+    dot = angle;
     angle = acos(angle);
     if (!isfinite(angle)) {
       fprintf(stderr, "%s: Numeric problem!\n", pModule);
@@ -805,6 +1686,15 @@ static void ivec_init(IVEC *piv, const VERTEX *v1, const VERTEX *v2) {
         raiseErr(__LINE__);
       }
       
+      /* Precompute single-precision values for the fast path */
+      if (m_slerp == SLERP_FAST) {
+        piv->fast     = 1;
+        piv->angle_f  = (float) angle;
+        piv->rdenom_f = (float) (1.0 / piv->denom);
+        piv->rdenom   = 1.0 / piv->denom;
+        piv->cot      = dot * piv->rdenom;
+      }
+      
     } else if (angle < MIN_SLERP_ANGLE) {
       /* Angle is close to zero, so use linear interpolation because
        * slerp approaches linear interpolation near zero and this way we
@@ -815,6 +1705,9 @@ static void ivec_init(IVEC *piv, const VERTEX *v1, const VERTEX *v2) {
       /* Angle is close to 180 degrees, so use double slerp
        * interpolation */
       piv->mode = IMODE_DOUBLE;
+      if (m_slerp == SLERP_FAST) {
+        piv->fast = 1;
+      }
       
     } else {
       raiseErr(__LINE__);
@@ -847,6 +1740,8 @@ static void ivec_compute(VERTEX *pr, const IVEC *piv, double t) {
   
   float f = 0.0f;
   float tf = 0.0f;
+  float af = 0.0f;
+  float bf = 0.0f;
   double d = 0.0;
   double a = 0.0;
   double b = 0.0;
@@ -913,6 +1808,49 @@ static void ivec_compute(VERTEX *pr, const IVEC *piv, double t) {
       raiseErr(__LINE__);
     }
     
+  } else if ((piv->mode == IMODE_SLERP) && piv->fast) {
+    /* Regular slerp, but with the weights computed in single precision
+     * by the polynomial approximation */
+    af = fastSin((1.0f - tf) * piv->angle_f) * piv->rdenom_f;
+    bf = fastSin(        tf  * piv->angle_f) * piv->rdenom_f;
+    
+    pr->vx = (af * (piv->v1).vx) + (bf * (piv->v2).vx);
+    pr->vy = (af * (piv->v1).vy) + (bf * (piv->v2).vy);
+    pr->vz = (af * (piv->v1).vz) + (bf * (piv->v2).vz);
+    
+    if (!(isfinite(pr->vx) && isfinite(pr->vy) && isfinite(pr->vz))) {
+      fprintf(stderr, "%s: Numeric problem!\n", pModule);
+      raiseErr(__LINE__);
+    }
+    
+  } else if ((piv->mode == IMODE_DOUBLE) && piv->fast) {
+    /* Double slerp through the vector (0, 0, 1) as described for the
+     * exact path below, but with the weights computed in single
+     * precision by the polynomial approximation */
+    if (tf < 0.5f) {
+      tf *= 2.0f;
+      af = fastSin((1.0f - tf) * ((float) M_PI_2));
+      bf = fastSin(        tf  * ((float) M_PI_2));
+      
+      pr->vx = af * (piv->v1).vx;
+      pr->vy = af * (piv->v1).vy;
+      pr->vz = (af * (piv->v1).vz) + bf;
+      
+    } else {
+      tf = (tf - 0.5f) * 2.0f;
+      af = fastSin((1.0f - tf) * ((float) M_PI_2));
+      bf = fastSin(        tf  * ((float) M_PI_2));
+      
+      pr->vx = bf * (piv->v2).vx;
+      pr->vy = bf * (piv->v2).vy;
+      pr->vz = af + (bf * (piv->v2).vz);
+    }
+    
+    if (!(isfinite(pr->vx) && isfinite(pr->vy) && isfinite(pr->vz))) {
+      fprintf(stderr, "%s: Numeric problem!\n", pModule);
+      raiseErr(__LINE__);
+    }
+    
   } else if (piv->mode == IMODE_SLERP) { 
     /* Angle between vectors is neither close to zero nor close to 180
      * degrees, so we can use regular slerp */
@@ -1234,495 +2172,3084 @@ static void ivec_atY(VERTEX *pr, const IVEC *piv, double y) {
 }
 
 /*
- * Render an interpolated span within a scanline.
+ * Initialize an attribute plane from the three vertices of a triangle.
  * 
- * v1 and v2 are the start and end vertices on the scanline.  They may
- * be in any order, and they may be the same structure.  However, they
- * must have exactly the same Y coordinate.
+ * The plane is computed from the X and Y coordinates and the scalar
+ * value v of each vertex.  m_inter must be INTER_SCALAR.
  * 
- * Clipping will be performed according to the dimensions of the pixel
- * buffer.
+ * If the three vertices are colinear in the graphics buffer space, for
+ * example because snapping to pixel centers collapsed a thin triangle,
+ * then there is no unique plane.  In this case, zero is returned and
+ * the caller should fall back to the general rendering path.
  * 
  * Parameters:
  * 
+ *   pp - the plane to initialize
+ * 
  *   v1 - the first vertex
  * 
  *   v2 - the second vertex
+ * 
+ *   v3 - the third vertex
+ * 
+ * Return:
+ * 
+ *   non-zero if successful, zero if the vertices are colinear
  */
-static void renderSpan(const VERTEX *v1, const VERTEX *v2) {
+static int plane_init(
+    PLANE        * pp,
+    const VERTEX * v1,
+    const VERTEX * v2,
+    const VERTEX * v3) {
   
-  const VERTEX *tv = NULL;
-  IVEC iv;
-  VERTEX vx;
+  double ax = 0.0;
+  double ay = 0.0;
+  double av = 0.0;
+  double bx = 0.0;
+  double by = 0.0;
+  double bv = 0.0;
+  double det = 0.0;
   
-  int32_t x     = 0;
-  int32_t x_min = 0;
-  int32_t x_max = 0;
-  int32_t y = 0;
+  /* Check parameters */
+  if (pp == NULL) {
+    raiseErr(__LINE__);
+  }
+  checkVertex(v1);
+  checkVertex(v2);
+  checkVertex(v3);
+  if (m_inter != INTER_SCALAR) {
+    raiseErr(__LINE__);
+  }
   
-  uint32_t *ps = NULL;
+  /* Reset structure */
+  memset(pp, 0, sizeof(PLANE));
+  
+  /* Get the edge vectors from the first vertex */
+  ax = v2->x - v1->x;
+  ay = v2->y - v1->y;
+  av = ((double) v2->v) - ((double) v1->v);
+  
+  bx = v3->x - v1->x;
+  by = v3->y - v1->y;
+  bv = ((double) v3->v) - ((double) v1->v);
+  
+  /* The vertex coordinates are all on pixel centers, so the determinant
+   * is either exactly zero or at least one */
+  det = (ax * by) - (bx * ay);
+  if (!(fabs(det) >= 0.5)) {
+    return 0;
+  }
   
-  /* Initialize structures */
-  memset(&iv, 0, sizeof(IVEC));
-  memset(&vx, 0, sizeof(VERTEX));
+  /* Solve for the gradient and the constant term */
+  pp->dx = ((av * by) - (bv * ay)) / det;
+  pp->dy = ((ax * bv) - (bx * av)) / det;
+  pp->c  = ((double) v1->v) - (pp->dx * v1->x) - (pp->dy * v1->y);
   
-  /* Check state */
-  if (pBuf == NULL) {
+  if (!(isfinite(pp->dx) && isfinite(pp->dy) && isfinite(pp->c))) {
+    fprintf(stderr, "%s: Numeric problem!\n", pModule);
     raiseErr(__LINE__);
   }
   
+  return 1;
+}
+
+/*
+ * Determine the range of pixels covered by an interval along the X or
+ * Y axis, according to the top-left rule.
+ * 
+ * lo and hi are the endpoints of the interval in the graphics buffer
+ * space, with lo less than or equal to hi.  A pixel is covered if its
+ * center is within the half-open interval [lo, hi).  The covered range
+ * is then clipped to [0, limit).
+ * 
+ * If any pixels remain after clipping, the first and last covered pixel
+ * indices are written to *pFirst and *pLast and a non-zero value is
+ * returned.  Otherwise, zero is returned.
+ * 
+ * Parameters:
+ * 
+ *   lo - the lower endpoint of the interval
+ * 
+ *   hi - the upper endpoint of the interval
+ * 
+ *   limit - the number of pixels along the axis
+ * 
+ *   pFirst - variable to receive the first covered pixel
+ * 
+ *   pLast - variable to receive the last covered pixel
+ * 
+ * Return:
+ * 
+ *   non-zero if at least one pixel covered, zero if none
+ */
+static int pixelRange(
+    double    lo,
+    double    hi,
+    int32_t   limit,
+    int32_t * pFirst,
+    int32_t * pLast) {
+  
+  int32_t first = 0;
+  int32_t last = 0;
+  
   /* Check parameters */
-  checkVertex(v1);
-  checkVertex(v2);
-  if (v1->y != v2->y) {
+  if ((pFirst == NULL) || (pLast == NULL)) {
     raiseErr(__LINE__);
   }
   
-  /* Swap parameters if necessary so that X coordinate of v1 is less
-   * than or equal to X coordinate of v2 */
-  if (!(v1->x <= v2->x)) {
-    tv = v1;
-    v1 = v2;
-    v2 = tv;
-  }
-  
-  /* Get the integer Y and X extent coordinates */
-  y     = ifloor(v1->y);
-  x_min = ifloor(v1->x);
-  x_max = ifloor(v2->x);
+  /* Get integer floors of the extent */
+  first = ifloor(lo);
+  last  = ifloor(hi);
   
-  /* If distance from x_min to actual X coordinate is greater than 0.5,
-   * then increment x_min by one; center of pixel is included in
-   * rendered range because of top-left rule */
-  if (v1->x - ((double) x_min) > 0.5) {
-    x_min = iinc(x_min);
+  /* If distance from first to actual lower bound is greater than 0.5
+   * then increment first; we include the exact pixel center here due to
+   * the top-left rule */
+  if (lo - ((double) first) > 0.5) {
+    first = iinc(first);
   }
   
-  /* If distance from x_max to actual X coordinate is less than or equal
-   * to 0.5, then decrement x_max by one; center of pixel is excluded
-   * from rendered range because of top-left rule */
-  if (v2->x - ((double) x_max) <= 0.5) {
-    x_max = idec(x_max);
+  /* If distance from last to actual upper bound is less than or equal
+   * to 0.5 then decrement last; we exclude the exact pixel center here
+   * due to the top-left rule */
+  if (hi - ((double) last) <= 0.5) {
+    last = idec(last);
   }
   
-  /* If x_min and x_max have crossed, nothing to render */
-  if (x_max < x_min) {
-    return;
+  /* If integer extents have crossed, nothing to render */
+  if (last < first) {
+    return 0;
   }
   
   /* Perform clipping */
-  if ((y < 0) || (y >= m_h)) {
-    return;
-  }
-  if ((x_max < 0) || (x_min >= m_w)) {
-    return;
+  if ((last < 0) || (first >= limit)) {
+    return 0;
   }
   
-  /* Clamp x_min and x_max to graphics buffer */
-  if (x_min < 0) {
-    x_min = 0;
+  /* Clamp range to graphics buffer */
+  if (first < 0) {
+    first = 0;
   }
-  if (x_max >= m_w) {
-    x_max = m_w - 1;
+  if (last >= limit) {
+    last = limit - 1;
   }
   
-  /* Initialize interpolation structure */
-  ivec_init(&iv, v1, v2);
-  
-  /* Get pointer to first pixel in graphics buffer */
-  ps = &(pBuf[(y * m_w) + x_min]);
-  
-  /* Iterate through all pixels and render them */
-  for(x = x_min; x <= x_max; x = iinc(x)) {
-    
-    /* Skip this pixel if it is masked out */
-    if (*ps == UINT32_C(0xff000000)) {
-      ps++;
-      continue;
-    }
-    
-    /* Interpolate this pixel */
-    ivec_atX(&vx, &iv, ((double) x) + 0.5);
-    
-    /* Store the converted color and advance buffer pointer */
-    *ps = vertexColor(&vx);
-    ps++;
-  }
+  /* Return the range */
+  *pFirst = first;
+  *pLast  = last;
+  return 1;
 }
 
 /*
- * Render the scanlines filling an area between a pair of edges.
+ * Compute the X coordinate where an edge crosses a given scanline.
  * 
- * va1 and va2 define the endpoints of the first edge, while vb1 and vb2
- * define the endpoints of the second edge.  All pointers may indicate
- * the same structure.
+ * v1 and v2 are the endpoints of the edge, with the Y coordinate of v1
+ * less than or equal to the Y coordinate of v2.
+ * 
+ * Vertices and scanlines are always on pixel centers, so the crossing
+ * is computed as a single quotient of integers added to the X
+ * coordinate of v1.  This is exact whenever the crossing falls exactly
+ * on a pixel center, and otherwise the crossing is at least 1/16384 of
+ * a pixel away from any pixel center, which is far more than the
+ * rounding error.  All coverage decisions made with this function are
+ * therefore exact, which lets renderSmallTri() make exactly the same
+ * decisions with integer edge functions.
  * 
  * Parameters:
  * 
- *   va1 - the first vertex of the first edge
+ *   v1 - the first vertex of the edge
  * 
- *   va2 - the second vertex of the first edge
+ *   v2 - the second vertex of the edge
  * 
- *   vb1 - the first vertex of the second edge
+ *   y - the Y coordinate of the scanline
  * 
- *   vb2 - the second vertex of the second edge
+ * Return:
+ * 
+ *   the X coordinate of the edge on the scanline
  */
-static void renderPair(
-    const VERTEX * va1,
-    const VERTEX * va2,
-    const VERTEX * vb1,
-    const VERTEX * vb2) {
-  
-  const VERTEX *tv = NULL;
+static double edgeX(const VERTEX *v1, const VERTEX *v2, double y) {
   
-  double ys    = 0.0;
-  double min_y = 0.0;
-  double max_y = 0.0;
+  /* If the edge is horizontal, just use the X coordinate of v1 */
+  if (!(v2->y - v1->y >= IVEC_THETA)) {
+    return v1->x;
+  }
   
-  int32_t y        = 0;
-  int32_t start_y  = 0;
-  int32_t finish_y = 0;
+  /* Clamp Y to the extent of the edge */
+  if (!(y >= v1->y)) {
+    y = v1->y;
+  } else if (!(y <= v2->y)) {
+    y = v2->y;
+  }
   
-  IVEC e1;
-  IVEC e2;
-  VERTEX ve1;
-  VERTEX ve2;
+  /* Compute the crossing */
+  return (v1->x + (((v2->x - v1->x) * (y - v1->y)) / (v2->y - v1->y)));
+}
+
+/*
+ * Find the slot of an edge in the shared edge table.
+ * 
+ * i1 and i2 are the indices of the points at either end of the edge, in
+ * any order.  The return value is the slot that holds the edge, or else
+ * the unused slot where the edge would be inserted, which has an i1
+ * field of -1.  The table must have been allocated.
+ * 
+ * Parameters:
+ * 
+ *   i1 - the index of one point of the edge
+ * 
+ *   i2 - the index of the other point of the edge
+ * 
+ * Return:
+ * 
+ *   the slot of the edge
+ */
+static EDGE_ENTRY *edge_table_slot(int32_t i1, int32_t i2) {
   
-  /* Initialize structures */
-  memset( &e1, 0, sizeof(IVEC));
-  memset( &e2, 0, sizeof(IVEC));
-  memset(&ve1, 0, sizeof(VERTEX));
-  memset(&ve2, 0, sizeof(VERTEX));
+  int32_t t = 0;
+  uint32_t h = 0;
+  EDGE_ENTRY *pe = NULL;
   
-  /* Check state */
-  if (pBuf == NULL) {
+  /* Check state and parameters */
+  if ((pEdges == NULL) || (i1 < 0) || (i2 < 0) || (i1 == i2)) {
     raiseErr(__LINE__);
   }
   
-  /* Check parameters */
-  checkVertex(va1);
-  checkVertex(va2);
-  checkVertex(vb1);
-  checkVertex(vb2);
-  
-  /* Within each edge, flip vertices if necessary so that first vertex Y
-   * is less than or equal to second vertex Y */
-  if (!(va1->y <= va2->y)) {
-    tv = va1;
-    va1 = va2;
-    va2 = tv;
+  /* Put the indices in canonical order */
+  if (i1 > i2) {
+    t = i1;
+    i1 = i2;
+    i2 = t;
   }
-  if (!(vb1->y <= vb2->y)) {
-    tv = vb1;
-    vb1 = vb2;
-    vb2 = tv;
+  
+  /* Hash the indices and probe linearly; the table is never more than
+   * half full, so there is always an unused slot */
+  h = (((uint32_t) i1) * UINT32_C(2654435761)) ^
+        (((uint32_t) i2) * UINT32_C(40503));
+  for(h &= (uint32_t) (m_edge_cap - 1);
+      ;
+      h = (h + 1) & ((uint32_t) (m_edge_cap - 1))) {
+    pe = &(pEdges[h]);
+    if ((pe->i1 < 0) || ((pe->i1 == i1) && (pe->i2 == i2))) {
+      break;
+    }
   }
   
-  /* Get the Y extent that is the intersection of the Y extents of the
-   * two edges; if intersection is empty, then nothing to render */
-  min_y = va1->y;
-  max_y = va2->y;
+  return pe;
+}
+
+/*
+ * Compute the clipped scanline range of an edge in the shared edge
+ * table.
+ * 
+ * The entry must have its i1 and i2 fields set.  Its y_first and
+ * y_count fields are set to the scanlines the edge covers, with a
+ * y_count of zero if the edge does not cover any scanline.
+ * 
+ * Parameters:
+ * 
+ *   pe - the edge table entry
+ */
+static void edge_table_range(EDGE_ENTRY *pe) {
   
-  if (!((vb1->y <= max_y) && (vb2->y >= min_y))) {
-    /* Non-overlapping Y extents */
-    return;
+  double y1 = 0.0;
+  double y2 = 0.0;
+  int32_t start_y = 0;
+  int32_t finish_y = 0;
+  
+  /* Check parameter */
+  if ((pe == NULL) || (pe->i1 < 0)) {
+    raiseErr(__LINE__);
   }
   
-  if (vb1->y > min_y) {
-    min_y = vb1->y;
+  /* Get the Y coordinates of the endpoints in order */
+  y1 = pva[pe->i1].y;
+  y2 = pva[pe->i2].y;
+  if (!(y1 <= y2)) {
+    y1 = pva[pe->i2].y;
+    y2 = pva[pe->i1].y;
   }
-  if (vb2->y < max_y) {
-    max_y = vb2->y;
+  
+  /* Get the clipped scanline range */
+  if (pixelRange(y1, y2, m_h, &start_y, &finish_y)) {
+    pe->y_first = start_y;
+    pe->y_count = finish_y - start_y + 1;
+  } else {
+    pe->y_first = 0;
+    pe->y_count = 0;
   }
+}
+
+/*
+ * Compute the scanline samples of an edge in the shared edge table.
+ * 
+ * The entry must have its i1 and i2 fields set and must not have been
+ * sampled yet.  The edge is interpolated in exactly the same way that
+ * renderPair() interpolates its edges, with the endpoint of lesser Y
+ * coordinate first; for horizontal edges, which never cover any
+ * scanlines, the point of lesser index is first.
+ * 
+ * Parameters:
+ * 
+ *   pe - the edge table entry
+ */
+static void edge_table_sample(EDGE_ENTRY *pe) {
   
-  /* Get integer floors of the intersected extent */
-  start_y  = ifloor(min_y);
-  finish_y = ifloor(max_y);
+  const VERTEX *v1 = NULL;
+  const VERTEX *v2 = NULL;
+  int32_t y = 0;
+  int32_t start_y = 0;
+  int32_t finish_y = 0;
+  double ys = 0.0;
+  IVEC iv;
   
-  /* If distance from starting Y to actual minimum Y is greater than 0.5
-   * then increment starting Y; we include the exact pixel center here
-   * due to the top-left rule */
-  if (min_y - ((double) start_y) > 0.5) {
-    start_y = iinc(start_y);
-  }
+  memset(&iv, 0, sizeof(IVEC));
   
-  /* If distance from finish Y to actual maximum Y is less than or equal
-   * to 0.5 then decrement finishing Y; we exclude the exact pixel
-   * center here due to the top-left rule */
-  if (max_y - ((double) finish_y) <= 0.5) {
-    finish_y = idec(finish_y);
+  /* Check parameter */
+  if ((pe == NULL) || (pe->i1 < 0) || (pe->pSamples != NULL)) {
+    raiseErr(__LINE__);
   }
   
-  /* If integer extents have crossed, nothing to render */
-  if (finish_y < start_y) {
-    return;
+  /* Get the endpoints in order of Y */
+  v1 = &(pva[pe->i1]);
+  v2 = &(pva[pe->i2]);
+  if (!(v1->y <= v2->y)) {
+    v1 = &(pva[pe->i2]);
+    v2 = &(pva[pe->i1]);
   }
   
-  /* Perform Y clipping */
-  if ((finish_y < 0) || (start_y >= m_h)) {
+  /* Get the clipped scanline range; if empty, no samples */
+  edge_table_range(pe);
+  if (pe->y_count < 1) {
     return;
   }
-  
-  /* Clamp Y range to graphics buffer */
-  if (start_y < 0) {
-    start_y = 0;
-  }
-  if (finish_y >= m_h) {
-    finish_y = m_h - 1;
+  start_y = pe->y_first;
+  finish_y = pe->y_first + pe->y_count - 1;
+  
+  /* Allocate the samples */
+  pe->pSamples = (VERTEX *) lilac_mesh_mem_alloc(
+                    LILAC_MESH_MEM_VERTEX,
+                    (size_t) pe->y_count, sizeof(VERTEX));
+  if (pe->pSamples == NULL) {
+    fprintf(stderr, "%s: Memory allocation failed!\n", pModule);
+    raiseErr(__LINE__);
   }
   
-  /* Initialize interpolation structures for the two edges */
-  ivec_init(&e1, va1, va2);
-  ivec_init(&e2, vb1, vb2);
-  
-  /* Render each scanline */
-  for(y = start_y; y <= finish_y; y = iinc(y)) {
-    /* Get the scanline Y coordinate, which goes through the center of
-     * the pixel */
+  /* Interpolate each scanline */
+  ivec_init(&iv, v1, v2);
+  for(y = start_y; y <= finish_y; y++) {
     ys = ((double) y) + 0.5;
-    
-    /* Interpolate both edges at ys */
-    ivec_atY(&ve1, &e1, ys);
-    ivec_atY(&ve2, &e2, ys);
-    
-    /* Render the scanline */
-    renderSpan(&ve1, &ve2);
+    ivec_atY(&((pe->pSamples)[y - start_y]), &iv, ys);
+    (pe->pSamples)[y - start_y].x = edgeX(v1, v2, ys);
   }
 }
 
 /*
- * Render a triangle.
+ * Build the shared edge table.
  * 
- * Parameters:
+ * The mesh and the converted vertex array must be initialized, and the
+ * table must not be built yet.
  * 
- *   v1 - the first vertex
+ * The table contains every edge of every triangle that will be rendered
+ * with renderPair(), each sampled once, so that adjacent triangles share
+ * the interpolation of their common edge.  This halves the edge work
+ * and guarantees identical values on both sides of the edge.
+ * Triangles rendered with other paths do not contribute edges.
  * 
- *   v2 - the second vertex
+ * If sample is zero, only the scanline range of each edge is computed,
+ * which is enough to find how much memory the samples would take.
  * 
- *   v3 - the third vertex
+ * Parameters:
+ * 
+ *   sample - non-zero to sample the edges, zero to only find their
+ *   scanline ranges
  */
-static void renderTri(
-    const VERTEX * v1,
-    const VERTEX * v2,
-    const VERTEX * v3) {
-  
-  EDGE et[3];
-  EDGE te;
-  int i = 0;
-  int long_edge = 0;
-  double max_extent = 0.0;
-  double ex = 0.0;
-  
-  /* Initialize structures and arrays */
-  memset( et, 0, 3 * sizeof(EDGE));
-  memset(&te, 0, sizeof(EDGE));
+static void edge_table_build(int sample) {
   
-  /* Check parameters */
-  checkVertex(v1);
-  checkVertex(v2);
-  checkVertex(v3);
+  int32_t i = 0;
+  int32_t k = 0;
+  int32_t cap = 0;
+  const uint16_t *pt = NULL;
+  EDGE_ENTRY *pe = NULL;
   
-  /* Set edges */
-  (et[0]).v1 = v1;
-  (et[0]).v2 = v2;
+  /* Check state */
+  if ((pMesh == NULL) || (pEdges != NULL)) {
+    raiseErr(__LINE__);
+  }
   
-  (et[1]).v1 = v2;
-  (et[1]).v2 = v3;
+  /* Nothing to do if no triangles */
+  if (pMesh->tri_count < 1) {
+    return;
+  }
   
-  (et[2]).v1 = v3;
-  (et[2]).v2 = v1;
+  /* Size the table to a power of two that is at least twice the
+   * maximum number of edges */
+  for(cap = 1; cap < pMesh->tri_count * 6; cap *= 2);
   
-  /* Figure out the longest edge in terms of Y extent */
-  long_edge = 0;
-  max_extent = fabs(((et[0]).v1)->y - ((et[0]).v2)->y);
-  if (!isfinite(max_extent)) {
+  pEdges = (EDGE_ENTRY *) lilac_mesh_mem_alloc(
+                            LILAC_MESH_MEM_VERTEX,
+                            (size_t) cap, sizeof(EDGE_ENTRY));
+  if (pEdges == NULL) {
+    fprintf(stderr, "%s: Memory allocation failed!\n", pModule);
     raiseErr(__LINE__);
   }
+  m_edge_cap = cap;
   
-  for(i = 1; i < 3; i++) {
-    ex = fabs(((et[i]).v1)->y - ((et[i]).v2)->y);
-    if (!isfinite(ex)) {
-      raiseErr(__LINE__);
+  for(i = 0; i < cap; i++) {
+    pEdges[i].i1 = -1;
+    pEdges[i].i2 = -1;
+  }
+  
+  /* Add and sample the edges of each triangle that will be rendered by
+   * renderPair() */
+  for(i = 0; i < pMesh->tri_count; i++) {
+    pt = &((pMesh->pTris)[i * 3]);
+    if (isSmallTri(&(pva[pt[0]]), &(pva[pt[1]]), &(pva[pt[2]]))) {
+      continue;
     }
     
-    if (ex > max_extent) {
-      long_edge = i;
-      max_extent = ex;
+    for(k = 0; k < 3; k++) {
+      pe = edge_table_slot(pt[k], pt[(k + 1) % 3]);
+      if (pe->i1 < 0) {
+        if (pt[k] < pt[(k + 1) % 3]) {
+          pe->i1 = pt[k];
+          pe->i2 = pt[(k + 1) % 3];
+        } else {
+          pe->i1 = pt[(k + 1) % 3];
+          pe->i2 = pt[k];
+        }
+        if (sample) {
+          edge_table_sample(pe);
+        } else {
+          edge_table_range(pe);
+        }
+      }
     }
   }
+}
+
+/*
+ * Release the shared edge table, if it was built.
+ */
+static void edge_table_free(void) {
   
-  /* Make the first edge the long one */
-  if (long_edge > 0) {
-    memcpy(&te, &(et[long_edge]), sizeof(EDGE));
-    memcpy(&(et[long_edge]), &(et[0]), sizeof(EDGE));
-    memcpy(&(et[0]), &te, sizeof(EDGE));
-  }
+  int32_t i = 0;
   
-  /* Render pairs of the long edge with the other two */
-  renderPair((et[0]).v1, (et[0]).v2, (et[1]).v1, (et[1]).v2);
-  renderPair((et[0]).v1, (et[0]).v2, (et[2]).v1, (et[2]).v2);
+  if (pEdges != NULL) {
+    for(i = 0; i < m_edge_cap; i++) {
+      if (pEdges[i].pSamples != NULL) {
+        lilac_mesh_mem_free(pEdges[i].pSamples);
+        pEdges[i].pSamples = NULL;
+      }
+    }
+    lilac_mesh_mem_free(pEdges);
+    pEdges = NULL;
+    m_edge_cap = 0;
+  }
 }
 
 /*
- * Initialize the pixel buffer using a given PNG mask file.
- * 
- * The pixel buffer must not be already initialized.
+ * Render kernels
+ * --------------
  * 
- * Parameters:
+ * Each kernel renders the pixels of one span for one interpolation
+ * mode.  ps points to the pixel in the graphics buffer for x_min, and
+ * the pixels x_min to x_max inclusive on that scanline are rendered,
+ * skipping masked pixels.  piv is the interpolation structure for the
+ * span, initialized by ivec_init() with the first vertex having the
+ * lesser X coordinate.
  * 
- *   pMaskPath - path to the PNG mask file
+ * The kernels produce exactly the same colors as interpolating each
+ * pixel with ivec_atX() and encoding it with vertexColor(), but they
+ * do not validate anything per pixel except in debug builds.
+ */
+
+/*
+ * Compute the interpolation parameter of a span at a given X
+ * coordinate.
+ * 
+ * This uses the same arithmetic as ivec_atX() and ivec_compute(),
+ * including the clamp to [0.0, 1.0].
+ * 
+ * Parameters:
+ * 
+ *   piv - the interpolation structure of the span
+ * 
+ *   x - the X coordinate
+ * 
+ * Return:
+ * 
+ *   the interpolation parameter
+ */
+static double spanT(const IVEC *piv, double x) {
+  
+  double t = 0.0;
+  
+  if ((piv->v2).x - (piv->v1).x >= IVEC_THETA) {
+    t = (x - (piv->v1).x) / ((piv->v2).x - (piv->v1).x);
+  }
+  
+  if (!(t >= 0.0)) {
+    t = 0.0;
+  } else if (!(t <= 1.0)) {
+    t = 1.0;
+  }
+  
+  return t;
+}
+
+/*
+ * Compute how much the interpolation parameter of a span changes from
+ * one pixel to the next.
+ * 
+ * The pixel centers covered by a span lie within the span, so stepping
+ * the result of spanT() by this amount stays in [0.0, 1.0] without any
+ * clamping.
+ * 
+ * Parameters:
+ * 
+ *   piv - the interpolation structure of the span
+ * 
+ * Return:
+ * 
+ *   the change of the interpolation parameter per pixel
+ */
+static double spanStep(const IVEC *piv) {
+  
+  double result = 0.0;
+  
+  if ((piv->v2).x - (piv->v1).x >= IVEC_THETA) {
+    result = 1.0 / ((piv->v2).x - (piv->v1).x);
+  }
+  
+  return result;
+}
+
+/*
+ * Render kernel for any span that interpolates each pixel with
+ * ivec_atX() and encodes it with vertexColor().
+ * 
+ * This is the generic path that the other kernels are specialized from.
+ * It is only used to render the reference frame of the interpolation
+ * check.
+ */
+static void kernelGeneric(uint32_t *ps, int32_t x_min, int32_t x_max,
+                          const IVEC *piv) {
+  
+  int32_t x = 0;
+  VERTEX vx;
+  
+  memset(&vx, 0, sizeof(VERTEX));
+  
+  for(x = x_min; x <= x_max; x++) {
+    if (*ps != UINT32_C(0xff000000)) {
+      ivec_atX(&vx, piv, ((double) x) + 0.5);
+      *ps = vertexColor(&vx);
+    }
+    ps++;
+  }
+}
+
+/*
+ * Render kernel for IMODE_SCALAR spans.
+ * 
+ * Scalar triangles are normally rendered with renderPairPlane(), so
+ * this kernel is only used for triangles that collapsed to a line.
+ */
+static void kernelScalar(uint32_t *ps, int32_t x_min, int32_t x_max,
+                         const IVEC *piv) {
+  
+  int32_t x = 0;
+  float tf = 0.0f;
+  float f = 0.0f;
+  
+  for(x = x_min; x <= x_max; x++) {
+    if (*ps != UINT32_C(0xff000000)) {
+      tf = (float) spanT(piv, ((double) x) + 0.5);
+      f = ((piv->v1).v * (1.0f - tf)) + ((piv->v2).v * tf);
+      CHECK_PIXEL(f, 0.0f, 0.0f);
+      *ps = scalarColor(f);
+    }
+    ps++;
+  }
+}
+
+/*
+ * Render kernel for IMODE_VLINEAR spans.
+ */
+static void kernelVLinear(uint32_t *ps, int32_t x_min, int32_t x_max,
+                          const IVEC *piv) {
+  
+  int32_t x = 0;
+  float tf = 0.0f;
+  float vx = 0.0f;
+  float vy = 0.0f;
+  float vz = 0.0f;
+  
+  for(x = x_min; x <= x_max; x++) {
+    if (*ps != UINT32_C(0xff000000)) {
+      tf = (float) spanT(piv, ((double) x) + 0.5);
+      vx = ((piv->v1).vx * (1.0f - tf)) + ((piv->v2).vx * tf);
+      vy = ((piv->v1).vy * (1.0f - tf)) + ((piv->v2).vy * tf);
+      vz = ((piv->v1).vz * (1.0f - tf)) + ((piv->v2).vz * tf);
+      CHECK_PIXEL(vx, vy, vz);
+      *ps = vectorColor(vx, vy, vz);
+    }
+    ps++;
+  }
+}
+
+/*
+ * Render kernel for IMODE_SLERP spans with exact weights.
+ */
+static void kernelSlerp(uint32_t *ps, int32_t x_min, int32_t x_max,
+                        const IVEC *piv) {
+  
+  int32_t x = 0;
+  double t = 0.0;
+  double a = 0.0;
+  double b = 0.0;
+  float vx = 0.0f;
+  float vy = 0.0f;
+  float vz = 0.0f;
+  
+  for(x = x_min; x <= x_max; x++) {
+    if (*ps != UINT32_C(0xff000000)) {
+      t = spanT(piv, ((double) x) + 0.5);
+      a = sin((1.0 - t) * piv->angle);
+      b = sin(       t  * piv->angle);
+      
+      vx = (float) (((a * ((double) (piv->v1).vx))
+                      + (b * ((double) (piv->v2).vx))) / piv->denom);
+      vy = (float) (((a * ((double) (piv->v1).vy))
+                      + (b * ((double) (piv->v2).vy))) / piv->denom);
+      vz = (float) (((a * ((double) (piv->v1).vz))
+                      + (b * ((double) (piv->v2).vz))) / piv->denom);
+      
+      CHECK_PIXEL(vx, vy, vz);
+      *ps = vectorColor(vx, vy, vz);
+    }
+    ps++;
+  }
+}
+
+/*
+ * Render kernel for IMODE_SLERP spans with fast weights.
+ * 
+ * With p = t * angle, the slerp weights are sin(angle - p) / denom,
+ * which is cos(p) - (cot * sin(p)), and sin(p) / denom.  Since t is
+ * linear in X, p grows by the same step at every pixel, so cos(p) and
+ * sin(p) are rotated by that step with the angle addition formulas
+ * instead of calling sin() at each pixel.  The rotation is in double
+ * precision, so its error stays far below one channel level even on
+ * the widest spans.
+ */
+static void kernelSlerpFast(uint32_t *ps, int32_t x_min, int32_t x_max,
+                            const IVEC *piv) {
+  
+  int32_t x = 0;
+  double p = 0.0;
+  double c = 0.0;
+  double s = 0.0;
+  double cs = 0.0;
+  double ss = 0.0;
+  double cn = 0.0;
+  double a = 0.0;
+  double b = 0.0;
+  float vx = 0.0f;
+  float vy = 0.0f;
+  float vz = 0.0f;
+  
+  p  = spanT(piv, ((double) x_min) + 0.5) * piv->angle;
+  c  = cos(p);
+  s  = sin(p);
+  
+  p  = spanStep(piv) * piv->angle;
+  cs = cos(p);
+  ss = sin(p);
+  
+  for(x = x_min; x <= x_max; x++) {
+    if (*ps != UINT32_C(0xff000000)) {
+      a = c - (piv->cot * s);
+      b = piv->rdenom * s;
+      
+      vx = (float) ((a * ((double) (piv->v1).vx))
+                      + (b * ((double) (piv->v2).vx)));
+      vy = (float) ((a * ((double) (piv->v1).vy))
+                      + (b * ((double) (piv->v2).vy)));
+      vz = (float) ((a * ((double) (piv->v1).vz))
+                      + (b * ((double) (piv->v2).vz)));
+      
+      CHECK_PIXEL(vx, vy, vz);
+      *ps = vectorColor(vx, vy, vz);
+    }
+    
+    cn = (c * cs) - (s * ss);
+    s  = (s * cs) + (c * ss);
+    c  = cn;
+    ps++;
+  }
+}
+
+/*
+ * Render kernel for IMODE_DOUBLE spans with exact weights.
+ */
+static void kernelDouble(uint32_t *ps, int32_t x_min, int32_t x_max,
+                         const IVEC *piv) {
+  
+  int32_t x = 0;
+  double t = 0.0;
+  double a = 0.0;
+  double b = 0.0;
+  float vx = 0.0f;
+  float vy = 0.0f;
+  float vz = 0.0f;
+  
+  for(x = x_min; x <= x_max; x++) {
+    if (*ps != UINT32_C(0xff000000)) {
+      t = spanT(piv, ((double) x) + 0.5);
+      if (t < 0.5) {
+        t *= 2.0;
+        a = sin((1.0 - t) * M_PI_2);
+        b = sin(       t  * M_PI_2);
+        
+        vx = (float) (a * ((double) (piv->v1).vx));
+        vy = (float) (a * ((double) (piv->v1).vy));
+        vz = (float) ((a * ((double) (piv->v1).vz)) + b);
+        
+      } else {
+        t = (t - 0.5) * 2.0;
+        a = sin((1.0 - t) * M_PI_2);
+        b = sin(       t  * M_PI_2);
+        
+        vx = (float) (b * ((double) (piv->v2).vx));
+        vy = (float) (b * ((double) (piv->v2).vy));
+        vz = (float) (a + (b * ((double) (piv->v2).vz)));
+      }
+      
+      CHECK_PIXEL(vx, vy, vz);
+      *ps = vectorColor(vx, vy, vz);
+    }
+    ps++;
+  }
+}
+
+/*
+ * Render kernel for IMODE_DOUBLE spans with fast weights.
+ * 
+ * With p = t * PI, the weights of the first half of the double slerp
+ * are cos(p) and sin(p), and those of the second half are sin(p) and
+ * -cos(p).  cos(p) and sin(p) are stepped from pixel to pixel as in
+ * kernelSlerpFast(), and the sign of cos(p) selects the half.
+ */
+static void kernelDoubleFast(uint32_t *ps, int32_t x_min, int32_t x_max,
+                             const IVEC *piv) {
+  
+  int32_t x = 0;
+  double p = 0.0;
+  double c = 0.0;
+  double s = 0.0;
+  double cs = 0.0;
+  double ss = 0.0;
+  double cn = 0.0;
+  float vx = 0.0f;
+  float vy = 0.0f;
+  float vz = 0.0f;
+  
+  p  = spanT(piv, ((double) x_min) + 0.5) * M_PI;
+  c  = cos(p);
+  s  = sin(p);
+  
+  p  = spanStep(piv) * M_PI;
+  cs = cos(p);
+  ss = sin(p);
+  
+  for(x = x_min; x <= x_max; x++) {
+    if (*ps != UINT32_C(0xff000000)) {
+      if (c > 0.0) {
+        vx = (float) (c * ((double) (piv->v1).vx));
+        vy = (float) (c * ((double) (piv->v1).vy));
+        vz = (float) ((c * ((double) (piv->v1).vz)) + s);
+        
+      } else {
+        vx = (float) (-c * ((double) (piv->v2).vx));
+        vy = (float) (-c * ((double) (piv->v2).vy));
+        vz = (float) (s - (c * ((double) (piv->v2).vz)));
+      }
+      
+      CHECK_PIXEL(vx, vy, vz);
+      *ps = vectorColor(vx, vy, vz);
+    }
+    
+    cn = (c * cs) - (s * ss);
+    s  = (s * cs) + (c * ss);
+    c  = cn;
+    ps++;
+  }
+}
+
+/*
+ * Render an interpolated span within a scanline.
+ * 
+ * v1 and v2 are the start and end vertices on the scanline.  They may
+ * be in any order, and they may be the same structure.  However, they
+ * must have exactly the same Y coordinate.
+ * 
+ * Clipping will be performed according to the dimensions of the pixel
+ * buffer.
+ * 
+ * Parameters:
+ * 
+ *   v1 - the first vertex
+ * 
+ *   v2 - the second vertex
+ */
+static void renderSpan(const VERTEX *v1, const VERTEX *v2) {
+  
+  const VERTEX *tv = NULL;
+  IVEC iv;
+  KERNEL kernel = NULL;
+  
+  int32_t x = 0;
+  int32_t x_end = 0;
+  int32_t x_min = 0;
+  int32_t x_max = 0;
+  int32_t y = 0;
+  
+  uint32_t *ps = NULL;
+  
+  /* Initialize structures */
+  memset(&iv, 0, sizeof(IVEC));
+  
+  /* Check state */
+  if (pBuf == NULL) {
+    raiseErr(__LINE__);
+  }
+  
+  /* Check parameters; the vertices come from ivec_atY(), which already
+   * validated them, so the full check is only made in debug builds */
+  if ((v1 == NULL) || (v2 == NULL)) {
+    raiseErr(__LINE__);
+  }
+#ifdef LILACME2PNG_DEBUG
+  checkVertex(v1);
+  checkVertex(v2);
+#endif
+  if (v1->y != v2->y) {
+    raiseErr(__LINE__);
+  }
+  
+  /* Swap parameters if necessary so that X coordinate of v1 is less
+   * than or equal to X coordinate of v2 */
+  if (!(v1->x <= v2->x)) {
+    tv = v1;
+    v1 = v2;
+    v2 = tv;
+  }
+  
+  /* Get the integer Y coordinate and clip it */
+  y = ifloor(v1->y);
+  if ((y < 0) || (y >= m_h)) {
+    return;
+  }
+  
+  /* Get the clipped X extent according to the top-left rule */
+  if (!pixelRange(v1->x, v2->x, m_w, &x_min, &x_max)) {
+    return;
+  }
+  
+  /* Initialize interpolation structure */
+  ivec_init(&iv, v1, v2);
+  
+  /* Select the kernel specialized for the interpolation mode of this
+   * span, or the generic kernel for the reference frame */
+  if (m_ref) {
+    kernel = &kernelGeneric;
+    
+  } else if (iv.mode == IMODE_SCALAR) {
+    kernel = &kernelScalar;
+    
+  } else if (iv.mode == IMODE_VLINEAR) {
+    kernel = &kernelVLinear;
+    
+  } else if (iv.mode == IMODE_SLERP) {
+    if (iv.fast) {
+      kernel = &kernelSlerpFast;
+    } else {
+      kernel = &kernelSlerp;
+    }
+    
+  } else if (iv.mode == IMODE_DOUBLE) {
+    if (iv.fast) {
+      kernel = &kernelDoubleFast;
+    } else {
+      kernel = &kernelDouble;
+    }
+    
+  } else {
+    raiseErr(__LINE__);
+  }
+  
+  /* Render each run of the span that is contiguous in the buffer;
+   * kernels compute each pixel from its X coordinate, so splitting the
+   * span does not change the result, except that the fast kernels
+   * start stepping again at each run, which only affects the last
+   * bits of the weights */
+  for(x = x_min; x <= x_max; x = x_end + 1) {
+    x_end = x + pixelRun(x) - 1;
+    if (x_end > x_max) {
+      x_end = x_max;
+    }
+    
+    ps = pixelPtr(x, y);
+    kernel(ps, x, x_end, &iv);
+  }
+}
+
+/*
+ * Render the scanlines filling an area between a pair of edges.
+ * 
+ * va1 and va2 define the endpoints of the first edge, while vb1 and vb2
+ * define the endpoints of the second edge.  All pointers may indicate
+ * the same structure.
+ * 
+ * Parameters:
+ * 
+ *   va1 - the first vertex of the first edge
+ * 
+ *   va2 - the second vertex of the first edge
+ * 
+ *   vb1 - the first vertex of the second edge
+ * 
+ *   vb2 - the second vertex of the second edge
+ * 
+ *   band_lo - the first scanline that may be rendered
+ * 
+ *   band_hi - the last scanline that may be rendered
+ */
+static void renderPair(
+    const VERTEX * va1,
+    const VERTEX * va2,
+    const VERTEX * vb1,
+    const VERTEX * vb2,
+    int32_t band_lo,
+    int32_t band_hi) {
+  
+  const VERTEX *tv = NULL;
+  
+  double ys    = 0.0;
+  double min_y = 0.0;
+  double max_y = 0.0;
+  
+  int32_t y        = 0;
+  int32_t start_y  = 0;
+  int32_t finish_y = 0;
+  
+  IVEC e1;
+  IVEC e2;
+  VERTEX ve1;
+  VERTEX ve2;
+  
+  EDGE_ENTRY *pe1 = NULL;
+  EDGE_ENTRY *pe2 = NULL;
+  
+  /* Initialize structures */
+  memset( &e1, 0, sizeof(IVEC));
+  memset( &e2, 0, sizeof(IVEC));
+  memset(&ve1, 0, sizeof(VERTEX));
+  memset(&ve2, 0, sizeof(VERTEX));
+  
+  /* Check state */
+  if (pBuf == NULL) {
+    raiseErr(__LINE__);
+  }
+  
+  /* Check parameters */
+  checkVertex(va1);
+  checkVertex(va2);
+  checkVertex(vb1);
+  checkVertex(vb2);
+  
+  /* Within each edge, flip vertices if necessary so that first vertex Y
+   * is less than or equal to second vertex Y */
+  if (!(va1->y <= va2->y)) {
+    tv = va1;
+    va1 = va2;
+    va2 = tv;
+  }
+  if (!(vb1->y <= vb2->y)) {
+    tv = vb1;
+    vb1 = vb2;
+    vb2 = tv;
+  }
+  
+  /* Get the Y extent that is the intersection of the Y extents of the
+   * two edges; if intersection is empty, then nothing to render */
+  min_y = va1->y;
+  max_y = va2->y;
+  
+  if (!((vb1->y <= max_y) && (vb2->y >= min_y))) {
+    /* Non-overlapping Y extents */
+    return;
+  }
+  
+  if (vb1->y > min_y) {
+    min_y = vb1->y;
+  }
+  if (vb2->y < max_y) {
+    max_y = vb2->y;
+  }
+  
+  /* Get the clipped scanline range according to the top-left rule */
+  if (!pixelRange(min_y, max_y, m_h, &start_y, &finish_y)) {
+    return;
+  }
+  
+  /* Restrict the range to the scanline band */
+  if (start_y < band_lo) {
+    start_y = band_lo;
+  }
+  if (finish_y > band_hi) {
+    finish_y = band_hi;
+  }
+  if (start_y > finish_y) {
+    return;
+  }
+  
+  /* If the edge table was built, render with the shared edge samples */
+  if (pEdges != NULL) {
+    pe1 = edge_table_slot(
+            (int32_t) (va1 - pva), (int32_t) (va2 - pva));
+    pe2 = edge_table_slot(
+            (int32_t) (vb1 - pva), (int32_t) (vb2 - pva));
+    
+    if ((pe1->i1 < 0) || (pe2->i1 < 0) ||
+        (start_y  < pe1->y_first) || (start_y  < pe2->y_first) ||
+        (finish_y >= pe1->y_first + pe1->y_count) ||
+        (finish_y >= pe2->y_first + pe2->y_count)) {
+      raiseErr(__LINE__);
+    }
+    
+    for(y = start_y; y <= finish_y; y++) {
+      renderSpan(
+        &((pe1->pSamples)[y - pe1->y_first]),
+        &((pe2->pSamples)[y - pe2->y_first]));
+    }
+    
+    return;
+  }
+  
+  /* Initialize interpolation structures for the two edges */
+  ivec_init(&e1, va1, va2);
+  ivec_init(&e2, vb1, vb2);
+  
+  /* Render each scanline */
+  for(y = start_y; y <= finish_y; y = iinc(y)) {
+    /* Get the scanline Y coordinate, which goes through the center of
+     * the pixel */
+    ys = ((double) y) + 0.5;
+    
+    /* Interpolate both edges at ys, using the exact edge crossings for
+     * the X coordinates */
+    ivec_atY(&ve1, &e1, ys);
+    ivec_atY(&ve2, &e2, ys);
+    
+    ve1.x = edgeX(va1, va2, ys);
+    ve2.x = edgeX(vb1, vb2, ys);
+    
+    /* Render the scanline */
+    renderSpan(&ve1, &ve2);
+  }
+}
+
+/*
+ * Render the scanlines filling an area between a pair of edges, using
+ * an attribute plane for the scalar value.
+ * 
+ * This is the INTER_SCALAR equivalent of renderPair().  The scanline
+ * range and the span extents are determined exactly as in renderPair()
+ * and renderSpan(), but the scalar value of each pixel is evaluated
+ * from the plane with one addition per pixel instead of interpolating
+ * along the edges and across the span.
+ * 
+ * Coverage is therefore identical to the general path, but the values
+ * are not always bit-identical, because the general path rounds to
+ * single precision at the edges and again across the span.  A pixel
+ * whose value lies right at a gray level boundary may be encoded one
+ * level differently, which happens to a few pixels in a million.
+ * 
+ * Parameters:
+ * 
+ *   va1 - the first vertex of the first edge
+ * 
+ *   va2 - the second vertex of the first edge
+ * 
+ *   vb1 - the first vertex of the second edge
+ * 
+ *   vb2 - the second vertex of the second edge
+ * 
+ *   pp - the attribute plane of the triangle
+ * 
+ *   band_lo - the first scanline that may be rendered
+ * 
+ *   band_hi - the last scanline that may be rendered
+ */
+static void renderPairPlane(
+    const VERTEX * va1,
+    const VERTEX * va2,
+    const VERTEX * vb1,
+    const VERTEX * vb2,
+    const PLANE  * pp,
+    int32_t band_lo,
+    int32_t band_hi) {
+  
+  const VERTEX *tv = NULL;
+  
+  double min_y = 0.0;
+  double max_y = 0.0;
+  double ys = 0.0;
+  double xa = 0.0;
+  double xb = 0.0;
+  double v = 0.0;
+  
+  int32_t x = 0;
+  int32_t y = 0;
+  int32_t start_y  = 0;
+  int32_t finish_y = 0;
+  int32_t x_min = 0;
+  int32_t x_max = 0;
+  int32_t run = 0;
+  
+  uint32_t *ps = NULL;
+  
+  /* Check state and parameters */
+  if ((pBuf == NULL) || (pp == NULL)) {
+    raiseErr(__LINE__);
+  }
+  checkVertex(va1);
+  checkVertex(va2);
+  checkVertex(vb1);
+  checkVertex(vb2);
+  
+  /* Within each edge, flip vertices if necessary so that first vertex Y
+   * is less than or equal to second vertex Y */
+  if (!(va1->y <= va2->y)) {
+    tv = va1;
+    va1 = va2;
+    va2 = tv;
+  }
+  if (!(vb1->y <= vb2->y)) {
+    tv = vb1;
+    vb1 = vb2;
+    vb2 = tv;
+  }
+  
+  /* Get the intersection of the Y extents of the two edges */
+  min_y = va1->y;
+  max_y = va2->y;
+  
+  if (!((vb1->y <= max_y) && (vb2->y >= min_y))) {
+    return;
+  }
+  
+  if (vb1->y > min_y) {
+    min_y = vb1->y;
+  }
+  if (vb2->y < max_y) {
+    max_y = vb2->y;
+  }
+  
+  /* Get the clipped scanline range according to the top-left rule */
+  if (!pixelRange(min_y, max_y, m_h, &start_y, &finish_y)) {
+    return;
+  }
+  
+  /* Restrict the range to the scanline band */
+  if (start_y < band_lo) {
+    start_y = band_lo;
+  }
+  if (finish_y > band_hi) {
+    finish_y = band_hi;
+  }
+  if (start_y > finish_y) {
+    return;
+  }
+  
+  /* Render each scanline */
+  for(y = start_y; y <= finish_y; y++) {
+    /* Get the scanline Y coordinate through the center of the pixel and
+     * the X coordinates of both edges on the scanline */
+    ys = ((double) y) + 0.5;
+    xa = edgeX(va1, va2, ys);
+    xb = edgeX(vb1, vb2, ys);
+    
+    /* Get the clipped span according to the top-left rule */
+    if (xa <= xb) {
+      if (!pixelRange(xa, xb, m_w, &x_min, &x_max)) {
+        continue;
+      }
+    } else {
+      if (!pixelRange(xb, xa, m_w, &x_min, &x_max)) {
+        continue;
+      }
+    }
+    
+    /* Evaluate the plane at the center of the first pixel and then step
+     * across the span */
+    v = pp->c + (pp->dx * (((double) x_min) + 0.5)) + (pp->dy * ys);
+    run = 0;
+    
+    for(x = x_min; x <= x_max; x++) {
+      /* Locate the next run of contiguous pixels when needed */
+      if (run < 1) {
+        ps = pixelPtr(x, y);
+        run = pixelRun(x);
+      }
+      
+      /* Write the pixel unless it is masked out */
+      if (*ps != UINT32_C(0xff000000)) {
+        *ps = scalarColor(v);
+      }
+      
+      v += pp->dx;
+      ps++;
+      run--;
+    }
+  }
+}
+
+/*
+ * Determine whether a triangle should be rendered by renderSmallTri().
+ * 
+ * See the documentation of SMALL_TRI_DIM and SMALL_TRI_DOT.
+ * 
+ * Parameters:
+ * 
+ *   v1 - the first vertex
+ * 
+ *   v2 - the second vertex
+ * 
+ *   v3 - the third vertex
+ * 
+ * Return:
+ * 
+ *   non-zero if the triangle is small, zero otherwise
+ */
+static int isSmallTri(
+    const VERTEX * v1,
+    const VERTEX * v2,
+    const VERTEX * v3) {
+  
+  double min_c = 0.0;
+  double max_c = 0.0;
+  
+  /* Check the width of the bounding box */
+  min_c = v1->x;
+  max_c = v1->x;
+  if (v2->x < min_c) { min_c = v2->x; }
+  if (v2->x > max_c) { max_c = v2->x; }
+  if (v3->x < min_c) { min_c = v3->x; }
+  if (v3->x > max_c) { max_c = v3->x; }
+  
+  if (max_c - min_c > (double) SMALL_TRI_DIM) {
+    return 0;
+  }
+  
+  /* Check the height of the bounding box */
+  min_c = v1->y;
+  max_c = v1->y;
+  if (v2->y < min_c) { min_c = v2->y; }
+  if (v2->y > max_c) { max_c = v2->y; }
+  if (v3->y < min_c) { min_c = v3->y; }
+  if (v3->y > max_c) { max_c = v3->y; }
+  
+  if (max_c - min_c > (double) SMALL_TRI_DIM) {
+    return 0;
+  }
+  
+  /* In vector mode, check that the vectors are close together */
+  if (m_inter == INTER_VECTOR) {
+    if (!(
+      ((v1->vx * v2->vx) + (v1->vy * v2->vy) + (v1->vz * v2->vz)
+          >= SMALL_TRI_DOT) &&
+      ((v2->vx * v3->vx) + (v2->vy * v3->vy) + (v2->vz * v3->vz)
+          >= SMALL_TRI_DOT) &&
+      ((v3->vx * v1->vx) + (v3->vy * v1->vy) + (v3->vz * v1->vz)
+          >= SMALL_TRI_DOT)
+    )) {
+      return 0;
+    }
+  }
+  
+  return 1;
+}
+
+/*
+ * Render a small triangle by testing each pixel in its bounding box.
+ * 
+ * Vertices are always on pixel centers, so with the pixel centers as
+ * the integer lattice, the edge functions of the triangle can be
+ * evaluated exactly in integers.  Pixels whose centers fall exactly on
+ * an edge are decided by the top-left rule: they are included on left
+ * edges and horizontal top edges and excluded on right edges and
+ * horizontal bottom edges.  This is exactly the coverage that the
+ * scanline path produces with edgeX() and pixelRange().
+ * 
+ * Vertex data is interpolated with the barycentric coordinates given
+ * by the edge functions.  In INTER_VECTOR mode, the interpolated vector
+ * is normalized.
+ * 
+ * Parameters:
+ * 
+ *   v1 - the first vertex
+ * 
+ *   v2 - the second vertex
+ * 
+ *   v3 - the third vertex
+ * 
+ *   band_lo - the first scanline that may be rendered
+ * 
+ *   band_hi - the last scanline that may be rendered
+ */
+static void renderSmallTri(
+    const VERTEX * v1,
+    const VERTEX * v2,
+    const VERTEX * v3,
+    int32_t band_lo,
+    int32_t band_hi) {
+  
+  const VERTEX *pv[3];
+  const VERTEX *tv = NULL;
+  
+  int64_t px[3];
+  int64_t py[3];
+  int64_t ex[3];
+  int64_t ey[3];
+  int64_t bias[3];
+  int64_t w[3];
+  int64_t area = 0;
+  
+  int32_t x = 0;
+  int32_t y = 0;
+  int32_t x_min = 0;
+  int32_t x_max = 0;
+  int32_t y_min = 0;
+  int32_t y_max = 0;
+  int32_t run = 0;
+  int i = 0;
+  int j = 0;
+  
+  float ra = 0.0f;
+  float b[3];
+  float vx = 0.0f;
+  float vy = 0.0f;
+  float vz = 0.0f;
+  float len = 0.0f;
+  
+  uint32_t *ps = NULL;
+  
+  /* Get the vertices and their lattice coordinates */
+  pv[0] = v1;
+  pv[1] = v2;
+  pv[2] = v3;
+  for(i = 0; i < 3; i++) {
+    px[i] = (int64_t) ifloor(pv[i]->x);
+    py[i] = (int64_t) ifloor(pv[i]->y);
+  }
+  
+  /* Compute twice the signed area; if the triangle collapsed to a line,
+   * it covers no pixels; if it is negative, swap the last two vertices
+   * so that the interior is on the positive side of every edge */
+  area = ((px[1] - px[0]) * (py[2] - py[0])) -
+          ((py[1] - py[0]) * (px[2] - px[0]));
+  if (area == 0) {
+    return;
+  
+  } else if (area < 0) {
+    tv = pv[1];
+    pv[1] = pv[2];
+    pv[2] = tv;
+    
+    px[1] = (int64_t) ifloor(pv[1]->x);
+    py[1] = (int64_t) ifloor(pv[1]->y);
+    px[2] = (int64_t) ifloor(pv[2]->x);
+    py[2] = (int64_t) ifloor(pv[2]->y);
+    
+    area = -area;
+  }
+  ra = (float) (1.0 / ((double) area));
+  
+  /* Edge i goes from vertex (i+1) to vertex (i+2) and is opposite
+   * vertex i, so its edge function is the barycentric weight of vertex
+   * i scaled by the area; edges where the interior is to the right are
+   * left edges, and horizontal edges where the interior is below are
+   * top edges, and only those include their boundary */
+  for(i = 0; i < 3; i++) {
+    j = (i + 1) % 3;
+    ex[i] = px[(i + 2) % 3] - px[j];
+    ey[i] = py[(i + 2) % 3] - py[j];
+    
+    if ((ey[i] < 0) || ((ey[i] == 0) && (ex[i] > 0))) {
+      bias[i] = 0;
+    } else {
+      bias[i] = -1;
+    }
+  }
+  
+  /* Get the bounding box clipped to the graphics buffer */
+  x_min = (int32_t) px[0];
+  x_max = (int32_t) px[0];
+  y_min = (int32_t) py[0];
+  y_max = (int32_t) py[0];
+  for(i = 1; i < 3; i++) {
+    if (px[i] < x_min) { x_min = (int32_t) px[i]; }
+    if (px[i] > x_max) { x_max = (int32_t) px[i]; }
+    if (py[i] < y_min) { y_min = (int32_t) py[i]; }
+    if (py[i] > y_max) { y_max = (int32_t) py[i]; }
+  }
+  
+  if (x_min < 0) { x_min = 0; }
+  if (y_min < 0) { y_min = 0; }
+  if (x_max >= m_w) { x_max = m_w - 1; }
+  if (y_max >= m_h) { y_max = m_h - 1; }
+  
+  if (y_min < band_lo) { y_min = band_lo; }
+  if (y_max > band_hi) { y_max = band_hi; }
+  
+  /* Test each pixel in the bounding box */
+  for(y = y_min; y <= y_max; y++) {
+    run = 0;
+    for(x = x_min; x <= x_max; x++) {
+      
+      /* Locate the next run of contiguous pixels when needed */
+      if (run < 1) {
+        ps = pixelPtr(x, y);
+        run = pixelRun(x);
+      }
+      
+      /* Evaluate the edge functions at this pixel center */
+      for(i = 0; i < 3; i++) {
+        j = (i + 1) % 3;
+        w[i] = (ex[i] * (((int64_t) y) - py[j])) -
+                (ey[i] * (((int64_t) x) - px[j]));
+      }
+      
+      /* Render the pixel if covered and not masked out */
+      if ((w[0] + bias[0] >= 0) && (w[1] + bias[1] >= 0) &&
+          (w[2] + bias[2] >= 0) && (*ps != UINT32_C(0xff000000))) {
+        
+        for(i = 0; i < 3; i++) {
+          b[i] = ((float) w[i]) * ra;
+        }
+        
+        if (m_inter == INTER_SCALAR) {
+          *ps = scalarColor(
+                  (b[0] * pv[0]->v) + (b[1] * pv[1]->v) +
+                  (b[2] * pv[2]->v));
+          
+        } else {
+          vx = (b[0] * pv[0]->vx) + (b[1] * pv[1]->vx) +
+                (b[2] * pv[2]->vx);
+          vy = (b[0] * pv[0]->vy) + (b[1] * pv[1]->vy) +
+                (b[2] * pv[2]->vy);
+          vz = (b[0] * pv[0]->vz) + (b[1] * pv[1]->vz) +
+                (b[2] * pv[2]->vz);
+          
+          len = (float) sqrt((vx * vx) + (vy * vy) + (vz * vz));
+          vx /= len;
+          vy /= len;
+          vz /= len;
+          
+          CHECK_PIXEL(vx, vy, vz);
+          *ps = vectorColor(vx, vy, vz);
+        }
+      }
+      
+      ps++;
+      run--;
+    }
+  }
+}
+
+/*
+ * Render a triangle.
+ * 
+ * Only the scanlines from band_lo to band_hi inclusive are rendered,
+ * which allows a large triangle to be rendered in several independent
+ * bands.  To render the whole triangle, pass zero and (m_h - 1).
+ * 
+ * Parameters:
+ * 
+ *   v1 - the first vertex
+ * 
+ *   v2 - the second vertex
+ * 
+ *   v3 - the third vertex
+ * 
+ *   band_lo - the first scanline that may be rendered
+ * 
+ *   band_hi - the last scanline that may be rendered
+ */
+static void renderTri(
+    const VERTEX * v1,
+    const VERTEX * v2,
+    const VERTEX * v3,
+    int32_t band_lo,
+    int32_t band_hi) {
+  
+  EDGE et[3];
+  EDGE te;
+  PLANE pl;
+  int i = 0;
+  int use_plane = 0;
+  int long_edge = 0;
+  double max_extent = 0.0;
+  double ex = 0.0;
+  
+  /* Initialize structures and arrays */
+  memset( et, 0, 3 * sizeof(EDGE));
+  memset(&te, 0, sizeof(EDGE));
+  memset(&pl, 0, sizeof(PLANE));
+  
+  /* Check parameters */
+  checkVertex(v1);
+  checkVertex(v2);
+  checkVertex(v3);
+  
+  /* Small triangles use a direct pixel test instead of scanlines */
+  if (isSmallTri(v1, v2, v3)) {
+    renderSmallTri(v1, v2, v3, band_lo, band_hi);
+    return;
+  }
+  
+  /* In scalar mode, use the attribute plane unless the triangle has
+   * collapsed to a line */
+  if (m_inter == INTER_SCALAR) {
+    use_plane = plane_init(&pl, v1, v2, v3);
+  }
+  
+  /* Set edges */
+  (et[0]).v1 = v1;
+  (et[0]).v2 = v2;
+  
+  (et[1]).v1 = v2;
+  (et[1]).v2 = v3;
+  
+  (et[2]).v1 = v3;
+  (et[2]).v2 = v1;
+  
+  /* Figure out the longest edge in terms of Y extent */
+  long_edge = 0;
+  max_extent = fabs(((et[0]).v1)->y - ((et[0]).v2)->y);
+  if (!isfinite(max_extent)) {
+    raiseErr(__LINE__);
+  }
+  
+  for(i = 1; i < 3; i++) {
+    ex = fabs(((et[i]).v1)->y - ((et[i]).v2)->y);
+    if (!isfinite(ex)) {
+      raiseErr(__LINE__);
+    }
+    
+    if (ex > max_extent) {
+      long_edge = i;
+      max_extent = ex;
+    }
+  }
+  
+  /* Make the first edge the long one */
+  if (long_edge > 0) {
+    memcpy(&te, &(et[long_edge]), sizeof(EDGE));
+    memcpy(&(et[long_edge]), &(et[0]), sizeof(EDGE));
+    memcpy(&(et[0]), &te, sizeof(EDGE));
+  }
+  
+  /* Render pairs of the long edge with the other two */
+  if (use_plane) {
+    renderPairPlane(
+      (et[0]).v1, (et[0]).v2, (et[1]).v1, (et[1]).v2, &pl,
+      band_lo, band_hi);
+    renderPairPlane(
+      (et[0]).v1, (et[0]).v2, (et[2]).v1, (et[2]).v2, &pl,
+      band_lo, band_hi);
+    
+  } else {
+    renderPair((et[0]).v1, (et[0]).v2, (et[1]).v1, (et[1]).v2,
+                band_lo, band_hi);
+    renderPair((et[0]).v1, (et[0]).v2, (et[2]).v1, (et[2]).v2,
+                band_lo, band_hi);
+  }
+}
+
+/*
+ * Get a pointer to a pixel in the pixel buffer.
+ * 
+ * The pixel buffer must be initialized.  The coordinates are not
+ * checked, so the caller must make sure they are in range.
+ * 
+ * Parameters:
+ * 
+ *   x - the X coordinate of the pixel
+ * 
+ *   y - the Y coordinate of the pixel
+ * 
+ * Return:
+ * 
+ *   pointer to the pixel
+ */
+static uint32_t *pixelPtr(int32_t x, int32_t y) {
+  return &(pBuf[pixelOffset(x, y)]);
+}
+
+/*
+ * Get the offset of a pixel from the start of a pixel buffer in the
+ * layout selected by m_layout.
+ * 
+ * Parameters:
+ * 
+ *   x - the X coordinate of the pixel
+ * 
+ *   y - the Y coordinate of the pixel
+ * 
+ * Return:
+ * 
+ *   the offset of the pixel, in pixels
+ */
+static size_t pixelOffset(int32_t x, int32_t y) {
+  
+  if (m_layout == LAYOUT_TILED) {
+    return (size_t) (
+      ((((y >> TILE_SHIFT) * m_tiles_x) + (x >> TILE_SHIFT))
+          << (2 * TILE_SHIFT)) +
+      ((y & TILE_MASK) << TILE_SHIFT) + (x & TILE_MASK));
+  
+  } else {
+    return (size_t) ((y * m_w) + x);
+  }
+}
+
+/*
+ * Get the number of pixels that are contiguous in the pixel buffer
+ * within a scanline, starting at a given X coordinate.
+ * 
+ * The returned count may extend past the right edge of the image, so
+ * the caller must still clip against the span it is rendering.
+ * 
+ * Parameters:
+ * 
+ *   x - the X coordinate of the first pixel
+ * 
+ * Return:
+ * 
+ *   the number of contiguous pixels, at least one
+ */
+static int32_t pixelRun(int32_t x) {
+  
+  if (m_layout == LAYOUT_TILED) {
+    return TILE_DIM - (x & TILE_MASK);
+  
+  } else {
+    return m_w - x;
+  }
+}
+
+/*
+ * Compute the length in pixels of a pixel buffer for the dimensions in
+ * m_w and m_h, in the layout selected by m_layout.
+ * 
+ * The tiled layout is padded to whole tiles.
+ * 
+ * Return:
+ * 
+ *   the length of the buffer in pixels
+ */
+static size_t bufLen(void) {
+  
+  /* Check state */
+  if ((m_w < 1) || (m_h < 1)) {
+    raiseErr(__LINE__);
+  }
+  
+  if (m_layout == LAYOUT_TILED) {
+    return ((size_t) ((m_w + TILE_MASK) >> TILE_SHIFT)) *
+            ((size_t) ((m_h + TILE_MASK) >> TILE_SHIFT)) *
+            ((size_t) (TILE_DIM * TILE_DIM));
+    
+  } else {
+    return ((size_t) m_w) * ((size_t) m_h);
+  }
+}
+
+/*
+ * Allocate the pixel buffer for the dimensions in m_w and m_h, in the
+ * layout selected by m_layout, with all pixels set to full zero.
+ * 
+ * The pixel buffer must not be already allocated.
+ */
+static void allocBuf(void) {
+  
+  size_t len = 0;
+  
+  /* Check state */
+  if ((pBuf != NULL) || (m_w < 1) || (m_h < 1)) {
+    raiseErr(__LINE__);
+  }
+  
+  /* Get the buffer length in pixels, and the tiles across the buffer
+   * in the tiled layout */
+  len = bufLen();
+  if (m_layout == LAYOUT_TILED) {
+    m_tiles_x = (m_w + TILE_MASK) >> TILE_SHIFT;
+  } else {
+    m_tiles_x = 0;
+  }
+  
+  /* Allocate buffer */
+  pBuf = (uint32_t *) lilac_mesh_mem_alloc(
+                        LILAC_MESH_MEM_FRAME, len, sizeof(uint32_t));
+  if (pBuf == NULL) {
+    fprintf(stderr, "%s: Memory buffer allocation failed!\n", pModule);
+    raiseErr(__LINE__);
+  }
+  m_buf_len = len;
+}
+
+/*
+ * Initialize the pixel buffer using a given preprocessed mask file.
+ * 
+ * The pixel buffer must not be already initialized.  If the file is not
+ * a preprocessed mask file, nothing is done and zero is returned so
+ * that the caller can read it as a PNG mask instead.  Any other error
+ * is reported and raised.
+ * 
+ * Parameters:
+ * 
+ *   pMaskPath - path to the mask file
+ * 
+ * Return:
+ * 
+ *   non-zero if the buffer was initialized, zero if the file is not a
+ *   preprocessed mask file
+ */
+static int initBufMaskFile(const char *pMaskPath) {
+  
+  int err_num = 0;
+  LILAC_MASK *pMask = NULL;
+  const unsigned char *pRow = NULL;
+  int32_t x = 0;
+  int32_t y = 0;
+  int32_t i = 0;
+  int32_t full = 0;
+  int32_t n = 0;
+  unsigned int b = 0;
+  
+  /* Check state */
+  if (pBuf != NULL) {
+    raiseErr(__LINE__);
+  }
+  
+  /* Check parameter */
+  if (pMaskPath == NULL) {
+    raiseErr(__LINE__);
+  }
+  
+  /* Map the mask file, stopping if it isn't a preprocessed mask */
+  pMask = lilac_mask_open(pMaskPath, &err_num);
+  if (pMask == NULL) {
+    if (err_num == LILAC_MASK_ERR_SIG) {
+      return 0;
+    }
+    fprintf(stderr, "%s: Failed to read mask file: %s!\n",
+            pModule, lilac_mask_errstr(err_num));
+    raiseErr(__LINE__);
+  }
+  
+  /* Get the mask file dimensions and check them as for PNG masks */
+  m_w = lilac_mask_width(pMask);
+  m_h = lilac_mask_height(pMask);
+  checkDim(m_w, m_h);
+  
+  /* Allocate buffer, which starts out with every pixel zero, meaning
+   * not masked off, so only the masked pixels need to be written */
+  allocBuf();
+  
+  /* Expand the zero bits of each row into opaque black pixels, skipping
+   * whole bytes of unmasked pixels at once */
+  full = (m_w + 7) / 8;
+  for(y = 0; y < m_h; y++) {
+    pRow = lilac_mask_row(pMask, y);
+    for(i = 0; i < full; i++) {
+      b = pRow[i];
+      if (b == 0xff) {
+        continue;
+      }
+      
+      x = i * 8;
+      n = m_w - x;
+      if (n > 8) {
+        n = 8;
+      }
+      for( ; n > 0; n--) {
+        if (!(b & 1)) {
+          *(pixelPtr(x, y)) = UINT32_C(0xff000000);
+        }
+        b >>= 1;
+        x++;
+      }
+    }
+  }
+  
+  /* Release the mask */
+  lilac_mask_close(pMask);
+  pMask = NULL;
+  
+  return 1;
+}
+
+/*
+ * Initialize the pixel buffer using a given mask file.
+ * 
+ * The pixel buffer must not be already initialized.  The mask file is
+ * either a preprocessed mask file or a PNG file.
+ * 
+ * Parameters:
+ * 
+ *   pMaskPath - path to the mask file
  */
 static void initBufMask(const char *pMaskPath) {
   
-  int err_num = 0;
-  SPH_IMAGE_READER *pr = NULL;
+  int err_num = 0;
+  double start = 0.0;
+  SPH_IMAGE_READER *pr = NULL;
+  int32_t x = 0;
+  int32_t y = 0;
+  uint32_t *ps = NULL;
+  uint32_t px = 0;
+  SPH_ARGB col;
+  
+  /* Initialize structures */
+  memset(&col, 0, sizeof(SPH_ARGB));
+  
+  /* Check state */
+  if (pBuf != NULL) {
+    raiseErr(__LINE__);
+  }
+  
+  /* Check parameter */
+  if (pMaskPath == NULL) {
+    raiseErr(__LINE__);
+  }
+  
+  start = lilac_trace_now();
+  
+  /* Use a preprocessed mask file directly if that is what was given */
+  if (initBufMaskFile(pMaskPath)) {
+    lilac_trace_span("mask decode", start, "rows", (long) m_h);
+    return;
+  }
+  
+  /* Open an image reader on the PNG mask file */
+  pr = sph_image_reader_newFromPath(pMaskPath, &err_num);
+  if (pr == NULL) {
+    fprintf(stderr, "%s: Failed to read PNG mask file: %s!\n",
+            pModule, sph_image_errorString(err_num));
+    raiseErr(__LINE__);
+  }
+  
+  /* Get the mask file dimensions */
+  m_w = sph_image_reader_width(pr);
+  m_h = sph_image_reader_height(pr);
+  
+  /* Check that dimensions are in range */
+  checkDim(m_w, m_h);
+  
+  /* Allocate buffer */
+  allocBuf();
+  
+  /* Read each mask image scanline and use to initialize the buffer */
+  for(y = 0; y < m_h; y++) {
+    /* Read a scanline */
+    ps = sph_image_reader_read(pr, &err_num);
+    if (ps == NULL) {
+      fprintf(stderr, "%s: Failed to read mask PNG scanline: %s!\n",
+              pModule, sph_image_errorString(err_num));
+      raiseErr(__LINE__);
+    }
+    
+    /* Use each pixel to initialize a pixel in the memory buffer */
+    for(x = 0; x < m_w; x++) {
+      /* Read current pixel */
+      px = *ps;
+      ps++;
+      
+      /* Convert ARGB value to a grayscale value */
+      sph_argb_unpack(px, &col);
+      sph_argb_downGray(&col);
+      px = (uint32_t) col.r;
+      
+      /* Threshold grayscale value so that 128 and above map to a value
+       * of 1 and values less than 128 map to a value of 0 */
+      if (px >= 128) {
+        px = 1;
+      } else {
+        px = 0;
+      }
+      
+      /* Threshold values of 1 (white) mean pixel is not masked off, so
+       * change to a full zero value in that case; in all other cases,
+       * change to a value of alpha channel fully opaque and RGB
+       * channels all zero */
+      if (px) {
+        px = 0;
+      } else {
+        px = UINT32_C(0xff000000);
+      }
+      
+      /* Write converted pixel to memory buffer */
+      *(pixelPtr(x, y)) = px;
+    }
+  }
+  
+  /* Release image reader */
+  sph_image_reader_close(pr);
+  pr = NULL;
+  
+  lilac_trace_span("mask decode", start, "rows", (long) m_h);
+}
+
+/*
+ * Initialize the pixel buffer using given output image dimensions.
+ * 
+ * The pixel buffer must not be already initialized.
+ * 
+ * Parameters:
+ * 
+ *   w - the width of the output image
+ * 
+ *   h - the height of the output image
+ */
+static void initBufDim(int32_t w, int32_t h) {
+  
+  /* Check state */
+  if (pBuf != NULL) {
+    raiseErr(__LINE__);
+  }
+  
+  /* Check that dimensions are in range */
+  checkDim(w, h);
+  
+  /* Store dimensions */
+  m_w = w;
+  m_h = h;
+  
+  /* Allocate buffer and initialize all pixels to full zero */
+  allocBuf();
+}
+
+/*
+ * Check that output image dimensions are in range.
+ * 
+ * Dimensions out of range are reported and raised.
+ * 
+ * Parameters:
+ * 
+ *   w - the width of the output image
+ * 
+ *   h - the height of the output image
+ */
+static void checkDim(int32_t w, int32_t h) {
+  
+  if ((w < 1) || (h < 1)) {
+    fprintf(stderr, "%s: Output image dimensions must be at least 1!\n",
+            pModule);
+    raiseErr(__LINE__);
+  }
+  
+  if ((w > MAX_IMAGE_DIM) || (h > MAX_IMAGE_DIM)) {
+    fprintf(stderr, "%s: Output image dimensions may be at most %d!\n",
+            pModule, (int) MAX_IMAGE_DIM);
+    raiseErr(__LINE__);
+  }
+  
+  if (w * h > MAX_IMAGE_PIXELS) {
+    fprintf(stderr, "%s: Output image may have at most %ld pixels!\n",
+            pModule, (long) MAX_IMAGE_PIXELS);
+    raiseErr(__LINE__);
+  }
+}
+
+/*
+ * Set the output image dimensions from a mask file without reading its
+ * pixels or allocating the pixel buffer.
+ * 
+ * This is used for dry runs.  The mask file is either a preprocessed
+ * mask file or a PNG file, of which only the header is read.  Errors
+ * are reported and raised.
+ * 
+ * Parameters:
+ * 
+ *   pMaskPath - path to the mask file
+ */
+static void maskDim(const char *pMaskPath) {
+  
+  int err_num = 0;
+  LILAC_MASK *pMask = NULL;
+  SPH_IMAGE_READER *pr = NULL;
+  
+  /* Check state */
+  if (pBuf != NULL) {
+    raiseErr(__LINE__);
+  }
+  
+  /* Check parameter */
+  if (pMaskPath == NULL) {
+    raiseErr(__LINE__);
+  }
+  
+  /* Try a preprocessed mask file first, and otherwise a PNG file */
+  pMask = lilac_mask_open(pMaskPath, &err_num);
+  if (pMask != NULL) {
+    m_w = lilac_mask_width(pMask);
+    m_h = lilac_mask_height(pMask);
+    lilac_mask_close(pMask);
+    pMask = NULL;
+  
+  } else if (err_num == LILAC_MASK_ERR_SIG) {
+    pr = sph_image_reader_newFromPath(pMaskPath, &err_num);
+    if (pr == NULL) {
+      fprintf(stderr, "%s: Failed to read PNG mask file: %s!\n",
+              pModule, sph_image_errorString(err_num));
+      raiseErr(__LINE__);
+    }
+    m_w = sph_image_reader_width(pr);
+    m_h = sph_image_reader_height(pr);
+    sph_image_reader_close(pr);
+    pr = NULL;
+  
+  } else {
+    fprintf(stderr, "%s: Failed to read mask file: %s!\n",
+            pModule, lilac_mask_errstr(err_num));
+    raiseErr(__LINE__);
+  }
+  
+  /* Check the dimensions as for rendering */
+  checkDim(m_w, m_h);
+}
+
+/*
+ * Parallel rendering
+ * ------------------
+ */
+
+/*
+ * Get the current time in seconds from a clock.
+ * 
+ * Parameters:
+ * 
+ *   id - the clock, such as CLOCK_MONOTONIC for wall-clock time or
+ *   CLOCK_THREAD_CPUTIME_ID for the CPU time of the calling thread
+ * 
+ * Return:
+ * 
+ *   the current time in seconds
+ */
+static double clockTime(clockid_t id) {
+  
+  struct timespec ts;
+  
+  memset(&ts, 0, sizeof(struct timespec));
+  if (clock_gettime(id, &ts)) {
+    raiseErr(__LINE__);
+  }
+  
+  return ((double) ts.tv_sec) + (((double) ts.tv_nsec) / 1000000000.0);
+}
+
+/*
+ * Generate the rendering tasks.
+ * 
+ * The mesh and the converted vertex array must be initialized.
+ * 
+ * Tasks are generated in mesh order.  Small triangles and triangles
+ * that cover at most TASK_ROWS scanlines are a single task.  Larger
+ * triangles are split into bands of TASK_ROWS scanlines, each of which
+ * is a separate task.  Triangles that do not cover any scanline of the
+ * pixel buffer generate no tasks.
+ * 
+ * Parameters:
+ * 
+ *   pOut - the array that receives the tasks, or NULL to only count
+ *   them
+ * 
+ * Return:
+ * 
+ *   the number of tasks
+ */
+static int32_t tasks_scan(TASK *pOut) {
+  
+  int32_t i = 0;
+  int32_t y = 0;
+  int32_t count = 0;
+  int32_t start_y = 0;
+  int32_t finish_y = 0;
+  double min_y = 0.0;
+  double max_y = 0.0;
+  const VERTEX *pv[3];
+  const uint16_t *pt = NULL;
+  
+  /* Check state */
+  if (pMesh == NULL) {
+    raiseErr(__LINE__);
+  }
+  
+  for(i = 0; i < pMesh->tri_count; i++) {
+    pt = &((pMesh->pTris)[i * 3]);
+    pv[0] = &(pva[pt[0]]);
+    pv[1] = &(pva[pt[1]]);
+    pv[2] = &(pva[pt[2]]);
+    
+    /* Small triangles are never split */
+    if (isSmallTri(pv[0], pv[1], pv[2])) {
+      if (pOut != NULL) {
+        pOut[count].tri = i;
+        pOut[count].y_lo = 0;
+        pOut[count].y_hi = m_h - 1;
+      }
+      count++;
+      continue;
+    }
+    
+    /* Get the clipped scanline range of the triangle */
+    min_y = pv[0]->y;
+    max_y = pv[0]->y;
+    if (pv[1]->y < min_y) { min_y = pv[1]->y; }
+    if (pv[1]->y > max_y) { max_y = pv[1]->y; }
+    if (pv[2]->y < min_y) { min_y = pv[2]->y; }
+    if (pv[2]->y > max_y) { max_y = pv[2]->y; }
+    
+    if (!pixelRange(min_y, max_y, m_h, &start_y, &finish_y)) {
+      continue;
+    }
+    
+    /* Generate a task for each band */
+    for(y = start_y; y <= finish_y; y += TASK_ROWS) {
+      if (pOut != NULL) {
+        pOut[count].tri = i;
+        pOut[count].y_lo = y;
+        if (finish_y - y >= TASK_ROWS) {
+          pOut[count].y_hi = y + TASK_ROWS - 1;
+        } else {
+          pOut[count].y_hi = finish_y;
+        }
+      }
+      count++;
+    }
+  }
+  
+  return count;
+}
+
+/*
+ * Build the rendering task array.
+ * 
+ * The mesh and the converted vertex array must be initialized, and the
+ * task array must not be built yet.  See tasks_scan() for the tasks.
+ */
+static void tasks_build(void) {
+  
+  int32_t count = 0;
+  
+  /* Check state */
+  if ((pMesh == NULL) || (pTasks != NULL)) {
+    raiseErr(__LINE__);
+  }
+  
+  /* Count the tasks, allocate the task array, and then store them */
+  count = tasks_scan(NULL);
+  if (count > 0) {
+    pTasks = (TASK *) lilac_mesh_mem_alloc(
+                        LILAC_MESH_MEM_VERTEX, (size_t) count, sizeof(TASK));
+    if (pTasks == NULL) {
+      fprintf(stderr, "%s: Memory allocation failed!\n", pModule);
+      raiseErr(__LINE__);
+    }
+    tasks_scan(pTasks);
+  }
+  
+  m_task_count = count;
+}
+
+/*
+ * Take the next task for a worker.
+ * 
+ * The worker first takes the task at the head of its own deque.  If its
+ * deque is empty, it tries to steal the task at the tail of the deque
+ * of each other worker in turn.
+ * 
+ * Since no tasks are added once rendering has started, there is no more
+ * work for the worker when this function fails.
+ * 
+ * Parameters:
+ * 
+ *   pw - the worker
+ * 
+ *   pt - receives the task
+ * 
+ * Return:
+ * 
+ *   non-zero if a task was taken, zero if there are no tasks left
+ */
+static int worker_take(WORKER *pw, TASK *pt) {
+  
+  int32_t i = 0;
+  int found = 0;
+  WORKER *pv = NULL;
+  
+  /* Check parameters */
+  if ((pw == NULL) || (pt == NULL)) {
+    raiseErr(__LINE__);
+  }
+  
+  /* Try the worker's own deque first, and then steal from the other
+   * workers, starting with the next one */
+  for(i = 0; i < m_threads; i++) {
+    pv = &(pWorkers[(pw->index + i) % m_threads]);
+    
+    if (pthread_mutex_lock(&(pv->lock))) {
+      raiseErr(__LINE__);
+    }
+    
+    if (pv->head < pv->tail) {
+      if (i == 0) {
+        memcpy(pt, &(pTasks[pv->head]), sizeof(TASK));
+        (pv->head)++;
+      } else {
+        (pv->tail)--;
+        memcpy(pt, &(pTasks[pv->tail]), sizeof(TASK));
+        (pw->steal_count)++;
+      }
+      found = 1;
+    }
+    
+    if (pthread_mutex_unlock(&(pv->lock))) {
+      raiseErr(__LINE__);
+    }
+    
+    if (found) {
+      break;
+    }
+  }
+  
+  return found;
+}
+
+/*
+ * The rendering thread procedure.
+ * 
+ * Renders tasks until no tasks remain in any deque.
+ * 
+ * Parameters:
+ * 
+ *   pArg - the WORKER structure of this thread
+ * 
+ * Return:
+ * 
+ *   NULL
+ */
+static void *worker_run(void *pArg) {
+  
+  WORKER *pw = NULL;
+  TASK t;
+  const uint16_t *pt = NULL;
+  double start = 0.0;
+  double task_start = 0.0;
+  
+  memset(&t, 0, sizeof(TASK));
+  
+  pw = (WORKER *) pArg;
+  if (pw == NULL) {
+    raiseErr(__LINE__);
+  }
+  
+  /* The first worker runs on the main thread, which keeps its name */
+  if (pw->index > 0) {
+    lilac_trace_thread("render", (long) pw->index);
+  }
+  
+  start = clockTime(CLOCK_THREAD_CPUTIME_ID);
+  
+  while (worker_take(pw, &t)) {
+    task_start = lilac_trace_now();
+    pt = &((pMesh->pTris)[t.tri * 3]);
+    renderTri(
+      &(pva[pt[0]]), &(pva[pt[1]]), &(pva[pt[2]]), t.y_lo, t.y_hi);
+    (pw->task_count)++;
+    lilac_trace_span("task", task_start, "tri", (long) t.tri);
+  }
+  
+  pw->busy = clockTime(CLOCK_THREAD_CPUTIME_ID) - start;
+  
+  return NULL;
+}
+
+/*
+ * Render all the triangles of the mesh with m_threads threads.
+ * 
+ * The mesh, the converted vertex array, and the pixel buffer must be
+ * initialized.  The shared edge table, if used, must already be built.
+ * 
+ * The tasks are divided into contiguous runs of equal length, one for
+ * the deque of each worker, and the workers then balance the load by
+ * stealing from each other.  The main thread runs the first worker.
+ * With a single thread, the triangles are rendered in mesh order,
+ * exactly as if rendered one after another.
+ * 
+ * If m_stats is set, the task count and the busy time and utilization
+ * of each thread are reported on standard error.  Utilization is the
+ * CPU time of the thread divided by the wall-clock time of rendering, so
+ * it drops below 100% both for threads that ran out of work and for
+ * threads that had to share a processor.
+ */
+static void renderTasks(void) {
+  
+  int32_t i = 0;
+  double start = 0.0;
+  double wall = 0.0;
+  
+  /* Check state */
+  if ((pMesh == NULL) || (pBuf == NULL) || (pWorkers != NULL) ||
+      (m_threads < 1) || (m_threads > MAX_THREADS)) {
+    raiseErr(__LINE__);
+  }
+  
+  /* Build the tasks and the workers */
+  tasks_build();
+  
+  pWorkers = (WORKER *) lilac_mesh_mem_alloc(
+                          LILAC_MESH_MEM_VERTEX,
+                          (size_t) m_threads, sizeof(WORKER));
+  if (pWorkers == NULL) {
+    fprintf(stderr, "%s: Memory allocation failed!\n", pModule);
+    raiseErr(__LINE__);
+  }
+  
+  for(i = 0; i < m_threads; i++) {
+    if (pthread_mutex_init(&(pWorkers[i].lock), NULL)) {
+      raiseErr(__LINE__);
+    }
+    pWorkers[i].index = i;
+    pWorkers[i].head = (int32_t) (
+      (((int64_t) m_task_count) * i) / m_threads);
+    pWorkers[i].tail = (int32_t) (
+      (((int64_t) m_task_count) * (i + 1)) / m_threads);
+  }
+  
+  /* Start the other threads, run the first worker on this thread, and
+   * wait for the others to finish */
+  start = clockTime(CLOCK_MONOTONIC);
+  
+  for(i = 1; i < m_threads; i++) {
+    if (pthread_create(
+          &(pWorkers[i].thread), NULL, &worker_run, &(pWorkers[i]))) {
+      fprintf(stderr, "%s: Failed to start rendering thread!\n",
+              pModule);
+      raiseErr(__LINE__);
+    }
+  }
+  
+  worker_run(&(pWorkers[0]));
+  
+  for(i = 1; i < m_threads; i++) {
+    if (pthread_join(pWorkers[i].thread, NULL)) {
+      raiseErr(__LINE__);
+    }
+  }
+  
+  wall = clockTime(CLOCK_MONOTONIC) - start;
+  
+  /* Report statistics if requested */
+  if (m_stats) {
+    fprintf(stderr,
+      "%s: Rendered %ld tasks from %ld triangles on %ld threads "
+      "in %.3f s\n",
+      pModule, (long) m_task_count, (long) pMesh->tri_count,
+      (long) m_threads, wall);
+    
+    for(i = 0; i < m_threads; i++) {
+      fprintf(stderr,
+        "%s: Thread %ld: %ld tasks, %ld stolen, busy %.3f s, "
+        "utilization %.1f%%\n",
+        pModule, (long) i,
+        (long) pWorkers[i].task_count,
+        (long) pWorkers[i].steal_count,
+        pWorkers[i].busy,
+        (wall > 0.0) ? ((pWorkers[i].busy / wall) * 100.0) : 0.0);
+    }
+  }
+  
+  /* Release the workers and the tasks */
+  for(i = 0; i < m_threads; i++) {
+    pthread_mutex_destroy(&(pWorkers[i].lock));
+  }
+  lilac_mesh_mem_free(pWorkers);
+  pWorkers = NULL;
+  
+  if (pTasks != NULL) {
+    lilac_mesh_mem_free(pTasks);
+    pTasks = NULL;
+  }
+  m_task_count = 0;
+}
+
+/*
+ * Load a mesh in either the Shastina text format or the compact binary
+ * format with lilac_parse_load().
+ * 
+ * Shastina meshes are tokenized with up to m_threads threads.  Errors
+ * are reported and raised.
+ * 
+ * Parameters:
+ * 
+ *   pPath - the path to the mesh
+ * 
+ * Return:
+ * 
+ *   the mesh
+ */
+static LILAC_MESH *loadMesh(const char *pPath) {
+  
+  int srcerr = 0;
+  int errcode = 0;
+  long line_num = 0;
+  LILAC_MESH *pm = NULL;
+  
+  /* Check parameter */
+  if (pPath == NULL) {
+    raiseErr(__LINE__);
+  }
+  
+  pm = lilac_parse_load(
+            pPath, (int) m_threads, &srcerr, &errcode, &line_num);
+  if (pm == NULL) {
+    if (srcerr) {
+      fprintf(stderr, "%s: %s!\n", pModule, lilac_source_errstr(srcerr));
+    } else if (line_num > 0) {
+      fprintf(stderr, "%s: Mesh error: [line %ld] %s!\n",
+                pModule, line_num, lilac_mesh_errstr(errcode));
+    } else {
+      fprintf(stderr, "%s: Mesh error: %s!\n",
+                pModule, lilac_mesh_errstr(errcode));
+    }
+    raiseErr(__LINE__);
+  }
+  
+  return pm;
+}
+
+/*
+ * Check that every keyframe mesh has the same topology as the first.
+ * 
+ * Since all meshes were validated when they were loaded, sharing the
+ * point count and the exact triangle list of the first keyframe is
+ * enough for every keyframe, and every interpolated frame, to be
+ * rendered with the triangles of pMesh.  Errors are reported and
+ * raised.
+ */
+static void keys_check(void) {
+  
+  int32_t k = 0;
+  const LILAC_MESH *pk = NULL;
+  
+  /* Check state */
+  if ((pMesh == NULL) || (m_key_count < 1) || (pKeys[0] != pMesh)) {
+    raiseErr(__LINE__);
+  }
+  
+  for(k = 1; k < m_key_count; k++) {
+    pk = pKeys[k];
+    if ((pk->point_count != pMesh->point_count) ||
+        (pk->tri_count != pMesh->tri_count)) {
+      fprintf(stderr,
+        "%s: Keyframe %ld does not match the point and triangle counts "
+        "of the first keyframe!\n", pModule, (long) k);
+      raiseErr(__LINE__);
+    }
+    
+    if (pMesh->tri_count > 0) {
+      if (memcmp(pk->pTris, pMesh->pTris,
+            ((size_t) pMesh->tri_count) * 3 * sizeof(uint16_t)) != 0) {
+        fprintf(stderr,
+          "%s: Keyframe %ld does not have the same triangles as the "
+          "first keyframe!\n", pModule, (long) k);
+        raiseErr(__LINE__);
+      }
+    }
+  }
+}
+
+/*
+ * Compute a mesh point of a frame.
+ * 
+ * Frame f is at position f * (m_key_count - 1) / (m_frames - 1) in the
+ * keyframe sequence, computed exactly in integers.  Frames that fall
+ * exactly on a keyframe copy its point unchanged, so they render
+ * exactly like that keyframe on its own.  Other frames interpolate the
+ * coordinates linearly and the normals as unit vectors, which are
+ * renormalized, and then round the results back to mesh units.
+ * 
+ * Parameters:
+ * 
+ *   pp - receives the point
+ * 
+ *   i - the index of the point
+ * 
+ *   f - the index of the frame
+ */
+static void framePoint(LILAC_MESH_POINT *pp, int32_t i, int32_t f) {
+  
+  int64_t num = 0;
+  int64_t den = 0;
+  int32_t k = 0;
+  int j = 0;
+  double u = 0.0;
+  double ad = 0.0;
+  double aa = 0.0;
+  double d = 0.0;
+  double a[3];
+  double b[3];
+  const LILAC_MESH_POINT *p1 = NULL;
+  const LILAC_MESH_POINT *p2 = NULL;
+  
+  /* Check parameters */
+  if ((pp == NULL) || (i < 0) || (i >= pMesh->point_count) ||
+      (f < 0) || (f >= m_frames)) {
+    raiseErr(__LINE__);
+  }
+  
+  /* Locate the frame between two keyframes */
+  num = ((int64_t) f) * ((int64_t) (m_key_count - 1));
+  den = (m_frames > 1) ? ((int64_t) (m_frames - 1)) : 1;
+  k = (int32_t) (num / den);
+  num = num % den;
+  
+  p1 = &((pKeys[k]->pPoints)[i]);
+  if (num == 0) {
+    memcpy(pp, p1, sizeof(LILAC_MESH_POINT));
+    return;
+  }
+  p2 = &((pKeys[k + 1]->pPoints)[i]);
+  u = ((double) num) / ((double) den);
+  
+  /* Interpolate the coordinates */
+  pp->x = (uint16_t) floor(
+            ((double) p1->x) + u * (((double) p2->x) - ((double) p1->x))
+            + 0.5);
+  pp->y = (uint16_t) floor(
+            ((double) p1->y) + u * (((double) p2->y) - ((double) p1->y))
+            + 0.5);
+  
+  /* Convert both normals to unit vectors and interpolate them */
+  for(j = 0; j < 2; j++) {
+    ad = ((double) ((j < 1) ? p1 : p2)->normd) /
+          ((double) LILAC_MESH_MAX_C);
+    aa = (((double) ((j < 1) ? p1 : p2)->norma) /
+          ((double) LILAC_MESH_MAX_C)) * 2.0 * M_PI;
+    b[0] = ad * cos(aa);
+    b[1] = ad * sin(aa);
+    b[2] = 1.0 - (ad * ad);
+    b[2] = (b[2] > 0.0) ? sqrt(b[2]) : 0.0;
+    if (j < 1) {
+      memcpy(a, b, sizeof(a));
+    }
+  }
+  
+  for(j = 0; j < 3; j++) {
+    a[j] = a[j] + u * (b[j] - a[j]);
+  }
+  
+  /* Renormalize, leaving the normal pointing at the viewer if the two
+   * normals were opposite, and convert back to mesh units */
+  d = sqrt((a[0] * a[0]) + (a[1] * a[1]) + (a[2] * a[2]));
+  if (!(d > 0.0)) {
+    a[0] = 0.0;
+    a[1] = 0.0;
+    d = 1.0;
+  }
+  
+  ad = floor((sqrt((a[0] * a[0]) + (a[1] * a[1])) / d) *
+              ((double) LILAC_MESH_MAX_C) + 0.5);
+  if (ad > (double) LILAC_MESH_MAX_C) {
+    ad = (double) LILAC_MESH_MAX_C;
+  }
+  
+  aa = 0.0;
+  if (ad >= 1.0) {
+    aa = floor((atan2(a[1], a[0]) / (2.0 * M_PI)) *
+                ((double) LILAC_MESH_MAX_C) + 0.5);
+    if (aa < 0.0) {
+      aa += (double) LILAC_MESH_MAX_C;
+    }
+    if (aa >= (double) LILAC_MESH_MAX_C) {
+      aa -= (double) LILAC_MESH_MAX_C;
+    }
+  }
+  
+  pp->normd = (uint16_t) ad;
+  pp->norma = (uint16_t) aa;
+}
+
+/*
+ * Generate the output path of a frame.
+ * 
+ * The last run of # characters in the pattern is replaced by the frame
+ * number, padded with zeros to the length of the run.  Frame numbers
+ * that need more digits than the run has are written in full.
+ * 
+ * Parameters:
+ * 
+ *   pPattern - the output path pattern, which must contain a #
+ * 
+ *   f - the index of the frame
+ * 
+ * Return:
+ * 
+ *   the dynamically allocated output path, which must eventually be
+ *   freed
+ */
+static char *framePath(const char *pPattern, int32_t f) {
+  
+  size_t len = 0;
+  size_t run_start = 0;
+  size_t run_len = 0;
+  char *pPath = NULL;
+  
+  /* Check parameters */
+  if ((pPattern == NULL) || (f < 0)) {
+    raiseErr(__LINE__);
+  }
+  
+  /* Find the last run of # characters */
+  len = strlen(pPattern);
+  for(run_start = len; run_start > 0; run_start--) {
+    if (pPattern[run_start - 1] == '#') {
+      break;
+    }
+  }
+  if (run_start < 1) {
+    raiseErr(__LINE__);
+  }
+  
+  for( ; run_start > 0; run_start--) {
+    if (pPattern[run_start - 1] != '#') {
+      break;
+    }
+    run_len++;
+  }
+  
+  /* Build the path, leaving room for all the digits of any frame
+   * number */
+  pPath = (char *) malloc(len + 16);
+  if (pPath == NULL) {
+    fprintf(stderr, "%s: Memory allocation failed!\n", pModule);
+    raiseErr(__LINE__);
+  }
+  
+  memcpy(pPath, pPattern, run_start);
+  sprintf(pPath + run_start, "%0*ld%s",
+          (int) run_len, (long) f, pPattern + run_start + run_len);
+  
+  return pPath;
+}
+
+/*
+ * Convert the points of a frame into the vertex array.
+ * 
+ * The output image dimensions must be set, and the vertex array must be
+ * allocated.
+ * 
+ * Parameters:
+ * 
+ *   f - the index of the frame
+ */
+static void convertFrame(int32_t f) {
+  
+  int32_t i = 0;
+  double start = 0.0;
+  LILAC_MESH_POINT pt;
+  
+  memset(&pt, 0, sizeof(LILAC_MESH_POINT));
+  
+  /* Check state */
+  if (pMesh == NULL) {
+    raiseErr(__LINE__);
+  }
+  
+  /* Get a vertex conversion for each point of the frame */
+  start = lilac_trace_now();
+  for(i = 0; i < pMesh->point_count; i++) {
+    framePoint(&pt, i, f);
+    convertVertex(&(pva[i]), &pt);
+  }
+  lilac_trace_span("convert vertices", start, "frame", (long) f);
+}
+
+/*
+ * Render a frame into the pixel buffer.
+ * 
+ * The pixel buffer must already hold its initial state from the mask or
+ * dimensions, and the vertex array must be allocated.  The points of
+ * the frame are converted into the vertex array, and the triangles of
+ * the mesh are then rendered with renderTasks().
+ * 
+ * If checking interpolation, the frame is then rendered again with the
+ * exact interpolation path into pRef, starting from the same initial
+ * state, and the two frames are compared with checkFrame().
+ * 
+ * Parameters:
+ * 
+ *   f - the index of the frame
+ */
+static void renderFrame(int32_t f) {
+  
+  double start = 0.0;
+  int pass = 0;
+  int slerp = 0;
+  uint32_t *pSwap = NULL;
+  
+  /* Check state */
+  if ((pMesh == NULL) || (pBuf == NULL) || (pEdges != NULL)) {
+    raiseErr(__LINE__);
+  }
+  
+  convertFrame(f);
+  
+  /* If checking interpolation, keep the initial state of the frame for
+   * the reference render */
+  if (m_check) {
+    if (pRef == NULL) {
+      pRef = (uint32_t *) lilac_mesh_mem_alloc(
+                            LILAC_MESH_MEM_FRAME,
+                            m_buf_len, sizeof(uint32_t));
+      if (pRef == NULL) {
+        fprintf(stderr, "%s: Memory buffer allocation failed!\n",
+                pModule);
+        raiseErr(__LINE__);
+      }
+    }
+    memcpy(pRef, pBuf, m_buf_len * sizeof(uint32_t));
+  }
+  
+  /* The first pass renders the frame, and the second pass renders the
+   * exact reference into pRef if checking interpolation; the edge table
+   * holds interpolated edge samples, so it is rebuilt for each pass */
+  for(pass = 0; pass < (m_check ? 2 : 1); pass++) {
+    if (pass > 0) {
+      pSwap = pBuf;
+      pBuf = pRef;
+      pRef = pSwap;
+      
+      slerp = m_slerp;
+      m_slerp = SLERP_EXACT;
+      m_ref = 1;
+    }
+    
+    /* In vector mode, interpolate each edge once in the shared edge
+     * table; scalar mode renders through attribute planes instead */
+    if (m_inter == INTER_VECTOR) {
+      start = lilac_trace_now();
+      edge_table_build(1);
+      lilac_trace_span("edge table", start, "frame", (long) f);
+    }
+    
+    /* Render each triangle in the mesh, using the converted vertex
+     * buffer */
+    start = lilac_trace_now();
+    renderTasks();
+    lilac_trace_span("render", start, "frame", (long) f);
+    
+    /* Release the shared edge table if built */
+    edge_table_free();
+    
+    if (pass > 0) {
+      m_slerp = slerp;
+      m_ref = 0;
+      
+      pSwap = pBuf;
+      pBuf = pRef;
+      pRef = pSwap;
+    }
+  }
+  
+  /* Compare against the reference if checking interpolation */
+  if (m_check) {
+    start = lilac_trace_now();
+    checkFrame();
+    lilac_trace_span("interpolation check", start, "frame", (long) f);
+  }
+}
+
+/*
+ * Write a pixel buffer to a PNG file.
+ * 
+ * The pixel buffer is in the layout selected by m_layout, and each
+ * scanline is gathered from its contiguous runs.  Errors are reported
+ * and raised.
+ * 
+ * Parameters:
+ * 
+ *   pPath - the path to the PNG file
+ * 
+ *   pb - the pixel buffer to write
+ */
+static void writeImage(const char *pPath, const uint32_t *pb) {
+  
+  int errcode = 0;
   int32_t x = 0;
   int32_t y = 0;
+  int32_t run = 0;
   uint32_t *ps = NULL;
-  uint32_t *pb = NULL;
-  uint32_t px = 0;
-  SPH_ARGB col;
+  double start = 0.0;
+  SPH_IMAGE_WRITER *pw = NULL;
+  
+  /* Check parameters */
+  if ((pPath == NULL) || (pb == NULL)) {
+    raiseErr(__LINE__);
+  }
+  
+  /* Allocate an image writer for writing the image buffer to output */
+  pw = sph_image_writer_newFromPath(
+          pPath, m_w, m_h, m_dconv, 0, &errcode);
+  if (pw == NULL) {
+    fprintf(stderr, "%s: Failed to open PNG output: %s!\n",
+            pModule, sph_image_errorString(errcode));
+    raiseErr(__LINE__);
+  }
+  
+  /* Transfer each scanline to output, gathering the contiguous runs
+   * of the scanline from the buffer layout, and tracing each stripe of
+   * TASK_ROWS scanlines */
+  for(y = 0; y < m_h; y++) {
+    if ((y % TASK_ROWS) == 0) {
+      start = lilac_trace_now();
+    }
+    
+    /* Copy scanline into output buffer */
+    ps = sph_image_writer_ptr(pw);
+    for(x = 0; x < m_w; x += run) {
+      run = pixelRun(x);
+      if (run > m_w - x) {
+        run = m_w - x;
+      }
+      memcpy(ps + x, pb + pixelOffset(x, y),
+              ((size_t) run) * sizeof(uint32_t));
+    }
+    
+    /* Write to output */
+    sph_image_writer_write(pw);
+    
+    if (((y % TASK_ROWS) == TASK_ROWS - 1) || (y == m_h - 1)) {
+      lilac_trace_span("encode", start, "row", (long) (y - (y % TASK_ROWS)));
+    }
+  }
+  
+  /* Close image writer */
+  start = lilac_trace_now();
+  sph_image_writer_close(pw);
+  pw = NULL;
+  lilac_trace_span("finish encode", start, NULL, 0);
+}
+
+/*
+ * The writer thread procedure.
+ * 
+ * Writes the frame in pBack to pBackPath.
+ * 
+ * Parameters:
+ * 
+ *   pArg - ignored
+ * 
+ * Return:
+ * 
+ *   NULL
+ */
+static void *writer_run(void *pArg) {
+  
+  (void) pArg;
+  lilac_trace_thread("writer", -1);
+  writeImage(pBackPath, pBack);
+  return NULL;
+}
+
+/*
+ * Start writing the frame in the pixel buffer on the writer thread.
+ * 
+ * The writer thread must not be running.  The pixel buffer is swapped
+ * with the back buffer, so the pixel buffer must be reset before the
+ * next frame is rendered into it.
+ * 
+ * Parameters:
+ * 
+ *   pPath - the dynamically allocated path to write the frame to, which
+ *   is freed by writer_finish()
+ */
+static void writer_start(char *pPath) {
   
-  /* Initialize structures */
-  memset(&col, 0, sizeof(SPH_ARGB));
+  uint32_t *pSwap = NULL;
   
   /* Check state */
-  if (pBuf != NULL) {
+  if (m_writing || (pBack == NULL) || (pBackPath != NULL)) {
     raiseErr(__LINE__);
   }
   
   /* Check parameter */
-  if (pMaskPath == NULL) {
-    raiseErr(__LINE__);
-  }
-  
-  /* Open an image reader on the PNG mask file */
-  pr = sph_image_reader_newFromPath(pMaskPath, &err_num);
-  if (pr == NULL) {
-    fprintf(stderr, "%s: Failed to read PNG mask file: %s!\n",
-            pModule, sph_image_errorString(err_num));
-    raiseErr(__LINE__);
-  }
-  
-  /* Get the mask file dimensions */
-  m_w = sph_image_reader_width(pr);
-  m_h = sph_image_reader_height(pr);
-  
-  /* Check that dimensions are in range */
-  if ((m_w > MAX_IMAGE_DIM) || (m_h > MAX_IMAGE_DIM)) {
-    fprintf(stderr, "%s: Output image dimensions may be at most %d!\n",
-            pModule, (int) MAX_IMAGE_DIM);
+  if (pPath == NULL) {
     raiseErr(__LINE__);
   }
   
-  if (m_w * m_h > MAX_IMAGE_PIXELS) {
-    fprintf(stderr, "%s: Output image may have at most %ld pixels!\n",
-            pModule, (long) MAX_IMAGE_PIXELS);
-    raiseErr(__LINE__);
-  }
+  pSwap = pBack;
+  pBack = pBuf;
+  pBuf = pSwap;
+  pBackPath = pPath;
   
-  /* Allocate buffer */
-  pBuf = (uint32_t *) calloc((size_t) (m_w * m_h), sizeof(uint32_t));
-  if (pBuf == NULL) {
-    fprintf(stderr, "%s: Memory buffer allocation failed!\n", pModule);
+  if (pthread_create(&m_writer, NULL, &writer_run, NULL)) {
+    fprintf(stderr, "%s: Failed to start writer thread!\n", pModule);
     raiseErr(__LINE__);
   }
+  m_writing = 1;
+}
+
+/*
+ * Wait for the writer thread to finish writing, if it is running.
+ */
+static void writer_finish(void) {
   
-  /* Read each mask image scanline and use to initialize the buffer */
-  pb = pBuf;
-  for(y = 0; y < m_h; y++) {
-    /* Read a scanline */
-    ps = sph_image_reader_read(pr, &err_num);
-    if (ps == NULL) {
-      fprintf(stderr, "%s: Failed to read mask PNG scanline: %s!\n",
-              pModule, sph_image_errorString(err_num));
+  if (m_writing) {
+    if (pthread_join(m_writer, NULL)) {
       raiseErr(__LINE__);
     }
+    m_writing = 0;
     
-    /* Use each pixel to initialize a pixel in the memory buffer */
-    for(x = 0; x < m_w; x++) {
-      /* Read current pixel */
-      px = *ps;
-      ps++;
-      
-      /* Convert ARGB value to a grayscale value */
-      sph_argb_unpack(px, &col);
-      sph_argb_downGray(&col);
-      px = (uint32_t) col.r;
-      
-      /* Threshold grayscale value so that 128 and above map to a value
-       * of 1 and values less than 128 map to a value of 0 */
-      if (px >= 128) {
-        px = 1;
-      } else {
-        px = 0;
-      }
-      
-      /* Threshold values of 1 (white) mean pixel is not masked off, so
-       * change to a full zero value in that case; in all other cases,
-       * change to a value of alpha channel fully opaque and RGB
-       * channels all zero */
-      if (px) {
-        px = 0;
-      } else {
-        px = UINT32_C(0xff000000);
-      }
-      
-      /* Write converted pixel to memory buffer */
-      *pb = px;
-      pb++;
-    }
+    free(pBackPath);
+    pBackPath = NULL;
   }
-  
-  /* Release image reader */
-  sph_image_reader_close(pr);
-  pr = NULL;
 }
 
 /*
- * Initialize the pixel buffer using given output image dimensions.
- * 
- * The pixel buffer must not be already initialized.
+ * Predict the peak memory of rendering and print it.
  * 
- * Parameters:
+ * This is the dry run.  The meshes must be loaded, the output image
+ * dimensions must be set, and the vertex array must be allocated, but
+ * the pixel buffer must not be.
  * 
- *   pMaskPath - path to the PNG mask file
+ * The meshes and the working memory of loading them are already
+ * counted.  The pixel buffers follow from the dimensions and layout.
+ * For the per-frame state, the vertices of every frame are converted,
+ * and its tasks and edge samples are counted without being allocated;
+ * the largest frame sets the prediction.  The total is the larger of
+ * the peak while loading and the sum of the mesh, pixel buffer, and
+ * largest per-frame memory, since these are all held while rendering.
  */
-static void initBufDim(int32_t w, int32_t h) {
+static void dryRun(void) {
+  
+  int32_t f = 0;
+  int32_t i = 0;
+  int sys = 0;
+  size_t mesh_cur = 0;
+  size_t load_peak = 0;
+  size_t bytes = 0;
+  size_t frame_mem = 0;
+  size_t vertex_mem = 0;
+  size_t total = 0;
+  size_t pred[LILAC_MESH_MEM_COUNT];
+  
+  memset(pred, 0, sizeof(pred));
   
   /* Check state */
-  if (pBuf != NULL) {
+  if ((pMesh == NULL) || (pBuf != NULL) || (pEdges != NULL) ||
+      (pTasks != NULL) || (m_w < 1) || (m_h < 1)) {
     raiseErr(__LINE__);
   }
   
-  /* Check that dimensions are in range */
-  if ((w < 1) || (h < 1)) {
-    fprintf(stderr, "%s: Output image dimensions must be at least 1!\n",
-            pModule);
-    raiseErr(__LINE__);
+  /* Get the memory of loading the meshes */
+  lilac_mesh_mem_stats(LILAC_MESH_MEM_MESH, &mesh_cur, NULL);
+  lilac_mesh_mem_stats(LILAC_MESH_MEM_WORK, NULL, &bytes);
+  lilac_mesh_mem_stats(LILAC_MESH_MEM_ALL, NULL, &load_peak);
+  pred[LILAC_MESH_MEM_MESH] = mesh_cur;
+  pred[LILAC_MESH_MEM_WORK] = bytes;
+  
+  /* A sequence also has the mask copy and the back buffer, and the
+   * interpolation check has the reference buffer */
+  frame_mem = bufLen() * sizeof(uint32_t);
+  if (m_frames > 1) {
+    frame_mem *= 3;
   }
+  if (m_check) {
+    frame_mem += bufLen() * sizeof(uint32_t);
+  }
+  pred[LILAC_MESH_MEM_FRAME] = frame_mem;
   
-  if ((w > MAX_IMAGE_DIM) || (h > MAX_IMAGE_DIM)) {
-    fprintf(stderr, "%s: Output image dimensions may be at most %d!\n",
-            pModule, (int) MAX_IMAGE_DIM);
-    raiseErr(__LINE__);
+  /* Find the largest per-frame memory */
+  for(f = 0; f < m_frames; f++) {
+    convertFrame(f);
+    
+    bytes = ((size_t) pMesh->point_count) * sizeof(VERTEX) +
+            ((size_t) tasks_scan(NULL)) * sizeof(TASK) +
+            ((size_t) m_threads) * sizeof(WORKER);
+    
+    if (m_inter == INTER_VECTOR) {
+      edge_table_build(0);
+      bytes += ((size_t) m_edge_cap) * sizeof(EDGE_ENTRY);
+      for(i = 0; i < m_edge_cap; i++) {
+        if (pEdges[i].i1 >= 0) {
+          bytes += ((size_t) pEdges[i].y_count) * sizeof(VERTEX);
+        }
+      }
+      edge_table_free();
+    }
+    
+    if (bytes > vertex_mem) {
+      vertex_mem = bytes;
+    }
   }
+  pred[LILAC_MESH_MEM_VERTEX] = vertex_mem;
   
-  if (w * h > MAX_IMAGE_PIXELS) {
-    fprintf(stderr, "%s: Output image may have at most %ld pixels!\n",
-            pModule, (long) MAX_IMAGE_PIXELS);
-    raiseErr(__LINE__);
+  /* Everything but the working memory is held while rendering */
+  total = mesh_cur + frame_mem + vertex_mem;
+  if (load_peak > total) {
+    total = load_peak;
   }
   
-  /* Store dimensions */
-  m_w = w;
-  m_h = h;
+  /* Print the prediction */
+  printf("Predicted peak memory for %ld frame(s) of %ld x %ld:\n",
+          (long) m_frames, (long) m_w, (long) m_h);
+  for(sys = 0; sys < LILAC_MESH_MEM_COUNT; sys++) {
+    printf("  %-8s %12lu bytes\n",
+            lilac_mesh_mem_name(sys), (unsigned long) pred[sys]);
+  }
+  printf("  %-8s %12lu bytes\n",
+          lilac_mesh_mem_name(LILAC_MESH_MEM_ALL), (unsigned long) total);
+}
+
+/*
+ * Report the peak and current memory of each subsystem and in total on
+ * standard error.
+ */
+static void reportMemory(void) {
   
-  /* Allocate buffer and initialize all pixels to full zero */
-  pBuf = (uint32_t *) calloc((size_t) (m_w * m_h), sizeof(uint32_t));
-  if (pBuf == NULL) {
-    fprintf(stderr, "%s: Memory buffer allocation failed!\n", pModule);
-    raiseErr(__LINE__);
+  int i = 0;
+  int sys = 0;
+  size_t cur = 0;
+  size_t peak = 0;
+  
+  for(i = 0; i <= LILAC_MESH_MEM_COUNT; i++) {
+    if (i < LILAC_MESH_MEM_COUNT) {
+      sys = i;
+    } else {
+      sys = LILAC_MESH_MEM_ALL;
+    }
+    
+    lilac_mesh_mem_stats(sys, &cur, &peak);
+    fprintf(stderr, "%s: Memory %s: peak %lu bytes, current %lu bytes\n",
+            pModule, lilac_mesh_mem_name(sys),
+            (unsigned long) peak, (unsigned long) cur);
   }
 }
 
@@ -1734,23 +5261,20 @@ static void initBufDim(int32_t w, int32_t h) {
 int main(int argc, char *argv[]) {
   
   int x = 0;
-  int errcode = 0;
-  long line_num = 0;
+  int argi = 0;
   
   const char *pMode = NULL;
   const char *pOutPath = NULL;
   const char *pMeshPath = NULL;
+  const char *pKeyPath[MAX_KEYS];
   
-  int dconv = 0;
-  FILE *pIn = NULL;
-  SNSOURCE *pSrc = NULL;
-  SPH_IMAGE_WRITER *pw = NULL;
-  
-  int32_t i = 0;
-  int32_t y = 0;
-  uint32_t *ps = NULL;
+  int32_t f = 0;
+  double start = 0.0;
+  double frame_start = 0.0;
+  const char *pTracePath = NULL;
   
-  VERTEX *pva = NULL;
+  /* Initialize arrays */
+  memset((void *) pKeyPath, 0, sizeof(pKeyPath));
   
   /* Get module name */
   pModule = NULL;
@@ -1773,6 +5297,121 @@ int main(int argc, char *argv[]) {
     }
   }
   
+  /* Parse any options that precede the core program arguments */
+  for(argi = 1; argi < argc; argi++) {
+    if (strncmp(argv[argi], "--", 2) != 0) {
+      break;
+    }
+    
+    if (strcmp(argv[argi], "--interp") == 0) {
+      if (argi >= argc - 1) {
+        fprintf(stderr, "%s: Option --interp requires a value!\n",
+                pModule);
+        raiseErr(__LINE__);
+      }
+      argi++;
+      
+      if (strcmp(argv[argi], "exact") == 0) {
+        m_slerp = SLERP_EXACT;
+      } else if (strcmp(argv[argi], "fast") == 0) {
+        m_slerp = SLERP_FAST;
+      } else {
+        fprintf(stderr, "%s: Unrecognized interpolation '%s'!\n",
+                pModule, argv[argi]);
+        raiseErr(__LINE__);
+      }
+      
+    } else if (strcmp(argv[argi], "--interp-check") == 0) {
+      m_check = 1;
+      
+    } else if (strcmp(argv[argi], "--threads") == 0) {
+      if (argi >= argc - 1) {
+        fprintf(stderr, "%s: Option --threads requires a value!\n",
+                pModule);
+        raiseErr(__LINE__);
+      }
+      argi++;
+      
+      m_threads = parseInt32Arg(argv[argi]);
+      if ((m_threads < 1) || (m_threads > MAX_THREADS)) {
+        fprintf(stderr, "%s: Thread count out of range!\n", pModule);
+        raiseErr(__LINE__);
+      }
+      
+    } else if (strcmp(argv[argi], "--stats") == 0) {
+      m_stats = 1;
+      
+    } else if (strcmp(argv[argi], "--dry-run") == 0) {
+      m_dry = 1;
+      
+    } else if (strcmp(argv[argi], "--layout") == 0) {
+      if (argi >= argc - 1) {
+        fprintf(stderr, "%s: Option --layout requires a value!\n",
+                pModule);
+        raiseErr(__LINE__);
+      }
+      argi++;
+      
+      if (strcmp(argv[argi], "linear") == 0) {
+        m_layout = LAYOUT_LINEAR;
+      } else if (strcmp(argv[argi], "tiled") == 0) {
+        m_layout = LAYOUT_TILED;
+      } else {
+        fprintf(stderr, "%s: Unrecognized layout '%s'!\n",
+                pModule, argv[argi]);
+        raiseErr(__LINE__);
+      }
+      
+    } else if (strcmp(argv[argi], "--key") == 0) {
+      if (argi >= argc - 1) {
+        fprintf(stderr, "%s: Option --key requires a value!\n",
+                pModule);
+        raiseErr(__LINE__);
+      }
+      argi++;
+      
+      if (m_key_count >= MAX_KEYS - 1) {
+        fprintf(stderr, "%s: Too many keyframes!\n", pModule);
+        raiseErr(__LINE__);
+      }
+      m_key_count++;
+      pKeyPath[m_key_count] = argv[argi];
+      
+    } else if (strcmp(argv[argi], "--trace-out") == 0) {
+      if (argi >= argc - 1) {
+        fprintf(stderr, "%s: Option --trace-out requires a value!\n",
+                pModule);
+        raiseErr(__LINE__);
+      }
+      argi++;
+      pTracePath = argv[argi];
+      
+    } else if (strcmp(argv[argi], "--frames") == 0) {
+      if (argi >= argc - 1) {
+        fprintf(stderr, "%s: Option --frames requires a value!\n",
+                pModule);
+        raiseErr(__LINE__);
+      }
+      argi++;
+      
+      m_frames = parseInt32Arg(argv[argi]);
+      if ((m_frames < 1) || (m_frames > MAX_FRAMES)) {
+        fprintf(stderr, "%s: Frame count out of range!\n", pModule);
+        raiseErr(__LINE__);
+      }
+      
+    } else {
+      fprintf(stderr, "%s: Unrecognized option '%s'!\n",
+              pModule, argv[argi]);
+      raiseErr(__LINE__);
+    }
+  }
+  
+  /* Shift the arguments so that the core program arguments begin at
+   * index one, as if there were no options */
+  argc -= (argi - 1);
+  argv += (argi - 1);
+  
   /* Check number of parameters */
   if ((argc != 5) && (argc != 6)) {
     fprintf(stderr, "%s: Wrong number of arguments!\n", pModule);
@@ -1784,73 +5423,85 @@ int main(int argc, char *argv[]) {
   pOutPath  = argv[2];
   pMeshPath = argv[3];
   
-  /* Parse the mode and set the state variables and dconv */
+  /* The input mesh is the first keyframe, and there is one frame for
+   * each keyframe unless the frame count was given */
+  pKeyPath[0] = pMeshPath;
+  m_key_count++;
+  if (m_frames < 1) {
+    m_frames = m_key_count;
+  }
+  
+  /* Start tracing if requested */
+  if (pTracePath != NULL) {
+    if (!lilac_trace_open(pTracePath)) {
+      fprintf(stderr, "%s: Can't create trace file!\n", pModule);
+      raiseErr(__LINE__);
+    }
+    lilac_trace_thread("main", -1);
+  }
+  
+  /* A sequence of frames needs a pattern for the output paths */
+  if ((m_frames > 1) && (strchr(pOutPath, '#') == NULL)) {
+    fprintf(stderr,
+      "%s: Output path must contain # to render several frames!\n",
+      pModule);
+    raiseErr(__LINE__);
+  }
+  
+  /* Parse the mode and set the state variables and m_dconv */
   if (strcmp(pMode, "vector") == 0) {
     m_inter = INTER_VECTOR;
     m_vmode = VMODE_3D;
-    dconv = SPH_IMAGE_DOWN_RGB;
+    m_dconv = SPH_IMAGE_DOWN_RGB;
+    
+  } else if (strcmp(pMode, "octa") == 0) {
+    m_inter = INTER_VECTOR;
+    m_vmode = VMODE_3D;
+    m_venc = VENC_OCTA;
+    m_dconv = SPH_IMAGE_DOWN_RGB;
     
   } else if (strcmp(pMode, "scalar-x") == 0) {
     m_inter = INTER_SCALAR;
     m_vmode = VMODE_X;
-    dconv = SPH_IMAGE_DOWN_GRAY;
+    m_dconv = SPH_IMAGE_DOWN_GRAY;
     
   } else if (strcmp(pMode, "scalar-y") == 0) {
     m_inter = INTER_SCALAR;
     m_vmode = VMODE_Y;
-    dconv = SPH_IMAGE_DOWN_GRAY;
+    m_dconv = SPH_IMAGE_DOWN_GRAY;
     
   } else {
     fprintf(stderr, "%s: Unrecognized mode '%s'!\n", pModule, pMode);
     raiseErr(__LINE__);
   }
   
-  /* Open the mesh file as a Shastina source and assign ownership of the
-   * file handle to the Shastina source object */
-  pIn = fopen(pMeshPath, "rb");
-  if (pIn != NULL) {
-    pSrc = snsource_file(pIn, 1);
-    pIn = NULL;
-    
-  } else {
-    fprintf(stderr, "%s: Can't open mesh file!\n", pModule);
-    raiseErr(__LINE__);
-  }
-
-  /* Parse the input file and build the mesh representation */
-  pMesh = lilac_mesh_new(pSrc, &errcode, &line_num);
-  if (pMesh == NULL) {
-    if (line_num > 0) {
-      fprintf(stderr, "%s: Mesh error: [line %ld] %s!\n",
-                pModule, line_num, lilac_mesh_errstr(errcode));
-    } else {
-      fprintf(stderr, "%s: Mesh error: %s!\n",
-                pModule, lilac_mesh_errstr(errcode));
-    }
-    raiseErr(__LINE__);
-  }
-  
-  /* Consume the rest of input, making sure nothing remains in file */
-  if (snsource_consume(pSrc) <= 0) {
-    fprintf(stderr, "%s: Failed to consume mesh input after |;\n", 
-              pModule);
-    raiseErr(__LINE__);
+  /* Load the keyframe meshes, and check that they all share the
+   * topology of the first one */
+  for(f = 0; f < m_key_count; f++) {
+    pKeys[f] = loadMesh(pKeyPath[f]);
   }
-  
-  /* Release the Shastina source, as well as any file handle owned by
-   * the source */
-  snsource_free(pSrc);
-  pSrc = NULL;
+  pMesh = pKeys[0];
+  keys_check();
   
   /* Initialize graphics buffer according to the last one or two
-   * parameters */
+   * parameters; a dry run only gets the dimensions */
   if (argc == 5) {
-    /* We were passed a path to a mask PNG file */
-    initBufMask(argv[4]);
+    /* We were passed a path to a mask file */
+    if (m_dry) {
+      maskDim(argv[4]);
+    } else {
+      initBufMask(argv[4]);
+    }
     
   } else if (argc == 6) {
     /* We were passed two integer dimensions */
-    initBufDim(parseInt32Arg(argv[4]), parseInt32Arg(argv[5]));
+    if (m_dry) {
+      m_w = parseInt32Arg(argv[4]);
+      m_h = parseInt32Arg(argv[5]);
+      checkDim(m_w, m_h);
+    } else {
+      initBufDim(parseInt32Arg(argv[4]), parseInt32Arg(argv[5]));
+    }
     
   } else {
     raiseErr(__LINE__);
@@ -1859,7 +5510,8 @@ int main(int argc, char *argv[]) {
   /* Allocate a vertex array with one vertex per vertex in the lilac
    * mesh; leave as NULL if no points */
   if (pMesh->point_count > 0) {
-    pva = (VERTEX *) calloc(
+    pva = (VERTEX *) lilac_mesh_mem_alloc(
+                      LILAC_MESH_MEM_VERTEX,
                       (size_t) pMesh->point_count, sizeof(VERTEX));
     if (pva == NULL) {
       fprintf(stderr, "%s: Memory allocation failed!\n", pModule);
@@ -1869,62 +5521,112 @@ int main(int argc, char *argv[]) {
   } else {
     pva = NULL;
   }
-
-  /* Get a vertex conversion for each lilac mesh vertex */
-  for(i = 0; i < pMesh->point_count; i++) {
-    convertVertex(&(pva[i]), &((pMesh->pPoints)[i]));
+  
+  /* A dry run only predicts the memory; a single frame is rendered and
+   * then written from the pixel buffer directly */
+  if (m_dry) {
+    dryRun();
+    
+  } else if (m_frames == 1) {
+    renderFrame(0);
+    
+    start = clockTime(CLOCK_MONOTONIC);
+    writeImage(pOutPath, pBuf);
+    
+    /* Report the output time if requested */
+    if (m_stats) {
+      fprintf(stderr, "%s: Wrote output in %.3f s\n",
+              pModule, clockTime(CLOCK_MONOTONIC) - start);
+    }
+  
+  /* For a sequence, keep a copy of the initial pixel buffer, and write
+   * each frame on the writer thread while the next frame renders */
+  } else {
+    pMaskBuf = (uint32_t *) lilac_mesh_mem_alloc(
+                              LILAC_MESH_MEM_FRAME,
+                              m_buf_len, sizeof(uint32_t));
+    pBack = (uint32_t *) lilac_mesh_mem_alloc(
+                              LILAC_MESH_MEM_FRAME,
+                              m_buf_len, sizeof(uint32_t));
+    if ((pMaskBuf == NULL) || (pBack == NULL)) {
+      fprintf(stderr, "%s: Memory buffer allocation failed!\n",
+              pModule);
+      raiseErr(__LINE__);
+    }
+    memcpy(pMaskBuf, pBuf, m_buf_len * sizeof(uint32_t));
+    
+    start = clockTime(CLOCK_MONOTONIC);
+    for(f = 0; f < m_frames; f++) {
+      frame_start = lilac_trace_now();
+      if (f > 0) {
+        memcpy(pBuf, pMaskBuf, m_buf_len * sizeof(uint32_t));
+      }
+      renderFrame(f);
+      lilac_trace_span("frame", frame_start, "frame", (long) f);
+      
+      frame_start = lilac_trace_now();
+      writer_finish();
+      lilac_trace_span("wait for writer", frame_start, NULL, 0);
+      writer_start(framePath(pOutPath, f));
+    }
+    writer_finish();
+    
+    /* Report the sequence time if requested */
+    if (m_stats) {
+      fprintf(stderr, "%s: Rendered and wrote %ld frames in %.3f s\n",
+              pModule, (long) m_frames,
+              clockTime(CLOCK_MONOTONIC) - start);
+    }
+    
+    lilac_mesh_mem_free(pMaskBuf);
+    pMaskBuf = NULL;
+    lilac_mesh_mem_free(pBack);
+    pBack = NULL;
   }
-
-  /* Render each triangle in the mesh, using the converted vertex
-   * buffer */
-  for(i = 0; i < pMesh->tri_count; i++) {
-    renderTri(
-      &(pva[(pMesh->pTris)[(i * 3)    ]]),
-      &(pva[(pMesh->pTris)[(i * 3) + 1]]),
-      &(pva[(pMesh->pTris)[(i * 3) + 2]])
-    );
+  
+  /* Release the pixel buffer, the reference buffer, and the vertex
+   * array if allocated */
+  lilac_mesh_mem_free(pBuf);
+  pBuf = NULL;
+  
+  if (pRef != NULL) {
+    lilac_mesh_mem_free(pRef);
+    pRef = NULL;
   }
   
-  /* Release vertex array if allocated */
   if (pva != NULL) {
-    free(pva);
+    lilac_mesh_mem_free(pva);
     pva = NULL;
   }
   
-  /* Release the mesh object */
-  lilac_mesh_free(pMesh);
+  /* Release the keyframe meshes */
+  for(f = 0; f < m_key_count; f++) {
+    lilac_mesh_free(pKeys[f]);
+    pKeys[f] = NULL;
+  }
   pMesh = NULL;
   
-  /* @@TODO: handle pixels that weren't written yet */
-  
-  /* Allocate an image writer for writing the image buffer to output */
-  pw = sph_image_writer_newFromPath(
-          pOutPath, m_w, m_h, dconv, 0, &errcode);
-  if (pw == NULL) {
-    fprintf(stderr, "%s: Failed to open PNG output: %s!\n",
-            pModule, sph_image_errorString(errcode));
-    raiseErr(__LINE__);
+  /* Report the interpolation check results if requested */
+  if (m_check) {
+    fprintf(stderr,
+      "%s: Interpolation check: %ld pixels, %ld differ, "
+      "max deviation R %d G %d B %d\n",
+      pModule, (long) m_check_count, (long) m_check_diff,
+      m_check_max[0], m_check_max[1], m_check_max[2]);
   }
   
-  /* Transfer each scanline to output */
-  ps = pBuf;
-  for(y = 0; y < m_h; y++) {
-    /* Copy scanline into output buffer */
-    memcpy(
-      sph_image_writer_ptr(pw),
-      ps,
-      ((size_t) m_w) * sizeof(uint32_t));
-    
-    /* Advance scanline pointer */
-    ps += m_w;
-    
-    /* Write to output */
-    sph_image_writer_write(pw);
+  /* Report the memory use if requested */
+  if (m_stats) {
+    reportMemory();
   }
   
-  /* Close image writer */
-  sph_image_writer_close(pw);
-  pw = NULL;
+  /* @@TODO: handle pixels that weren't written yet */
+  
+  /* Write the trace file if tracing */
+  if (!lilac_trace_close()) {
+    fprintf(stderr, "%s: Failed to write trace file!\n", pModule);
+    raiseErr(__LINE__);
+  }
   
   /* If we got here, return successfully */
   return 0;
@@ -0,0 +1,859 @@
+/*
+ * lilacmeinfo.c
+ * =============
+ * 
+ * Utility program that reports statistics about Lilac meshes.
+ * 
+ * Syntax
+ * ------
+ * 
+ *   lilacmeinfo [options] [path] ...
+ * 
+ * [options] is a sequence of zero or more options, each of which begins
+ * with "--".  The following options are supported:
+ * 
+ *   --counts
+ * 
+ *     Only report the point and triangle counts, as one line per mesh
+ *     with the path, the point count, and the triangle count separated
+ *     by spaces.  For Shastina text meshes, only the header of the file
+ *     is read, so this is very fast even for large and compressed
+ *     files.  Compact binary meshes are decoded completely.
+ * 
+ *   --threads [n]
+ * 
+ *     Inspect meshes on n threads, in range [1, 64].  The default is
+ *     one.  The reports are always written in the same order.
+ * 
+ *   --trace-out [file]
+ * 
+ *     Record a timeline of the run and write it to the given file as a
+ *     Chrome trace event JSON file, which can be opened in a trace
+ *     viewer such as chrome://tracing or Perfetto.  The timeline has a
+ *     row for each thread, with a span for each mesh inspected, and
+ *     spans within it for reading the mesh and for the header,
+ *     tokenizing, interpreting, and validating steps of the parser.
+ * 
+ * Each [path] is either a Lilac mesh or a directory.  A mesh may be in
+ * either format, compressed, or a mesh within a Lilac mesh archive, in
+ * the same way as for lilacme2json.  For a directory, every regular
+ * file directly within it whose name does not begin with a dot is
+ * inspected, in ascending order of name.
+ * 
+ * Reports
+ * -------
+ * 
+ * Without --counts, the report for each mesh is a block of lines
+ * starting with the path.  It has the point and triangle counts, the
+ * bounding box of the points, and the area covered by the triangles as
+ * a percentage of the whole coordinate square.  For the edges, each
+ * edge shared by two triangles counted once, it has the number of
+ * edges, the shortest, mean, and longest edge length in mesh units,
+ * and a histogram of edge lengths in bins from one power of two to the
+ * next.  For the normals, it has the number of points whose normal
+ * faces the viewer, and the smallest, mean, and largest normd value.
+ * 
+ * The reports are written to standard output.  Meshes that can't be
+ * read are reported on standard error, and the other meshes are still
+ * reported.  The exit status is non-zero if any mesh failed.
+ * 
+ * Compilation
+ * -----------
+ * 
+ * Build this program together with the lilac_mesh.c, lilac_source.c,
+ * lilac_archive.c, lilac_pack.c, lilac_parse.c, and lilac_trace.c
+ * modules of Lilac, Shastina, zlib, the math library, and pthreads.  To read
+ * Zstandard-compressed meshes, also define LILAC_SOURCE_ZSTD and link
+ * with libzstd.  It requires POSIX.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "lilac_mesh.h"
+#include "lilac_parse.h"
+#include "lilac_source.h"
+#include "lilac_trace.h"
+#include "shastina.h"
+
+/*
+ * Constants
+ * ---------
+ */
+
+/*
+ * The maximum number of threads.
+ */
+#define MAX_THREADS (64)
+
+/*
+ * The maximum length of a report, including the terminating nul.
+ * 
+ * The longest possible report is well within this limit.
+ */
+#define REPORT_MAX (2048)
+
+/*
+ * The number of bins in the edge length histogram.
+ * 
+ * Bin k counts edges of length at least 2^k and less than 2^(k+1).
+ * Edges are at least one unit long and at most 16384 * sqrt(2) units
+ * long, so bin 14 is the last one that can be used.
+ */
+#define EDGE_BINS (15)
+
+/*
+ * Type declarations
+ * -----------------
+ */
+
+/*
+ * A mesh to inspect and its report.
+ */
+typedef struct {
+  
+  /*
+   * The path to the mesh, which is dynamically allocated.
+   */
+  char *pPath;
+  
+  /*
+   * Non-zero if the report is a statistics report, zero if it is an
+   * error message.
+   */
+  int ok;
+  
+  /*
+   * The length of the report so far, not including the nul.
+   */
+  size_t len;
+  
+  /*
+   * The report, or the error message without the path.
+   */
+  char report[REPORT_MAX];
+  
+} JOB;
+
+/*
+ * Local data
+ * ----------
+ */
+
+/*
+ * The name of this executable module.
+ * 
+ * This is set at the start of the program entrypoint.  It should be
+ * included in error reports from the program.
+ */
+static const char *pModule = NULL;
+
+/*
+ * Non-zero if only the counts are reported.
+ */
+static int m_counts = 0;
+
+/*
+ * The meshes to inspect.
+ * 
+ * m_pJobs is a dynamically allocated array of m_job_cap elements, of
+ * which the first m_job_count are used.
+ */
+static JOB *m_pJobs = NULL;
+static int32_t m_job_count = 0;
+static int32_t m_job_cap = 0;
+
+/*
+ * The index of the next mesh that a worker thread will inspect, which
+ * is protected by m_lock.
+ */
+static int32_t m_job_next = 0;
+static pthread_mutex_t m_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Local functions
+ * ---------------
+ */
+
+/* Prototypes */
+static void appendf(JOB *pj, const char *pFmt, ...);
+static void addJob(const char *pPath);
+static int cmpName(const void *pA, const void *pB);
+static int addPath(const char *pPath);
+
+static LILAC_MESH *loadMesh(JOB *pj);
+static void inspectCounts(JOB *pj);
+static void inspectFull(JOB *pj);
+static int cmpEdge(const void *pA, const void *pB);
+
+static void *worker(void *pArg);
+
+/*
+ * Append formatted text to the report of a job.
+ * 
+ * Text beyond the capacity of the report is dropped.
+ * 
+ * Parameters:
+ * 
+ *   pj - the job
+ * 
+ *   pFmt - the printf format string
+ * 
+ *   ... - the format arguments
+ */
+static void appendf(JOB *pj, const char *pFmt, ...) {
+  
+  int n = 0;
+  va_list ap;
+  
+  if (pj->len >= REPORT_MAX - 1) {
+    return;
+  }
+  
+  va_start(ap, pFmt);
+  n = vsnprintf(
+        &((pj->report)[pj->len]), REPORT_MAX - pj->len, pFmt, ap);
+  va_end(ap);
+  
+  if (n > 0) {
+    pj->len += (size_t) n;
+    if (pj->len > REPORT_MAX - 1) {
+      pj->len = REPORT_MAX - 1;
+    }
+  }
+}
+
+/*
+ * Add a mesh to the list of meshes to inspect.
+ * 
+ * Parameters:
+ * 
+ *   pPath - the path to the mesh, which is copied
+ */
+static void addJob(const char *pPath) {
+  
+  JOB *pNew = NULL;
+  
+  if (m_job_count >= m_job_cap) {
+    if (m_job_cap < 1) {
+      m_job_cap = 64;
+    } else {
+      m_job_cap *= 2;
+    }
+    pNew = (JOB *) realloc(m_pJobs, ((size_t) m_job_cap) * sizeof(JOB));
+    if (pNew == NULL) {
+      abort();
+    }
+    m_pJobs = pNew;
+  }
+  
+  memset(&(m_pJobs[m_job_count]), 0, sizeof(JOB));
+  m_pJobs[m_job_count].pPath = (char *) malloc(strlen(pPath) + 1);
+  if (m_pJobs[m_job_count].pPath == NULL) {
+    abort();
+  }
+  strcpy(m_pJobs[m_job_count].pPath, pPath);
+  m_job_count++;
+}
+
+/*
+ * Comparison function for sorting jobs by path.
+ * 
+ * Parameters:
+ * 
+ *   pA - the first job
+ * 
+ *   pB - the second job
+ * 
+ * Return:
+ * 
+ *   less than, equal to, or greater than zero
+ */
+static int cmpName(const void *pA, const void *pB) {
+  return strcmp(((const JOB *) pA)->pPath, ((const JOB *) pB)->pPath);
+}
+
+/*
+ * Add a program argument path to the list of meshes to inspect.
+ * 
+ * Directories are expanded to the regular files within them, sorted by
+ * name.  Anything else is added as it is, so that archive references
+ * and missing files are reported when they are inspected.
+ * 
+ * Parameters:
+ * 
+ *   pPath - the path
+ * 
+ * Return:
+ * 
+ *   non-zero if successful, zero if a directory could not be read
+ */
+static int addPath(const char *pPath) {
+  
+  int32_t first = 0;
+  size_t dlen = 0;
+  char *pFull = NULL;
+  DIR *pDir = NULL;
+  struct dirent *pEnt = NULL;
+  struct stat st;
+  
+  memset(&st, 0, sizeof(struct stat));
+  
+  if ((stat(pPath, &st) != 0) || (!S_ISDIR(st.st_mode))) {
+    addJob(pPath);
+    return 1;
+  }
+  
+  pDir = opendir(pPath);
+  if (pDir == NULL) {
+    fprintf(stderr, "%s: %s: Can't read directory!\n", pModule, pPath);
+    return 0;
+  }
+  
+  first = m_job_count;
+  dlen = strlen(pPath);
+  for(pEnt = readdir(pDir); pEnt != NULL; pEnt = readdir(pDir)) {
+    if ((pEnt->d_name)[0] == '.') {
+      continue;
+    }
+  
+    pFull = (char *) malloc(dlen + strlen(pEnt->d_name) + 2);
+    if (pFull == NULL) {
+      abort();
+    }
+    strcpy(pFull, pPath);
+    if ((dlen < 1) || (pPath[dlen - 1] != '/')) {
+      strcat(pFull, "/");
+    }
+    strcat(pFull, pEnt->d_name);
+  
+    if ((stat(pFull, &st) == 0) && S_ISREG(st.st_mode)) {
+      addJob(pFull);
+    }
+  
+    free(pFull);
+    pFull = NULL;
+  }
+  closedir(pDir);
+  
+  if (m_job_count - first > 1) {
+    qsort(&(m_pJobs[first]), (size_t) (m_job_count - first),
+            sizeof(JOB), &cmpName);
+  }
+  
+  return 1;
+}
+
+/*
+ * Load a mesh in either format with lilac_parse_load().
+ * 
+ * Upon failure, the error message is written to the report of the job.
+ * 
+ * Parameters:
+ * 
+ *   pj - the job
+ * 
+ * Return:
+ * 
+ *   the mesh, or NULL if failure
+ */
+static LILAC_MESH *loadMesh(JOB *pj) {
+  
+  int srcerr = 0;
+  int errcode = 0;
+  long line_num = 0;
+  LILAC_MESH *pMesh = NULL;
+  
+  pMesh = lilac_parse_load(pj->pPath, 1, &srcerr, &errcode, &line_num);
+  if (pMesh == NULL) {
+    if (srcerr) {
+      appendf(pj, "%s", lilac_source_errstr(srcerr));
+    } else {
+      if (line_num > 0) {
+        appendf(pj, "[line %ld] ", line_num);
+      }
+      appendf(pj, "%s", lilac_mesh_errstr(errcode));
+    }
+  }
+  
+  return pMesh;
+}
+
+/*
+ * Inspect the counts of a mesh.
+ * 
+ * Parameters:
+ * 
+ *   pj - the job
+ */
+static void inspectCounts(JOB *pj) {
+  
+  int status = 1;
+  int errcode = 0;
+  long line_num = 0;
+  int32_t point_count = 0;
+  int32_t tri_count = 0;
+  double start = 0.0;
+  SNSOURCE *pIn = NULL;
+  LILAC_MESH *pMesh = NULL;
+  
+  /* Read just the header of text meshes */
+  start = lilac_trace_now();
+  pIn = lilac_source_open(pj->pPath, &errcode);
+  if (pIn == NULL) {
+    status = 0;
+    appendf(pj, "%s", lilac_source_errstr(errcode));
+  }
+  
+  if (status) {
+    if (!lilac_mesh_dim(
+            pIn, &point_count, &tri_count, &errcode, &line_num)) {
+      status = 0;
+    }
+    snsource_free(pIn);
+    pIn = NULL;
+    lilac_trace_span("header", start, NULL, 0);
+  
+    /* Anything without a text header may be a compact mesh, so load it
+     * completely to report it in any case */
+    if (!status) {
+      status = 1;
+      pMesh = loadMesh(pj);
+      if (pMesh == NULL) {
+        status = 0;
+      } else {
+        point_count = pMesh->point_count;
+        tri_count = pMesh->tri_count;
+      }
+      lilac_mesh_free(pMesh);
+      pMesh = NULL;
+    }
+  }
+  
+  if (status) {
+    pj->ok = 1;
+    appendf(pj, "%s %ld %ld\n",
+              pj->pPath, (long) point_count, (long) tri_count);
+  }
+}
+
+/*
+ * Comparison function for sorting undirected edge keys.
+ * 
+ * Parameters:
+ * 
+ *   pA - the first key
+ * 
+ *   pB - the second key
+ * 
+ * Return:
+ * 
+ *   less than, equal to, or greater than zero
+ */
+static int cmpEdge(const void *pA, const void *pB) {
+  
+  uint32_t a = 0;
+  uint32_t b = 0;
+  
+  a = *((const uint32_t *) pA);
+  b = *((const uint32_t *) pB);
+  
+  if (a < b) {
+    return -1;
+  } else if (a > b) {
+    return 1;
+  }
+  return 0;
+}
+
+/*
+ * Inspect a mesh and write the full statistics report.
+ * 
+ * Parameters:
+ * 
+ *   pj - the job
+ */
+static void inspectFull(JOB *pj) {
+  
+  int32_t i = 0;
+  int32_t k = 0;
+  int32_t a = 0;
+  int32_t b = 0;
+  int32_t dx = 0;
+  int32_t dy = 0;
+  int32_t edge_count = 0;
+  int32_t facing = 0;
+  int32_t x_min = 0;
+  int32_t x_max = 0;
+  int32_t y_min = 0;
+  int32_t y_max = 0;
+  int32_t nd_min = 0;
+  int32_t nd_max = 0;
+  int64_t nd_sum = 0;
+  int64_t area2 = 0;
+  double len = 0.0;
+  double len_min = 0.0;
+  double len_max = 0.0;
+  double len_sum = 0.0;
+  double bin_top = 0.0;
+  int32_t bins[EDGE_BINS];
+  
+  const LILAC_MESH_POINT *pp = NULL;
+  const LILAC_MESH_POINT *pa = NULL;
+  const LILAC_MESH_POINT *pb = NULL;
+  const LILAC_MESH_POINT *pc = NULL;
+  const uint16_t *pt = NULL;
+  uint32_t *pEdges = NULL;
+  LILAC_MESH *pMesh = NULL;
+  
+  memset(bins, 0, sizeof(bins));
+  
+  pMesh = loadMesh(pj);
+  if (pMesh == NULL) {
+    return;
+  }
+  
+  /* Points */
+  for(i = 0; i < pMesh->point_count; i++) {
+    pp = &((pMesh->pPoints)[i]);
+    if ((i == 0) || (pp->x < x_min)) {
+      x_min = pp->x;
+    }
+    if ((i == 0) || (pp->x > x_max)) {
+      x_max = pp->x;
+    }
+    if ((i == 0) || (pp->y < y_min)) {
+      y_min = pp->y;
+    }
+    if ((i == 0) || (pp->y > y_max)) {
+      y_max = pp->y;
+    }
+    if ((i == 0) || (pp->normd < nd_min)) {
+      nd_min = pp->normd;
+    }
+    if ((i == 0) || (pp->normd > nd_max)) {
+      nd_max = pp->normd;
+    }
+    nd_sum += pp->normd;
+    if (pp->normd == 0) {
+      facing++;
+    }
+  }
+  
+  /* Triangles, gathering each edge as the lower point index shifted
+   * left 16 bits plus the higher point index */
+  if (pMesh->tri_count > 0) {
+    pEdges = (uint32_t *) calloc(
+                ((size_t) pMesh->tri_count) * 3, sizeof(uint32_t));
+    if (pEdges == NULL) {
+      abort();
+    }
+  }
+  
+  for(i = 0; i < pMesh->tri_count; i++) {
+    pt = &((pMesh->pTris)[i * 3]);
+    pa = &((pMesh->pPoints)[pt[0]]);
+    pb = &((pMesh->pPoints)[pt[1]]);
+    pc = &((pMesh->pPoints)[pt[2]]);
+  
+    area2 += ((int64_t) (((int32_t) pb->x) - ((int32_t) pa->x))) *
+                (((int32_t) pc->y) - ((int32_t) pa->y)) -
+              ((int64_t) (((int32_t) pb->y) - ((int32_t) pa->y))) *
+                (((int32_t) pc->x) - ((int32_t) pa->x));
+  
+    for(k = 0; k < 3; k++) {
+      a = pt[k];
+      b = pt[(k + 1) % 3];
+      if (a > b) {
+        a = pt[(k + 1) % 3];
+        b = pt[k];
+      }
+      pEdges[i * 3 + k] = (((uint32_t) a) << 16) | ((uint32_t) b);
+    }
+  }
+  
+  /* Edges shared by two triangles appear twice, so sort the keys and
+   * measure each distinct edge */
+  if (pMesh->tri_count > 0) {
+    qsort(pEdges, ((size_t) pMesh->tri_count) * 3, sizeof(uint32_t),
+            &cmpEdge);
+  }
+  
+  for(i = 0; i < pMesh->tri_count * 3; i++) {
+    if ((i > 0) && (pEdges[i] == pEdges[i - 1])) {
+      continue;
+    }
+    pa = &((pMesh->pPoints)[pEdges[i] >> 16]);
+    pb = &((pMesh->pPoints)[pEdges[i] & 0xffff]);
+    dx = ((int32_t) pb->x) - ((int32_t) pa->x);
+    dy = ((int32_t) pb->y) - ((int32_t) pa->y);
+    len = sqrt(((double) dx) * dx + ((double) dy) * dy);
+  
+    if ((edge_count == 0) || (len < len_min)) {
+      len_min = len;
+    }
+    if ((edge_count == 0) || (len > len_max)) {
+      len_max = len;
+    }
+    len_sum += len;
+    edge_count++;
+  
+    for(k = 0, bin_top = 2.0; (k < EDGE_BINS - 1) && (len >= bin_top);
+        k++, bin_top *= 2.0);
+    bins[k]++;
+  }
+  
+  free(pEdges);
+  pEdges = NULL;
+  
+  /* Write the report */
+  pj->ok = 1;
+  appendf(pj, "%s\n", pj->pPath);
+  appendf(pj, "  points     %ld\n", (long) pMesh->point_count);
+  appendf(pj, "  triangles  %ld\n", (long) pMesh->tri_count);
+  
+  if (pMesh->point_count > 0) {
+    appendf(pj, "  bounds     x %ld to %ld, y %ld to %ld\n",
+              (long) x_min, (long) x_max, (long) y_min, (long) y_max);
+  }
+  
+  appendf(pj, "  area       %.2f%%\n",
+            ((double) area2) * 50.0 /
+              (((double) LILAC_MESH_MAX_C) * LILAC_MESH_MAX_C));
+  
+  if (edge_count > 0) {
+    appendf(pj, "  edges      %ld, length min %.1f mean %.1f max %.1f\n",
+              (long) edge_count, len_min, len_sum / edge_count, len_max);
+    for(k = 0; k < EDGE_BINS; k++) {
+      if (bins[k] > 0) {
+        appendf(pj, "    [%ld, %ld)  %ld\n",
+                  (long) (((int32_t) 1) << k),
+                  (long) (((int32_t) 1) << (k + 1)),
+                  (long) bins[k]);
+      }
+    }
+  }
+  
+  if (pMesh->point_count > 0) {
+    appendf(pj, "  normals    %ld facing, normd min %ld mean %.1f max %ld\n",
+              (long) facing, (long) nd_min,
+              ((double) nd_sum) / pMesh->point_count, (long) nd_max);
+  }
+  
+  lilac_mesh_free(pMesh);
+  pMesh = NULL;
+}
+
+/*
+ * Worker thread that inspects meshes until none are left.
+ * 
+ * The entrypoint also runs this function on its own thread.
+ * 
+ * Parameters:
+ * 
+ *   pArg - ignored
+ * 
+ * Return:
+ * 
+ *   NULL
+ */
+static void *worker(void *pArg) {
+  
+  int32_t i = 0;
+  double start = 0.0;
+  
+  /* Name the worker threads other than the main thread */
+  if (pArg != NULL) {
+    lilac_trace_thread("worker", *((const long *) pArg));
+  }
+  
+  for(;;) {
+    pthread_mutex_lock(&m_lock);
+    i = m_job_next;
+    if (i < m_job_count) {
+      m_job_next++;
+    }
+    pthread_mutex_unlock(&m_lock);
+  
+    if (i >= m_job_count) {
+      break;
+    }
+  
+    start = lilac_trace_now();
+    if (m_counts) {
+      inspectCounts(&(m_pJobs[i]));
+    } else {
+      inspectFull(&(m_pJobs[i]));
+    }
+    lilac_trace_span("mesh", start, "job", (long) i);
+  }
+  
+  return NULL;
+}
+
+/*
+ * Program entrypoint
+ * ------------------
+ */
+
+int main(int argc, char *argv[]) {
+  
+  int status = 1;
+  int x = 0;
+  int argi = 1;
+  long threads = 1;
+  int started = 0;
+  char *endptr = NULL;
+  const char *pTracePath = NULL;
+  pthread_t tids[MAX_THREADS];
+  long ids[MAX_THREADS];
+  
+  memset(tids, 0, sizeof(tids));
+  memset(ids, 0, sizeof(ids));
+  
+  /* Get module name */
+  pModule = NULL;
+  if ((argc > 0) && (argv != NULL)) {
+    pModule = argv[0];
+  }
+  if (pModule == NULL) {
+    pModule = "lilacmeinfo";
+  }
+  
+  /* Check argv */
+  if (argc > 0) {
+    if (argv == NULL) {
+      abort();
+    }
+    for(x = 0; x < argc; x++) {
+      if (argv[x] == NULL) {
+        abort();
+      }
+    }
+  }
+  
+  /* Get the options */
+  for(argi = 1; status && (argi < argc); argi++) {
+    if (strncmp(argv[argi], "--", 2) != 0) {
+      break;
+    }
+  
+    if (strcmp(argv[argi], "--counts") == 0) {
+      m_counts = 1;
+  
+    } else if (strcmp(argv[argi], "--threads") == 0) {
+      if (argi >= argc - 1) {
+        status = 0;
+        fprintf(stderr, "%s: Option --threads requires a value!\n",
+                  pModule);
+      } else {
+        argi++;
+        errno = 0;
+        threads = strtol(argv[argi], &endptr, 10);
+        if (errno || (endptr == argv[argi]) || (*endptr != 0) ||
+            (threads < 1) || (threads > MAX_THREADS)) {
+          status = 0;
+          fprintf(stderr, "%s: Thread count out of range!\n", pModule);
+        }
+      }
+  
+    } else if (strcmp(argv[argi], "--trace-out") == 0) {
+      if (argi >= argc - 1) {
+        status = 0;
+        fprintf(stderr, "%s: Option --trace-out requires a value!\n",
+                  pModule);
+      } else {
+        argi++;
+        pTracePath = argv[argi];
+      }
+  
+    } else {
+      status = 0;
+      fprintf(stderr, "%s: Unknown option: %s\n", pModule, argv[argi]);
+    }
+  }
+  
+  /* Check number of parameters */
+  if (status && (argi >= argc)) {
+    status = 0;
+    fprintf(stderr, "%s: Wrong number of arguments!\n", pModule);
+  }
+  
+  /* Start tracing if requested */
+  if (status && (pTracePath != NULL)) {
+    if (lilac_trace_open(pTracePath)) {
+      lilac_trace_thread("main", -1);
+    } else {
+      status = 0;
+      fprintf(stderr, "%s: Can't create trace file!\n", pModule);
+    }
+  }
+  
+  /* Gather the meshes */
+  if (status) {
+    for( ; argi < argc; argi++) {
+      if (!addPath(argv[argi])) {
+        status = 0;
+      }
+    }
+  }
+  
+  /* Inspect the meshes on all the threads, including this one */
+  if (m_job_count > 0) {
+    if (threads > m_job_count) {
+      threads = m_job_count;
+    }
+    for(x = 1; x < threads; x++) {
+      ids[x] = (long) x;
+      if (pthread_create(&(tids[x]), NULL, &worker, &(ids[x])) != 0) {
+        break;
+      }
+      started++;
+    }
+  
+    worker(NULL);
+  
+    for(x = 1; x <= started; x++) {
+      pthread_join(tids[x], NULL);
+    }
+  }
+  
+  /* Write the reports in order */
+  for(x = 0; x < m_job_count; x++) {
+    if (m_pJobs[x].ok) {
+      fputs(m_pJobs[x].report, stdout);
+    } else {
+      status = 0;
+      fprintf(stderr, "%s: %s: %s!\n",
+                pModule, m_pJobs[x].pPath, m_pJobs[x].report);
+    }
+    free(m_pJobs[x].pPath);
+    m_pJobs[x].pPath = NULL;
+  }
+  
+  free(m_pJobs);
+  m_pJobs = NULL;
+  
+  /* Write the trace file if tracing */
+  if (!lilac_trace_close()) {
+    status = 0;
+    fprintf(stderr, "%s: Failed to write trace file!\n", pModule);
+  }
+  
+  /* Invert status and return */
+  if (status) {
+    status = 0;
+  } else {
+    status = 1;
+  }
+  return status;
+}
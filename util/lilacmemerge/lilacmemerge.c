@@ -0,0 +1,678 @@
+/*
+ * lilacmemerge.c
+ * ==============
+ * 
+ * Utility program that merges several Lilac meshes into one, welding
+ * together points that coincide.
+ * 
+ * Syntax
+ * ------
+ * 
+ *   lilacmemerge [options] [output] [input] ...
+ * 
+ * [options] is a sequence of zero or more options, each of which begins
+ * with "--".  The following options are supported:
+ * 
+ *   --weld [d]
+ * 
+ *     Weld points that are at most d units apart, measured as Euclidean
+ *     distance in mesh coordinates, in range [0, 16384].  The default
+ *     of zero only welds points at exactly the same position.
+ * 
+ *   --pack
+ * 
+ *     Write the output in the compact binary mesh format instead of as
+ *     a Shastina text mesh.
+ * 
+ * [output] is the path to the merged mesh to write.  Each [input] is
+ * the path to a Lilac mesh in either format, which may be compressed or
+ * be a mesh within a Lilac mesh archive, in the same way as for
+ * lilacmepack.  At least one input is required.
+ * 
+ * Welding
+ * -------
+ * 
+ * The points of all the inputs are visited in order, the inputs in the
+ * order given and the points of each input in index order.  A point
+ * that is within the weld distance of a point already kept is welded to
+ * the first such point, and otherwise it is kept.  Welded points take
+ * the position and normal of the point they are welded to.  Kept points
+ * are found through a spatial hash of grid cells one more than the weld
+ * distance wide, so each point only needs to be compared with the kept
+ * points in the nine cells around it, and merging takes time close to
+ * linear in the size of the inputs.
+ * 
+ * After the triangles are renumbered, triangles with two vertices
+ * welded into one point, and triangles whose points became colinear,
+ * are dropped.  When the inputs overlap, the same triangle may appear
+ * more than once, and only one copy is kept.  Points that are left
+ * without any triangle are dropped.  The triangles are then rotated and
+ * sorted into the canonical order of the mesh format.
+ * 
+ * The merged mesh must satisfy all the rules of the mesh format,
+ * including the limits on the number of points and triangles.  Welding
+ * may flip a triangle, and overlapping inputs may share a directed edge
+ * between different triangles, and both are reported as errors.
+ * 
+ * Compilation
+ * -----------
+ * 
+ * Build this program together with the lilac_mesh.c, lilac_source.c,
+ * lilac_archive.c, lilac_pack.c, lilac_parse.c, and lilac_trace.c
+ * modules of Lilac, Shastina, zlib, and pthreads.  To read
+ * Zstandard-compressed meshes, also define LILAC_SOURCE_ZSTD and link
+ * with libzstd.
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lilac_mesh.h"
+#include "lilac_pack.h"
+#include "lilac_parse.h"
+#include "lilac_source.h"
+#include "shastina.h"
+
+/*
+ * Constants
+ * ---------
+ */
+
+/*
+ * Key value of an empty cell in the spatial hash table.
+ */
+#define CELL_EMPTY (UINT32_MAX)
+
+/*
+ * Local data
+ * ----------
+ */
+
+/*
+ * The name of this executable module.
+ * 
+ * This is set at the start of the program entrypoint.  It should be
+ * included in error reports from the program.
+ */
+static const char *pModule = NULL;
+
+/*
+ * Local functions
+ * ---------------
+ */
+
+/* Prototypes */
+static int parseDist(const char *pStr, int32_t *pDist);
+static LILAC_MESH *loadMesh(const char *pPath);
+
+static uint32_t cellHome(uint32_t key, int bits);
+static int cmpTri(const void *pA, const void *pB);
+
+static LILAC_MESH *mergeMeshes(
+    LILAC_MESH ** ppIn,
+    int           count,
+    int32_t       dist,
+    int         * pErrCode);
+
+/*
+ * Parse the weld distance program argument.
+ * 
+ * Parameters:
+ * 
+ *   pStr - the argument to parse
+ * 
+ *   pDist - receives the distance
+ * 
+ * Return:
+ * 
+ *   non-zero if successful, zero if the argument is not a decimal
+ *   integer in range
+ */
+static int parseDist(const char *pStr, int32_t *pDist) {
+  
+  long v = 0;
+  char *endptr = NULL;
+  
+  /* Check parameters */
+  if ((pStr == NULL) || (pDist == NULL)) {
+    abort();
+  }
+  
+  if ((pStr[0] < '0') || (pStr[0] > '9')) {
+    return 0;
+  }
+  
+  errno = 0;
+  v = strtol(pStr, &endptr, 10);
+  if (errno || (endptr == NULL) || (*endptr != 0)) {
+    return 0;
+  }
+  if ((v < 0) || (v > LILAC_MESH_MAX_C)) {
+    return 0;
+  }
+  
+  *pDist = (int32_t) v;
+  return 1;
+}
+
+/*
+ * Load a mesh in either format with lilac_parse_load().
+ * 
+ * Errors are reported on standard error, together with the path.
+ * 
+ * Parameters:
+ * 
+ *   pPath - the path to the mesh
+ * 
+ * Return:
+ * 
+ *   the mesh, or NULL if failure
+ */
+static LILAC_MESH *loadMesh(const char *pPath) {
+  
+  int srcerr = 0;
+  int errcode = 0;
+  long line_num = 0;
+  LILAC_MESH *pMesh = NULL;
+  
+  pMesh = lilac_parse_load(pPath, 1, &srcerr, &errcode, &line_num);
+  if (pMesh == NULL) {
+    if (srcerr) {
+      fprintf(stderr, "%s: %s: %s!\n",
+                pModule, pPath, lilac_source_errstr(srcerr));
+    } else if (line_num > 0) {
+      fprintf(stderr, "%s: %s: [line %ld] %s!\n",
+                pModule, pPath, line_num, lilac_mesh_errstr(errcode));
+    } else {
+      fprintf(stderr, "%s: %s: %s!\n",
+                pModule, pPath, lilac_mesh_errstr(errcode));
+    }
+  }
+  
+  return pMesh;
+}
+
+/*
+ * Get the home slot of a cell key in the spatial hash table.
+ * 
+ * Parameters:
+ * 
+ *   key - the cell key
+ * 
+ *   bits - the base-2 logarithm of the table size
+ * 
+ * Return:
+ * 
+ *   the home slot
+ */
+static uint32_t cellHome(uint32_t key, int bits) {
+  return (uint32_t) ((key * UINT32_C(2654435761)) >> (32 - bits));
+}
+
+/*
+ * Comparison function for sorting renumbered triangles, which are
+ * stored as three int32_t vertex indices.
+ * 
+ * Triangles are ordered by all three vertices, so that copies of the
+ * same triangle end up next to each other.
+ * 
+ * Parameters:
+ * 
+ *   pA - the first triangle
+ * 
+ *   pB - the second triangle
+ * 
+ * Return:
+ * 
+ *   less than, equal to, or greater than zero
+ */
+static int cmpTri(const void *pA, const void *pB) {
+  
+  const int32_t *pa = NULL;
+  const int32_t *pb = NULL;
+  int i = 0;
+  
+  pa = (const int32_t *) pA;
+  pb = (const int32_t *) pB;
+  
+  for(i = 0; i < 3; i++) {
+    if (pa[i] < pb[i]) {
+      return -1;
+    } else if (pa[i] > pb[i]) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*
+ * Merge meshes, welding points within a distance of each other.
+ * 
+ * See the program documentation at the top of this file for the
+ * details.
+ * 
+ * Parameters:
+ * 
+ *   ppIn - the input meshes
+ * 
+ *   count - the number of input meshes, at least one
+ * 
+ *   dist - the weld distance
+ * 
+ *   pErrCode - receives the error code if the merged mesh is invalid
+ * 
+ * Return:
+ * 
+ *   the merged mesh, or NULL if it breaks a rule of the mesh format
+ */
+static LILAC_MESH *mergeMeshes(
+    LILAC_MESH ** ppIn,
+    int           count,
+    int32_t       dist,
+    int         * pErrCode) {
+  
+  int m = 0;
+  int bits = 0;
+  int32_t i = 0;
+  int32_t k = 0;
+  int32_t r = 0;
+  int32_t base = 0;
+  int32_t cell = 0;
+  int32_t cx = 0;
+  int32_t cy = 0;
+  int32_t gx = 0;
+  int32_t gy = 0;
+  int32_t dx = 0;
+  int32_t dy = 0;
+  int32_t total_pts = 0;
+  int32_t total_tris = 0;
+  int32_t rep_count = 0;
+  int32_t tri_count = 0;
+  int32_t out_pts = 0;
+  int32_t out_tris = 0;
+  uint32_t key = 0;
+  uint32_t h = 0;
+  uint32_t mask = 0;
+  
+  const LILAC_MESH *pm = NULL;
+  const LILAC_MESH_POINT *pp = NULL;
+  const LILAC_MESH_POINT *pq = NULL;
+  int32_t *pt = NULL;
+  
+  int32_t *pMap = NULL;
+  int32_t *pRepNext = NULL;
+  LILAC_MESH_POINT *pReps = NULL;
+  uint32_t *pCellKey = NULL;
+  int32_t *pCellHead = NULL;
+  int32_t *pTris = NULL;
+  int32_t *pRenum = NULL;
+  uint16_t *pOutTris = NULL;
+  LILAC_MESH *pResult = NULL;
+  
+  /* Check parameters */
+  if ((ppIn == NULL) || (count < 1) ||
+      (dist < 0) || (dist > LILAC_MESH_MAX_C) || (pErrCode == NULL)) {
+    abort();
+  }
+  
+  /* Count the input */
+  for(m = 0; m < count; m++) {
+    total_pts += ppIn[m]->point_count;
+    total_tris += ppIn[m]->tri_count;
+  }
+  
+  /* Allocate the working arrays, with at least one element each, and a
+   * cell table at least twice as large as the number of points */
+  bits = 4;
+  while ((((int32_t) 1) << bits) < total_pts * 2) {
+    bits++;
+  }
+  mask = (((uint32_t) 1) << bits) - 1;
+  
+  pMap = (int32_t *) calloc((size_t) total_pts + 1, sizeof(int32_t));
+  pRepNext = (int32_t *) calloc((size_t) total_pts + 1, sizeof(int32_t));
+  pReps = (LILAC_MESH_POINT *) calloc(
+              (size_t) total_pts + 1, sizeof(LILAC_MESH_POINT));
+  pRenum = (int32_t *) calloc((size_t) total_pts + 1, sizeof(int32_t));
+  pCellKey = (uint32_t *) calloc((size_t) mask + 1, sizeof(uint32_t));
+  pCellHead = (int32_t *) calloc((size_t) mask + 1, sizeof(int32_t));
+  pTris = (int32_t *) calloc(
+              ((size_t) total_tris + 1) * 3, sizeof(int32_t));
+  if ((pMap == NULL) || (pRepNext == NULL) || (pReps == NULL) ||
+      (pRenum == NULL) || (pCellKey == NULL) || (pCellHead == NULL) ||
+      (pTris == NULL)) {
+    abort();
+  }
+  
+  for(h = 0; h <= mask; h++) {
+    pCellKey[h] = CELL_EMPTY;
+  }
+  
+  /* Weld the points of all the inputs in order */
+  base = 0;
+  for(m = 0; m < count; m++) {
+    pm = ppIn[m];
+    for(i = 0; i < pm->point_count; i++) {
+      pp = &((pm->pPoints)[i]);
+      cx = ((int32_t) pp->x) / (dist + 1);
+      cy = ((int32_t) pp->y) / (dist + 1);
+  
+      /* Look for the first kept point within range in the nine cells
+       * around the point; lower indices are earlier points */
+      r = -1;
+      for(gy = cy - 1; gy <= cy + 1; gy++) {
+        for(gx = cx - 1; gx <= cx + 1; gx++) {
+          if ((gx < 0) || (gy < 0)) {
+            continue;
+          }
+          key = (((uint32_t) gx) << 16) | ((uint32_t) gy);
+          for(h = cellHome(key, bits);
+              pCellKey[h] != CELL_EMPTY;
+              h = (h + 1) & mask) {
+            if (pCellKey[h] == key) {
+              break;
+            }
+          }
+          if (pCellKey[h] != key) {
+            continue;
+          }
+  
+          for(cell = pCellHead[h]; cell >= 0; cell = pRepNext[cell]) {
+            if ((r >= 0) && (cell > r)) {
+              continue;
+            }
+            pq = &(pReps[cell]);
+            dx = ((int32_t) pq->x) - ((int32_t) pp->x);
+            dy = ((int32_t) pq->y) - ((int32_t) pp->y);
+            if (dx * dx + dy * dy <= dist * dist) {
+              r = cell;
+            }
+          }
+        }
+      }
+  
+      /* Keep the point if nothing is in range */
+      if (r < 0) {
+        r = rep_count;
+        rep_count++;
+        pReps[r] = *pp;
+  
+        key = (((uint32_t) cx) << 16) | ((uint32_t) cy);
+        for(h = cellHome(key, bits);
+            (pCellKey[h] != CELL_EMPTY) && (pCellKey[h] != key);
+            h = (h + 1) & mask);
+        if (pCellKey[h] == CELL_EMPTY) {
+          pCellKey[h] = key;
+          pCellHead[h] = -1;
+        }
+        pRepNext[r] = pCellHead[h];
+        pCellHead[h] = r;
+      }
+  
+      pMap[base + i] = r;
+    }
+    base += pm->point_count;
+  }
+  
+  /* Renumber the triangles, dropping collapsed ones, and rotate each
+   * triangle so that its lowest vertex comes first */
+  base = 0;
+  for(m = 0; m < count; m++) {
+    pm = ppIn[m];
+    for(i = 0; i < pm->tri_count; i++) {
+      pt = &(pTris[tri_count * 3]);
+      for(k = 0; k < 3; k++) {
+        pt[k] = pMap[base + (pm->pTris)[i * 3 + k]];
+      }
+  
+      if ((pt[0] == pt[1]) || (pt[0] == pt[2]) || (pt[1] == pt[2])) {
+        continue;
+      }
+  
+      dx = (((int32_t) pReps[pt[1]].x) - ((int32_t) pReps[pt[0]].x)) *
+            (((int32_t) pReps[pt[2]].y) - ((int32_t) pReps[pt[0]].y));
+      dy = (((int32_t) pReps[pt[1]].y) - ((int32_t) pReps[pt[0]].y)) *
+            (((int32_t) pReps[pt[2]].x) - ((int32_t) pReps[pt[0]].x));
+      if (dx == dy) {
+        continue;
+      }
+  
+      while ((pt[1] < pt[0]) || (pt[2] < pt[0])) {
+        r = pt[0];
+        pt[0] = pt[1];
+        pt[1] = pt[2];
+        pt[2] = r;
+      }
+      tri_count++;
+    }
+    base += pm->point_count;
+  }
+  
+  /* Sort the triangles and drop copies */
+  if (tri_count > 0) {
+    qsort(pTris, (size_t) tri_count, 3 * sizeof(int32_t), &cmpTri);
+  }
+  
+  for(i = 0; i < tri_count; i++) {
+    if ((out_tris > 0) &&
+        (cmpTri(&(pTris[i * 3]), &(pTris[(out_tris - 1) * 3])) == 0)) {
+      continue;
+    }
+    if (out_tris != i) {
+      memcpy(&(pTris[out_tris * 3]), &(pTris[i * 3]),
+              3 * sizeof(int32_t));
+    }
+    out_tris++;
+  }
+  
+  /* Drop points without triangles; renumbering in ascending order keeps
+   * the triangles rotated and sorted */
+  for(i = 0; i < out_tris * 3; i++) {
+    pRenum[pTris[i]] = 1;
+  }
+  for(i = 0; i < rep_count; i++) {
+    if (pRenum[i]) {
+      pReps[out_pts] = pReps[i];
+      pRenum[i] = out_pts;
+      out_pts++;
+    }
+  }
+  
+  /* Build and check the merged mesh */
+  if (out_pts > LILAC_MESH_MAX_POINTS) {
+    *pErrCode = LILAC_MESH_ERR_PCOUNT;
+  
+  } else if (out_tris > LILAC_MESH_MAX_TRIS) {
+    *pErrCode = LILAC_MESH_ERR_TCOUNT;
+  
+  } else {
+    if (out_tris > 0) {
+      pOutTris = (uint16_t *) calloc(
+                    (size_t) out_tris * 3, sizeof(uint16_t));
+      if (pOutTris == NULL) {
+        abort();
+      }
+      for(i = 0; i < out_tris * 3; i++) {
+        pOutTris[i] = (uint16_t) pRenum[pTris[i]];
+      }
+    }
+  
+    pResult = lilac_mesh_from_arrays(
+                pReps, out_pts, pOutTris, out_tris, 0, pErrCode);
+  }
+  
+  free(pMap);
+  free(pRepNext);
+  free(pReps);
+  free(pRenum);
+  free(pCellKey);
+  free(pCellHead);
+  free(pTris);
+  free(pOutTris);
+  
+  return pResult;
+}
+
+/*
+ * Program entrypoint
+ * ------------------
+ */
+
+int main(int argc, char *argv[]) {
+  
+  int status = 1;
+  int x = 0;
+  int pack = 0;
+  int argi = 1;
+  int in_count = 0;
+  int errcode = 0;
+  int32_t dist = 0;
+  size_t len = 0;
+  const char *pOutPath = NULL;
+  
+  unsigned char *pPacked = NULL;
+  LILAC_MESH **ppIn = NULL;
+  LILAC_MESH *pMesh = NULL;
+  FILE *pOut = NULL;
+  
+  /* Get module name */
+  pModule = NULL;
+  if ((argc > 0) && (argv != NULL)) {
+    pModule = argv[0];
+  }
+  if (pModule == NULL) {
+    pModule = "lilacmemerge";
+  }
+  
+  /* Check argv */
+  if (argc > 0) {
+    if (argv == NULL) {
+      abort();
+    }
+    for(x = 0; x < argc; x++) {
+      if (argv[x] == NULL) {
+        abort();
+      }
+    }
+  }
+  
+  /* Get the options */
+  for(argi = 1; status && (argi < argc); argi++) {
+    if (strncmp(argv[argi], "--", 2) != 0) {
+      break;
+    }
+  
+    if (strcmp(argv[argi], "--weld") == 0) {
+      if (argi >= argc - 1) {
+        status = 0;
+        fprintf(stderr, "%s: Option --weld requires a value!\n",
+                  pModule);
+      } else {
+        argi++;
+        if (!parseDist(argv[argi], &dist)) {
+          status = 0;
+          fprintf(stderr, "%s: Invalid weld distance!\n", pModule);
+        }
+      }
+  
+    } else if (strcmp(argv[argi], "--pack") == 0) {
+      pack = 1;
+  
+    } else {
+      status = 0;
+      fprintf(stderr, "%s: Unknown option: %s\n", pModule, argv[argi]);
+    }
+  }
+  
+  /* Check number of parameters */
+  if (status && (argc - argi < 2)) {
+    status = 0;
+    fprintf(stderr, "%s: Wrong number of arguments!\n", pModule);
+  }
+  
+  /* Load all the input meshes */
+  if (status) {
+    pOutPath = argv[argi];
+    in_count = argc - argi - 1;
+  
+    ppIn = (LILAC_MESH **) calloc((size_t) in_count, sizeof(LILAC_MESH *));
+    if (ppIn == NULL) {
+      abort();
+    }
+  
+    for(x = 0; x < in_count; x++) {
+      ppIn[x] = loadMesh(argv[argi + 1 + x]);
+      if (ppIn[x] == NULL) {
+        status = 0;
+        break;
+      }
+    }
+  }
+  
+  /* Merge the meshes */
+  if (status) {
+    pMesh = mergeMeshes(ppIn, in_count, dist, &errcode);
+    if (pMesh == NULL) {
+      status = 0;
+      fprintf(stderr, "%s: Merged mesh is invalid: %s!\n",
+                pModule, lilac_mesh_errstr(errcode));
+    }
+  }
+  
+  /* Write the output file */
+  if (status) {
+    pOut = fopen(pOutPath, "wb");
+    if (pOut == NULL) {
+      status = 0;
+      fprintf(stderr, "%s: Can't create output file!\n", pModule);
+    }
+  }
+  
+  if (status) {
+    if (pack) {
+      pPacked = lilac_pack_encode(pMesh, &len);
+      if (fwrite(pPacked, 1, len, pOut) != len) {
+        status = 0;
+      }
+      free(pPacked);
+      pPacked = NULL;
+  
+    } else {
+      status = lilac_mesh_write(pMesh, pOut);
+    }
+  
+    if (fclose(pOut)) {
+      status = 0;
+    }
+    pOut = NULL;
+  
+    if (!status) {
+      fprintf(stderr, "%s: Failed to write output file!\n", pModule);
+    }
+  }
+  
+  /* Release the mesh objects if allocated */
+  if (ppIn != NULL) {
+    for(x = 0; x < in_count; x++) {
+      lilac_mesh_free(ppIn[x]);
+      ppIn[x] = NULL;
+    }
+    free(ppIn);
+    ppIn = NULL;
+  }
+  
+  lilac_mesh_free(pMesh);
+  pMesh = NULL;
+  
+  /* Invert status and return */
+  if (status) {
+    status = 0;
+  } else {
+    status = 1;
+  }
+  return status;
+}
@@ -0,0 +1,211 @@
+/*
+ * lilacmepack.c
+ * =============
+ * 
+ * Utility program that converts Lilac meshes between the Shastina text
+ * format and the compact binary mesh format.
+ * 
+ * Syntax
+ * ------
+ * 
+ *   lilacmepack [input] [output]
+ *   lilacmepack --text [input] [output]
+ * 
+ * [input] is the path to a Lilac mesh in either format.  It may also be
+ * compressed with gzip, or with Zstandard if built with support for
+ * it, and it may be a mesh within a Lilac mesh archive, given as the
+ * archive path, a colon, and the name of the mesh.
+ * 
+ * [output] is the path to the file to write.  By default, the mesh is
+ * written in the compact binary mesh format.  With the --text option,
+ * it is written as a Shastina text mesh instead.  See MeshCompact.md in
+ * the documentation folder for the compact binary mesh format.
+ * 
+ * Compilation
+ * -----------
+ * 
+ * Build this program together with the lilac_mesh.c, lilac_source.c,
+ * lilac_archive.c, lilac_pack.c, lilac_parse.c, and lilac_trace.c
+ * modules of Lilac, Shastina, zlib, and pthreads.  To read
+ * Zstandard-compressed meshes, also define LILAC_SOURCE_ZSTD and link
+ * with libzstd.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lilac_mesh.h"
+#include "lilac_pack.h"
+#include "lilac_parse.h"
+#include "lilac_source.h"
+#include "shastina.h"
+
+/*
+ * Local data
+ * ----------
+ */
+
+/*
+ * The name of this executable module.
+ * 
+ * This is set at the start of the program entrypoint.  It should be
+ * included in error reports from the program.
+ */
+static const char *pModule = NULL;
+
+/*
+ * Local functions
+ * ---------------
+ */
+
+/* Prototypes */
+static LILAC_MESH *loadMesh(const char *pPath);
+
+/*
+ * Load a mesh in either format with lilac_parse_load().
+ * 
+ * Errors are reported on standard error.
+ * 
+ * Parameters:
+ * 
+ *   pPath - the path to the mesh
+ * 
+ * Return:
+ * 
+ *   the mesh, or NULL if failure
+ */
+static LILAC_MESH *loadMesh(const char *pPath) {
+  
+  int srcerr = 0;
+  int errcode = 0;
+  long line_num = 0;
+  LILAC_MESH *pMesh = NULL;
+  
+  pMesh = lilac_parse_load(pPath, 1, &srcerr, &errcode, &line_num);
+  if (pMesh == NULL) {
+    if (srcerr) {
+      fprintf(stderr, "%s: %s!\n", pModule, lilac_source_errstr(srcerr));
+    } else if (line_num > 0) {
+      fprintf(stderr, "%s: [line %ld] %s!\n",
+                pModule, line_num, lilac_mesh_errstr(errcode));
+    } else {
+      fprintf(stderr, "%s: %s!\n", pModule, lilac_mesh_errstr(errcode));
+    }
+  }
+  
+  return pMesh;
+}
+
+/*
+ * Program entrypoint
+ * ------------------
+ */
+
+int main(int argc, char *argv[]) {
+  
+  int status = 1;
+  int x = 0;
+  int text = 0;
+  int argi = 1;
+  size_t len = 0;
+  const char *pInPath = NULL;
+  const char *pOutPath = NULL;
+  
+  unsigned char *pPacked = NULL;
+  LILAC_MESH *pMesh = NULL;
+  FILE *pOut = NULL;
+  
+  /* Get module name */
+  pModule = NULL;
+  if ((argc > 0) && (argv != NULL)) {
+    pModule = argv[0];
+  }
+  if (pModule == NULL) {
+    pModule = "lilacmepack";
+  }
+  
+  /* Check argv */
+  if (argc > 0) {
+    if (argv == NULL) {
+      abort();
+    }
+    for(x = 0; x < argc; x++) {
+      if (argv[x] == NULL) {
+        abort();
+      }
+    }
+  }
+  
+  /* Get the option, if present */
+  if ((argc > 1) && (strcmp(argv[1], "--text") == 0)) {
+    text = 1;
+    argi = 2;
+  }
+  
+  /* Check number of parameters */
+  if (argc - argi != 2) {
+    status = 0;
+    fprintf(stderr, "%s: Wrong number of arguments!\n", pModule);
+  }
+  
+  /* Get the program arguments */
+  if (status) {
+    pInPath = argv[argi];
+    pOutPath = argv[argi + 1];
+  }
+  
+  /* Load the mesh */
+  if (status) {
+    pMesh = loadMesh(pInPath);
+    if (pMesh == NULL) {
+      status = 0;
+    }
+  }
+  
+  /* Write the output file */
+  if (status) {
+    pOut = fopen(pOutPath, "wb");
+    if (pOut == NULL) {
+      status = 0;
+      fprintf(stderr, "%s: Can't create output file!\n", pModule);
+    }
+  }
+  
+  if (status) {
+    if (text) {
+      status = lilac_mesh_write(pMesh, pOut);
+  
+    } else {
+      pPacked = lilac_pack_encode(pMesh, &len);
+      if (fwrite(pPacked, 1, len, pOut) != len) {
+        status = 0;
+      }
+      free(pPacked);
+      pPacked = NULL;
+    }
+  
+    if (fclose(pOut)) {
+      status = 0;
+    }
+    pOut = NULL;
+  
+    if (!status) {
+      fprintf(stderr, "%s: Failed to write output file!\n", pModule);
+    }
+  }
+  
+  /* Release the mesh object if allocated */
+  lilac_mesh_free(pMesh);
+  pMesh = NULL;
+  
+  /* Invert status and return */
+  if (status) {
+    status = 0;
+  } else {
+    status = 1;
+  }
+  return status;
+}